@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+namespace reshade
+{
+	/// <summary>
+	/// Collects the statistics of executed command lists in one tracker per thread, so that threads executing command lists on different queues do not block each other, and merges them into a single tracker once per frame.
+	/// </summary>
+	/// <typeparam name="TTracker">The tracker type, which needs to be default constructible and have "reset()" and "merge(const TTracker &amp;)" methods.</typeparam>
+	template <typename TTracker>
+	class buffer_detection_accumulator
+	{
+	public:
+		buffer_detection_accumulator() : _id(s_next_id++) {}
+
+		/// <summary>
+		/// Adds the statistics of an executed command list to the tracker of the calling thread.
+		/// </summary>
+		void merge(const TTracker &source)
+		{
+			thread_stats &thread = current_thread_stats();
+
+			// Only the thread itself and 'flush' ever lock this, so it is practically never contended
+			const std::lock_guard<std::mutex> lock(thread.mutex);
+			thread.stats.merge(source);
+			thread.sequence.store(++_sequence, std::memory_order_relaxed);
+			thread.empty = false;
+		}
+
+		/// <summary>
+		/// Merges the statistics that were collected by all threads since the last call into the specified tracker and removes the trackers of threads that exited.
+		/// Threads are merged in the order they last executed a command list, so that state a tracker inherits from a merge (like the bound depth-stencil) is the one of the command list that was executed last.
+		/// </summary>
+		void flush(TTracker &target)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			// Take a snapshot of the order first, since threads may keep executing command lists while this sorts
+			for (const auto &thread : _threads)
+				thread->flush_sequence = thread->sequence.load(std::memory_order_relaxed);
+			std::sort(_threads.begin(), _threads.end(),
+				[](const auto &lhs, const auto &rhs) { return lhs->flush_sequence < rhs->flush_sequence; });
+
+			for (auto it = _threads.begin(); it != _threads.end();)
+			{
+				thread_stats &thread = **it;
+
+				// Check this before merging, since a thread that exited cannot add anything afterwards, but one that is about to may still do so until then
+				const bool exited = thread.owner.expired();
+
+				{
+					const std::lock_guard<std::mutex> thread_lock(thread.mutex);
+					if (!thread.empty)
+					{
+						target.merge(thread.stats);
+
+						// This keeps the memory of the tracker around, so that the next frame does not have to allocate again
+						thread.stats.reset();
+						thread.empty = true;
+					}
+				}
+
+				if (exited)
+					it = _threads.erase(it);
+				else
+					++it;
+			}
+		}
+
+		/// <summary>
+		/// Drops the statistics of all threads, e.g. of command lists that were executed but never presented.
+		/// </summary>
+		void clear()
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			for (const auto &thread : _threads)
+			{
+				const std::lock_guard<std::mutex> thread_lock(thread->mutex);
+				thread->stats.reset();
+				thread->empty = true;
+			}
+		}
+
+		/// <summary>
+		/// Returns the number of threads that currently have a tracker.
+		/// </summary>
+		size_t num_threads()
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+			return _threads.size();
+		}
+
+	private:
+		struct thread_stats
+		{
+			explicit thread_stats(const std::shared_ptr<void> &owner) : owner(owner) {}
+
+			std::mutex mutex;
+			const std::weak_ptr<void> owner;
+			std::atomic<uint64_t> sequence = 0;
+			uint64_t flush_sequence = 0;
+			TTracker stats;
+			bool empty = true;
+		};
+
+		/// <summary>
+		/// Returns a token that lives as long as the calling thread, so that the trackers of threads that exited can be found and removed.
+		/// Thread IDs cannot be used for this, since a new thread may get the ID of one that exited.
+		/// </summary>
+		static const std::shared_ptr<void> &current_thread_token()
+		{
+			thread_local const std::shared_ptr<void> s_token = std::make_shared<char>();
+			return s_token;
+		}
+
+		thread_stats &current_thread_stats()
+		{
+			// Remember the tracker of the accumulator that was used last on this thread, which is usually the only one
+			// That tracker is only ever removed after this thread exited, so the pointer stays valid as long as it can be used
+			thread_local std::pair<uint64_t, thread_stats *> s_last_thread_stats = { 0, nullptr };
+			if (s_last_thread_stats.first == _id)
+				return *s_last_thread_stats.second;
+
+			const std::shared_ptr<void> &token = current_thread_token();
+
+			const std::lock_guard<std::mutex> lock(_mutex);
+
+			const auto it = std::find_if(_threads.begin(), _threads.end(),
+				[&token](const auto &thread) { return !thread->owner.owner_before(token) && !token.owner_before(thread->owner); });
+			thread_stats *const thread = it != _threads.end() ? it->get() : _threads.emplace_back(std::make_unique<thread_stats>(token)).get();
+
+			s_last_thread_stats = { _id, thread };
+			return *thread;
+		}
+
+		// Used to tell apart the thread caches of different accumulators, since a new accumulator may be created at the address of a destroyed one
+		static inline std::atomic<uint64_t> s_next_id = 1;
+		const uint64_t _id;
+		std::atomic<uint64_t> _sequence = 0;
+		std::mutex _mutex;
+		std::vector<std::unique_ptr<thread_stats>> _threads;
+	};
+}
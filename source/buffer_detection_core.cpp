@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "buffer_detection_core.hpp"
+#include <cmath>
+
+reshade::draw_stats *reshade::draw_stats_arena::allocate(size_t count)
+{
+	// Move on to the next block if the current one is full, and add a new one if there is none that is large enough
+	while (_block < _blocks.size() && _offset + count > _blocks[_block].size)
+		_block++, _offset = 0;
+	if (_block == _blocks.size())
+		_blocks.push_back({ std::max(count, block_size), std::make_unique<draw_stats[]>(std::max(count, block_size)) });
+
+	draw_stats *const result = _blocks[_block].data.get() + _offset;
+	_offset += count;
+	return result;
+}
+
+void reshade::clear_list::push_back(draw_stats_arena &arena, const draw_stats &stats)
+{
+	if (_size == _capacity)
+	{
+		// Grow into a new allocation, the old one is simply left behind until the arena is reset at the end of the frame
+		_capacity = std::max(_capacity * 2, 4u);
+		draw_stats *const new_data = arena.allocate(_capacity);
+		std::copy_n(_data, _size, new_data);
+		_data = new_data;
+	}
+
+	_data[_size++] = stats;
+}
+
+bool reshade::check_depthstencil_fit(uint32_t frame_width, uint32_t frame_height, uint32_t width, uint32_t height)
+{
+	const float w = static_cast<float>(frame_width);
+	const float w_ratio = w / width;
+	const float h = static_cast<float>(frame_height);
+	const float h_ratio = h / height;
+	const float aspect_ratio = (w / h) - (static_cast<float>(width) / height);
+
+	return std::fabs(aspect_ratio) <= 0.1f && w_ratio <= 1.85f && h_ratio <= 1.85f && w_ratio >= 0.5f && h_ratio >= 0.5f;
+}
@@ -0,0 +1,619 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include "buffer_detection_trace.hpp"
+
+namespace reshade
+{
+	struct draw_stats
+	{
+		uint32_t vertices = 0;
+		uint32_t drawcalls = 0;
+		bool rect = false;
+	};
+
+	/// <summary>
+	/// Linear allocator for draw statistics that only lives for a single frame.
+	/// Memory is kept around after a reset, so that recording the same workload again does not allocate.
+	/// </summary>
+	class draw_stats_arena
+	{
+	public:
+		/// <summary>
+		/// Returns storage for the specified number of elements, which stays valid until the next <see cref="reset"/>.
+		/// </summary>
+		draw_stats *allocate(size_t count);
+		/// <summary>
+		/// Makes all memory available again, which invalidates everything that was allocated before.
+		/// </summary>
+		void reset() { _block = 0; _offset = 0; }
+
+	private:
+		static constexpr size_t block_size = 256;
+
+		struct block
+		{
+			size_t size;
+			std::unique_ptr<draw_stats[]> data;
+		};
+
+		std::vector<block> _blocks;
+		size_t _block = 0;
+		size_t _offset = 0;
+	};
+
+	/// <summary>
+	/// List of the statistics recorded before every clear of a depth-stencil, allocated from a <see cref="draw_stats_arena"/>.
+	/// Copies of this list share the same storage, so they are only valid until the arena is reset.
+	/// </summary>
+	class clear_list
+	{
+	public:
+		bool empty() const { return _size == 0; }
+		size_t size() const { return _size; }
+
+		const draw_stats &operator[](size_t index) const { assert(index < _size); return _data[index]; }
+		const draw_stats *begin() const { return _data; }
+		const draw_stats *end() const { return _data + _size; }
+
+		void push_back(draw_stats_arena &arena, const draw_stats &stats);
+
+	private:
+		draw_stats *_data = nullptr;
+		uint32_t _size = 0;
+		uint32_t _capacity = 0;
+	};
+
+	/// <summary>
+	/// Hash map with open addressing that stores its values densely in insertion order, so that iteration is fast and the order is guaranteed.
+	/// References to values are invalidated by insertion and erasure, just like with "std::vector".
+	/// </summary>
+	template <typename TKey, typename TValue>
+	class flat_hash_map
+	{
+	public:
+		using value_type = std::pair<TKey, TValue>;
+
+		bool empty() const { return _values.empty(); }
+		size_t size() const { return _values.size(); }
+
+		auto begin() { return _values.begin(); }
+		auto begin() const { return _values.begin(); }
+		auto end() { return _values.end(); }
+		auto end() const { return _values.end(); }
+
+		/// <summary>
+		/// Removes all entries, but keeps the memory around for reuse.
+		/// </summary>
+		void clear()
+		{
+			_values.clear();
+			std::fill(_slots.begin(), _slots.end(), 0u);
+		}
+
+		TValue *find(const TKey &key)
+		{
+			const size_t slot = find_slot(key);
+			return _slots.empty() || _slots[slot] == 0 ? nullptr : &_values[_slots[slot] - 1].second;
+		}
+		const TValue *find(const TKey &key) const
+		{
+			return const_cast<flat_hash_map *>(this)->find(key);
+		}
+
+		/// <summary>
+		/// Returns the value associated with the specified <paramref name="key"/>, and adds a default constructed one if it did not exist yet.
+		/// </summary>
+		TValue &operator[](const TKey &key)
+		{
+			return try_emplace(key).first;
+		}
+		/// <summary>
+		/// Returns the value associated with the specified <paramref name="key"/> and whether it was added by this call.
+		/// </summary>
+		std::pair<TValue &, bool> try_emplace(const TKey &key)
+		{
+			// Keep the load factor below one half, so that searches stay short
+			if ((_values.size() + 1) * 2 > _slots.size())
+				rehash(std::max<size_t>(16, _slots.size() * 2));
+
+			const size_t slot = find_slot(key);
+			if (_slots[slot] != 0)
+				return { _values[_slots[slot] - 1].second, false };
+
+			_values.emplace_back(key, TValue());
+			_slots[slot] = static_cast<uint32_t>(_values.size());
+			return { _values.back().second, true };
+		}
+
+		bool erase(const TKey &key)
+		{
+			if (_slots.empty())
+				return false;
+
+			size_t slot = find_slot(key);
+			if (_slots[slot] == 0)
+				return false;
+
+			// Move the last value into the gap, so that values stay dense
+			if (const uint32_t index = _slots[slot] - 1; index + 1 != _values.size())
+			{
+				_slots[find_slot(_values.back().first)] = index + 1;
+				_values[index] = std::move(_values.back());
+			}
+			_values.pop_back();
+
+			// Shift following entries back into the freed slot, so that no tombstones are needed
+			const size_t mask = _slots.size() - 1;
+			for (size_t next = (slot + 1) & mask; _slots[next] != 0; next = (next + 1) & mask)
+			{
+				const size_t home = hash(_values[_slots[next] - 1].first) & mask;
+				if (((next - home) & mask) >= ((next - slot) & mask))
+				{
+					_slots[slot] = _slots[next];
+					slot = next;
+				}
+			}
+			_slots[slot] = 0;
+
+			return true;
+		}
+
+	private:
+		static size_t hash(const TKey &key)
+		{
+			// Handles are usually pointers or indices with little entropy in the low bits, so mix all bits into them
+			uint64_t h = static_cast<uint64_t>(std::hash<TKey>()(key));
+			h ^= h >> 33;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 33;
+			return static_cast<size_t>(h);
+		}
+
+		size_t find_slot(const TKey &key) const
+		{
+			if (_slots.empty())
+				return 0;
+
+			const size_t mask = _slots.size() - 1;
+			size_t slot = hash(key) & mask;
+			while (_slots[slot] != 0 && !(_values[_slots[slot] - 1].first == key))
+				slot = (slot + 1) & mask;
+			return slot;
+		}
+
+		void rehash(size_t new_size)
+		{
+			_slots.assign(new_size, 0u);
+			for (size_t i = 0; i < _values.size(); ++i)
+				_slots[find_slot(_values[i].first)] = static_cast<uint32_t>(i + 1);
+		}
+
+		std::vector<value_type> _values;
+		// Index into the value list plus one, or zero for an empty slot
+		std::vector<uint32_t> _slots;
+	};
+
+	/// <summary>
+	/// Description of a depth-stencil resource, as needed to decide whether it is a candidate for the main scene depth buffer.
+	/// </summary>
+	struct depthstencil_desc
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t samples = 1;
+	};
+
+	enum class depthstencil_selection
+	{
+		// Weigh the number of vertices against the fraction of draw calls that went to a depth-stencil
+		weighted_vertices,
+		// Choose the depth-stencil with the most vertices (or draw calls, if some of them were indirect)
+		most_vertices,
+	};
+
+	/// <summary>
+	/// Checks whether a depth-stencil with the specified dimensions could belong to a frame with the specified dimensions.
+	/// </summary>
+	bool check_depthstencil_fit(uint32_t frame_width, uint32_t frame_height, uint32_t width, uint32_t height);
+
+	struct no_depthstencil_data {};
+
+	/// <summary>
+	/// The API-agnostic part of the depth buffer detection, which counts draw calls and clears per depth-stencil and picks the one most likely to be the main scene depth buffer.
+	/// </summary>
+	/// <typeparam name="THandle">Opaque handle that identifies a depth-stencil resource. It needs to be comparable and hashable with "std::hash".</typeparam>
+	/// <typeparam name="TData">Additional API-specific data to store for every depth-stencil.</typeparam>
+	template <typename THandle, typename TData = no_depthstencil_data>
+	class buffer_detection_core
+	{
+	public:
+		struct depthstencil_info : TData
+		{
+			draw_stats total_stats;
+			draw_stats current_stats; // Stats since last clear
+			clear_list clears;
+		};
+
+		uint32_t total_vertices() const { return _stats.vertices; }
+		uint32_t total_drawcalls() const { return _stats.drawcalls; }
+
+		const auto &depth_buffer_counters() const { return _counters_per_used_depthstencil; }
+
+		/// <summary>
+		/// Starts recording all events this tracker receives to a trace file (see <see cref="trace_event_type"/> for the format), which can be replayed to test changes to the heuristics.
+		/// </summary>
+		/// <param name="path">The path to the trace file to create.</param>
+		/// <param name="num_frames">The number of frames after which recording stops again.</param>
+		/// <returns><c>true</c> if recording started, <c>false</c> if the trace file could not be created.</returns>
+		bool start_trace(const std::filesystem::path &path, uint32_t num_frames)
+		{
+			_trace = std::make_unique<buffer_detection_trace>();
+			if (_trace->open(path, num_frames))
+				return true;
+
+			_trace.reset();
+			return false;
+		}
+		/// <summary>
+		/// Returns whether events are currently recorded to a trace file.
+		/// </summary>
+		bool is_tracing() const { return _trace != nullptr && _trace->is_open(); }
+
+		/// <summary>
+		/// Removes all depth-stencils and statistics at the start of a new frame (or command list).
+		/// </summary>
+		void reset_core()
+		{
+			trace(trace_event_type::reset);
+
+			_stats = { 0, 0 };
+			_has_indirect_drawcalls = false;
+			_counters_per_used_depthstencil.clear();
+			_clear_arena.reset();
+		}
+		/// <summary>
+		/// Resets the statistics of all depth-stencils, but keeps the depth-stencils themselves around.
+		/// </summary>
+		void reset_core_stats()
+		{
+			trace(trace_event_type::reset_stats);
+
+			_stats = { 0, 0 };
+			_has_indirect_drawcalls = false;
+			for (auto &[handle, counters] : _counters_per_used_depthstencil)
+				counters.total_stats = counters.current_stats = { 0, 0 }, counters.clears = clear_list();
+			_clear_arena.reset();
+		}
+
+		/// <summary>
+		/// Adds the statistics of another tracker (e.g. of a command list that was executed) to this one.
+		/// </summary>
+		void merge_core(const buffer_detection_core &source)
+		{
+			merge_core(source._stats, source._has_indirect_drawcalls);
+
+			for (const auto &[handle, snapshot] : source._counters_per_used_depthstencil)
+				merge_core(handle, snapshot);
+		}
+		/// <summary>
+		/// Adds the totals of another tracker to this one.
+		/// </summary>
+		void merge_core(const draw_stats &stats, bool has_indirect_drawcalls)
+		{
+			trace(trace_event_type::merge_totals, 0, stats.vertices, stats.drawcalls, has_indirect_drawcalls);
+
+			_stats.vertices += stats.vertices;
+			_stats.drawcalls += stats.drawcalls;
+			_has_indirect_drawcalls |= has_indirect_drawcalls;
+		}
+		/// <summary>
+		/// Adds the statistics of a depth-stencil in another tracker to this one.
+		/// </summary>
+		void merge_core(const THandle &handle, const depthstencil_info &snapshot)
+		{
+			trace(trace_event_type::merge, selection_key(handle), snapshot.total_stats.vertices, snapshot.total_stats.drawcalls, snapshot.current_stats.vertices, snapshot.current_stats.drawcalls);
+
+			auto [target_snapshot, inserted] = _counters_per_used_depthstencil.try_emplace(handle);
+			if (inserted)
+				static_cast<TData &>(target_snapshot) = snapshot;
+
+			target_snapshot.total_stats.vertices += snapshot.total_stats.vertices;
+			target_snapshot.total_stats.drawcalls += snapshot.total_stats.drawcalls;
+			target_snapshot.current_stats.vertices += snapshot.current_stats.vertices;
+			target_snapshot.current_stats.drawcalls += snapshot.current_stats.drawcalls;
+
+			// The clears of the source live in a different arena, so copy them into this one
+			for (const draw_stats &clear_stats : snapshot.clears)
+				target_snapshot.clears.push_back(_clear_arena, clear_stats);
+		}
+
+		/// <summary>
+		/// Counts a draw call in the totals of the frame.
+		/// </summary>
+		void count_draw(uint32_t vertices)
+		{
+			trace(trace_event_type::draw, 0, vertices);
+
+			_stats.vertices += vertices;
+			_stats.drawcalls += 1;
+		}
+		/// <summary>
+		/// Counts a draw call to the specified depth-stencil (in addition to <see cref="count_draw(uint32_t)"/>).
+		/// </summary>
+		depthstencil_info &count_draw(const THandle &handle, uint32_t vertices, bool count_since_clear = true)
+		{
+			trace(trace_event_type::draw_to, selection_key(handle), vertices, count_since_clear);
+
+			return count_draw(_counters_per_used_depthstencil[handle], vertices, count_since_clear);
+		}
+
+		/// <summary>
+		/// Stores the statistics since the last clear of a depth-stencil in its list of clears.
+		/// The caller still has to reset the statistics since the last clear afterwards, but can look at them and the list of clears before doing so.
+		/// </summary>
+		void count_clear(const THandle &handle, depthstencil_info &counters)
+		{
+			trace(trace_event_type::clear, selection_key(handle), counters.current_stats.vertices, counters.current_stats.drawcalls);
+
+			counters.clears.push_back(_clear_arena, counters.current_stats);
+		}
+
+		/// <summary>
+		/// Returns the depth-stencil that is currently bound, or an empty handle if there is none.
+		/// </summary>
+		const THandle &current_depthstencil() const { return _current_depthstencil; }
+		/// <summary>
+		/// Remembers the depth-stencil that is bound by the application, so that draw calls do not have to query it from the API again.
+		/// This has to be called whenever the binding changes, including when the state is cleared.
+		/// </summary>
+		void set_current_depthstencil(THandle handle)
+		{
+			trace(trace_event_type::set, selection_key(handle));
+
+			_current_depthstencil = std::move(handle);
+		}
+		/// <summary>
+		/// Counts a draw call to the currently bound depth-stencil (in addition to <see cref="count_draw(uint32_t)"/>).
+		/// </summary>
+		/// <returns>A pointer to the statistics of the depth-stencil, or <c>nullptr</c> if none is bound.</returns>
+		depthstencil_info *count_draw_current(uint32_t vertices, bool count_since_clear = true)
+		{
+			if (_current_depthstencil == THandle())
+				return nullptr; // This is a draw call with no depth-stencil bound
+
+			trace(trace_event_type::draw_current, 0, vertices, count_since_clear);
+
+			return &count_draw(_counters_per_used_depthstencil[_current_depthstencil], vertices, count_since_clear);
+		}
+
+		/// <summary>
+		/// Finds the depth-stencil that most likely contains the main scene. Call this once per frame.
+		/// Candidates are scored with statistics that are smoothed over multiple frames, and the selection only switches to a different depth-stencil once it scores notably better for several frames in a row.
+		/// This avoids flipping between depth-stencils with similar workloads, which would cause the runtime to recreate its resources every time.
+		/// </summary>
+		/// <param name="width">Width of the frame, or zero to accept depth-stencils of any dimensions.</param>
+		/// <param name="height">Height of the frame, or zero to accept depth-stencils of any dimensions.</param>
+		/// <param name="selection">The heuristic to use.</param>
+		/// <param name="describe">Callback that fills in the description of a depth-stencil, or returns <c>false</c> to skip it.</param>
+		/// <returns>A pointer to the best entry, or <c>nullptr</c> if there was no suitable depth-stencil.</returns>
+		template <typename F>
+		const std::pair<THandle, depthstencil_info> *select_best(uint32_t width, uint32_t height, depthstencil_selection selection, F describe)
+		{
+			if (!is_tracing())
+				return select_best_untraced(width, height, selection, describe);
+
+			trace(trace_event_type::select, 0, width, height, static_cast<uint32_t>(selection));
+
+			// Record the description of every candidate too, so that the selection can be replayed without the resources
+			const auto best = select_best_untraced(width, height, selection, [this, &describe](const THandle &handle, const depthstencil_info &snapshot, depthstencil_desc &desc) {
+				const bool result = describe(handle, snapshot, desc);
+				if (result)
+					trace(trace_event_type::desc, selection_key(handle), desc.width, desc.height, desc.samples);
+				else
+					trace(trace_event_type::skip, selection_key(handle));
+				return result;
+			});
+
+			trace(trace_event_type::selected, best != nullptr ? selection_key(best->first) : 0);
+
+			return best;
+		}
+
+		/// <summary>
+		/// Forgets the history of previous selections, so that the next call to <see cref="select_best"/> starts from scratch.
+		/// </summary>
+		void reset_selection()
+		{
+			_selection_history.clear();
+			_has_selection = false;
+			_challenger_frames = 0;
+		}
+
+		// Weight of the statistics of the current frame in the smoothed score
+		static constexpr float selection_smoothing = 0.25f;
+		// Fraction by which another depth-stencil has to score better than the selected one to be considered for a switch
+		static constexpr float selection_margin = 0.15f;
+		// Number of frames in a row another depth-stencil has to score better before the selection switches to it
+		static constexpr uint32_t selection_switch_frames = 10;
+		// Number of frames after which the history of a depth-stencil that was not used is dropped
+		static constexpr uint32_t selection_history_frames = 30;
+
+	protected:
+		draw_stats _stats;
+		bool _has_indirect_drawcalls = false;
+		THandle _current_depthstencil = THandle();
+		draw_stats_arena _clear_arena;
+		flat_hash_map<THandle, depthstencil_info> _counters_per_used_depthstencil;
+
+	private:
+		depthstencil_info &count_draw(depthstencil_info &counters, uint32_t vertices, bool count_since_clear)
+		{
+			counters.total_stats.vertices += vertices;
+			counters.total_stats.drawcalls += 1;
+
+			// Indirect draw calls do not report a vertex count
+			if (vertices == 0)
+				_has_indirect_drawcalls = true;
+
+			if (count_since_clear)
+			{
+				counters.current_stats.vertices += vertices;
+				counters.current_stats.drawcalls += 1;
+			}
+
+			return counters;
+		}
+
+		template <typename F>
+		const std::pair<THandle, depthstencil_info> *select_best_untraced(uint32_t width, uint32_t height, depthstencil_selection selection, F describe)
+		{
+			// Decay the history of all depth-stencils, including those that were not used this frame
+			for (auto &[handle, history] : _selection_history)
+			{
+				history.score *= 1.0f - selection_smoothing;
+				history.unused_frames++;
+			}
+
+			const std::pair<THandle, depthstencil_info> *leader = nullptr;
+			const std::pair<THandle, depthstencil_info> *selected = nullptr;
+			float leader_score = 0.0f;
+
+			for (const auto &entry : _counters_per_used_depthstencil)
+			{
+				const draw_stats &stats = entry.second.total_stats;
+				if (stats.drawcalls == 0 || (selection == depthstencil_selection::weighted_vertices && stats.vertices == 0))
+					continue; // Skip unused
+
+				depthstencil_desc desc;
+				if (!describe(entry.first, entry.second, desc))
+					continue;
+				if (desc.samples > 1)
+					continue; // Ignore MSAA textures, since they would need to be resolved first
+				if (width != 0 && height != 0 && !check_depthstencil_fit(width, height, desc.width, desc.height))
+					continue; // Not a good fit
+
+				const uint64_t key = selection_key(entry.first);
+
+				// A depth-stencil without history starts with the score of this frame, instead of catching up from zero (which would e.g. keep the selection away from a depth-stencil that was just recreated after a resize)
+				auto [history, inserted] = _selection_history.try_emplace(key);
+				history.score = inserted ? score(stats, selection) : history.score + selection_smoothing * score(stats, selection);
+				history.unused_frames = 0;
+
+				if (leader == nullptr || history.score > leader_score)
+				{
+					leader = &entry;
+					leader_score = history.score;
+				}
+
+				if (_has_selection && key == _selected)
+					selected = &entry;
+			}
+
+			// Forget about depth-stencils that have not been used in a while, so that the history does not grow indefinitely
+			for (size_t i = 0; i < _selection_history.size();)
+			{
+				if (const auto &[key, history] = _selection_history.begin()[i]; history.unused_frames > selection_history_frames)
+					_selection_history.erase(uint64_t(key)); // This moves the last entry into the current position, so check it again
+				else
+					i++;
+			}
+
+			if (leader == nullptr)
+			{
+				reset_selection();
+				return nullptr;
+			}
+
+			// Switch right away if there is no previous selection or it cannot be used this frame
+			if (selected == nullptr)
+			{
+				_selected = selection_key(leader->first);
+				_has_selection = true;
+				_challenger_frames = 0;
+				return leader;
+			}
+
+			if (leader != selected && leader_score > _selection_history.find(_selected)->score * (1.0f + selection_margin))
+			{
+				if (const uint64_t leader_key = selection_key(leader->first); _challenger_frames == 0 || _challenger != leader_key)
+				{
+					_challenger = leader_key;
+					_challenger_frames = 0;
+				}
+
+				if (++_challenger_frames >= selection_switch_frames)
+				{
+					_selected = _challenger;
+					_challenger_frames = 0;
+					return leader;
+				}
+			}
+			else
+			{
+				_challenger_frames = 0;
+			}
+
+			return selected;
+		}
+
+		struct selection_history
+		{
+			float score = 0.0f;
+			uint32_t unused_frames = 0;
+		};
+
+		float score(const draw_stats &stats, depthstencil_selection selection) const
+		{
+			switch (selection)
+			{
+			case depthstencil_selection::weighted_vertices:
+				return stats.vertices * (1.2f - static_cast<float>(stats.drawcalls) / _stats.drawcalls);
+			default:
+				// Vertices may not be accurate if the application is using indirect draw calls, so use draw calls instead in that case
+				return static_cast<float>(!_has_indirect_drawcalls ? stats.vertices : stats.drawcalls);
+			}
+		}
+
+		// Depth-stencils are identified by the raw value of their handle here, so that the history does not keep references to them alive after the application released them
+		// A handle value that is reused for a new depth-stencil before the history of the old one was dropped just inherits its score, which the smoothing corrects within a few frames
+		template <typename T>
+		static uint64_t selection_key(T *handle)
+		{
+			return reinterpret_cast<uintptr_t>(handle);
+		}
+		template <typename T>
+		static uint64_t selection_key(const T &handle)
+		{
+			if constexpr (std::is_integral_v<T>)
+				return static_cast<uint64_t>(handle);
+			else
+				return reinterpret_cast<uintptr_t>(handle.get());
+		}
+
+		void trace(trace_event_type type, uint64_t handle = 0, uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0, uint32_t arg3 = 0)
+		{
+			if (_trace != nullptr)
+				_trace->write({ type, { arg0, arg1, arg2, arg3 }, handle });
+		}
+
+		flat_hash_map<uint64_t, selection_history> _selection_history;
+		uint64_t _selected = 0;
+		bool _has_selection = false;
+		uint64_t _challenger = 0;
+		uint32_t _challenger_frames = 0; // Zero if there is no challenger
+		std::unique_ptr<buffer_detection_trace> _trace;
+	};
+}
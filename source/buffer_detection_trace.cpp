@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "buffer_detection_trace.hpp"
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+
+static const struct
+{
+	const char *name;
+	unsigned int num_args;
+	bool has_handle;
+} s_event_formats[] = {
+	{ "reset", 0, false },
+	{ "reset_stats", 0, false },
+	{ "set", 0, true },
+	{ "draw", 1, false },
+	{ "draw_current", 2, false },
+	{ "draw_to", 2, true },
+	{ "clear", 2, true },
+	{ "merge_totals", 3, false },
+	{ "merge", 4, true },
+	{ "select", 3, false },
+	{ "desc", 3, true },
+	{ "skip", 0, true },
+	{ "selected", 0, true },
+};
+
+static const char s_header[] = "# ReShade depth buffer detection trace 1";
+
+bool reshade::buffer_detection_trace::open(const std::filesystem::path &path, uint32_t num_frames)
+{
+	_file.open(path, std::ios::out | std::ios::trunc);
+	if (!_file.is_open())
+		return false;
+
+	_file << s_header << '\n';
+	_remaining_frames = num_frames;
+	return true;
+}
+
+void reshade::buffer_detection_trace::write(const trace_event &event)
+{
+	if (!_file.is_open())
+		return;
+
+	const auto &format = s_event_formats[static_cast<uint32_t>(event.type)];
+
+	// Format into a local buffer, which is a lot faster than going through the stream operators for every argument
+	char line[128];
+	int length = std::snprintf(line, sizeof(line), "%s", format.name);
+	if (format.has_handle)
+		length += std::snprintf(line + length, sizeof(line) - length, " %llx", static_cast<unsigned long long>(event.handle));
+	for (unsigned int i = 0; i < format.num_args; ++i)
+		length += std::snprintf(line + length, sizeof(line) - length, " %u", event.args[i]);
+	line[length++] = '\n';
+
+	_file.write(line, length);
+
+	if (event.type == trace_event_type::selected && --_remaining_frames == 0)
+		_file.close();
+}
+
+bool reshade::read_buffer_detection_trace(std::istream &stream, std::vector<trace_event> &events, std::string &errors)
+{
+	std::string line;
+	for (size_t line_number = 1; std::getline(stream, line); ++line_number)
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line_number == 1 && line != s_header)
+		{
+			errors = "line 1: not a trace of a supported version";
+			return false;
+		}
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream line_stream(line);
+		std::string name;
+		line_stream >> name;
+
+		trace_event event = {};
+
+		const auto format = std::find_if(std::begin(s_event_formats), std::end(s_event_formats),
+			[&name](const auto &format) { return name == format.name; });
+		if (format == std::end(s_event_formats))
+		{
+			errors = "line " + std::to_string(line_number) + ": unknown event '" + name + '\'';
+			return false;
+		}
+
+		event.type = static_cast<trace_event_type>(format - std::begin(s_event_formats));
+		if (format->has_handle)
+			line_stream >> std::hex >> event.handle >> std::dec;
+		for (unsigned int i = 0; i < format->num_args; ++i)
+			line_stream >> event.args[i];
+
+		if (line_stream.fail() || !(line_stream >> std::ws).eof())
+		{
+			errors = "line " + std::to_string(line_number) + ": invalid arguments for event '" + name + '\'';
+			return false;
+		}
+
+		events.push_back(event);
+	}
+
+	return true;
+}
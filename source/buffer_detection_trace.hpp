@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// Events the depth buffer detection receives, in the order they are recorded to a trace.
+	/// </summary>
+	/// <remarks>
+	/// A trace is a text file with one event per line, which starts with the event name followed by its arguments (handles are written in hexadecimal, everything else in decimal).
+	/// Lines starting with '#' are comments. The first line is "# ReShade depth buffer detection trace 1", where the number is the format version.
+	///   reset                                      Start of a new frame, all depth-stencils and statistics are removed
+	///   reset_stats                                Start of a new frame, only the statistics are reset
+	///   set HANDLE                                 A depth-stencil is bound (zero if none is bound anymore)
+	///   draw VERTICES                              A draw call is made, which is counted in the totals of the frame
+	///   draw_current VERTICES SINCE_CLEAR          The draw call is counted to the bound depth-stencil (SINCE_CLEAR is 1 if it counts toward the statistics since the last clear)
+	///   draw_to HANDLE VERTICES SINCE_CLEAR        The draw call is counted to the specified depth-stencil
+	///   clear HANDLE VERTICES DRAWCALLS            A depth-stencil is cleared, with the statistics since the last clear that were stored for it
+	///   merge_totals VERTICES DRAWCALLS INDIRECT   The totals of an executed command list are added
+	///   merge HANDLE VERTICES DRAWCALLS CURRENT_VERTICES CURRENT_DRAWCALLS
+	///                                              The statistics of a depth-stencil used in an executed command list are added (its clears are not recorded)
+	///   select WIDTH HEIGHT SELECTION              The best depth-stencil is selected for a frame of the specified dimensions (SELECTION is the value of "depthstencil_selection")
+	///   desc HANDLE WIDTH HEIGHT SAMPLES           Description of a candidate depth-stencil during selection
+	///   skip HANDLE                                A candidate depth-stencil that was skipped, because it could not be described
+	///   selected HANDLE                            The result of the selection (zero if there was no suitable depth-stencil)
+	/// </remarks>
+	enum class trace_event_type : uint32_t
+	{
+		reset,
+		reset_stats,
+		set,
+		draw,
+		draw_current,
+		draw_to,
+		clear,
+		merge_totals,
+		merge,
+		select,
+		desc,
+		skip,
+		selected,
+	};
+
+	struct trace_event
+	{
+		trace_event_type type;
+		uint32_t args[4];
+		uint64_t handle;
+	};
+
+	/// <summary>
+	/// Records the events the depth buffer detection receives to a file, so that they can be replayed later.
+	/// </summary>
+	class buffer_detection_trace
+	{
+	public:
+		/// <summary>
+		/// Create the trace file and start recording.
+		/// </summary>
+		/// <param name="path">The path to the trace file to create.</param>
+		/// <param name="num_frames">The number of frames (selections) after which recording stops again.</param>
+		/// <returns><c>true</c> if the file was created, <c>false</c> otherwise.</returns>
+		bool open(const std::filesystem::path &path, uint32_t num_frames);
+		/// <summary>
+		/// Return whether events are still recorded.
+		/// </summary>
+		bool is_open() const { return _file.is_open(); }
+
+		/// <summary>
+		/// Record an event. The file is closed after the selection of the last frame was recorded.
+		/// </summary>
+		void write(const trace_event &event);
+
+	private:
+		std::ofstream _file;
+		uint32_t _remaining_frames = 0;
+	};
+
+	/// <summary>
+	/// Parse a trace that was written by <see cref="buffer_detection_trace"/>.
+	/// </summary>
+	/// <param name="stream">The stream to read the trace from.</param>
+	/// <param name="events">The list to append the events to.</param>
+	/// <param name="errors">Receives a description of the first line that could not be parsed.</param>
+	/// <returns><c>true</c> if the whole trace was read, <c>false</c> otherwise.</returns>
+	bool read_buffer_detection_trace(std::istream &stream, std::vector<trace_event> &events, std::string &errors);
+}
@@ -6,7 +6,6 @@
 #include "dll_log.hpp"
 #include "buffer_detection.hpp"
 #include "dxgi/format_utils.hpp"
-#include <cmath>
 
 #if RESHADE_DEPTH
 static inline com_ptr<ID3D10Texture2D> texture_from_dsv(ID3D10DepthStencilView *dsv)
@@ -22,19 +21,30 @@ static inline com_ptr<ID3D10Texture2D> texture_from_dsv(ID3D10DepthStencilView *
 }
 #endif
 
+reshade::d3d10::buffer_detection::buffer_detection(ID3D10Device *device) :
+	_device(device)
+{
+#if RESHADE_DEPTH
+	// Pick up any depth-stencil that was bound before the device was wrapped, all later changes are tracked through 'on_set_depthstencil'
+	com_ptr<ID3D10DepthStencilView> depthstencil;
+	_device->OMGetRenderTargets(0, nullptr, &depthstencil);
+	on_set_depthstencil(depthstencil.get());
+#endif
+}
+
 void reshade::d3d10::buffer_detection::reset(bool release_resources)
 {
-	_stats = { 0, 0 };
+	reset_core();
 #if RESHADE_DEPTH
 	_best_copy_stats = { 0, 0 };
 	_first_empty_stats = true;
 	_depth_stencil_cleared = false;
-	_counters_per_used_depth_texture.clear();
 
 	if (release_resources)
 	{
 		_previous_stats = { 0, 0 };
 		_depthstencil_clear_texture.reset();
+		reset_selection();
 	}
 #else
 	UNREFERENCED_PARAMETER(release_resources);
@@ -43,15 +53,11 @@ void reshade::d3d10::buffer_detection::reset(bool release_resources)
 
 void reshade::d3d10::buffer_detection::on_draw(UINT vertices)
 {
-	_stats.vertices += vertices;
-	_stats.drawcalls += 1;
+	count_draw(vertices);
 
 #if RESHADE_DEPTH
-	com_ptr<ID3D10DepthStencilView> depthstencil;
-	_device->OMGetRenderTargets(0, nullptr, &depthstencil);
-
-	const auto dsv_texture = texture_from_dsv(depthstencil.get());
-	if (dsv_texture == nullptr)
+	// Use the depth-stencil remembered in 'on_set_depthstencil', instead of querying it from the device on every draw call
+	if (_current_depthstencil == nullptr)
 		return; // This is a draw call with no depth-stencil bound
 
 	// Check if this draw call likely represets a fullscreen rectangle (one or two triangles), which would clear the depth-stencil
@@ -72,33 +78,38 @@ void reshade::d3d10::buffer_detection::on_draw(UINT vertices)
 
 		if (rs_desc.CullMode == D3D10_CULL_NONE && dss_desc.DepthWriteMask == D3D10_DEPTH_WRITE_MASK_ALL && dss_desc.DepthEnable == TRUE && dss_desc.DepthFunc == D3D10_COMPARISON_ALWAYS)
 		{
-			on_clear_depthstencil(D3D10_CLEAR_DEPTH, depthstencil.get(), true);
+			on_clear_depthstencil(D3D10_CLEAR_DEPTH, _current_depthstencil, true);
 
 			_depth_stencil_cleared = false;
 		}
 	}
 
-	auto &counters = _counters_per_used_depth_texture[dsv_texture];
-	counters.total_stats.vertices += vertices;
-	counters.total_stats.drawcalls += 1;
-	counters.current_stats.vertices += vertices;
-	counters.current_stats.drawcalls += 1;
+	count_draw_current(vertices);
 #endif
 }
 
 #if RESHADE_DEPTH
-void reshade::d3d10::buffer_detection::on_clear_depthstencil(UINT clear_flags, ID3D10DepthStencilView *dsv, bool fullscreen_draw_call)
+void reshade::d3d10::buffer_detection::on_set_depthstencil(ID3D10DepthStencilView *dsv)
+{
+	// Holding a reference to the texture here does not extend its lifetime, since the device holds one too for as long as it is bound
+	set_current_depthstencil(texture_from_dsv(dsv));
+}
+
+void reshade::d3d10::buffer_detection::on_clear_depthstencil(UINT clear_flags, ID3D10DepthStencilView *dsv)
+{
+	on_clear_depthstencil(clear_flags, texture_from_dsv(dsv));
+}
+void reshade::d3d10::buffer_detection::on_clear_depthstencil(UINT clear_flags, const com_ptr<ID3D10Texture2D> &dsv_texture, bool fullscreen_draw_call)
 {
 	_depth_stencil_cleared = true;
 
 	if ((clear_flags & D3D10_CLEAR_DEPTH) == 0 || !preserve_depth_buffers)
 		return;
 
-	com_ptr<ID3D10Texture2D> dsv_texture = texture_from_dsv(dsv);
 	if (dsv_texture == nullptr || _depthstencil_clear_texture == nullptr || dsv_texture != depthstencil_clear_index.first)
 		return;
 
-	auto &counters = _counters_per_used_depth_texture[dsv_texture];
+	auto &counters = _counters_per_used_depthstencil[dsv_texture];
 
 	// Update stats with data from previous frame
 	if (!fullscreen_draw_call && counters.current_stats.drawcalls == 0 && _first_empty_stats)
@@ -114,7 +125,7 @@ void reshade::d3d10::buffer_detection::on_clear_depthstencil(UINT clear_flags, I
 	if (fullscreen_draw_call)
 		counters.current_stats.rect = true;
 
-	counters.clears.push_back(counters.current_stats);
+	count_clear(dsv_texture, counters);
 
 	// Make a backup copy of the depth texture before it is cleared
 	if (depthstencil_clear_index.second == 0 ?
@@ -164,43 +175,21 @@ com_ptr<ID3D10Texture2D> reshade::d3d10::buffer_detection::find_best_depth_textu
 	com_ptr<ID3D10Texture2D> best_match = std::move(override);
 	if (best_match != nullptr)
 	{
-		best_snapshot = _counters_per_used_depth_texture[best_match];
+		best_snapshot = _counters_per_used_depthstencil[best_match];
 	}
-	else
-	{
-		for (auto &[dsv_texture, snapshot] : _counters_per_used_depth_texture)
-		{
-			if (snapshot.total_stats.drawcalls == 0)
-				continue; // Skip unused
-
+	else if (const auto best = select_best(width, height, depthstencil_selection::most_vertices,
+		[](const com_ptr<ID3D10Texture2D> &dsv_texture, const depthstencil_info &, depthstencil_desc &result) {
 			D3D10_TEXTURE2D_DESC desc;
 			dsv_texture->GetDesc(&desc);
 			assert((desc.BindFlags & D3D10_BIND_DEPTH_STENCIL) != 0);
+			assert((desc.BindFlags & D3D10_BIND_SHADER_RESOURCE) != 0 || desc.SampleDesc.Count > 1);
 
-			if (desc.SampleDesc.Count > 1)
-				continue; // Ignore MSAA textures, since they would need to be resolved first
-
-			assert((desc.BindFlags & D3D10_BIND_SHADER_RESOURCE) != 0);
-
-			if (width != 0 && height != 0)
-			{
-				const float w = static_cast<float>(width);
-				const float w_ratio = w / desc.Width;
-				const float h = static_cast<float>(height);
-				const float h_ratio = h / desc.Height;
-				const float aspect_ratio = (w / h) - (static_cast<float>(desc.Width) / desc.Height);
-
-				if (std::fabs(aspect_ratio) > 0.1f || w_ratio > 1.85f || h_ratio > 1.85f || w_ratio < 0.5f || h_ratio < 0.5f)
-					continue; // Not a good fit
-			}
-
-			// Choose snapshot with the most vertices, since that is likely to contain the main scene
-			if (snapshot.total_stats.vertices > best_snapshot.total_stats.vertices)
-			{
-				best_match = dsv_texture;
-				best_snapshot = snapshot;
-			}
-		}
+			result = { desc.Width, desc.Height, desc.SampleDesc.Count };
+			return true;
+		}); best != nullptr)
+	{
+		best_match = best->first;
+		best_snapshot = best->second;
 	}
 
 	depthstencil_clear_index.first = best_match.get();
@@ -5,55 +5,38 @@
 
 #pragma once
 
-#include <map>
-#include <vector>
 #include <d3d10_1.h>
 #include "com_ptr.hpp"
+#include "buffer_detection_core.hpp"
 
 namespace reshade::d3d10
 {
-	class buffer_detection
+	class buffer_detection : public buffer_detection_core<com_ptr<ID3D10Texture2D>>
 	{
 	public:
-		struct draw_stats
-		{
-			UINT vertices = 0;
-			UINT drawcalls = 0;
-			bool rect = false;
-		};
-		struct depthstencil_info
-		{
-			draw_stats total_stats;
-			draw_stats current_stats; // Stats since last clear
-			std::vector<draw_stats> clears;
-		};
-
-		explicit buffer_detection(ID3D10Device *device) : _device(device) {}
-
-		UINT total_vertices() const { return _stats.vertices; }
-		UINT total_drawcalls() const { return _stats.drawcalls; }
+		explicit buffer_detection(ID3D10Device *device);
 
 		void reset(bool release_resources);
 
 		void on_draw(UINT vertices);
 #if RESHADE_DEPTH
-		void on_clear_depthstencil(UINT clear_flags, ID3D10DepthStencilView *dsv, bool rect_draw_call = false);
+		void on_set_depthstencil(ID3D10DepthStencilView *dsv);
+		void on_clear_depthstencil(UINT clear_flags, ID3D10DepthStencilView *dsv);
 
 		// Detection Settings
 		bool preserve_depth_buffers = false;
 		std::pair<ID3D10Texture2D *, UINT> depthstencil_clear_index = { nullptr, 0 };
 
-		const auto &depth_buffer_counters() const { return _counters_per_used_depth_texture; }
-
 		com_ptr<ID3D10Texture2D> find_best_depth_texture(UINT width, UINT height,
 			com_ptr<ID3D10Texture2D> override = nullptr);
 #endif
 
 	private:
-		draw_stats _stats;
 		ID3D10Device *const _device;
 
 #if RESHADE_DEPTH
+		void on_clear_depthstencil(UINT clear_flags, const com_ptr<ID3D10Texture2D> &dsv_texture, bool fullscreen_draw_call = false);
+
 		bool update_depthstencil_clear_texture(D3D10_TEXTURE2D_DESC desc);
 
 		draw_stats _previous_stats;
@@ -61,8 +44,6 @@ namespace reshade::d3d10
 		bool _first_empty_stats = true;
 		bool _depth_stencil_cleared = false;
 		com_ptr<ID3D10Texture2D> _depthstencil_clear_texture;
-		// Use "std::map" instead of "std::unordered_map" so that the iteration order is guaranteed
-		std::map<com_ptr<ID3D10Texture2D>, depthstencil_info> _counters_per_used_depth_texture;
 #endif
 	};
 }
@@ -172,6 +172,9 @@ void    STDMETHODCALLTYPE D3D10Device::GSSetSamplers(UINT StartSlot, UINT NumSam
 void    STDMETHODCALLTYPE D3D10Device::OMSetRenderTargets(UINT NumViews, ID3D10RenderTargetView *const *ppRenderTargetViews, ID3D10DepthStencilView *pDepthStencilView)
 {
 	_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+#if RESHADE_DEPTH
+	_buffer_detection.on_set_depthstencil(pDepthStencilView);
+#endif
 }
 void    STDMETHODCALLTYPE D3D10Device::OMSetBlendState(ID3D10BlendState *pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
 {
@@ -356,6 +359,9 @@ HRESULT STDMETHODCALLTYPE D3D10Device::SetPrivateDataInterface(REFGUID guid, con
 void    STDMETHODCALLTYPE D3D10Device::ClearState()
 {
 	_orig->ClearState();
+#if RESHADE_DEPTH
+	_buffer_detection.on_set_depthstencil(nullptr);
+#endif
 }
 void    STDMETHODCALLTYPE D3D10Device::Flush()
 {
@@ -8,11 +8,15 @@
 #include "runtime_d3d10.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "frame_profiler.hpp"
+#include "pixel_conversion.hpp"
 #include "dxgi/format_utils.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
 
+extern std::filesystem::path g_reshade_dll_path;
+
 namespace reshade::d3d10
 {
 	struct d3d10_tex_data
@@ -344,27 +348,17 @@ bool reshade::d3d10::runtime_d3d10::capture_screenshot(uint8_t *buffer) const
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-			}
+			pixel::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width);
+		}
+		else if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+			_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, pitch);
-
-			if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-				_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
 
@@ -905,16 +899,13 @@ void reshade::d3d10::runtime_d3d10::upload_texture(const texture &texture, const
 	case reshadefx::texture_format::r8:
 		upload_pitch = texture.width;
 		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 1)
-			upload_data[k] = pixels[i];
+		pixel::convert_rgba8_to_r8(upload_data.data(), pixels, texture.width * texture.height);
 		pixels = upload_data.data();
 		break;
 	case reshadefx::texture_format::rg8:
 		upload_pitch = texture.width * 2;
 		upload_data.resize(upload_pitch * texture.height);
-		for (uint32_t i = 0, k = 0; i < texture.width * texture.height * 4; i += 4, k += 2)
-			upload_data[k + 0] = pixels[i + 0],
-			upload_data[k + 1] = pixels[i + 1];
+		pixel::convert_rgba8_to_rg8(upload_data.data(), pixels, texture.width * texture.height);
 		pixels = upload_data.data();
 		break;
 	case reshadefx::texture_format::rgba8:
@@ -952,7 +943,12 @@ void reshade::d3d10::runtime_d3d10::render_technique(technique &technique)
 			impl->timestamp_query_end->GetData(&timestamp1, sizeof(timestamp1), D3D10_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
 		{
 			if (!disjoint.Disjoint)
-				technique.average_gpu_duration.append((timestamp1 - timestamp0) * 1'000'000'000 / disjoint.Frequency);
+			{
+				const uint64_t duration = (timestamp1 - timestamp0) * 1'000'000'000 / disjoint.Frequency;
+				technique.average_gpu_duration.append(duration);
+				technique.gpu_statistics.append(duration);
+				_profiler->add_gpu_event(technique.name, duration);
+			}
 			impl->query_in_flight = false;
 		}
 	}
@@ -977,11 +973,16 @@ void reshade::d3d10::runtime_d3d10::render_technique(technique &technique)
 	// Setup shader constants
 	if (ID3D10Buffer *const cb = effect_data.cb.get(); cb != nullptr)
 	{
-		if (void *mapped;
-			SUCCEEDED(cb->Map(D3D10_MAP_WRITE_DISCARD, 0, &mapped)))
+		// Discarding the buffer requires all of it to be rewritten, so only skip the upload when nothing changed since the last technique of this effect was rendered
+		if (effect &effect = _effects[technique.effect_index]; effect.is_uniform_data_dirty())
 		{
-			std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), _effects[technique.effect_index].uniform_data_storage.size());
-			cb->Unmap();
+			if (void *mapped;
+				SUCCEEDED(cb->Map(D3D10_MAP_WRITE_DISCARD, 0, &mapped)))
+			{
+				std::memcpy(mapped, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+				cb->Unmap();
+				effect.clear_uniform_data_dirty();
+			}
 		}
 
 		_device->VSSetConstantBuffers(0, 1, &cb);
@@ -996,6 +997,11 @@ void reshade::d3d10::runtime_d3d10::render_technique(technique &technique)
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
+		if (technique.culled_passes[pass_index])
+			continue; // Skip passes whose output is never used
+
+		const frame_profiler::scope profile(*_profiler, "Pass", static_cast<uint32_t>(pass_index));
+
 		if (needs_implicit_backbuffer_copy)
 		{
 			// Save back buffer of previous pass
@@ -1333,6 +1339,15 @@ void reshade::d3d10::runtime_d3d10::draw_depth_debug_menu(buffer_detection &trac
 	if (modified) // Detection settings have changed, reset heuristic
 		tracker.reset(true);
 
+	if (tracker.is_tracing())
+		ImGui::TextUnformatted("Recording depth buffer detection trace ...");
+	else if (ImGui::Button("Record trace of the next 300 frames", ImVec2(-1, 0)))
+	{
+		// Traces can be replayed with the "buffer_detection_replay" tool in the tests, to find out how changes to the heuristics would affect the selection
+		if (const std::filesystem::path trace_path = g_reshade_dll_path.parent_path() / L"ReShade_depth.trace"; !tracker.start_trace(trace_path, 300))
+			LOG(ERROR) << "Failed to create depth buffer detection trace " << trace_path << '.';
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
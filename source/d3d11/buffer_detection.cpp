@@ -6,7 +6,6 @@
 #include "dll_log.hpp"
 #include "buffer_detection.hpp"
 #include "dxgi/format_utils.hpp"
-#include <cmath>
 
 #if RESHADE_DEPTH
 static inline com_ptr<ID3D11Texture2D> texture_from_dsv(ID3D11DepthStencilView *dsv)
@@ -26,17 +25,22 @@ void reshade::d3d11::buffer_detection::init(ID3D11DeviceContext *device_context,
 {
 	_device_context = device_context;
 	_context = context;
+
+#if RESHADE_DEPTH
+	// Pick up any depth-stencil that was bound before the device context was wrapped, all later changes are tracked through 'on_set_depthstencil'
+	com_ptr<ID3D11DepthStencilView> depthstencil;
+	_device_context->OMGetRenderTargets(0, nullptr, &depthstencil);
+	on_set_depthstencil(depthstencil.get());
+#endif
 }
 
 void reshade::d3d11::buffer_detection::reset()
 {
-	_stats = { 0, 0 };
+	reset_core();
 #if RESHADE_DEPTH
 	_best_copy_stats = { 0, 0 };
 	_first_empty_stats = true;
 	_depth_stencil_cleared = false;
-	_has_indirect_drawcalls = false;
-	_counters_per_used_depth_texture.clear();
 #endif
 }
 void reshade::d3d11::buffer_detection_context::reset(bool release_resources)
@@ -51,6 +55,7 @@ void reshade::d3d11::buffer_detection_context::reset(bool release_resources)
 		assert(_context == this);
 
 		_previous_stats = { 0, 0 };
+		reset_selection();
 		_depthstencil_clear_texture.reset();
 	}
 #else
@@ -60,47 +65,26 @@ void reshade::d3d11::buffer_detection_context::reset(bool release_resources)
 
 void reshade::d3d11::buffer_detection::merge(const buffer_detection &source)
 {
-	_stats.vertices += source._stats.vertices;
-	_stats.drawcalls += source._stats.drawcalls;
+	merge_core(source);
 
 #if RESHADE_DEPTH
 	_first_empty_stats |= source._first_empty_stats;
 	_depth_stencil_cleared |= source._depth_stencil_cleared;
-	_has_indirect_drawcalls |= source._has_indirect_drawcalls;
 
 	if (source._best_copy_stats.vertices > _best_copy_stats.vertices)
 		_best_copy_stats = source._best_copy_stats;
-
-	for (const auto &[dsv_texture, snapshot] : source._counters_per_used_depth_texture)
-	{
-		auto &target_snapshot = _counters_per_used_depth_texture[dsv_texture];
-		target_snapshot.total_stats.vertices += snapshot.total_stats.vertices;
-		target_snapshot.total_stats.drawcalls += snapshot.total_stats.drawcalls;
-		target_snapshot.current_stats.vertices += snapshot.current_stats.vertices;
-		target_snapshot.current_stats.drawcalls += snapshot.current_stats.drawcalls;
-
-		target_snapshot.clears.insert(target_snapshot.clears.end(), snapshot.clears.begin(), snapshot.clears.end());
-	}
 #endif
 }
 
 void reshade::d3d11::buffer_detection::on_draw(UINT vertices)
 {
-	_stats.vertices += vertices;
-	_stats.drawcalls += 1;
+	count_draw(vertices);
 
 #if RESHADE_DEPTH
-	com_ptr<ID3D11DepthStencilView> depthstencil;
-	_device_context->OMGetRenderTargets(0, nullptr, &depthstencil);
-
-	const auto dsv_texture = texture_from_dsv(depthstencil.get());
-	if (dsv_texture == nullptr)
+	// Use the depth-stencil remembered in 'on_set_depthstencil', instead of querying it from the device context on every draw call
+	if (_current_depthstencil == nullptr)
 		return; // This is a draw call with no depth-stencil bound
 
-	// See 'D3D11DeviceContext::DrawInstancedIndirect' and 'D3D11DeviceContext::DrawIndexedInstancedIndirect'
-	if (vertices == 0)
-		_has_indirect_drawcalls = true;
-
 	// Check if this draw call likely represets a fullscreen rectangle (one or two triangles), which would clear the depth-stencil
 	if (_context->preserve_depth_buffers && vertices <= 6 && _depth_stencil_cleared)
 	{
@@ -119,22 +103,29 @@ void reshade::d3d11::buffer_detection::on_draw(UINT vertices)
 
 		if (rs_desc.CullMode == D3D11_CULL_NONE && dss_desc.DepthWriteMask == D3D11_DEPTH_WRITE_MASK_ALL && dss_desc.DepthEnable == TRUE && dss_desc.DepthFunc == D3D11_COMPARISON_ALWAYS)
 		{
-			on_clear_depthstencil(D3D11_CLEAR_DEPTH, depthstencil.get(), true);
+			on_clear_depthstencil(D3D11_CLEAR_DEPTH, _current_depthstencil, true);
 
 			_depth_stencil_cleared = false;
 		}
 	}
 
-	auto &counters = _counters_per_used_depth_texture[dsv_texture];
-	counters.total_stats.vertices += vertices;
-	counters.total_stats.drawcalls += 1;
-	counters.current_stats.vertices += vertices;
-	counters.current_stats.drawcalls += 1;
+	// Indirect draw calls are counted with zero vertices (see 'D3D11DeviceContext::DrawInstancedIndirect' and 'D3D11DeviceContext::DrawIndexedInstancedIndirect')
+	count_draw_current(vertices);
 #endif
 }
 
 #if RESHADE_DEPTH
-void reshade::d3d11::buffer_detection::on_clear_depthstencil(UINT clear_flags, ID3D11DepthStencilView *dsv, bool fullscreen_draw_call)
+void reshade::d3d11::buffer_detection::on_set_depthstencil(ID3D11DepthStencilView *dsv)
+{
+	// Holding a reference to the texture here does not extend its lifetime, since the device context holds one too for as long as it is bound
+	set_current_depthstencil(texture_from_dsv(dsv));
+}
+
+void reshade::d3d11::buffer_detection::on_clear_depthstencil(UINT clear_flags, ID3D11DepthStencilView *dsv)
+{
+	on_clear_depthstencil(clear_flags, texture_from_dsv(dsv));
+}
+void reshade::d3d11::buffer_detection::on_clear_depthstencil(UINT clear_flags, const com_ptr<ID3D11Texture2D> &dsv_texture, bool fullscreen_draw_call)
 {
 	assert(_context != nullptr);
 
@@ -143,11 +134,10 @@ void reshade::d3d11::buffer_detection::on_clear_depthstencil(UINT clear_flags, I
 	if ((clear_flags & D3D11_CLEAR_DEPTH) == 0 || !_context->preserve_depth_buffers)
 		return;
 
-	com_ptr<ID3D11Texture2D> dsv_texture = texture_from_dsv(dsv);
 	if (dsv_texture == nullptr || _context->_depthstencil_clear_texture == nullptr || dsv_texture != _context->depthstencil_clear_index.first)
 		return;
 
-	auto &counters = _counters_per_used_depth_texture[dsv_texture];
+	auto &counters = _counters_per_used_depthstencil[dsv_texture];
 
 	// Update stats with data from previous frame
 	if (!fullscreen_draw_call && counters.current_stats.drawcalls == 0 && _first_empty_stats)
@@ -163,7 +153,7 @@ void reshade::d3d11::buffer_detection::on_clear_depthstencil(UINT clear_flags, I
 	if (fullscreen_draw_call)
 		counters.current_stats.rect = true;
 
-	counters.clears.push_back(counters.current_stats);
+	count_clear(dsv_texture, counters);
 
 	// Make a backup copy of the depth texture before it is cleared
 	if (_context->depthstencil_clear_index.second == 0 ?
@@ -219,46 +209,21 @@ com_ptr<ID3D11Texture2D> reshade::d3d11::buffer_detection_context::find_best_dep
 	com_ptr<ID3D11Texture2D> best_match = std::move(override);
 	if (best_match != nullptr)
 	{
-		best_snapshot = _counters_per_used_depth_texture[best_match];
+		best_snapshot = _counters_per_used_depthstencil[best_match];
 	}
-	else
-	{
-		for (auto &[dsv_texture, snapshot] : _counters_per_used_depth_texture)
-		{
-			if (snapshot.total_stats.drawcalls == 0)
-				continue; // Skip unused
-
+	else if (const auto best = select_best(width, height, depthstencil_selection::most_vertices,
+		[](const com_ptr<ID3D11Texture2D> &dsv_texture, const depthstencil_info &, depthstencil_desc &result) {
 			D3D11_TEXTURE2D_DESC desc;
 			dsv_texture->GetDesc(&desc);
 			assert((desc.BindFlags & D3D11_BIND_DEPTH_STENCIL) != 0);
+			assert((desc.BindFlags & D3D11_BIND_SHADER_RESOURCE) != 0 || desc.SampleDesc.Count > 1);
 
-			if (desc.SampleDesc.Count > 1)
-				continue; // Ignore MSAA textures, since they would need to be resolved first
-
-			assert((desc.BindFlags & D3D11_BIND_SHADER_RESOURCE) != 0);
-
-			if (width != 0 && height != 0)
-			{
-				const float w = static_cast<float>(width);
-				const float w_ratio = w / desc.Width;
-				const float h = static_cast<float>(height);
-				const float h_ratio = h / desc.Height;
-				const float aspect_ratio = (w / h) - (static_cast<float>(desc.Width) / desc.Height);
-
-				if (std::fabs(aspect_ratio) > 0.1f || w_ratio > 1.85f || h_ratio > 1.85f || w_ratio < 0.5f || h_ratio < 0.5f)
-					continue; // Not a good fit
-			}
-
-			if (!_has_indirect_drawcalls ?
-				// Choose snapshot with the most vertices, since that is likely to contain the main scene
-				snapshot.total_stats.vertices > best_snapshot.total_stats.vertices :
-				// Or check draw calls, since vertices may not be accurate if application is using indirect draw calls
-				snapshot.total_stats.drawcalls > best_snapshot.total_stats.drawcalls)
-			{
-				best_match = dsv_texture;
-				best_snapshot = snapshot;
-			}
-		}
+			result = { desc.Width, desc.Height, desc.SampleDesc.Count };
+			return true;
+		}); best != nullptr)
+	{
+		best_match = best->first;
+		best_snapshot = best->second;
 	}
 
 	depthstencil_clear_index.first = best_match.get();
@@ -248,10 +248,18 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::GSSetSamplers(UINT StartSlot, UINT
 void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargets(UINT NumViews, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView)
 {
 	_orig->OMSetRenderTargets(NumViews, ppRenderTargetViews, pDepthStencilView);
+#if RESHADE_DEPTH
+	_buffer_detection.on_set_depthstencil(pDepthStencilView);
+#endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetRenderTargetsAndUnorderedAccessViews(UINT NumRTVs, ID3D11RenderTargetView *const *ppRenderTargetViews, ID3D11DepthStencilView *pDepthStencilView, UINT UAVStartSlot, UINT NumUAVs, ID3D11UnorderedAccessView *const *ppUnorderedAccessViews, const UINT *pUAVInitialCounts)
 {
 	_orig->OMSetRenderTargetsAndUnorderedAccessViews(NumRTVs, ppRenderTargetViews, pDepthStencilView, UAVStartSlot, NumUAVs, ppUnorderedAccessViews, pUAVInitialCounts);
+#if RESHADE_DEPTH
+	// The depth-stencil is left unchanged when only unordered access views are updated
+	if (NumRTVs != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL)
+		_buffer_detection.on_set_depthstencil(pDepthStencilView);
+#endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::OMSetBlendState(ID3D11BlendState *pBlendState, const FLOAT BlendFactor[4], UINT SampleMask)
 {
@@ -364,6 +372,12 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::ExecuteCommandList(ID3D11CommandLi
 
 	// Get original command list pointer from proxy object and execute with it
 	_orig->ExecuteCommandList(command_list_proxy->_orig, RestoreContextState);
+
+#if RESHADE_DEPTH
+	// The device context is reset to its default state afterwards if the previous state is not restored
+	if (!RestoreContextState)
+		_buffer_detection.on_set_depthstencil(nullptr);
+#endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::HSSetShaderResources(UINT StartSlot, UINT NumViews, ID3D11ShaderResourceView *const *ppShaderResourceViews)
 {
@@ -572,6 +586,9 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::CSGetConstantBuffers(UINT StartSlo
 void    STDMETHODCALLTYPE D3D11DeviceContext::ClearState()
 {
 	_orig->ClearState();
+#if RESHADE_DEPTH
+	_buffer_detection.on_set_depthstencil(nullptr);
+#endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::Flush()
 {
@@ -597,6 +614,12 @@ HRESULT STDMETHODCALLTYPE D3D11DeviceContext::FinishCommandList(BOOL RestoreDefe
 	// All statistics are now stored in the command list tracker, so reset current tracker here
 	_buffer_detection.reset(false);
 
+#if RESHADE_DEPTH
+	// The deferred context is reset to its default state if the previous state is not restored
+	if (!RestoreDeferredContextState)
+		_buffer_detection.on_set_depthstencil(nullptr);
+#endif
+
 	return hr;
 }
 D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE D3D11DeviceContext::GetType()
@@ -688,6 +711,13 @@ void    STDMETHODCALLTYPE D3D11DeviceContext::SwapDeviceContextState(ID3DDeviceC
 {
 	assert(_interface_version >= 1);
 	static_cast<ID3D11DeviceContext1 *>(_orig)->SwapDeviceContextState(pState, ppPreviousState);
+
+#if RESHADE_DEPTH
+	// The new state object may have any depth-stencil bound, so query it once
+	com_ptr<ID3D11DepthStencilView> depthstencil;
+	_orig->OMGetRenderTargets(0, nullptr, &depthstencil);
+	_buffer_detection.on_set_depthstencil(depthstencil.get());
+#endif
 }
 void    STDMETHODCALLTYPE D3D11DeviceContext::ClearView(ID3D11View *pView, const FLOAT Color[4], const D3D11_RECT *pRect, UINT NumRects)
 {
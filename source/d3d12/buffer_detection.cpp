@@ -7,10 +7,14 @@
 #include "buffer_detection.hpp"
 #include "dxgi/format_utils.hpp"
 #include <mutex>
-#include <cmath>
 
 static std::mutex s_global_mutex;
 
+reshade::d3d12::buffer_detection_context::buffer_detection_context(ID3D12Device *device)
+{
+	init(device, nullptr, nullptr);
+}
+
 void reshade::d3d12::buffer_detection::init(ID3D12Device *device, ID3D12GraphicsCommandList *cmd_list, const buffer_detection_context *context)
 {
 	_device = device;
@@ -20,13 +24,11 @@ void reshade::d3d12::buffer_detection::init(ID3D12Device *device, ID3D12Graphics
 
 void reshade::d3d12::buffer_detection::reset()
 {
-	_stats = { 0, 0 };
+	reset_core();
 #if RESHADE_DEPTH
 	_best_copy_stats = { 0, 0 };
 	_current_depthstencil.reset();
 	_first_empty_stats = true;
-	_has_indirect_drawcalls = false;
-	_counters_per_used_depth_texture.clear();
 #endif
 }
 void reshade::d3d12::buffer_detection_context::reset(bool release_resources)
@@ -41,6 +43,10 @@ void reshade::d3d12::buffer_detection_context::reset(bool release_resources)
 		assert(_context == this);
 
 		_previous_stats = { 0, 0 };
+		reset_selection();
+
+		// Drop statistics of command lists that were executed but never presented
+		_deferred.clear();
 
 		// Can only destroy this when it is guaranteed to no longer be in use
 		_depthstencil_clear_texture.reset();
@@ -53,56 +59,42 @@ void reshade::d3d12::buffer_detection_context::reset(bool release_resources)
 
 void reshade::d3d12::buffer_detection::merge(const buffer_detection &source)
 {
-	_stats.vertices += source._stats.vertices;
-	_stats.drawcalls += source._stats.drawcalls;
+	merge_core(source);
 
 #if RESHADE_DEPTH
 	// Executing a command list in a different command list inherits state
 	_current_depthstencil = source._current_depthstencil;
 
 	_first_empty_stats |= source._first_empty_stats;
-	_has_indirect_drawcalls |= source._has_indirect_drawcalls;
 
 	if (source._best_copy_stats.vertices > _best_copy_stats.vertices)
 		_best_copy_stats = source._best_copy_stats;
+#endif
+}
 
-	for (const auto &[dsv_texture, snapshot] : source._counters_per_used_depth_texture)
-	{
-		auto &target_snapshot = _counters_per_used_depth_texture[dsv_texture];
-		target_snapshot.total_stats.vertices += snapshot.total_stats.vertices;
-		target_snapshot.total_stats.drawcalls += snapshot.total_stats.drawcalls;
-		target_snapshot.current_stats.vertices += snapshot.current_stats.vertices;
-		target_snapshot.current_stats.drawcalls += snapshot.current_stats.drawcalls;
+void reshade::d3d12::buffer_detection_context::merge_deferred(const buffer_detection &source)
+{
+	_deferred.merge(source);
+}
 
-		target_snapshot.clears.insert(target_snapshot.clears.end(), snapshot.clears.begin(), snapshot.clears.end());
-	}
-#endif
+void reshade::d3d12::buffer_detection_context::flush_deferred()
+{
+	_deferred.flush(*this);
 }
 
 void reshade::d3d12::buffer_detection::on_draw(UINT vertices)
 {
-	_stats.vertices += vertices;
-	_stats.drawcalls += 1;
+	count_draw(vertices);
 
 #if RESHADE_DEPTH
-	if (_current_depthstencil == nullptr)
-		return; // This is a draw call with no depth-stencil bound
-
-	auto &counters = _counters_per_used_depth_texture[_current_depthstencil];
-	counters.total_stats.vertices += vertices;
-	counters.total_stats.drawcalls += 1;
-	counters.current_stats.vertices += vertices;
-	counters.current_stats.drawcalls += 1;
-
-	if (vertices == 0)
-		_has_indirect_drawcalls = true;
+	count_draw_current(vertices);
 #endif
 }
 
 #if RESHADE_DEPTH
 void reshade::d3d12::buffer_detection::on_set_depthstencil(D3D12_CPU_DESCRIPTOR_HANDLE dsv)
 {
-	_current_depthstencil = _context->resource_from_handle(dsv);
+	set_current_depthstencil(_context->resource_from_handle(dsv));
 }
 void reshade::d3d12::buffer_detection::on_clear_depthstencil(D3D12_CLEAR_FLAGS clear_flags, D3D12_CPU_DESCRIPTOR_HANDLE dsv)
 {
@@ -115,7 +107,7 @@ void reshade::d3d12::buffer_detection::on_clear_depthstencil(D3D12_CLEAR_FLAGS c
 	if (dsv_texture == nullptr || _context->_depthstencil_clear_texture == nullptr || dsv_texture != _context->depthstencil_clear_index.first)
 		return;
 
-	auto &counters = _counters_per_used_depth_texture[dsv_texture];
+	auto &counters = _counters_per_used_depthstencil[dsv_texture];
 
 	// Update stats with data from previous frame
 	if (counters.current_stats.drawcalls == 0 && _first_empty_stats)
@@ -128,7 +120,7 @@ void reshade::d3d12::buffer_detection::on_clear_depthstencil(D3D12_CLEAR_FLAGS c
 	if (counters.current_stats.drawcalls == 0)
 		return;
 
-	counters.clears.push_back(counters.current_stats);
+	count_clear(dsv_texture, counters);
 
 	// Make a backup copy of the depth texture before it is cleared
 	if (_context->depthstencil_clear_index.second == 0 ?
@@ -224,43 +216,19 @@ com_ptr<ID3D12Resource> reshade::d3d12::buffer_detection_context::update_depth_t
 	com_ptr<ID3D12Resource> best_match = override;
 	if (best_match != nullptr)
 	{
-		best_snapshot = _counters_per_used_depth_texture[best_match];
+		best_snapshot = _counters_per_used_depthstencil[best_match];
 	}
-	else
-	{
-		for (auto &[dsv_texture, snapshot] : _counters_per_used_depth_texture)
-		{
-			if (snapshot.total_stats.drawcalls == 0)
-				continue; // Skip unused
-
+	else if (const auto best = select_best(width, height, depthstencil_selection::most_vertices,
+		[](const com_ptr<ID3D12Resource> &dsv_texture, const depthstencil_info &, depthstencil_desc &result) {
 			const D3D12_RESOURCE_DESC desc = dsv_texture->GetDesc();
 			assert((desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0);
 
-			if (desc.SampleDesc.Count > 1)
-				continue; // Ignore MSAA textures, since they would need to be resolved first
-
-			if (width != 0 && height != 0)
-			{
-				const float w = static_cast<float>(width);
-				const float w_ratio = w / desc.Width;
-				const float h = static_cast<float>(height);
-				const float h_ratio = h / desc.Height;
-				const float aspect_ratio = (w / h) - (static_cast<float>(desc.Width) / desc.Height);
-
-				if (std::fabs(aspect_ratio) > 0.1f || w_ratio > 1.85f || h_ratio > 1.85f || w_ratio < 0.5f || h_ratio < 0.5f)
-					continue; // Not a good fit
-			}
-
-			if (!_has_indirect_drawcalls ?
-				// Choose snapshot with the most vertices, since that is likely to contain the main scene
-				snapshot.total_stats.vertices > best_snapshot.total_stats.vertices :
-				// Or check draw calls, since vertices may not be accurate if application is using indirect draw calls
-				snapshot.total_stats.drawcalls > best_snapshot.total_stats.drawcalls)
-			{
-				best_match = dsv_texture;
-				best_snapshot = snapshot;
-			}
-		}
+			result = { static_cast<uint32_t>(desc.Width), desc.Height, desc.SampleDesc.Count };
+			return true;
+		}); best != nullptr)
+	{
+		best_match = best->first;
+		best_snapshot = best->second;
 	}
 
 	depthstencil_clear_index.first = best_match.get();
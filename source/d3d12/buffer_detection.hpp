@@ -5,29 +5,17 @@
 
 #pragma once
 
-#include <map>
-#include <vector>
 #include <unordered_map>
 #include <d3d12.h>
 #include "com_ptr.hpp"
+#include "buffer_detection_core.hpp"
+#include "buffer_detection_accumulator.hpp"
 
 namespace reshade::d3d12
 {
-	class buffer_detection
+	class buffer_detection : public buffer_detection_core<com_ptr<ID3D12Resource>>
 	{
 	public:
-		struct draw_stats
-		{
-			UINT vertices = 0;
-			UINT drawcalls = 0;
-		};
-		struct depthstencil_info
-		{
-			draw_stats total_stats;
-			draw_stats current_stats; // Stats since last clear
-			std::vector<draw_stats> clears;
-		};
-
 		void init(ID3D12Device *device, ID3D12GraphicsCommandList *cmd_list, const class buffer_detection_context *context);
 		void reset();
 
@@ -40,17 +28,12 @@ namespace reshade::d3d12
 #endif
 
 	protected:
-		draw_stats _stats;
 		ID3D12Device *_device = nullptr;
 		ID3D12GraphicsCommandList *_cmd_list = nullptr;
 		const buffer_detection_context *_context = nullptr;
 #if RESHADE_DEPTH
 		draw_stats _best_copy_stats;
-		com_ptr<ID3D12Resource> _current_depthstencil;
 		bool _first_empty_stats = false;
-		bool _has_indirect_drawcalls = false;
-		// Use "std::map" instead of "std::unordered_map" so that the iteration order is guaranteed
-		std::map<com_ptr<ID3D12Resource>, depthstencil_info> _counters_per_used_depth_texture;
 #endif
 	};
 
@@ -59,13 +42,19 @@ namespace reshade::d3d12
 		friend class buffer_detection;
 
 	public:
-		explicit buffer_detection_context(ID3D12Device *device) { init(device, nullptr, nullptr); }
-
-		UINT total_vertices() const { return _stats.vertices; }
-		UINT total_drawcalls() const { return _stats.drawcalls; }
+		explicit buffer_detection_context(ID3D12Device *device);
 
 		void reset(bool release_resources);
 
+		/// <summary>
+		/// Adds the statistics of an executed command list to an accumulator of the calling thread, so that threads executing command lists do not block each other.
+		/// </summary>
+		void merge_deferred(const buffer_detection &source);
+		/// <summary>
+		/// Merges the statistics that were accumulated by all threads since the last call into this tracker. Call this once per frame before presenting.
+		/// </summary>
+		void flush_deferred();
+
 #if RESHADE_DEPTH
 		void on_create_dsv(ID3D12Resource *dsv_texture, D3D12_CPU_DESCRIPTOR_HANDLE handle);
 
@@ -73,14 +62,14 @@ namespace reshade::d3d12
 		bool preserve_depth_buffers = false;
 		std::pair<ID3D12Resource *, UINT> depthstencil_clear_index = { nullptr, 0 };
 
-		const auto &depth_buffer_counters() const { return _counters_per_used_depth_texture; }
-
 		com_ptr<ID3D12Resource> update_depth_texture(ID3D12CommandQueue *queue, ID3D12GraphicsCommandList *list,
 			UINT width, UINT height,
 			ID3D12Resource *override = nullptr);
 #endif
 
 	private:
+		buffer_detection_accumulator<buffer_detection> _deferred;
+
 #if RESHADE_DEPTH
 		com_ptr<ID3D12Resource> resource_from_handle(D3D12_CPU_DESCRIPTOR_HANDLE handle) const;
 
@@ -8,9 +8,6 @@
 #include "d3d12_command_list.hpp"
 #include "d3d12_command_queue.hpp"
 #include "d3d12_command_queue_downlevel.hpp"
-#include <mutex>
-
-static std::mutex s_global_mutex;
 
 D3D12CommandQueue::D3D12CommandQueue(D3D12Device *device, ID3D12CommandQueue *original) :
 	_orig(original),
@@ -150,11 +147,8 @@ void    STDMETHODCALLTYPE D3D12CommandQueue::ExecuteCommandLists(UINT NumCommand
 		if (com_ptr<D3D12GraphicsCommandList> command_list_proxy;
 			SUCCEEDED(ppCommandLists[i]->QueryInterface(&command_list_proxy)))
 		{
-			// Lock here in case there are multiple command queues
-			const std::lock_guard<std::mutex> lock(s_global_mutex);
-
-			// Merge command list trackers into device one
-			_device->_buffer_detection.merge(command_list_proxy->_buffer_detection);
+			// Merge command list trackers into device one (through an accumulator of this thread, which is only merged into the device one on present)
+			_device->_buffer_detection.merge_deferred(command_list_proxy->_buffer_detection);
 
 			// Get original command list pointer from proxy object
 			command_lists[i] = command_list_proxy->_orig;
@@ -87,6 +87,9 @@ HRESULT STDMETHODCALLTYPE D3D12CommandQueueDownlevel::Present(ID3D12GraphicsComm
 			LOG(ERROR) << "Failed to initialize Direct3D 12 runtime environment on runtime " << _runtime.get() << '.';
 	}
 
+	// Collect stats of all command lists executed this frame
+	_device->_buffer_detection.flush_deferred();
+
 	_runtime->on_present();
 
 	// Clear current frame stats
@@ -9,11 +9,15 @@
 #include "runtime_d3d12.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "frame_profiler.hpp"
+#include "pixel_conversion.hpp"
 #include "dxgi/format_utils.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
 
+extern std::filesystem::path g_reshade_dll_path;
+
 #define D3D12_RESOURCE_STATE_SHADER_RESOURCE \
 	(D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
 
@@ -477,27 +481,17 @@ bool reshade::d3d12::runtime_d3d12::capture_screenshot(uint8_t *buffer) const
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < data_pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-			}
+			pixel::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width);
+		}
+		else if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+			_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, data_pitch);
-
-			if (_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM ||
-				_backbuffer_format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < data_pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
 
@@ -631,6 +625,9 @@ bool reshade::d3d12::runtime_d3d12::init_effect(size_t index)
 		effect_data.cb->SetName(L"ReShade constant buffer");
 #endif
 		effect_data.cbv_gpu_address = effect_data.cb->GetGPUVirtualAddress();
+
+		// The buffer is created without initial data, so upload everything before it is used the first time
+		effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 	}
 
 	{   D3D12_DESCRIPTOR_HEAP_DESC desc = { D3D12_DESCRIPTOR_HEAP_TYPE_RTV };
@@ -1202,14 +1199,11 @@ void reshade::d3d12::runtime_d3d12::upload_texture(const texture &texture, const
 	{
 	case reshadefx::texture_format::r8:
 		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x] = pixels[x * 4];
+			pixel::convert_rgba8_to_r8(mapped_data, pixels, texture.width);
 		break;
 	case reshadefx::texture_format::rg8:
 		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
-			for (uint32_t x = 0; x < texture.width; ++x)
-				mapped_data[x * 2 + 0] = pixels[x * 4 + 0],
-				mapped_data[x * 2 + 1] = pixels[x * 4 + 1];
+			pixel::convert_rgba8_to_rg8(mapped_data, pixels, texture.width);
 		break;
 	case reshadefx::texture_format::rgba8:
 		for (uint32_t y = 0; y < texture.height; ++y, mapped_data += upload_pitch, pixels += data_pitch)
@@ -1309,11 +1303,19 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 	// Setup shader constants
 	if (effect_data.cb != nullptr)
 	{
-		if (void *mapped;
-			SUCCEEDED(effect_data.cb->Map(0, nullptr, &mapped)))
+		// Only update the range that was modified since the last technique of this effect was rendered
+		if (effect &effect = _effects[technique.effect_index]; effect.is_uniform_data_dirty())
 		{
-			std::memcpy(mapped, _effects[technique.effect_index].uniform_data_storage.data(), _effects[technique.effect_index].uniform_data_storage.size());
-			effect_data.cb->Unmap(0, nullptr);
+			const D3D12_RANGE written_range = { effect.uniform_data_dirty_begin, effect.uniform_data_dirty_end };
+			const D3D12_RANGE read_range = { 0, 0 };
+
+			if (uint8_t *mapped;
+				SUCCEEDED(effect_data.cb->Map(0, &read_range, reinterpret_cast<void **>(&mapped))))
+			{
+				std::memcpy(mapped + written_range.Begin, effect.uniform_data_storage.data() + written_range.Begin, written_range.End - written_range.Begin);
+				effect_data.cb->Unmap(0, &written_range);
+				effect.clear_uniform_data_dirty();
+			}
 		}
 
 		_cmd_list->SetGraphicsRootConstantBufferView(0, effect_data.cbv_gpu_address);
@@ -1341,6 +1343,11 @@ void reshade::d3d12::runtime_d3d12::render_technique(technique &technique)
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
+		if (technique.culled_passes[pass_index])
+			continue; // Skip passes whose output is never used
+
+		const frame_profiler::scope profile(*_profiler, "Pass", static_cast<uint32_t>(pass_index));
+
 		if (needs_implicit_backbuffer_copy)
 		{
 			// Save back buffer of previous pass
@@ -1739,6 +1746,15 @@ void reshade::d3d12::runtime_d3d12::draw_depth_debug_menu(buffer_detection_conte
 		// Do not release resources here, as they may still be in use on the device
 		tracker.reset(false);
 
+	if (tracker.is_tracing())
+		ImGui::TextUnformatted("Recording depth buffer detection trace ...");
+	else if (ImGui::Button("Record trace of the next 300 frames", ImVec2(-1, 0)))
+	{
+		// Traces can be replayed with the "buffer_detection_replay" tool in the tests, to find out how changes to the heuristics would affect the selection
+		if (const std::filesystem::path trace_path = g_reshade_dll_path.parent_path() / L"ReShade_depth.trace"; !tracker.start_trace(trace_path, 300))
+			LOG(ERROR) << "Failed to create depth buffer detection trace " << trace_path << '.';
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
@@ -13,13 +13,13 @@ static constexpr auto D3DFMT_DF24 = static_cast<D3DFORMAT>(MAKEFOURCC('D', 'F',
 
 void reshade::d3d9::buffer_detection::reset(bool release_resources)
 {
-	_stats = { 0, 0 };
+	reset_core();
 #if RESHADE_DEPTH
-	_counters_per_used_depth_surface.clear();
 
 	if (release_resources)
 	{
 		update_depthstencil_replacement(nullptr);
+		reset_selection();
 	}
 	else if (preserve_depth_buffers && _depthstencil_replacement != nullptr)
 	{
@@ -58,8 +58,7 @@ void reshade::d3d9::buffer_detection::on_draw(D3DPRIMITIVETYPE type, UINT vertic
 		break;
 	}
 
-	_stats.vertices += vertices;
-	_stats.drawcalls += 1;
+	count_draw(vertices);
 
 #if RESHADE_DEPTH
 	com_ptr<IDirect3DSurface9> depthstencil;
@@ -68,11 +67,7 @@ void reshade::d3d9::buffer_detection::on_draw(D3DPRIMITIVETYPE type, UINT vertic
 	if (depthstencil == nullptr)
 		return; // This is a draw call with no depth-stencil bound
 
-	// Update draw statistics for tracked depth-stencil surfaces
-	auto &counters = _counters_per_used_depth_surface[depthstencil == _depthstencil_replacement ? _depthstencil_original : depthstencil];
-	counters.total_stats.vertices += vertices;
-	counters.total_stats.drawcalls += 1;
-
+	bool count_since_clear = false;
 	if (preserve_depth_buffers && _depthstencil_replacement != nullptr)
 	{
 		D3DVIEWPORT9 viewport;
@@ -80,12 +75,12 @@ void reshade::d3d9::buffer_detection::on_draw(D3DPRIMITIVETYPE type, UINT vertic
 		D3DSURFACE_DESC depthstencil_desc;
 		_depthstencil_replacement->GetDesc(&depthstencil_desc);
 
-		if (!check_aspect_ratio(viewport.Width, viewport.Height, depthstencil_desc.Width, depthstencil_desc.Height))
-			return; // Ignore draw calls that go to a smaller viewport (this helps removing infrequent clears in e.g. Mirror's Edge)
-
-		counters.current_stats.vertices += vertices;
-		counters.current_stats.drawcalls += 1;
+		// Ignore draw calls that go to a smaller viewport (this helps removing infrequent clears in e.g. Mirror's Edge)
+		count_since_clear = check_aspect_ratio(viewport.Width, viewport.Height, depthstencil_desc.Width, depthstencil_desc.Height);
 	}
+
+	// Update draw statistics for tracked depth-stencil surfaces
+	count_draw(depthstencil == _depthstencil_replacement ? _depthstencil_original : depthstencil, vertices, count_since_clear);
 #endif
 }
 
@@ -94,7 +89,7 @@ void reshade::d3d9::buffer_detection::on_set_depthstencil(IDirect3DSurface9 *&de
 {
 	if (_depthstencil_replacement != nullptr && depthstencil == _depthstencil_original &&
 		// Do not replace surface after targeted clear, so that all draw calls from then on end up in the original surface
-		_counters_per_used_depth_surface[_depthstencil_original].clears.size() < depthstencil_clear_index)
+		_counters_per_used_depthstencil[_depthstencil_original].clears.size() < depthstencil_clear_index)
 	{
 		// Replace application depth-stencil surface with our custom one
 		depthstencil = _depthstencil_replacement.get();
@@ -124,14 +119,14 @@ void reshade::d3d9::buffer_detection::on_clear_depthstencil(UINT clear_flags)
 	if (depthstencil != _depthstencil_original && depthstencil != _depthstencil_replacement)
 		return; // Can only avoid clear of the replacement surface
 
-	auto &counters = _counters_per_used_depth_surface[_depthstencil_original];
+	auto &counters = _counters_per_used_depthstencil[_depthstencil_original];
 
 	// Ignore clears when there was no meaningful workload
 	// Also triggers when '_preserve_depth_buffers' is false, since no clear stats are recorded then
 	if (counters.current_stats.vertices <= 4 || counters.current_stats.drawcalls == 0)
 		return;
 
-	counters.clears.push_back(counters.current_stats);
+	count_clear(_depthstencil_original, counters);
 
 	if (depthstencil_clear_index == counters.clears.size())
 	{
@@ -248,39 +243,31 @@ com_ptr<IDirect3DSurface9> reshade::d3d9::buffer_detection::find_best_depth_surf
 
 	if (best_match != nullptr)
 	{
-		best_snapshot = _counters_per_used_depth_surface[best_match];
+		best_snapshot = _counters_per_used_depthstencil[best_match];
 
 		// Always replace when there is an override surface
 		no_replacement = false;
 	}
-	else
-	{
-		for (const auto &[surface, snapshot] : _counters_per_used_depth_surface)
-		{
-			if (snapshot.total_stats.drawcalls == 0 || snapshot.total_stats.vertices == 0)
-				continue; // Skip unused
-
+	else if (const auto best = select_best(0, 0, depthstencil_selection::weighted_vertices,
+		[&](const com_ptr<IDirect3DSurface9> &surface, const depthstencil_info &, depthstencil_desc &result) {
 			D3DSURFACE_DESC desc;
 			surface->GetDesc(&desc);
 			assert((desc.Usage & D3DUSAGE_DEPTHSTENCIL) != 0);
 
-			if (desc.MultiSampleType != D3DMULTISAMPLE_NONE)
-				continue; // MSAA depth buffers are not supported since they would have to be moved into a plain surface before attaching to a shader slot
-
-			if (width != 0 && height != 0 && !check_aspect_ratio(desc.Width, desc.Height, width, height))
-				continue; // Not a good fit
+			// MSAA depth buffers are not supported since they would have to be moved into a plain surface before attaching to a shader slot
+			result = { desc.Width, desc.Height, desc.MultiSampleType != D3DMULTISAMPLE_NONE ? 2u : 1u };
 
-			const auto curr_weight = snapshot.total_stats.vertices * (1.2f - static_cast<float>(snapshot.total_stats.drawcalls) / _stats.drawcalls);
-			const auto best_weight = best_snapshot.total_stats.vertices * (1.2f - static_cast<float>(best_snapshot.total_stats.drawcalls) / _stats.vertices);
-			if (curr_weight >= best_weight)
-			{
-				best_match = surface;
-				best_snapshot = snapshot;
+			// Use a stricter aspect ratio check than the default one
+			return width == 0 || height == 0 || check_aspect_ratio(desc.Width, desc.Height, width, height);
+		}); best != nullptr)
+	{
+		best_match = best->first;
+		best_snapshot = best->second;
 
-				// Do not need to replace if format already support shader access
-				no_replacement = check_texture_format(desc);
-			}
-		}
+		// Do not need to replace if format already support shader access
+		D3DSURFACE_DESC desc;
+		best_match->GetDesc(&desc);
+		no_replacement = check_texture_format(desc);
 	}
 
 	if (preserve_depth_buffers && best_match != nullptr)
@@ -5,33 +5,17 @@
 
 #pragma once
 
-#include <map>
-#include <vector>
 #include <d3d9.h>
 #include "com_ptr.hpp"
+#include "buffer_detection_core.hpp"
 
 namespace reshade::d3d9
 {
-	class buffer_detection
+	class buffer_detection : public buffer_detection_core<com_ptr<IDirect3DSurface9>>
 	{
 	public:
-		struct draw_stats
-		{
-			UINT vertices = 0;
-			UINT drawcalls = 0;
-		};
-		struct depthstencil_info
-		{
-			draw_stats total_stats;
-			draw_stats current_stats; // Stats since last clear
-			std::vector<draw_stats> clears;
-		};
-
 		explicit buffer_detection(IDirect3DDevice9 *device) : _device(device) {}
 
-		UINT total_vertices() const { return _stats.vertices; }
-		UINT total_drawcalls() const { return _stats.drawcalls; }
-
 		void reset(bool release_resources);
 
 		void on_draw(D3DPRIMITIVETYPE type, UINT primitives);
@@ -46,7 +30,6 @@ namespace reshade::d3d9
 		UINT depthstencil_clear_index = std::numeric_limits<UINT>::max();
 		UINT depthstencil_clear_index_override = 0;
 
-		const auto &depth_buffer_counters() const { return _counters_per_used_depth_surface; }
 		IDirect3DSurface9 *current_depth_surface() const { return _depthstencil_original.get(); }
 		IDirect3DSurface9 *current_depth_replacement() const { return _depthstencil_replacement.get(); }
 
@@ -55,7 +38,6 @@ namespace reshade::d3d9
 #endif
 
 	private:
-		draw_stats _stats;
 		IDirect3DDevice9 *const _device;
 
 #if RESHADE_DEPTH
@@ -66,8 +48,6 @@ namespace reshade::d3d9
 
 		com_ptr<IDirect3DSurface9> _depthstencil_original;
 		com_ptr<IDirect3DSurface9> _depthstencil_replacement;
-		// Use "std::map" instead of "std::unordered_map" so that the iteration order is guaranteed
-		std::map<com_ptr<IDirect3DSurface9>, depthstencil_info> _counters_per_used_depth_surface;
 #endif
 	};
 }
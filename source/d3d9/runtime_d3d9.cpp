@@ -7,10 +7,14 @@
 #include "runtime_d3d9.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "frame_profiler.hpp"
+#include "pixel_conversion.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 #include <d3dcompiler.h>
 
+extern std::filesystem::path g_reshade_dll_path;
+
 namespace reshade::d3d9
 {
 	struct d3d9_tex_data
@@ -272,29 +276,17 @@ bool reshade::d3d9::runtime_d3d9::capture_screenshot(uint8_t *buffer) const
 	{
 		if (_color_bit_depth == 10)
 		{
-			for (uint32_t x = 0; x < pitch; x += 4)
-			{
-				const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-				// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-				buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-				buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-				buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-				buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-				if (_backbuffer_format == D3DFMT_A2R10G10B10)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
+			pixel::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width, _backbuffer_format == D3DFMT_A2R10G10B10);
+		}
+		else if (_backbuffer_format == D3DFMT_A8R8G8B8 ||
+			_backbuffer_format == D3DFMT_X8R8G8B8)
+		{
+			// Format is BGRA, but output should be RGBA, so flip channels
+			pixel::swap_red_blue(buffer, mapped_data, _width);
 		}
 		else
 		{
 			std::memcpy(buffer, mapped_data, pitch);
-
-			if (_backbuffer_format == D3DFMT_A8R8G8B8 ||
-				_backbuffer_format == D3DFMT_X8R8G8B8)
-			{
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (uint32_t x = 0; x < pitch; x += 4)
-					std::swap(buffer[x + 0], buffer[x + 2]);
-			}
 		}
 	}
 
@@ -826,11 +818,7 @@ void reshade::d3d9::runtime_d3d9::upload_texture(const texture &texture, const u
 		break;
 	case reshadefx::texture_format::rgba8:
 		for (uint32_t y = 0, pitch = texture.width * 4; y < texture.height; ++y, mapped_data += mapped.Pitch, pixels += pitch)
-			for (uint32_t x = 0; x < pitch; x += 4)
-				mapped_data[x + 0] = pixels[x + 2], // Flip RGBA input to BGRA
-				mapped_data[x + 1] = pixels[x + 1],
-				mapped_data[x + 2] = pixels[x + 0],
-				mapped_data[x + 3] = pixels[x + 3];
+			pixel::swap_red_blue(mapped_data, pixels, texture.width); // Flip RGBA input to BGRA
 		break;
 	default:
 		LOG(ERROR) << "Texture upload is not supported for format " << static_cast<unsigned int>(texture.format) << " of texture '" << texture.unique_name << "'!";
@@ -872,6 +860,11 @@ void reshade::d3d9::runtime_d3d9::render_technique(technique &technique)
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
+		if (technique.culled_passes[pass_index])
+			continue; // Skip passes whose output is never used
+
+		const frame_profiler::scope profile(*_profiler, "Pass", static_cast<uint32_t>(pass_index));
+
 		if (needs_implicit_backbuffer_copy)
 		{
 			// Save back buffer of previous pass
@@ -1186,6 +1179,15 @@ void reshade::d3d9::runtime_d3d9::draw_depth_debug_menu(buffer_detection &tracke
 	_reset_buffer_detection |= ImGui::Checkbox("Use aspect ratio heuristics", &_filter_aspect_ratio);
 	_reset_buffer_detection |= ImGui::Checkbox("Copy depth buffer before clear operations", &tracker.preserve_depth_buffers);
 
+	if (tracker.is_tracing())
+		ImGui::TextUnformatted("Recording depth buffer detection trace ...");
+	else if (ImGui::Button("Record trace of the next 300 frames", ImVec2(-1, 0)))
+	{
+		// Traces can be replayed with the "buffer_detection_replay" tool in the tests, to find out how changes to the heuristics would affect the selection
+		if (const std::filesystem::path trace_path = g_reshade_dll_path.parent_path() / L"ReShade_depth.trace"; !tracker.start_trace(trace_path, 300))
+			LOG(ERROR) << "Failed to create depth buffer detection trace " << trace_path << '.';
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
@@ -5,15 +5,327 @@
 
 #include "dll_log.hpp"
 #include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <cassert>
+#include <cstring>
 #include <fstream>
+#include <algorithm>
 #include <Windows.h>
 
-std::ostringstream reshade::log::line;
-static std::mutex s_message_mutex;
-static std::ofstream s_file_stream;
+thread_local std::ostringstream reshade::log::line;
 
-reshade::log::message::message(level level)
+namespace
+{
+	struct record_header
+	{
+		uint64_t sequence;
+		uint32_t size; // Size of the text following this header in bytes
+		reshade::log::level level;
+		bool last_chunk; // Messages that are too large for the ring are split into multiple chunks with the same sequence number
+	};
+
+	/// <summary>
+	/// Single-producer single-consumer ring buffer of formatted messages. The producer is the thread owning it, the consumer whoever holds the drain mutex.
+	/// </summary>
+	struct thread_ring
+	{
+		static constexpr size_t capacity = 16 * 1024; // Has to be a power of two
+
+		alignas(64) std::atomic<uint64_t> head = 0;
+		alignas(64) std::atomic<uint64_t> tail = 0;
+		// Set while a thread owns this ring, so that rings of threads that have exited can be reused once they were drained
+		std::atomic<bool> in_use = true;
+		// Chunks of a message that were already read by the consumer while the rest is still missing
+		std::string pending;
+		uint64_t pending_sequence = 0;
+		char data[capacity];
+	};
+
+	struct log_state
+	{
+		std::mutex rings_mutex; // Only taken by producers when a thread logs for the first time
+		std::vector<thread_ring *> rings;
+		std::atomic<uint64_t> next_sequence = 0;
+		std::atomic<bool> running = false;
+		std::atomic<bool> synchronous = false; // Set once the writer thread was stopped, so that producers write their messages themselves
+
+		std::mutex drain_mutex; // Serializes consumers and protects the file stream
+		std::ofstream file_stream;
+		std::chrono::steady_clock::time_point last_flush_time;
+		bool unflushed = false; // Set while messages were written to the file stream, but not flushed yet
+		std::vector<std::pair<uint64_t, reshade::log::record>> records;
+
+		// Most recent messages for the log viewer in the overlay, so that it does not have to read them back from the file
+		static constexpr size_t history_size = 1000;
+		std::mutex history_mutex;
+		std::deque<reshade::log::record> history;
+		uint64_t history_generation = 0; // Generation of the first message in 'history'
+		std::atomic<uint64_t> generation = 0;
+
+		HANDLE writer_thread = nullptr;
+		HANDLE writer_exited = nullptr; // Event that is signaled when the writer thread left its loop
+		HANDLE writer_wake = nullptr; // Auto-reset event that wakes up the writer thread when there are new messages
+	};
+
+	// This is never destroyed, since the writer thread may still be accessing it while static destructors run during unload
+	log_state *const s_state = new log_state();
+
+	struct thread_ring_owner
+	{
+		thread_ring_owner()
+		{
+			const std::lock_guard<std::mutex> lock(s_state->rings_mutex);
+
+			// Reuse rings of threads that have exited and whose messages were all written out already
+			for (thread_ring *const existing_ring : s_state->rings)
+			{
+				if (!existing_ring->in_use.load(std::memory_order_acquire) && existing_ring->head.load(std::memory_order_relaxed) == existing_ring->tail.load(std::memory_order_acquire))
+				{
+					ring = existing_ring;
+					ring->in_use.store(true, std::memory_order_relaxed);
+					return;
+				}
+			}
+
+			ring = new thread_ring();
+			s_state->rings.push_back(ring);
+		}
+		~thread_ring_owner()
+		{
+			ring->in_use.store(false, std::memory_order_release);
+		}
+
+		thread_ring *ring;
+	};
+
+	thread_local thread_ring_owner s_thread_ring;
+}
+
+static void copy_to_ring(thread_ring &ring, uint64_t offset, const void *data, size_t size)
+{
+	const size_t begin = static_cast<size_t>(offset & (thread_ring::capacity - 1));
+	const size_t first_size = std::min(size, thread_ring::capacity - begin);
+	std::memcpy(ring.data + begin, data, first_size);
+	std::memcpy(ring.data, static_cast<const char *>(data) + first_size, size - first_size);
+}
+static void copy_from_ring(const thread_ring &ring, uint64_t offset, void *data, size_t size)
+{
+	const size_t begin = static_cast<size_t>(offset & (thread_ring::capacity - 1));
+	const size_t first_size = std::min(size, thread_ring::capacity - begin);
+	std::memcpy(data, ring.data + begin, first_size);
+	std::memcpy(static_cast<char *>(data) + first_size, ring.data, size - first_size);
+}
+
+/// <summary>
+/// Write all messages in the rings to the log file.
+/// </summary>
+/// <returns><c>true</c> if messages were added to a ring while it was drained, which may not have woken up the writer thread, <c>false</c> otherwise.</returns>
+static bool write_pending_records(bool force_flush = false)
+{
+	// Caller has to hold the drain mutex
+	bool needs_flush = force_flush;
+	bool has_more = false;
+
+	std::unique_lock<std::mutex> rings_lock(s_state->rings_mutex);
+	const std::vector<thread_ring *> rings = s_state->rings;
+	rings_lock.unlock();
+
+	for (thread_ring *const ring : rings)
+	{
+		uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+
+		while (tail < head)
+		{
+			record_header header;
+			copy_from_ring(*ring, tail, &header, sizeof(header));
+
+			// Discard chunks of a message the producer gave up on writing completely
+			if (header.sequence != ring->pending_sequence)
+				ring->pending.clear();
+			ring->pending_sequence = header.sequence;
+
+			const size_t offset = ring->pending.size();
+			ring->pending.resize(offset + header.size);
+			copy_from_ring(*ring, tail + sizeof(header), ring->pending.data() + offset, header.size);
+
+			tail += (sizeof(header) + header.size + 7) & ~size_t(7);
+
+			if (header.last_chunk)
+			{
+				s_state->records.push_back({ header.sequence, { header.level, std::move(ring->pending) } });
+				ring->pending.clear();
+
+				needs_flush |= header.level == reshade::log::level::error;
+			}
+		}
+
+		// Producers only wake up the writer thread when they see the ring empty after adding a message (see 'write_record'), so check for messages that were added in the meantime
+		// Both this and the producer side use sequentially consistent ordering, so that at least one of them sees the store of the other
+		ring->tail.store(tail, std::memory_order_seq_cst);
+		has_more |= ring->head.load(std::memory_order_seq_cst) != tail;
+	}
+
+	// Continue with an empty batch if the flush of earlier messages is still outstanding
+	if (s_state->records.empty() && !needs_flush && !s_state->unflushed)
+		return has_more;
+
+	// Restore the order in which messages were logged across threads
+	// Note that a message whose sequence number was taken just before this batch may still end up in the next one, so the order is only exact within a batch
+	std::sort(s_state->records.begin(), s_state->records.end(),
+		[](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+	std::string batch;
+	for (const auto &record : s_state->records)
+		batch += record.second.text, batch += '\n';
+
+	s_state->file_stream.write(batch.data(), batch.size());
+
+	if (!s_state->records.empty())
+	{
+		const std::lock_guard<std::mutex> lock(s_state->history_mutex);
+
+		for (auto &record : s_state->records)
+			s_state->history.push_back(std::move(record.second));
+
+		for (; s_state->history.size() > log_state::history_size; s_state->history_generation++)
+			s_state->history.pop_front();
+
+		s_state->generation.store(s_state->history_generation + s_state->history.size(), std::memory_order_release);
+	}
+
+	s_state->records.clear();
+
+	// Flush at least once a second so that the log file on disk (and the log viewer in the overlay) never falls behind too far
+	if (const auto now = std::chrono::steady_clock::now(); needs_flush || now - s_state->last_flush_time >= std::chrono::seconds(1))
+	{
+		s_state->file_stream.flush();
+		s_state->last_flush_time = now;
+		s_state->unflushed = false;
+	}
+	else
+	{
+		s_state->unflushed = true;
+	}
+
+	return has_more;
+}
+
+static void write_record(reshade::log::level level, std::string_view text)
+{
+	if (!s_state->running.load(std::memory_order_relaxed))
+		return; // Drop messages while no log file is open
+
+	thread_ring &ring = *s_thread_ring.ring;
+
+	const uint64_t sequence = s_state->next_sequence.fetch_add(1, std::memory_order_relaxed);
+	constexpr size_t max_chunk_size = thread_ring::capacity / 2 - sizeof(record_header);
+
+	do
+	{
+		const size_t chunk_size = std::min(text.size(), max_chunk_size);
+		const record_header header = { sequence, static_cast<uint32_t>(chunk_size), level, chunk_size == text.size() };
+		const size_t record_size = (sizeof(header) + chunk_size + 7) & ~size_t(7);
+
+		const uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+		// Wait for the writer thread to make room if the ring is full
+		for (const auto wait_start_time = std::chrono::steady_clock::now(); thread_ring::capacity - (head - ring.tail.load(std::memory_order_acquire)) < record_size;)
+		{
+			SetEvent(s_state->writer_wake);
+
+			// Help draining in case the writer thread is not keeping up or is no longer running (which is the case during process exit)
+			if (s_state->drain_mutex.try_lock())
+			{
+				// Messages other threads added meanwhile may not have woken up the writer thread, so pass that on
+				if (write_pending_records())
+					SetEvent(s_state->writer_wake);
+				s_state->drain_mutex.unlock();
+			}
+			else if (std::chrono::steady_clock::now() - wait_start_time > std::chrono::seconds(1))
+			{
+				return; // Never block the calling thread indefinitely
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		copy_to_ring(ring, head, &header, sizeof(header));
+		copy_to_ring(ring, head + sizeof(header), text.data(), chunk_size);
+		ring.head.store(head + record_size, std::memory_order_seq_cst);
+
+		// Only wake up the writer thread if the ring was empty before, otherwise it was woken up for the earlier messages already and sees this one when it checks the ring again after draining it
+		if (ring.tail.load(std::memory_order_seq_cst) == head && !s_state->synchronous.load(std::memory_order_relaxed))
+			SetEvent(s_state->writer_wake);
+
+		text.remove_prefix(chunk_size);
+	} while (!text.empty());
+
+	if (s_state->synchronous.load(std::memory_order_relaxed))
+	{
+		const std::lock_guard<std::mutex> lock(s_state->drain_mutex);
+		write_pending_records(true);
+	}
+}
+
+static DWORD WINAPI writer_main(LPVOID)
+{
+	// Sleep until there are new messages, except while some were written without flushing the file yet, in which case wake up again when the next flush is due
+	for (DWORD timeout = INFINITE; s_state->running.load(std::memory_order_relaxed) && !s_state->synchronous.load(std::memory_order_relaxed);)
+	{
+		WaitForSingleObject(s_state->writer_wake, timeout);
+
+		const std::lock_guard<std::mutex> lock(s_state->drain_mutex);
+		while (write_pending_records())
+			continue;
+
+		timeout = INFINITE;
+		if (s_state->unflushed)
+			timeout = static_cast<DWORD>(std::max<long long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds(1) - (std::chrono::steady_clock::now() - s_state->last_flush_time)).count()));
+	}
+
+	// This has to be the last thing done before returning, so that 'stop_writer_thread' knows that the thread no longer holds any locks or accesses the state
+	SetEvent(s_state->writer_exited);
+
+	return 0;
+}
+
+static struct log_shutdown
+{
+	~log_shutdown()
+	{
+		if (!s_state->running.exchange(false))
+			return;
+
+		SetEvent(s_state->writer_wake);
+
+		// Do not wait for the writer thread to exit, since this runs while the loader lock is held (which the thread needs to exit)
+		// When the module is unloaded via 'FreeLibrary' it was stopped in 'DllMain' already, and during process exit it was terminated already anyway
+		// So write out the remaining messages from here, unless the writer thread was terminated while holding the drain mutex
+		for (int attempt = 0; attempt < 100; ++attempt)
+		{
+			if (s_state->drain_mutex.try_lock())
+			{
+				write_pending_records(true);
+				s_state->drain_mutex.unlock();
+				break;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		CloseHandle(s_state->writer_thread);
+		CloseHandle(s_state->writer_exited);
+		CloseHandle(s_state->writer_wake);
+	}
+} s_shutdown;
+
+reshade::log::message::message(level level) : _level(level)
 {
 	SYSTEMTIME time;
 	GetLocalTime(&time);
@@ -21,12 +333,10 @@ reshade::log::message::message(level level)
 	const char level_names[][6] = { "ERROR", "WARN ", "INFO ", "DEBUG" };
 	assert(static_cast<unsigned int>(level) - 1 < ARRAYSIZE(level_names));
 
-	// Lock the stream until the message is complete
-	s_message_mutex.lock();
-
 	// Start a new line
 	line.str("");
 	line.clear();
+	line.setf(std::ios::showbase);
 
 	line << std::right << std::setfill('0')
 #if RESHADE_VERBOSE_LOG
@@ -45,33 +355,82 @@ reshade::log::message::~message()
 {
 	std::string line_string = line.str();
 
-	// Write line to the log file and flush it
-	s_file_stream << line_string << std::endl;
+	// Queue line for the writer thread
+	write_record(_level, line_string);
 
 #ifndef NDEBUG
 	// Write line to the debug output
 	line_string += '\n';
 	OutputDebugStringA(line_string.c_str());
 #endif
-
-	// The message is finished, we can unlock the stream
-	s_message_mutex.unlock();
 }
 
 bool reshade::log::open(const std::filesystem::path &path)
 {
-	if (s_file_stream.is_open())
-		// Close the previous stream first
-		s_file_stream.close();
+	const std::lock_guard<std::mutex> lock(s_state->drain_mutex);
 
-	line.setf(std::ios::left);
-	line.setf(std::ios::showbase);
+	if (s_state->file_stream.is_open())
+	{
+		// Write out everything that was logged so far to the previous file and close it (messages logged meanwhile go to the new file, once the writer thread gets the lock)
+		if (write_pending_records(true))
+			SetEvent(s_state->writer_wake);
+		s_state->file_stream.close();
+
+		// Skip a generation, so that viewers notice that the history was cleared even if they had seen all messages before
+		const std::lock_guard<std::mutex> history_lock(s_state->history_mutex);
+		s_state->history.clear();
+		s_state->history_generation = s_state->generation.load(std::memory_order_relaxed) + 1;
+		s_state->generation.store(s_state->history_generation, std::memory_order_release);
+	}
+
+	s_state->file_stream.open(path, std::ios::out | std::ios::trunc);
+
+	s_state->file_stream.setf(std::ios::left);
+	s_state->file_stream.setf(std::ios::showbase);
+	s_state->file_stream.flush();
+
+	// Use 'CreateThread' instead of 'std::thread', since this is called from 'DllMain', where waiting for the thread to start (which 'std::thread' may do) would dead-lock on the loader lock
+	if (s_state->writer_thread == nullptr)
+	{
+		s_state->writer_exited = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		s_state->writer_wake = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		// Only start accepting messages once the events exist, since producers signal the writer thread through them
+		s_state->running.store(true);
+		s_state->writer_thread = CreateThread(nullptr, 0, writer_main, nullptr, 0, nullptr);
+	}
+
+	return s_state->file_stream.is_open();
+}
+
+void reshade::log::stop_writer_thread()
+{
+	if (s_state->writer_thread == nullptr || s_state->synchronous.exchange(true))
+		return;
+
+	SetEvent(s_state->writer_wake);
+
+	// Cannot wait on the thread handle, since a thread needs the loader lock to exit and this is called from 'DllMain' while it is held, so wait for the thread to leave its loop instead
+	WaitForSingleObject(s_state->writer_exited, INFINITE);
+
+	// Write out everything that was logged before the switch to synchronous writing
+	const std::lock_guard<std::mutex> lock(s_state->drain_mutex);
+	write_pending_records(true);
+}
+
+uint64_t reshade::log::generation()
+{
+	return s_state->generation.load(std::memory_order_acquire);
+}
+
+bool reshade::log::read_history(uint64_t &generation, std::vector<record> &records)
+{
+	const std::lock_guard<std::mutex> lock(s_state->history_mutex);
 
-	s_file_stream.open(path, std::ios::out | std::ios::trunc);
+	const bool incremental = generation >= s_state->history_generation;
+	const size_t first = incremental ? static_cast<size_t>(std::min<uint64_t>(generation - s_state->history_generation, s_state->history.size())) : 0;
 
-	s_file_stream.setf(std::ios::left);
-	s_file_stream.setf(std::ios::showbase);
-	s_file_stream.flush();
+	records.insert(records.end(), s_state->history.begin() + first, s_state->history.end());
+	generation = s_state->history_generation + s_state->history.size();
 
-	return s_file_stream.is_open();
+	return incremental;
 }
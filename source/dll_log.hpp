@@ -5,17 +5,23 @@
 
 #pragma once
 
+#include <vector>
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
 #include <utf8/unchecked.h>
 #include <combaseapi.h> // Included for REFIID and HRESULT
 
+// Messages with a level above this are removed at compile time, including the evaluation of their arguments (1 = errors only, 2 = warnings, 3 = info, 4 = everything)
+#ifndef RESHADE_LOG_LEVEL
+#define RESHADE_LOG_LEVEL 4
+#endif
+
 #define LOG(LEVEL) LOG_##LEVEL()
-#define LOG_INFO() reshade::log::message(reshade::log::level::info)
-#define LOG_ERROR() reshade::log::message(reshade::log::level::error)
-#define LOG_WARN() reshade::log::message(reshade::log::level::warning)
-#define LOG_DEBUG() reshade::log::message(reshade::log::level::debug)
+#define LOG_INFO() if constexpr (RESHADE_LOG_LEVEL < 3) {} else reshade::log::message(reshade::log::level::info)
+#define LOG_ERROR() if constexpr (RESHADE_LOG_LEVEL < 1) {} else reshade::log::message(reshade::log::level::error)
+#define LOG_WARN() if constexpr (RESHADE_LOG_LEVEL < 2) {} else reshade::log::message(reshade::log::level::warning)
+#define LOG_DEBUG() if constexpr (RESHADE_LOG_LEVEL < 4) {} else reshade::log::message(reshade::log::level::debug)
 
 namespace reshade::log
 {
@@ -28,18 +34,46 @@ namespace reshade::log
 	};
 
 	/// <summary>
-	/// Open a log file for writing.
+	/// Open a log file for writing and start the background thread that writes messages to it.
 	/// </summary>
 	/// <param name="path">The path to the log file.</param>
 	bool open(const std::filesystem::path &path);
+	/// <summary>
+	/// Stop the background thread and wait for it to leave its loop, after which messages are written by the thread logging them.
+	/// Call this in 'DllMain' before the module is unloaded, since the background thread would otherwise still be executing code of it.
+	/// </summary>
+	void stop_writer_thread();
+
+	/// <summary>
+	/// A message that was written to the log file.
+	/// </summary>
+	struct record
+	{
+		reshade::log::level level;
+		std::string text;
+	};
+
+	/// <summary>
+	/// Return a counter that changes whenever new messages were written to the log file or it was cleared, so that viewers can cheaply check whether to call <see cref="read_history"/>.
+	/// </summary>
+	uint64_t generation();
 
 	/// <summary>
-	/// The current log line stream.
+	/// Copy the most recent messages written to the log file (up to a fixed number) that are newer than the specified generation.
 	/// </summary>
-	extern std::ostringstream line;
+	/// <param name="generation">The generation up to which the caller has seen messages already. This is updated to the current generation.</param>
+	/// <param name="records">The list to append the messages to.</param>
+	/// <returns><c>true</c> if only new messages were appended, or <c>false</c> if the log was cleared or the caller fell behind by more messages than are kept, in which case all kept messages are appended and previously seen ones should be discarded.</returns>
+	bool read_history(uint64_t &generation, std::vector<record> &records);
 
 	/// <summary>
-	/// Constructs a single log message including current time and level and writes it to the open log file.
+	/// The current log line stream of the calling thread.
+	/// </summary>
+	extern thread_local std::ostringstream line;
+
+	/// <summary>
+	/// Constructs a single log message including current time and level and queues it for writing to the open log file.
+	/// Messages are written in batches by a background thread, which flushes the file after errors, about once a second and on exit.
 	/// </summary>
 	struct message
 	{
@@ -53,60 +87,6 @@ namespace reshade::log
 			return *this;
 		}
 
-		template <>
-		message &operator<<(REFIID riid)
-		{
-			OLECHAR riid_string[40];
-			StringFromGUID2(riid, riid_string, ARRAYSIZE(riid_string));
-			return *this << riid_string;
-		}
-
-		template <>
-		message &operator<<(const HRESULT &hresult) // Note: HRESULT is just an alias for long, so this falsely catches all long values too
-		{
-			switch (hresult)
-			{
-			case E_NOTIMPL:
-				return *this << "E_NOTIMPL";
-			case E_OUTOFMEMORY:
-				return *this << "E_OUTOFMEMORY";
-			case E_INVALIDARG:
-				return *this << "E_INVALIDARG";
-			case E_NOINTERFACE:
-				return *this << "E_NOINTERFACE";
-			case E_FAIL:
-				return *this << "E_FAIL";
-			case DXGI_ERROR_INVALID_CALL:
-				return *this << "DXGI_ERROR_INVALID_CALL";
-			case DXGI_ERROR_UNSUPPORTED:
-				return *this << "DXGI_ERROR_UNSUPPORTED";
-			case DXGI_ERROR_DEVICE_REMOVED:
-				return *this << "DXGI_ERROR_DEVICE_REMOVED";
-			case DXGI_ERROR_DEVICE_HUNG:
-				return *this << "DXGI_ERROR_DEVICE_HUNG";
-			case DXGI_ERROR_DEVICE_RESET:
-				return *this << "DXGI_ERROR_DEVICE_RESET";
-			default:
-				return *this << std::hex << static_cast<unsigned long>(hresult) << std::dec;
-			}
-		}
-
-		template <>
-		message &operator<<(const std::wstring &message)
-		{
-			static_assert(sizeof(std::wstring::value_type) == sizeof(uint16_t), "expected 'std::wstring' to use UTF-16 encoding");
-			std::string utf8_message;
-			utf8_message.reserve(message.size());
-			utf8::unchecked::utf16to8(message.begin(), message.end(), std::back_inserter(utf8_message));
-			return operator<<(utf8_message);
-		}
-
-		template <>
-		message &operator<<(const std::filesystem::path &path)
-		{
-			return operator<<('"' + path.u8string() + '"');
-		}
-
 		inline message &operator<<(const char *message)
 		{
 			line << message;
@@ -115,10 +95,72 @@ namespace reshade::log
 
 		inline message &operator<<(const wchar_t *message)
 		{
-			static_assert(sizeof(wchar_t) == sizeof(uint16_t), "expected 'wchar_t' to use UTF-16 encoding");
 			std::string utf8_message;
-			utf8::unchecked::utf16to8(message, message + wcslen(message), std::back_inserter(utf8_message));
+			// 'wchar_t' is UTF-16 on Windows, but UTF-32 on other platforms
+			if constexpr (sizeof(wchar_t) == sizeof(uint16_t))
+				utf8::unchecked::utf16to8(message, message + wcslen(message), std::back_inserter(utf8_message));
+			else
+				utf8::unchecked::utf32to8(message, message + wcslen(message), std::back_inserter(utf8_message));
 			return operator<<(utf8_message);
 		}
+
+	private:
+		level _level;
 	};
+
+	// Explicit specializations have to be declared at namespace scope (declaring them in the class is a Microsoft extension)
+
+	template <>
+	inline message &message::operator<<(REFIID riid)
+	{
+		OLECHAR riid_string[40];
+		StringFromGUID2(riid, riid_string, ARRAYSIZE(riid_string));
+		return *this << riid_string;
+	}
+	template <>
+	inline message &message::operator<<(const HRESULT &hresult) // Note: HRESULT is just an alias for long, so this falsely catches all long values too
+	{
+		switch (hresult)
+		{
+		case E_NOTIMPL:
+			return *this << "E_NOTIMPL";
+		case E_OUTOFMEMORY:
+			return *this << "E_OUTOFMEMORY";
+		case E_INVALIDARG:
+			return *this << "E_INVALIDARG";
+		case E_NOINTERFACE:
+			return *this << "E_NOINTERFACE";
+		case E_FAIL:
+			return *this << "E_FAIL";
+		case DXGI_ERROR_INVALID_CALL:
+			return *this << "DXGI_ERROR_INVALID_CALL";
+		case DXGI_ERROR_UNSUPPORTED:
+			return *this << "DXGI_ERROR_UNSUPPORTED";
+		case DXGI_ERROR_DEVICE_REMOVED:
+			return *this << "DXGI_ERROR_DEVICE_REMOVED";
+		case DXGI_ERROR_DEVICE_HUNG:
+			return *this << "DXGI_ERROR_DEVICE_HUNG";
+		case DXGI_ERROR_DEVICE_RESET:
+			return *this << "DXGI_ERROR_DEVICE_RESET";
+		default:
+			return *this << std::hex << static_cast<unsigned long>(hresult) << std::dec;
+		}
+	}
+	template <>
+	inline message &message::operator<<(const std::wstring &message)
+	{
+		std::string utf8_message;
+		utf8_message.reserve(message.size());
+		// 'wchar_t' is UTF-16 on Windows, but UTF-32 on other platforms
+		if constexpr (sizeof(std::wstring::value_type) == sizeof(uint16_t))
+			utf8::unchecked::utf16to8(message.begin(), message.end(), std::back_inserter(utf8_message));
+		else
+			utf8::unchecked::utf32to8(message.begin(), message.end(), std::back_inserter(utf8_message));
+		return operator<<(utf8_message);
+	}
+	template <>
+	inline message &message::operator<<(const std::filesystem::path &path)
+	{
+		return operator<<('"' + path.u8string() + '"');
+	}
 }
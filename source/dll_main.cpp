@@ -746,7 +746,7 @@ static PVOID g_exception_handler_handle = nullptr;
 // Export special symbol to identify modules as ReShade instances
 extern "C" __declspec(dllexport) const char *ReShadeVersion = VERSION_STRING_PRODUCT;
 
-BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID lpReserved)
 {
 	using namespace reshade;
 
@@ -858,6 +858,11 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	case DLL_PROCESS_DETACH:
 		LOG(INFO) << "Exiting ...";
 
+		// The module is unloaded via 'FreeLibrary' (rather than the process exiting, in which case all other threads were terminated already), so the log writer thread has to stop executing code of it
+		// It returns from its entry point right after signaling that it stopped, which is covered by the wait for any in-flight hook calls below
+		if (lpReserved == nullptr)
+			log::stop_writer_thread();
+
 		hooks::uninstall();
 
 #  ifndef NDEBUG
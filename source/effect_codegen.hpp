@@ -267,6 +267,11 @@ namespace reshadefx
 		/// Leave the current function. Any code added after this call is added in the global scope.
 		/// </summary>
 		virtual void leave_function() = 0;
+		/// <summary>
+		/// Remove the function that was left last again, together with all code generated for it.
+		/// </summary>
+		/// <param name="function">The SSA ID of the function to remove, which has to be the last one that was defined.</param>
+		virtual void discard_function(id function) = 0;
 
 		/// <summary>
 		/// Look up an existing struct definition.
@@ -289,6 +294,26 @@ namespace reshadefx
 				[id](const auto &it) { return it.id == id; });
 		}
 		/// <summary>
+		/// Look up an existing texture definition by name.
+		/// </summary>
+		/// <param name="unique_name">The unique name of the texture to find.</param>
+		/// <returns>A reference to the texture description.</returns>
+		texture_info &find_texture(const std::string &unique_name)
+		{
+			return *std::find_if(_module.textures.begin(), _module.textures.end(),
+				[&unique_name](const auto &it) { return it.unique_name == unique_name; });
+		}
+		/// <summary>
+		/// Look up an existing sampler definition.
+		/// </summary>
+		/// <param name="id">The SSA ID of the sampler variable to find.</param>
+		/// <returns>A reference to the sampler description.</returns>
+		sampler_info &find_sampler(id id)
+		{
+			return *std::find_if(_module.samplers.begin(), _module.samplers.end(),
+				[id](const auto &it) { return it.id == id; });
+		}
+		/// <summary>
 		/// Look up an existing function definition.
 		/// </summary>
 		/// <param name="id">The SSA ID of the function variable to find.</param>
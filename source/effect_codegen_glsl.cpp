@@ -41,6 +41,7 @@ private:
 	std::string _compute_block;
 	std::unordered_map<id, std::string> _names;
 	std::unordered_map<id, std::string> _blocks;
+	size_t _last_function_offset = 0;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	std::unordered_map<id, id> _remapped_sampler_variables;
@@ -514,6 +515,10 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		// Remember where the function starts, so that it can be removed again in 'discard_function'
+		assert(_current_block == 0);
+		_last_function_offset = code.size();
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -1577,6 +1582,13 @@ private:
 
 		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
 	}
+	void discard_function(id function) override
+	{
+		assert(!_functions.empty() && _functions.back()->definition == function);
+
+		_blocks.at(0).resize(_last_function_offset);
+		_functions.pop_back();
+	}
 };
 
 codegen *reshadefx::create_codegen_glsl(bool debug_info, bool uniforms_to_spec_constants)
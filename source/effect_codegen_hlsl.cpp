@@ -39,6 +39,8 @@ private:
 	std::string _current_location;
 	std::unordered_map<id, std::string> _names;
 	std::unordered_map<id, std::string> _blocks;
+	size_t _last_function_offset = 0;
+	std::string _last_function_location;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	unsigned int _shader_model = 0;
@@ -556,6 +558,11 @@ private:
 
 		std::string &code = _blocks.at(_current_block);
 
+		// Remember where the function starts, so that it can be removed again in 'discard_function'
+		assert(_current_block == 0);
+		_last_function_offset = code.size();
+		_last_function_location = _current_location;
+
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
@@ -1493,6 +1500,14 @@ private:
 
 		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
 	}
+	void discard_function(id function) override
+	{
+		assert(!_functions.empty() && _functions.back()->definition == function);
+
+		_blocks.at(0).resize(_last_function_offset);
+		_current_location = _last_function_location;
+		_functions.pop_back();
+	}
 };
 
 codegen *reshadefx::create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
@@ -2036,6 +2036,27 @@ private:
 
 		_current_function = nullptr;
 	}
+	void discard_function(id function) override
+	{
+		assert(!is_in_function() && !_functions.empty() && _functions.back()->definition == function);
+
+		// Remove debug names and decorations of anything defined in the function too, since those would reference IDs that no longer exist
+		std::unordered_set<spv::Id> function_ids;
+		const function_blocks &blocks = _functions_blocks.back();
+		for (const spirv_basic_block *block : { &blocks.declaration, &blocks.variables, &blocks.definition })
+			for (const spirv_instruction &inst : block->instructions)
+				if (inst.result != 0)
+					function_ids.insert(inst.result);
+
+		const auto references_function = [&function_ids](const spirv_instruction &inst) {
+			return !inst.operands.empty() && function_ids.find(inst.operands[0]) != function_ids.end();
+		};
+		_debug_b.instructions.erase(std::remove_if(_debug_b.instructions.begin(), _debug_b.instructions.end(), references_function), _debug_b.instructions.end());
+		_annotations.instructions.erase(std::remove_if(_annotations.instructions.begin(), _annotations.instructions.end(), references_function), _annotations.instructions.end());
+
+		_functions_blocks.pop_back();
+		_functions.pop_back();
+	}
 };
 
 codegen *reshadefx::create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool invert_y)
@@ -688,6 +688,11 @@ void reshadefx::lexer::reset_to_offset(size_t offset)
 	assert(offset < _input.size());
 	_cur = _input.data() + offset;
 }
+void reshadefx::lexer::reset_to_offset(size_t offset, const location &location)
+{
+	reset_to_offset(offset);
+	_cur_location = location;
+}
 
 void reshadefx::lexer::parse_identifier(token &tok) const
 {
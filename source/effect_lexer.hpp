@@ -58,6 +58,10 @@ namespace reshadefx
 		/// Get the current position in the input string.
 		/// </summary>
 		size_t input_offset() const { return _cur - _input.data(); }
+		/// <summary>
+		/// Get the source location of the current position in the input string.
+		/// </summary>
+		const location &input_location() const { return _cur_location; }
 
 		/// <summary>
 		/// Get the input string this lexical analyzer works on.
@@ -85,6 +89,12 @@ namespace reshadefx
 		/// </summary>
 		/// <param name="offset">Offset in characters from the start of the input string.</param>
 		void reset_to_offset(size_t offset);
+		/// <summary>
+		/// Reset position to the specified <paramref name="offset"/> and continue counting source locations from <paramref name="location"/>.
+		/// </summary>
+		/// <param name="offset">Offset in characters from the start of the input string.</param>
+		/// <param name="location">Source location of that offset, as returned by <see cref="input_location"/>.</param>
+		void reset_to_offset(size_t offset, const location &location);
 
 	private:
 		/// <summary>
@@ -287,6 +287,9 @@ namespace reshadefx
 		primitive_topology topology = primitive_topology::triangle_list;
 		uint32_t viewport_width = 0;
 		uint32_t viewport_height = 0;
+		uint8_t discards = false; // Set if any shader of this pass contains a 'discard' statement
+		std::vector<std::string> sampled_texture_names; // Textures that are read through samplers by any shader of this pass
+		std::vector<std::string> storage_texture_names; // Textures that are accessed through storages by any shader of this pass
 	};
 
 	/// <summary>
@@ -25,12 +25,13 @@ reshadefx::parser::~parser()
 {
 }
 
-bool reshadefx::parser::parse(std::string input, codegen *backend)
+bool reshadefx::parser::parse(std::string input, codegen *backend, unsigned int backbuffer_color_bit_depth)
 {
 	_lexer.reset(new lexer(std::move(input)));
 
 	// Set backend for subsequent code-generation
 	_codegen = backend;
+	_backbuffer_color_bit_depth = backbuffer_color_bit_depth;
 
 	consume();
 
@@ -562,6 +563,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 				_codegen->emit_constant(exp.type, one));
 
 			// The "++" and "--" operands modify the source variable, so store result back into it
+			record_store(exp);
 			_codegen->emit_store(exp, result);
 		}
 		else if (op != tokenid::plus) // Ignore "+" operator since it does not actually do anything
@@ -925,7 +927,14 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 					_codegen->emit_store(parameters[i], _codegen->emit_load(arguments[i]));
 
 			// Check if the call resolving found an intrinsic or function and invoke the corresponding code
-			const auto result = symbol.op == symbol_type::function ?
+			// Keep track of the call graph, so that the resources used by an entry point can be determined later
+			if (symbol.op == symbol_type::function && _current_function != 0)
+				_function_usage[_current_function].references.push_back(symbol.id);
+
+			// Samples from the output of the previous pass are replaced with a call to its pixel shader when generating a fused pixel shader
+			const auto result = is_fused_sample(symbol, arguments) ?
+				emit_fused_sample(location) :
+				symbol.op == symbol_type::function ?
 				_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
 				_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
 
@@ -935,7 +944,10 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			for (size_t i = 0; i < arguments.size(); ++i)
 				// Only do this for pointer parameters as discovered above
 				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out) && !parameters[i].type.is_sampler() && !parameters[i].type.is_storage())
+				{
+					record_store(arguments[i]);
 					_codegen->emit_store(arguments[i], _codegen->emit_load(parameters[i]));
+				}
 		}
 		else if (symbol.op == symbol_type::invalid)
 		{
@@ -947,6 +959,12 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			assert(symbol.id != 0);
 			// Simply return the pointer to the variable, dereferencing is done on site where necessary
 			exp.reset_to_lvalue(location, symbol.id, symbol.type);
+
+			if ((symbol.type.is_sampler() || symbol.type.is_storage()) && _current_function != 0)
+				_function_usage[_current_function].references.push_back(symbol.id);
+
+			if (_fusion != nullptr && std::find(_fusion->samplers.begin(), _fusion->samplers.end(), symbol.id) != _fusion->samplers.end())
+				_fusion->num_references++;
 		}
 		else if (symbol.op == symbol_type::constant)
 		{
@@ -984,6 +1002,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 			const auto result = _codegen->emit_binary_op(location, _token.id, exp.type, value, _codegen->emit_constant(exp.type, one));
 
 			// The "++" and "--" operands modify the source variable, so store result back into it
+			record_store(exp);
 			_codegen->emit_store(exp, result);
 
 			// All postfix operators return a r-value rather than a l-value to the variable
@@ -1468,6 +1487,7 @@ bool reshadefx::parser::parse_expression_assignment(expression &lhs)
 		}
 
 		// Write result back to variable
+		record_store(lhs);
 		_codegen->emit_store(lhs, result);
 
 		// Return the result value since you can write assignments within expressions
@@ -2047,6 +2067,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 		#pragma region Discard
 		if (accept(tokenid::discard_))
 		{
+			if (_current_function != 0)
+				_function_usage[_current_function].discards = true;
+
 			// Leave the current function block
 			_codegen->leave_block_and_kill();
 
@@ -2336,7 +2359,7 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 	bool expect_parenthesis = true;
 
 	// Enter function scope
-	enter_scope(); on_scope_exit _([this]() { leave_scope(); _codegen->leave_function(); });
+	enter_scope(); on_scope_exit _([this]() { leave_scope(); _codegen->leave_function(); _current_function = 0; });
 
 	while (!peek(')'))
 	{
@@ -2462,6 +2485,17 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 		if (!insert_symbol(param.name, { symbol_type::variable, param.definition, param.type }))
 			return error(param.location, 3003, "redefinition of '" + param.name + '\''), false;
 
+	_current_function = id;
+	function_usage &usage = _function_usage[id]; // Always add an entry, so that functions are distinguishable from other references
+
+	// Remember where the body starts, so that it can be parsed again later (only done for global functions, since symbols are looked up from the global scope then)
+	if (current_scope().namespace_level == 0)
+	{
+		usage.body_token = _token_next;
+		usage.body_offset = _lexer->input_offset();
+		usage.body_location = _lexer->input_location();
+	}
+
 	// A function has to start with a new block
 	_codegen->enter_block(_codegen->create_block());
 
@@ -2755,6 +2789,8 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 
 		symbol = { symbol_type::variable, 0, type };
 		symbol.id = _codegen->define_sampler(location, sampler_info);
+
+		_sampler_textures[symbol.id] = sampler_info.texture_name;
 	}
 	else if (type.is_storage())
 	{
@@ -2769,6 +2805,8 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 
 		symbol = { symbol_type::variable, 0, type };
 		symbol.id = _codegen->define_storage(location, storage_info);
+
+		_storage_textures[symbol.id] = storage_info.texture_name;
 	}
 	// Uniform variables are put into a global uniform buffer structure
 	else if (type.has(type::q_uniform))
@@ -2831,6 +2869,10 @@ bool reshadefx::parser::parse_technique()
 		}
 	}
 
+	// Merge passes where possible, but only if all of them are valid (since the fusion depends on the information gathered about each one)
+	if (parse_success && current_scope().namespace_level == 0)
+		fuse_technique_passes(info);
+
 	_codegen->define_technique(info);
 
 	return expect('}') && parse_success;
@@ -3188,7 +3230,404 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 		if (info.srgb_write_enable && !targets_support_srgb)
 			parse_success = false,
 			error(pass_location, 4582, "one or more render target(s) do not support sRGB writes (only textures with RGBA8 format do)");
+
+		if (parse_success)
+		{
+			collect_pass_resources(info, { vs_info.definition, ps_info.definition, cs_info.definition });
+
+			// Keep track of which function each entry point belongs to, so that passes can be fused later
+			if (!info.vs_entry_point.empty())
+				_entry_point_functions[info.vs_entry_point] = vs_info.definition;
+			if (!info.ps_entry_point.empty())
+				_entry_point_functions[info.ps_entry_point] = ps_info.definition;
+		}
 	}
 
 	return expect('}') && parse_success;
 }
+
+void reshadefx::parser::collect_pass_resources(pass_info &info, std::initializer_list<uint32_t> entry_points) const
+{
+	// Walk the call graph starting at the entry points of the pass and gather all the samplers and storages that are referenced somewhere along the way
+	std::vector<uint32_t> functions_to_visit;
+	std::vector<uint32_t> visited_functions;
+	for (const uint32_t id : entry_points)
+		if (id != 0)
+			functions_to_visit.push_back(id);
+
+	while (!functions_to_visit.empty())
+	{
+		const uint32_t function_id = functions_to_visit.back();
+		functions_to_visit.pop_back();
+
+		if (std::find(visited_functions.begin(), visited_functions.end(), function_id) != visited_functions.end())
+			continue;
+		visited_functions.push_back(function_id);
+
+		const auto usage_it = _function_usage.find(function_id);
+		if (usage_it == _function_usage.end())
+			continue;
+
+		if (usage_it->second.discards)
+			info.discards = true;
+
+		for (const uint32_t id : usage_it->second.references)
+		{
+			if (_function_usage.find(id) != _function_usage.end())
+				functions_to_visit.push_back(id);
+			else if (const auto it = _sampler_textures.find(id); it != _sampler_textures.end())
+			{
+				if (std::find(info.sampled_texture_names.begin(), info.sampled_texture_names.end(), it->second) == info.sampled_texture_names.end())
+					info.sampled_texture_names.push_back(it->second);
+			}
+			else if (const auto it = _storage_textures.find(id); it != _storage_textures.end())
+			{
+				if (std::find(info.storage_texture_names.begin(), info.storage_texture_names.end(), it->second) == info.storage_texture_names.end())
+					info.storage_texture_names.push_back(it->second);
+			}
+		}
+	}
+}
+bool reshadefx::parser::references_any(uint32_t function, const std::vector<uint32_t> &ids) const
+{
+	std::vector<uint32_t> functions_to_visit = { function };
+	std::vector<uint32_t> visited_functions;
+
+	while (!functions_to_visit.empty())
+	{
+		const uint32_t function_id = functions_to_visit.back();
+		functions_to_visit.pop_back();
+
+		if (std::find(visited_functions.begin(), visited_functions.end(), function_id) != visited_functions.end())
+			continue;
+		visited_functions.push_back(function_id);
+
+		const auto usage_it = _function_usage.find(function_id);
+		if (usage_it == _function_usage.end())
+			continue;
+
+		for (const uint32_t id : usage_it->second.references)
+		{
+			if (std::find(ids.begin(), ids.end(), id) != ids.end())
+				return true;
+			if (_function_usage.find(id) != _function_usage.end())
+				functions_to_visit.push_back(id);
+		}
+	}
+
+	return false;
+}
+
+void reshadefx::parser::fuse_technique_passes(technique_info &info)
+{
+	// Pixel shader function of every pass, which may be changed to a fused function below
+	std::vector<uint32_t> pixel_shaders(info.passes.size());
+	for (size_t pass_index = 0; pass_index < info.passes.size(); ++pass_index)
+		if (const auto it = _entry_point_functions.find(info.passes[pass_index].ps_entry_point); it != _entry_point_functions.end())
+			pixel_shaders[pass_index] = it->second;
+	std::vector<bool> fused(info.passes.size());
+
+	for (size_t pass_index = 1; pass_index < info.passes.size();)
+	{
+		bool replaces_prev = false;
+
+		if (const uint32_t function = fuse_pass(info.passes[pass_index - 1], pixel_shaders[pass_index - 1], info.passes[pass_index], pixel_shaders[pass_index], replaces_prev); function != 0)
+		{
+			pixel_shaders[pass_index] = function;
+			fused[pass_index] = true;
+
+			if (replaces_prev)
+			{
+				// The fused pass takes the place of the previous one, so try to fuse it with the pass following it next
+				info.passes.erase(info.passes.begin() + (pass_index - 1));
+				pixel_shaders.erase(pixel_shaders.begin() + (pass_index - 1));
+				fused.erase(fused.begin() + (pass_index - 1));
+				continue;
+			}
+		}
+
+		pass_index++;
+	}
+
+	// Only generate entry points for the fused functions that are actually used in the end
+	for (size_t pass_index = 0; pass_index < info.passes.size(); ++pass_index)
+	{
+		if (!fused[pass_index])
+			continue;
+
+		function_info entry_point = _codegen->find_function(pixel_shaders[pass_index]);
+		_codegen->define_entry_point(entry_point, shader_type::ps);
+		info.passes[pass_index].ps_entry_point = entry_point.unique_name;
+	}
+}
+
+uint32_t reshadefx::parser::fuse_pass(const pass_info &prev, uint32_t prev_function, pass_info &pass, uint32_t pass_function, bool &replaces_prev)
+{
+	// Both passes have to draw a full-screen triangle with the same vertex shader, so that both pixel shaders are invoked with the same inputs for every pixel
+	if (!prev.cs_entry_point.empty() || !pass.cs_entry_point.empty() || prev.vs_entry_point != pass.vs_entry_point)
+		return 0;
+	if (prev.num_vertices != 3 || prev.topology != primitive_topology::triangle_list || pass.num_vertices != 3 || pass.topology != primitive_topology::triangle_list)
+		return 0;
+	// The previous pass has to write the result of its pixel shader unmodified to every pixel of a single target
+	if (prev.blend_enable || prev.stencil_enable || prev.discards || (prev.color_write_mask & 0xF) != 0xF || !prev.render_target_names[1].empty())
+		return 0;
+	// The fused pixel shader reads everything the previous one did, so none of that may be a target of this pass (e.g. a history texture that the previous pass samples and this pass updates)
+	for (const std::string &target_name : pass.render_target_names)
+		if (!target_name.empty() && (
+			std::find(prev.sampled_texture_names.begin(), prev.sampled_texture_names.end(), target_name) != prev.sampled_texture_names.end() ||
+			std::find(prev.storage_texture_names.begin(), prev.storage_texture_names.end(), target_name) != prev.storage_texture_names.end()))
+			return 0;
+
+	fusion_state state;
+	replaces_prev = prev.render_target_names[0].empty();
+
+	if (replaces_prev)
+	{
+		// The previous pass can only be dropped if this pass overwrites all of the back buffer again, since nothing else can observe what it wrote then
+		if (!pass.render_target_names[0].empty() || pass.blend_enable || pass.stencil_enable || pass.discards || (pass.color_write_mask & 0xF) != 0xF)
+			return 0;
+		// Writing to an unsigned normalized back buffer clamps the result, which has to be reproduced below (floating-point back buffers would keep values outside that range instead)
+		if (_backbuffer_color_bit_depth != 8 && _backbuffer_color_bit_depth != 10)
+			return 0;
+
+		// Back buffer contents are read through the textures with the color semantic (the alpha channel is assumed to be stored too)
+		for (const auto &[id, texture_name] : _sampler_textures)
+			if (_codegen->find_texture(texture_name).semantic == "COLOR")
+				state.samplers.push_back(id);
+
+		state.saturate = true;
+	}
+	else
+	{
+		const texture_info &target = _codegen->find_texture(prev.render_target_names[0]);
+
+		// Every pixel of this pass has to correspond to exactly one texel of the target, so that sampling it at the current texture coordinate returns what the previous pass wrote for that same pixel
+		if (pass.render_target_names[0].empty() || pass.viewport_width != target.width || pass.viewport_height != target.height || target.levels != 1)
+			return 0;
+		// Only formats with four channels return the same components the pixel shader wrote
+		if (target.format != texture_format::rgba8 && target.format != texture_format::rgba16 && target.format != texture_format::rgba16f && target.format != texture_format::rgba32f && target.format != texture_format::rgb10a2)
+			return 0;
+		if (std::find(pass.storage_texture_names.begin(), pass.storage_texture_names.end(), target.unique_name) != pass.storage_texture_names.end())
+			return 0;
+
+		for (const auto &[id, texture_name] : _sampler_textures)
+			if (texture_name == target.unique_name)
+				state.samplers.push_back(id);
+
+		state.saturate = target.format != texture_format::rgba16f && target.format != texture_format::rgba32f;
+	}
+
+	// Conversion to and from sRGB only cancels out if it is done on both writing and reading
+	for (const uint32_t sampler : state.samplers)
+		if (_codegen->find_sampler(sampler).srgb != prev.srgb_write_enable)
+			return 0;
+
+	if (prev_function == 0 || pass_function == 0)
+		return 0;
+
+	const function_info &source = _codegen->find_function(prev_function);
+	const function_info &function = _codegen->find_function(pass_function);
+	const function_usage &usage = _function_usage.at(pass_function);
+
+	// Only functions whose body can be parsed again can be fused, and only if that would actually replace something
+	if (usage.body_offset == 0 || std::none_of(usage.references.begin(), usage.references.end(),
+			[&state](uint32_t reference) { return std::find(state.samplers.begin(), state.samplers.end(), reference) != state.samplers.end(); }))
+		return 0;
+
+	// The pixel shader of the previous pass has to return a single color value, so that calling it produces exactly what was written to the target
+	if (!source.return_type.is_floating_point() || !source.return_type.is_vector() || source.return_type.rows != 4 || source.return_type.is_array() ||
+		(source.return_semantic != "SV_TARGET" && source.return_semantic != "SV_TARGET0" && source.return_semantic != "COLOR" && source.return_semantic != "COLOR0"))
+		return 0;
+
+	// Samples are only replaced when done at the texture coordinate passed in from the vertex shader
+	size_t texcoord_index = function.parameter_list.size();
+	for (size_t i = 0; i < function.parameter_list.size(); ++i)
+		if ((function.parameter_list[i].semantic == "TEXCOORD" || function.parameter_list[i].semantic == "TEXCOORD0") && function.parameter_list[i].type == type { type::t_float, 2, 1 })
+			texcoord_index = i;
+	if (texcoord_index == function.parameter_list.size())
+		return 0;
+
+	// Every input of the previous pixel shader has to be available in this one too
+	for (const struct_member_info &source_param : source.parameter_list)
+	{
+		if (source_param.type.has(type::q_out) || source_param.semantic.empty())
+			return 0;
+
+		const auto param_it = std::find_if(function.parameter_list.begin(), function.parameter_list.end(),
+			[&source_param](const struct_member_info &param) { return param.semantic == source_param.semantic && param.type == source_param.type && param.type.has(type::q_in); });
+		if (param_it == function.parameter_list.end())
+			return 0;
+
+		state.source_arguments.push_back(param_it - function.parameter_list.begin());
+	}
+
+	// Only samples done directly in the pixel shader are replaced, so none of the functions it calls may access the output of the previous pass
+	for (const uint32_t id : usage.references)
+		if (id != pass_function && _function_usage.find(id) != _function_usage.end() && references_any(id, state.samplers))
+			return 0;
+
+	state.source = &source;
+
+	// Reuse functions that were already generated for the same combination (e.g. for passes that are repeated in multiple techniques)
+	std::string fused_key = std::to_string(source.definition) + '_' + std::to_string(function.definition) + '_' + (replaces_prev ? std::string() : prev.render_target_names[0]);
+	auto fused_it = _fused_functions.find(fused_key);
+	if (fused_it == _fused_functions.end())
+		fused_it = _fused_functions.emplace(std::move(fused_key), define_fused_function(function, texcoord_index, state)).first;
+
+	if (fused_it->second == 0)
+		return 0;
+
+	pass.discards = false;
+	pass.sampled_texture_names.clear();
+	pass.storage_texture_names.clear();
+	collect_pass_resources(pass, { _entry_point_functions.at(pass.vs_entry_point), fused_it->second });
+
+	return fused_it->second;
+}
+
+uint32_t reshadefx::parser::define_fused_function(const function_info &function, size_t texcoord_index, fusion_state &state)
+{
+	function_usage &usage = _function_usage.at(function.definition);
+
+	function_info info;
+	info.name = function.name;
+	info.unique_name = function.unique_name + "_fused" + std::to_string(_fused_functions.size());
+	info.return_type = function.return_type;
+	info.return_semantic = function.return_semantic;
+	info.parameter_list = function.parameter_list;
+
+	const auto id = _codegen->define_function(usage.body_token.location, info);
+	_function_usage[id];
+
+	// Save the parser state, since the body is parsed again from the middle of a technique definition
+	const token token = _token, token_next = _token_next;
+	const size_t lexer_offset = _lexer->input_offset();
+	const location lexer_location = _lexer->input_location();
+	const size_t errors_size = _errors.size();
+	const reshadefx::type return_type = _current_return_type;
+
+	enter_scope();
+
+	const function_info &fused_function = _codegen->find_function(id);
+
+	bool parse_success = true;
+	for (const struct_member_info &param : fused_function.parameter_list)
+		if (!insert_symbol(param.name, { symbol_type::variable, param.definition, param.type }))
+			parse_success = false;
+
+	state.texcoord = fused_function.parameter_list[texcoord_index].definition;
+
+	_fusion = &state;
+	_current_function = id;
+	_current_return_type = info.return_type;
+	_token_next = usage.body_token;
+	_lexer->reset_to_offset(usage.body_offset, usage.body_location);
+
+	_codegen->enter_block(_codegen->create_block());
+
+	if (!parse_statement_block(false))
+		parse_success = false;
+
+	if (_codegen->is_in_block())
+		_codegen->leave_block_and_return();
+
+	leave_scope();
+	_codegen->leave_function();
+
+	_fusion = nullptr;
+	_current_function = 0;
+	_current_return_type = return_type;
+	_token = token;
+	_token_next = token_next;
+	_lexer->reset_to_offset(lexer_offset, lexer_location);
+
+	if (!parse_success)
+	{
+		// The body was parsed without errors the first time, so anything reported now is caused by the substitution and not something the effect author can fix
+		// Keep the diagnostics as warnings though, so that the reason is visible, but the effect still compiles (just without fusing these passes)
+		std::string diagnostics = _errors.substr(errors_size);
+		_errors.resize(errors_size);
+
+		warning(usage.body_token.location, 0, "could not fuse pixel shader '" + function.name + "' with the pixel shader of the previous pass:");
+		for (size_t offset = 0; (offset = diagnostics.find(": error", offset)) != std::string::npos; offset += 9)
+			diagnostics.replace(offset, 7, ": warning");
+		_errors += diagnostics;
+	}
+	else
+	{
+		// Any warnings were already reported when the function was parsed the first time
+		_errors.resize(errors_size);
+	}
+
+	// Every access to the output of the previous pass has to have been replaced, otherwise the fused function still depends on it
+	if (!parse_success || state.failed || state.num_substitutions == 0 || state.num_substitutions != state.num_references)
+	{
+		// Remove the function again, so that no code is generated for it
+		_codegen->discard_function(id);
+		_function_usage.erase(id);
+		return 0;
+	}
+
+	// The replaced samples no longer read from the output of the previous pass
+	std::vector<uint32_t> &references = _function_usage.at(id).references;
+	references.erase(std::remove_if(references.begin(), references.end(),
+		[&state](uint32_t reference) { return std::find(state.samplers.begin(), state.samplers.end(), reference) != state.samplers.end(); }), references.end());
+
+	return id;
+}
+
+bool reshadefx::parser::is_fused_sample(const symbol &symbol, const std::vector<expression> &arguments) const
+{
+	return _fusion != nullptr && symbol.op == symbol_type::intrinsic && symbol.function->name == "tex2D" && arguments.size() == 2 &&
+		arguments[0].is_lvalue && arguments[0].chain.empty() && std::find(_fusion->samplers.begin(), _fusion->samplers.end(), arguments[0].base) != _fusion->samplers.end() &&
+		arguments[1].is_lvalue && arguments[1].chain.empty() && arguments[1].base == _fusion->texcoord;
+}
+
+uint32_t reshadefx::parser::emit_fused_sample(const location &location)
+{
+	_fusion->num_substitutions++;
+
+	const function_info &function = _codegen->find_function(_current_function);
+	const function_info &source = *_fusion->source;
+
+	// Pass on the matching inputs of the current function, copied into temporary variables like for any other function call
+	std::vector<expression> parameters(source.parameter_list.size());
+	for (size_t i = 0; i < parameters.size(); ++i)
+	{
+		const struct_member_info &param = function.parameter_list[_fusion->source_arguments[i]];
+
+		expression argument;
+		argument.reset_to_lvalue(location, param.definition, param.type);
+
+		const auto temp_variable = _codegen->define_variable(location, source.parameter_list[i].type);
+		parameters[i].reset_to_lvalue(location, temp_variable, source.parameter_list[i].type);
+		_codegen->emit_store(parameters[i], _codegen->emit_load(argument));
+	}
+
+	_function_usage[_current_function].references.push_back(source.definition);
+
+	auto result = _codegen->emit_call(location, source.definition, source.return_type, parameters);
+
+	// Writing to an unsigned normalized target clamps the value, so do the same here
+	if (_fusion->saturate)
+	{
+		std::vector<expression> arguments(1);
+		arguments[0].reset_to_rvalue(location, result, source.return_type);
+
+		symbol symbol;
+		bool ambiguous = false;
+		if (resolve_function_call("saturate", arguments, current_scope(), symbol, ambiguous))
+			result = _codegen->emit_call_intrinsic(location, symbol.id, symbol.type, arguments);
+		else
+			_fusion->failed = true;
+	}
+
+	return result;
+}
+
+void reshadefx::parser::record_store(const expression &target)
+{
+	// The texture coordinate may not change, since the previous pass was evaluated at the original one
+	if (_fusion != nullptr && target.is_lvalue && target.base == _fusion->texcoord)
+		_fusion->failed = true;
+}
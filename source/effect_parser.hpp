@@ -7,6 +7,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <memory> // std::unique_ptr
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -25,8 +26,9 @@ namespace reshadefx
 		/// </summary>
 		/// <param name="source">The string to analyze.</param>
 		/// <param name="backend">The code generation implementation to use.</param>
+		/// <param name="backbuffer_color_bit_depth">The bit depth of the unsigned normalized back buffer format (8 or 10), or zero if it is not known or not unsigned normalized. Passes are only fused into ones writing to the back buffer if this is set.</param>
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
-		bool parse(std::string source, class codegen *backend);
+		bool parse(std::string source, class codegen *backend, unsigned int backbuffer_color_bit_depth = 0);
 
 		/// <summary>
 		/// Get the list of error messages.
@@ -75,7 +77,30 @@ namespace reshadefx
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
 
+		void collect_pass_resources(pass_info &info, std::initializer_list<uint32_t> entry_points) const;
+		bool references_any(uint32_t function, const std::vector<uint32_t> &ids) const;
+
+		struct fusion_state
+		{
+			const function_info *source = nullptr; // Pixel shader of the previous pass, which is called in place of sampling its output
+			std::vector<size_t> source_arguments; // Indices of the parameters of the fused function to pass on to the source function
+			std::vector<uint32_t> samplers; // Samplers that read the output of the previous pass
+			uint32_t texcoord = 0;
+			bool saturate = false;
+			bool failed = false;
+			size_t num_references = 0;
+			size_t num_substitutions = 0;
+		};
+
+		void fuse_technique_passes(technique_info &info);
+		uint32_t fuse_pass(const pass_info &prev, uint32_t prev_function, pass_info &pass, uint32_t pass_function, bool &replaces_prev);
+		uint32_t define_fused_function(const function_info &function, size_t texcoord_index, fusion_state &state);
+		bool is_fused_sample(const symbol &symbol, const std::vector<expression> &arguments) const;
+		uint32_t emit_fused_sample(const location &location);
+		void record_store(const expression &target);
+
 		codegen *_codegen = nullptr;
+		unsigned int _backbuffer_color_bit_depth = 0;
 		std::string _errors;
 		token _token, _token_next, _token_backup;
 		std::unique_ptr<class lexer> _lexer;
@@ -83,5 +108,23 @@ namespace reshadefx
 		reshadefx::type _current_return_type;
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
+
+		struct function_usage
+		{
+			bool discards = false;
+			std::vector<uint32_t> references; // IDs of samplers, storages and functions referenced in the function body
+			// Position of the function body in the input, so that it can be parsed again to generate fused pixel shaders
+			token body_token;
+			size_t body_offset = 0;
+			location body_location;
+		};
+
+		uint32_t _current_function = 0;
+		std::unordered_map<uint32_t, function_usage> _function_usage;
+		std::unordered_map<uint32_t, std::string> _sampler_textures;
+		std::unordered_map<uint32_t, std::string> _storage_textures;
+		std::unordered_map<std::string, uint32_t> _entry_point_functions;
+		std::unordered_map<std::string, uint32_t> _fused_functions;
+		fusion_state *_fusion = nullptr;
 	};
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "file_index.hpp"
+#include <cwctype>
+#include <algorithm>
+
+extern bool resolve_path(std::filesystem::path &path);
+
+static std::wstring to_lower(std::wstring name)
+{
+	std::transform(name.begin(), name.end(), name.begin(), [](wchar_t c) { return static_cast<wchar_t>(towlower(c)); });
+	return name;
+}
+
+std::vector<std::filesystem::path> reshade::file_index::find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions)
+{
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::path &search_path : search_paths)
+		for (const std::filesystem::path &file : lookup(search_path).files)
+			if (std::find(extensions.begin(), extensions.end(), file.extension()) != extensions.end())
+				files.push_back(file);
+	return files;
+}
+
+bool reshade::file_index::find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path)
+{
+	std::error_code ec;
+	// Do not have to perform a search if the path is already absolute
+	if (path.is_absolute())
+		return std::filesystem::exists(path, ec);
+
+	const std::wstring name = to_lower(path.native());
+
+	for (std::filesystem::path search_path : search_paths)
+	{
+		// Only the files directly in a search path are indexed, so fall back to the file system for anything in a subdirectory
+		if (path.has_parent_path())
+		{
+			_num_fallbacks++;
+
+			// Append relative file path to absolute search path
+			if (search_path /= path; resolve_path(search_path))
+				return path = std::move(search_path), true;
+			continue;
+		}
+
+		const directory &dir = lookup(search_path);
+
+		if (const auto it = dir.names.find(name); it != dir.names.end())
+		{
+			_num_hits++;
+			return path = dir.files[it->second], true;
+		}
+	}
+
+	_num_misses++;
+	return false;
+}
+
+void reshade::file_index::log_statistics() const
+{
+	size_t num_directories = 0, num_files = 0;
+	for (const auto &[search_path, dir] : _directories)
+	{
+		num_directories += dir.exists;
+		num_files += dir.files.size();
+	}
+
+	LOG(INFO) << "File index contains " << num_files << " files in " << num_directories << " search paths, after " <<
+		_num_scans << " directory scans, " << _num_hits << " hits, " << _num_misses << " misses and " << _num_fallbacks << " lookups in subdirectories so far.";
+}
+
+const reshade::file_index::directory &reshade::file_index::lookup(const std::filesystem::path &search_path)
+{
+	directory &dir = _directories[search_path.native()];
+
+	// Only check each directory once per batch of lookups
+	if (dir.generation == _generation)
+		return dir;
+	dir.generation = _generation;
+
+	std::error_code ec;
+	std::filesystem::path path = search_path;
+
+	if (!resolve_path(path))
+	{
+		dir = directory();
+		dir.generation = _generation;
+		return dir;
+	}
+
+	const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path, ec);
+	if (dir.exists && ec.value() == 0 && last_write_time == dir.last_write_time && path == dir.path)
+		return dir;
+
+	_num_scans++;
+
+	dir.exists = true;
+	dir.path = std::move(path);
+	dir.last_write_time = last_write_time;
+	dir.files.clear();
+	dir.names.clear();
+
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(dir.path, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (entry.is_directory(ec))
+			continue;
+
+		// Keep the first file in case two names only differ in case (which can happen on case-sensitive file systems)
+		dir.names.emplace(to_lower(entry.path().filename().native()), dir.files.size());
+		dir.files.emplace_back(entry); // Construct path from directory entry in-place
+	}
+
+	return dir;
+}
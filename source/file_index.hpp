@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// Caches the listings of search path directories, so that looking up effect and texture files does not have to walk the file system every time.
+	/// A directory is only listed again after its modification time changed, which happens when files are added to, removed from or renamed in it.
+	/// </summary>
+	class file_index
+	{
+	public:
+		/// <summary>
+		/// Build a list of all files with one of the specified extensions in the search paths.
+		/// </summary>
+		/// <param name="search_paths">The list of directories to search in.</param>
+		/// <param name="extensions">The list of file extensions to include (including the leading dot).</param>
+		std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions);
+		/// <summary>
+		/// Search for a file in the search paths and replace the specified relative <paramref name="path"/> with the absolute path to it.
+		/// </summary>
+		/// <param name="search_paths">The list of directories to search in.</param>
+		/// <param name="path">The path to the file to search, which is left as is if it is already absolute.</param>
+		/// <returns><c>true</c> if the file was found, <c>false</c> otherwise.</returns>
+		bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path);
+
+		/// <summary>
+		/// Check the modification time of every directory again the next time it is used.
+		/// Call this before a batch of lookups, so that changes made since the last batch are picked up.
+		/// </summary>
+		void invalidate() { _generation++; }
+
+		/// <summary>
+		/// Write statistics about the index and how it was used to the log.
+		/// </summary>
+		void log_statistics() const;
+
+	private:
+		struct directory
+		{
+			bool exists = false;
+			size_t generation = 0;
+			std::filesystem::path path;
+			std::filesystem::file_time_type last_write_time;
+			std::vector<std::filesystem::path> files;
+			std::unordered_map<std::wstring, size_t> names; // Lowercase file name to index into 'files'
+		};
+
+		const directory &lookup(const std::filesystem::path &search_path);
+
+		size_t _generation = 1;
+		std::unordered_map<std::wstring, directory> _directories;
+
+		size_t _num_scans = 0;
+		size_t _num_hits = 0;
+		size_t _num_misses = 0;
+		size_t _num_fallbacks = 0;
+	};
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "frame_capture.hpp"
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+	struct file_header
+	{
+		char magic[4] = { 'R', 'S', 'F', 'C' };
+		uint32_t version = 1;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t format = 0; // 0 = RGBA8
+		uint32_t frame_size = 0;
+		uint32_t reserved[2] = {};
+	};
+	struct frame_header
+	{
+		uint64_t index;
+		uint64_t timestamp;
+		uint64_t latency;
+	};
+
+	static_assert(sizeof(file_header) == 32 && sizeof(frame_header) == 24);
+}
+
+reshade::frame_capture::~frame_capture()
+{
+	stop();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+bool reshade::frame_capture::start(const std::filesystem::path &path, unsigned int width, unsigned int height, size_t num_buffers)
+{
+	assert(!is_active() && num_buffers != 0);
+
+	// Do not wait for the I/O thread of a previous capture to finish writing its remaining frames, since that would stall the render thread
+	if (is_writing())
+	{
+		LOG(WARN) << "Cannot start frame capture while the previous one is still being written to " << _path << '.';
+		return false;
+	}
+
+	// The I/O thread is done already at this point, so this returns right away
+	if (_thread.joinable())
+		_thread.join();
+
+	const size_t frame_size = size_t(width) * size_t(height) * 4;
+
+	if (_wfopen_s(&_file, path.c_str(), L"wb") != 0)
+	{
+		LOG(ERROR) << "Failed to open " << path << " for frame capture!";
+		return false;
+	}
+
+	file_header header;
+	header.width = width;
+	header.height = height;
+	header.frame_size = static_cast<uint32_t>(frame_size);
+
+	if (fwrite(&header, sizeof(header), 1, _file) != 1)
+	{
+		LOG(ERROR) << "Failed to write frame capture header to " << path << '!';
+		fclose(_file);
+		_file = nullptr;
+		return false;
+	}
+
+	// Allocate all buffers up front, so that no allocations happen while frames are captured
+	_slots.resize(num_buffers);
+	for (frame_slot &slot : _slots)
+		slot.data.resize(frame_size);
+
+	_path = path;
+	_write_index = 0;
+	_read_index = 0;
+	_frames_written = 0;
+	_frames_captured = 0;
+	_frames_dropped = 0;
+	_total_latency = std::chrono::nanoseconds(0);
+	_max_latency = std::chrono::nanoseconds(0);
+	_start_time = std::chrono::high_resolution_clock::now();
+
+	_stop_requested = false;
+	_active = true;
+	_writing = true;
+
+	_thread = std::thread(&frame_capture::write_frames, this);
+
+	LOG(INFO) << "Started frame capture to " << path << " with " << num_buffers << " buffers of " << width << 'x' << height << " pixels.";
+
+	return true;
+}
+void reshade::frame_capture::stop()
+{
+	if (!_active.exchange(false))
+		return;
+
+	LOG(INFO) << "Stopped frame capture after " << _frames_captured << " frames (" << _frames_dropped << " dropped, "
+		<< (average_latency().count() * 1e-6f) << " ms average and " << (_max_latency.count() * 1e-6f) << " ms maximum capture latency).";
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+		_stop_requested = true;
+	}
+
+	_signal.notify_one();
+}
+
+uint8_t *reshade::frame_capture::begin_frame()
+{
+	if (!is_active())
+		return nullptr;
+
+	const size_t write_index = _write_index.load(std::memory_order_relaxed);
+
+	// Drop the frame if the I/O thread has not caught up yet, rather than waiting on it
+	if (write_index - _read_index.load(std::memory_order_acquire) >= _slots.size())
+	{
+		_frames_dropped++;
+		return nullptr;
+	}
+
+	return _slots[write_index % _slots.size()].data.data();
+}
+void reshade::frame_capture::end_frame(uint64_t frame_index, std::chrono::nanoseconds latency, bool success)
+{
+	if (!success)
+	{
+		_frames_dropped++;
+		return;
+	}
+
+	const size_t write_index = _write_index.load(std::memory_order_relaxed);
+
+	frame_slot &slot = _slots[write_index % _slots.size()];
+	slot.index = frame_index;
+	slot.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _start_time).count();
+	slot.latency = latency.count();
+
+	_frames_captured++;
+	_total_latency += latency;
+	_max_latency = std::max(_max_latency, latency);
+
+	_write_index.store(write_index + 1, std::memory_order_release);
+
+	// Acquire the lock briefly so that the notification cannot get lost between the I/O thread checking for work and starting to wait
+	{ const std::lock_guard<std::mutex> lock(_mutex); }
+	_signal.notify_one();
+}
+
+void reshade::frame_capture::write_frames()
+{
+	bool success = true;
+
+	while (true)
+	{
+		size_t read_index = _read_index.load(std::memory_order_relaxed);
+
+		{ std::unique_lock<std::mutex> lock(_mutex);
+			_signal.wait(lock, [this, read_index]() { return _stop_requested || _write_index.load(std::memory_order_acquire) != read_index; });
+		}
+
+		// Write out all frames that are ready (including those still queued after a stop was requested)
+		const size_t write_index = _write_index.load(std::memory_order_acquire);
+		if (read_index == write_index)
+			break;
+
+		for (; read_index != write_index && success; ++read_index)
+		{
+			const frame_slot &slot = _slots[read_index % _slots.size()];
+
+			const frame_header header = { slot.index, slot.timestamp, slot.latency };
+			success = fwrite(&header, sizeof(header), 1, _file) == 1 &&
+				fwrite(slot.data.data(), slot.data.size(), 1, _file) == 1;
+
+			// Release the buffer back to the producer
+			_read_index.store(read_index + 1, std::memory_order_release);
+			if (success)
+				_frames_written.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (!success)
+		{
+			LOG(ERROR) << "Failed to write frame to " << _path << "! Aborting frame capture.";
+			_active = false;
+			break;
+		}
+	}
+
+	fclose(_file);
+	_file = nullptr;
+
+	if (success)
+		LOG(INFO) << "Finished writing " << _frames_written.load() << " frames to " << _path << '.';
+
+	_writing.store(false, std::memory_order_release);
+}
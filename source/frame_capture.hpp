@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// Streams a sequence of frames to disk using a preallocated ring of buffers and a dedicated I/O thread.
+	/// Frames are dropped when all buffers are still waiting to be written, so that the render thread never has to wait on disk I/O.
+	/// </summary>
+	/// <remarks>
+	/// The output is a simple raw container: A 32-byte file header ('RSFC' magic, version, width, height, format, frame size and reserved space),
+	/// followed by a 24-byte header (frame index, timestamp and capture latency in nanoseconds) and the tightly packed RGBA8 pixels for every frame.
+	/// </remarks>
+	class frame_capture
+	{
+	public:
+		frame_capture() = default;
+		~frame_capture();
+
+		frame_capture(const frame_capture &) = delete;
+		frame_capture &operator=(const frame_capture &) = delete;
+
+		/// <summary>
+		/// Return whether a capture is currently in progress and accepts new frames.
+		/// </summary>
+		bool is_active() const { return _active.load(std::memory_order_relaxed); }
+		/// <summary>
+		/// Return whether the I/O thread is still writing frames of the current or a previous capture.
+		/// </summary>
+		bool is_writing() const { return _writing.load(std::memory_order_acquire); }
+
+		/// <summary>
+		/// Open the output file, allocate the buffer ring and start the I/O thread.
+		/// </summary>
+		/// <param name="path">The path to the container file to create.</param>
+		/// <param name="width">The width of every frame in pixels.</param>
+		/// <param name="height">The height of every frame in pixels.</param>
+		/// <param name="num_buffers">The number of frames that can be queued for writing before new ones are dropped.</param>
+		/// <returns><c>true</c> if the capture was started, <c>false</c> otherwise (e.g. because the frames of the previous capture are still being written).</returns>
+		bool start(const std::filesystem::path &path, unsigned int width, unsigned int height, size_t num_buffers);
+		/// <summary>
+		/// Stop accepting new frames. Frames still in the ring are written out by the I/O thread before it exits, without blocking the caller.
+		/// </summary>
+		void stop();
+
+		/// <summary>
+		/// Reserve the next free buffer in the ring. Only call this from a single producer thread.
+		/// </summary>
+		/// <returns>A pointer to a buffer that fits a full 32bpp RGBA frame, or <c>nullptr</c> if the frame has to be dropped.</returns>
+		uint8_t *begin_frame();
+		/// <summary>
+		/// Commit the buffer reserved with <see cref="begin_frame"/> to the I/O thread.
+		/// </summary>
+		/// <param name="frame_index">The index of the frame the buffer contains.</param>
+		/// <param name="latency">The time it took to copy the frame into the buffer.</param>
+		/// <param name="success">Set to <c>false</c> to discard the buffer instead (e.g. because the copy failed).</param>
+		void end_frame(uint64_t frame_index, std::chrono::nanoseconds latency, bool success = true);
+
+		/// <summary>
+		/// Return the path to the file that is written to.
+		/// </summary>
+		const std::filesystem::path &path() const { return _path; }
+
+		/// <summary>
+		/// Return the number of frames that were queued for writing so far.
+		/// </summary>
+		uint64_t frames_captured() const { return _frames_captured; }
+		/// <summary>
+		/// Return the number of frames that were dropped because the ring was full or the copy failed.
+		/// </summary>
+		uint64_t frames_dropped() const { return _frames_dropped; }
+		/// <summary>
+		/// Return the number of frames that were written to disk so far.
+		/// </summary>
+		uint64_t frames_written() const { return _frames_written.load(std::memory_order_relaxed); }
+		/// <summary>
+		/// Return the average and maximum time it took to copy a frame into a buffer.
+		/// </summary>
+		std::chrono::nanoseconds average_latency() const { return _frames_captured != 0 ? _total_latency / static_cast<std::chrono::nanoseconds::rep>(_frames_captured) : std::chrono::nanoseconds(0); }
+		std::chrono::nanoseconds max_latency() const { return _max_latency; }
+
+	private:
+		struct frame_slot
+		{
+			uint64_t index = 0;
+			uint64_t timestamp = 0;
+			uint64_t latency = 0;
+			std::vector<uint8_t> data;
+		};
+
+		void write_frames();
+
+		FILE *_file = nullptr;
+		std::filesystem::path _path;
+		std::vector<frame_slot> _slots;
+		std::thread _thread;
+		std::mutex _mutex;
+		std::condition_variable _signal;
+		std::atomic<bool> _active = false;
+		std::atomic<bool> _stop_requested = false;
+		std::atomic<bool> _writing = false;
+		// Producer increments '_write_index' after filling a slot, the I/O thread increments '_read_index' after writing it
+		std::atomic<size_t> _write_index = 0;
+		std::atomic<size_t> _read_index = 0;
+		std::atomic<uint64_t> _frames_written = 0;
+
+		// These are only accessed by the producer thread
+		uint64_t _frames_captured = 0;
+		uint64_t _frames_dropped = 0;
+		std::chrono::nanoseconds _total_latency = {};
+		std::chrono::nanoseconds _max_latency = {};
+		std::chrono::high_resolution_clock::time_point _start_time;
+	};
+}
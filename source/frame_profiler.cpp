@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "dll_log.hpp"
+#include "frame_profiler.hpp"
+#include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// Enough for several hundred frames with a typical number of techniques and passes
+static constexpr size_t ring_size = 65536;
+
+reshade::frame_profiler::~frame_profiler()
+{
+	if (_export_thread.joinable())
+		_export_thread.join();
+}
+
+void reshade::frame_profiler::set_enabled(bool enabled)
+{
+	if (enabled && _events == nullptr)
+		_events = std::make_unique<event[]>(ring_size);
+
+	_enabled = enabled;
+	_frame_begin = now();
+}
+
+void reshade::frame_profiler::next_frame(uint64_t frame_index)
+{
+	if (!_enabled)
+		return;
+
+	const uint64_t time = now();
+	record(timeline::cpu, "Frame", _frame, _frame_begin, time);
+
+	_frame = static_cast<uint32_t>(frame_index);
+	_frame_begin = time;
+}
+
+void reshade::frame_profiler::add_gpu_event(std::string_view name, uint64_t duration)
+{
+	if (!_enabled)
+		return;
+
+	// Keep events on the GPU timeline from overlapping, since the GPU executes the work one after another too
+	const uint64_t begin = std::max(now(), _gpu_end);
+	_gpu_end = begin + duration;
+
+	record(timeline::gpu, name, no_index, begin, _gpu_end);
+}
+
+void reshade::frame_profiler::record(timeline track, std::string_view name, uint32_t index, uint64_t begin, uint64_t end)
+{
+	const uint64_t write_index = _write_index.load(std::memory_order_relaxed);
+
+	event &e = _events[write_index % ring_size];
+	const size_t name_length = std::min(name.size(), sizeof(e.name) - 1);
+	std::memcpy(e.name, name.data(), name_length);
+	e.name[name_length] = '\0';
+	e.track = track;
+	e.index = index;
+	e.frame = _frame;
+	e.begin = begin;
+	e.end = end;
+
+	_write_index.store(write_index + 1, std::memory_order_release);
+}
+
+bool reshade::frame_profiler::export_trace(const std::filesystem::path &path, size_t num_frames)
+{
+	if (_events == nullptr)
+		return false;
+
+	// Do not wait for the previous trace to be written, since that would stall the calling thread
+	if (is_exporting())
+	{
+		LOG(WARN) << "Cannot save profiler trace while the previous one is still being written.";
+		return false;
+	}
+
+	// The export thread is done already at this point, so this returns right away
+	if (_export_thread.joinable())
+		_export_thread.join();
+
+	// Copy the events out of the ring first, so that the render thread can continue to record new ones in the meantime
+	const uint64_t end_index = _write_index.load(std::memory_order_acquire);
+	const uint64_t begin_index = end_index > ring_size ? end_index - ring_size : 0;
+
+	std::vector<event> events(static_cast<size_t>(end_index - begin_index));
+	for (uint64_t i = begin_index; i < end_index; ++i)
+		events[static_cast<size_t>(i - begin_index)] = _events[i % ring_size];
+
+	// Throw away all events that may have been overwritten while copying (including the one that may be in the process of being written)
+	if (const uint64_t current_index = _write_index.load(std::memory_order_acquire); current_index >= begin_index + ring_size)
+	{
+		const uint64_t first_valid_index = std::min(current_index - ring_size + 1, end_index);
+		events.erase(events.begin(), events.begin() + static_cast<ptrdiff_t>(first_valid_index - begin_index));
+	}
+
+	if (events.empty())
+		return false;
+
+	// Formatting and writing the file takes a while for a full ring, so do that on a separate thread
+	_exporting = true;
+	_export_thread = std::thread([this, path, events = std::move(events), num_frames]() mutable {
+		write_trace(path, std::move(events), num_frames);
+		_exporting.store(false, std::memory_order_release);
+	});
+
+	return true;
+}
+
+void reshade::frame_profiler::write_trace(const std::filesystem::path &path, std::vector<event> events, size_t num_frames)
+{
+	const uint32_t last_frame = std::max_element(events.begin(), events.end(),
+		[](const event &lhs, const event &rhs) { return lhs.frame < rhs.frame; })->frame;
+	const uint32_t first_frame = last_frame >= num_frames ? static_cast<uint32_t>(last_frame - num_frames + 1) : 0;
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const event &e : events)
+	{
+		if (e.frame < first_frame)
+			continue;
+
+		json += ",\n{\"name\":\"";
+		for (const char *c = e.name; *c != '\0'; ++c)
+		{
+			if (*c == '\"' || *c == '\\')
+				json += '\\';
+			if (static_cast<unsigned char>(*c) >= 0x20)
+				json += *c;
+		}
+		if (e.index != no_index)
+			json += ' ' + std::to_string(e.index);
+
+		char buf[160];
+		sprintf_s(buf, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+			e.track == timeline::gpu ? "gpu" : "cpu", e.track == timeline::gpu ? 2 : 1, e.begin * 1e-3, (e.end - e.begin) * 1e-3, e.frame);
+		json += buf;
+	}
+
+	json += "\n]}\n";
+
+	FILE *file = nullptr;
+	if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+	{
+		LOG(ERROR) << "Failed to open " << path << " for writing profiler trace!";
+		return;
+	}
+
+	const bool success = fwrite(json.data(), 1, json.size(), file) == json.size();
+	fclose(file);
+
+	if (success)
+		LOG(INFO) << "Saved profiler trace of " << (last_frame - first_frame + 1) << " frames to " << path << '.';
+	else
+		LOG(ERROR) << "Failed to write profiler trace to " << path << '!';
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+
+namespace reshade
+{
+	/// <summary>
+	/// Records the time nested sections of every frame take on the CPU (and on the GPU where timestamp queries are available) into a fixed-size ring buffer,
+	/// so that the last frames can be exported in the Chrome trace event format (which can be viewed in "chrome://tracing" or Perfetto).
+	/// </summary>
+	/// <remarks>
+	/// Events are only ever recorded by the render thread. Exporting copies them out of the ring and leaves formatting and writing the file to a separate thread.
+	/// </remarks>
+	class frame_profiler
+	{
+	public:
+		static constexpr uint32_t no_index = 0xFFFFFFFF;
+
+		frame_profiler() = default;
+		~frame_profiler();
+
+		frame_profiler(const frame_profiler &) = delete;
+		frame_profiler &operator=(const frame_profiler &) = delete;
+
+		/// <summary>
+		/// Measures the CPU time between its construction and destruction. Does nothing when the profiler is disabled.
+		/// </summary>
+		class scope
+		{
+		public:
+			scope(frame_profiler &profiler, std::string_view name, uint32_t index = no_index) :
+				_profiler(profiler._enabled ? &profiler : nullptr), _name(name), _index(index)
+			{
+				if (_profiler != nullptr)
+					_begin = _profiler->now();
+			}
+			~scope()
+			{
+				if (_profiler != nullptr)
+					_profiler->record(timeline::cpu, _name, _index, _begin, _profiler->now());
+			}
+
+			scope(const scope &) = delete;
+			scope &operator=(const scope &) = delete;
+
+		private:
+			frame_profiler *const _profiler;
+			const std::string_view _name;
+			const uint32_t _index;
+			uint64_t _begin = 0;
+		};
+
+		/// <summary>
+		/// Return whether events are currently recorded.
+		/// </summary>
+		bool is_enabled() const { return _enabled; }
+		/// <summary>
+		/// Start or stop recording events. The ring buffer is only allocated the first time recording is started.
+		/// </summary>
+		void set_enabled(bool enabled);
+
+		/// <summary>
+		/// Mark the start of a new frame and record the previous one as a whole.
+		/// </summary>
+		/// <param name="frame_index">The index of the frame that starts now.</param>
+		void next_frame(uint64_t frame_index);
+
+		/// <summary>
+		/// Record work on the GPU, as measured by timestamp queries.
+		/// Since query results only become available some time after the work was submitted, it is placed on a separate timeline starting at the current time.
+		/// </summary>
+		/// <param name="name">The name of the event (e.g. the technique name).</param>
+		/// <param name="duration">The time the work took on the GPU in nanoseconds.</param>
+		void add_gpu_event(std::string_view name, uint64_t duration);
+
+		/// <summary>
+		/// Return whether a previously exported trace is still being written.
+		/// </summary>
+		bool is_exporting() const { return _exporting.load(std::memory_order_acquire); }
+
+		/// <summary>
+		/// Copy the events of the last frames out of the ring and write them to a JSON file in the Chrome trace event format on a separate thread.
+		/// </summary>
+		/// <param name="path">The path to the file to create.</param>
+		/// <param name="num_frames">The number of frames to include, counting back from the current one.</param>
+		/// <returns><c>true</c> if writing the file was started, <c>false</c> otherwise (e.g. because there are no events or the previous trace is still being written).</returns>
+		bool export_trace(const std::filesystem::path &path, size_t num_frames);
+
+	private:
+		enum class timeline : uint8_t
+		{
+			cpu,
+			gpu
+		};
+
+		struct event
+		{
+			char name[47];
+			timeline track;
+			uint32_t index;
+			uint32_t frame;
+			uint64_t begin;
+			uint64_t end;
+		};
+
+		uint64_t now() const
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - _start_time).count();
+		}
+
+		void record(timeline track, std::string_view name, uint32_t index, uint64_t begin, uint64_t end);
+
+		static void write_trace(const std::filesystem::path &path, std::vector<event> events, size_t num_frames);
+
+		bool _enabled = false;
+		uint32_t _frame = 0;
+		uint64_t _frame_begin = 0;
+		uint64_t _gpu_end = 0;
+		const std::chrono::high_resolution_clock::time_point _start_time = std::chrono::high_resolution_clock::now();
+
+		// The writer publishes an event by incrementing '_write_index' after filling its slot, which overwrites the oldest event once the ring is full
+		std::unique_ptr<event[]> _events;
+		std::atomic<uint64_t> _write_index = 0;
+
+		std::thread _export_thread;
+		std::atomic<bool> _exporting = false;
+	};
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "frame_statistics.hpp"
+#include <cmath>
+#include <algorithm>
+
+void reshade::duration_histogram::clear()
+{
+	_count = 0;
+	_sum = 0;
+	_max = 0;
+	std::fill_n(_buckets, num_buckets, 0u);
+}
+
+void reshade::duration_histogram::append(uint64_t value)
+{
+	_count++;
+	_sum += value;
+	_max = std::max(_max, value);
+	_buckets[bucket_index(value)]++;
+}
+
+uint64_t reshade::duration_histogram::percentile(double fraction) const
+{
+	if (_count == 0)
+		return 0;
+
+	const uint64_t rank = std::clamp(static_cast<uint64_t>(std::ceil(fraction * _count)), uint64_t(1), _count);
+
+	uint64_t sum = 0;
+	for (size_t i = 0; i < num_buckets; ++i)
+		if ((sum += _buckets[i]) >= rank)
+			return std::min(bucket_value(i), _max); // The maximum is exact, so use it to avoid overshooting in the last bucket
+
+	return _max;
+}
+
+size_t reshade::duration_histogram::bucket_index(uint64_t value)
+{
+	value = std::min(value, (uint64_t(1) << max_value_bits) - 1);
+
+	// The first group of buckets covers small values with a width of one each
+	if (value < (uint64_t(1) << sub_bucket_bits))
+		return static_cast<size_t>(value);
+
+	unsigned int msb = sub_bucket_bits;
+	while (value >> (msb + 1))
+		msb++;
+
+	// Every following group covers the next power of two, split into sub-buckets of equal width
+	const unsigned int group = msb - sub_bucket_bits + 1;
+	const size_t sub_bucket = static_cast<size_t>(value >> (group - 1)) - (size_t(1) << sub_bucket_bits);
+
+	return (size_t(group) << sub_bucket_bits) + sub_bucket;
+}
+
+uint64_t reshade::duration_histogram::bucket_value(size_t index)
+{
+	const unsigned int group = static_cast<unsigned int>(index >> sub_bucket_bits);
+	const uint64_t sub_bucket = index & ((size_t(1) << sub_bucket_bits) - 1);
+
+	if (group == 0)
+		return sub_bucket;
+
+	// Report the center of the range the bucket covers
+	const uint64_t width = uint64_t(1) << (group - 1);
+	return (((uint64_t(1) << sub_bucket_bits) + sub_bucket) << (group - 1)) + width / 2;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+namespace reshade
+{
+	/// <summary>
+	/// Histogram of durations in nanoseconds with logarithmically spaced buckets, which allows estimating percentiles of an unbounded number of samples in constant memory.
+	/// Every power of two is split into 16 linear sub-buckets, so that estimates are within about 3% of the actual value.
+	/// </summary>
+	class duration_histogram
+	{
+	public:
+		/// <summary>
+		/// Remove all samples.
+		/// </summary>
+		void clear();
+		/// <summary>
+		/// Add a sample. Durations longer than about 18 minutes are counted as that.
+		/// </summary>
+		void append(uint64_t value);
+
+		/// <summary>
+		/// Return the number of samples.
+		/// </summary>
+		uint64_t count() const { return _count; }
+		/// <summary>
+		/// Return the exact average and maximum of all samples.
+		/// </summary>
+		uint64_t mean() const { return _count != 0 ? _sum / _count : 0; }
+		uint64_t max() const { return _max; }
+		/// <summary>
+		/// Estimate the value below which the specified fraction of samples falls.
+		/// </summary>
+		/// <param name="fraction">The fraction of samples in the range [0, 1] (e.g. 0.95 for the 95th percentile).</param>
+		uint64_t percentile(double fraction) const;
+
+	private:
+		static constexpr unsigned int sub_bucket_bits = 4;
+		static constexpr unsigned int max_value_bits = 40;
+		static constexpr size_t num_buckets = (max_value_bits - sub_bucket_bits + 1) << sub_bucket_bits;
+
+		static size_t bucket_index(uint64_t value);
+		static uint64_t bucket_value(size_t index);
+
+		uint64_t _count = 0;
+		uint64_t _sum = 0;
+		uint64_t _max = 0;
+		uint32_t _buckets[num_buckets] = {};
+	};
+
+	/// <summary>
+	/// Collects durations in windows of time, so that the reported statistics reflect recent behavior instead of everything since startup.
+	/// </summary>
+	class duration_statistics
+	{
+	public:
+		/// <summary>
+		/// Remove all samples, including those of the previous window.
+		/// </summary>
+		void clear() { _current.clear(); _previous.clear(); }
+		/// <summary>
+		/// Add a sample to the current window.
+		/// </summary>
+		void append(uint64_t value) { _current.append(value); }
+		/// <summary>
+		/// Finish the current window and start a new one.
+		/// </summary>
+		void next_window() { _previous = _current; _current.clear(); }
+
+		/// <summary>
+		/// Return the statistics of the last complete window, or those of the current one if no window was completed with any samples yet.
+		/// This keeps the reported values stable while a window is still being filled.
+		/// </summary>
+		const duration_histogram &results() const { return _previous.count() != 0 ? _previous : _current; }
+
+	private:
+		duration_histogram _current;
+		duration_histogram _previous;
+	};
+
+	/// <summary>
+	/// A frame that took significantly longer than the frames around it.
+	/// </summary>
+	struct stutter_event
+	{
+		uint64_t frame = 0;
+		std::chrono::nanoseconds time = {};
+		uint64_t duration = 0;
+		uint64_t median_duration = 0;
+	};
+}
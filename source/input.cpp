@@ -158,27 +158,27 @@ bool reshade::input::handle_window_message(const void *message_data)
 				break; // Input is already handled (since legacy mouse messages are enabled), so nothing to do here
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_DOWN)
-				input->_keys[VK_LBUTTON] = 0x88;
+				input->update_key_state(VK_LBUTTON, true);
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_LEFT_BUTTON_UP)
-				input->_keys[VK_LBUTTON] = 0x08;
+				input->update_key_state(VK_LBUTTON, false);
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN)
-				input->_keys[VK_RBUTTON] = 0x88;
+				input->update_key_state(VK_RBUTTON, true);
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)
-				input->_keys[VK_RBUTTON] = 0x08;
+				input->update_key_state(VK_RBUTTON, false);
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_DOWN)
-				input->_keys[VK_MBUTTON] = 0x88;
+				input->update_key_state(VK_MBUTTON, true);
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_MIDDLE_BUTTON_UP)
-				input->_keys[VK_MBUTTON] = 0x08;
+				input->update_key_state(VK_MBUTTON, false);
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_DOWN)
-				input->_keys[VK_XBUTTON1] = 0x88;
+				input->update_key_state(VK_XBUTTON1, true);
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_4_UP)
-				input->_keys[VK_XBUTTON1] = 0x08;
+				input->update_key_state(VK_XBUTTON1, false);
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_DOWN)
-				input->_keys[VK_XBUTTON2] = 0x88;
+				input->update_key_state(VK_XBUTTON2, true);
 			else if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_BUTTON_5_UP)
-				input->_keys[VK_XBUTTON2] = 0x08;
+				input->update_key_state(VK_XBUTTON2, false);
 
 			if (raw_data.data.mouse.usButtonFlags & RI_MOUSE_WHEEL)
 				input->_mouse_wheel_delta += static_cast<short>(raw_data.data.mouse.usButtonData) / WHEEL_DELTA;
@@ -194,7 +194,7 @@ bool reshade::input::handle_window_message(const void *message_data)
 
 			// Filter out prefix messages without a key code
 			if (raw_data.data.keyboard.VKey < 0xFF)
-				input->_keys[raw_data.data.keyboard.VKey] = (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0 ? 0x88 : 0x08,
+				input->update_key_state(raw_data.data.keyboard.VKey, (raw_data.data.keyboard.Flags & RI_KEY_BREAK) == 0),
 				input->_keys_time[raw_data.data.keyboard.VKey] = details.time;
 
 			// No 'WM_CHAR' messages are sent if legacy keyboard messages are disabled, so need to generate text input manually here
@@ -211,7 +211,7 @@ bool reshade::input::handle_window_message(const void *message_data)
 	case WM_KEYDOWN:
 	case WM_SYSKEYDOWN:
 		assert(details.wParam < ARRAYSIZE(input->_keys));
-		input->_keys[details.wParam] = 0x88;
+		input->update_key_state(static_cast<unsigned int>(details.wParam), true);
 		input->_keys_time[details.wParam] = details.time;
 		if (input->_block_keyboard)
 			input->_keys[details.wParam] |= 0x04;
@@ -222,37 +222,37 @@ bool reshade::input::handle_window_message(const void *message_data)
 		// Do not block key up messages if the key down one was not blocked previously (so key does not get stuck for the application)
 		if (input->_block_keyboard && (input->_keys[details.wParam] & 0x04) == 0)
 			is_keyboard_message = false;
-		input->_keys[details.wParam] = 0x08;
+		input->update_key_state(static_cast<unsigned int>(details.wParam), false);
 		input->_keys_time[details.wParam] = details.time;
 		break;
 	case WM_LBUTTONDOWN:
-		input->_keys[VK_LBUTTON] = 0x88;
+		input->update_key_state(VK_LBUTTON, true);
 		break;
 	case WM_LBUTTONUP:
-		input->_keys[VK_LBUTTON] = 0x08;
+		input->update_key_state(VK_LBUTTON, false);
 		break;
 	case WM_RBUTTONDOWN:
-		input->_keys[VK_RBUTTON] = 0x88;
+		input->update_key_state(VK_RBUTTON, true);
 		break;
 	case WM_RBUTTONUP:
-		input->_keys[VK_RBUTTON] = 0x08;
+		input->update_key_state(VK_RBUTTON, false);
 		break;
 	case WM_MBUTTONDOWN:
-		input->_keys[VK_MBUTTON] = 0x88;
+		input->update_key_state(VK_MBUTTON, true);
 		break;
 	case WM_MBUTTONUP:
-		input->_keys[VK_MBUTTON] = 0x08;
+		input->update_key_state(VK_MBUTTON, false);
 		break;
 	case WM_MOUSEWHEEL:
 		input->_mouse_wheel_delta += GET_WHEEL_DELTA_WPARAM(details.wParam) / WHEEL_DELTA;
 		break;
 	case WM_XBUTTONDOWN:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x88;
+		input->update_key_state(VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1), true);
 		break;
 	case WM_XBUTTONUP:
 		assert(HIWORD(details.wParam) == XBUTTON1 || HIWORD(details.wParam) == XBUTTON2);
-		input->_keys[VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1)] = 0x08;
+		input->update_key_state(VK_XBUTTON1 + (HIWORD(details.wParam) - XBUTTON1), false);
 		break;
 	}
 
@@ -353,12 +353,24 @@ bool reshade::input::is_any_mouse_button_released() const
 	return false;
 }
 
+void reshade::input::update_key_state(unsigned int keycode, bool down)
+{
+	assert(keycode < ARRAYSIZE(_keys));
+
+	// Only record the first change of a key per frame, so that the list contains every key at most once
+	if ((_keys[keycode] & 0x08) == 0)
+		_changed_keys.push_back(keycode);
+
+	_keys[keycode] = down ? 0x88 : 0x08;
+}
+
 void reshade::input::next_frame()
 {
 	_frame_count++;
 
 	for (auto &state : _keys)
 		state &= ~0x08;
+	_changed_keys.clear();
 
 	// Reset any pressed down key states (apart from mouse buttons) that have not been updated for more than 5 seconds
 	// Do not check mouse buttons here, since 'GetAsyncKeyState' always returns the state of the physical mouse buttons, not the logical ones in case they were remapped
@@ -369,7 +381,7 @@ void reshade::input::next_frame()
 		if ((_keys[i] & 0x80) != 0 &&
 			(time - _keys_time[i]) > 5000 &&
 			(GetAsyncKeyState(i) & 0x8000) == 0)
-			(_keys[i] = 0x08);
+			update_key_state(i, false);
 
 	_text_input.clear();
 	_mouse_wheel_delta = 0;
@@ -382,12 +394,12 @@ void reshade::input::next_frame()
 	// Update modifier key state
 	if ((_keys[VK_MENU] & 0x88) != 0 &&
 		(GetKeyState(VK_MENU) & 0x8000) == 0)
-		(_keys[VK_MENU] = 0x08);
+		update_key_state(VK_MENU, false);
 
 	// Update print screen state (there is no key down message, but the key up one is received via the message queue)
 	if ((_keys[VK_SNAPSHOT] & 0x80) == 0 &&
 		(GetAsyncKeyState(VK_SNAPSHOT) & 0x8000) != 0)
-		(_keys[VK_SNAPSHOT] = 0x88),
+		update_key_state(VK_SNAPSHOT, true),
 		(_keys_time[VK_SNAPSHOT] = time);
 }
 
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace reshade
 {
@@ -57,6 +58,12 @@ namespace reshade
 		unsigned int mouse_position_x() const { return _mouse_position[0]; }
 		unsigned int mouse_position_y() const { return _mouse_position[1]; }
 
+		/// <summary>
+		/// Key codes (including mouse buttons) whose state changed in the current frame, in the order they changed.
+		/// This allows handling shortcuts by looking only at keys that were actually pressed, instead of polling every possible binding.
+		/// </summary>
+		const std::vector<unsigned int> &changed_keys() const { return _changed_keys; }
+
 		/// <summary>
 		/// Character input as captured by 'WM_CHAR' for the current frame.
 		/// </summary>
@@ -104,12 +111,15 @@ namespace reshade
 		static bool handle_window_message(const void *message_data);
 
 	private:
+		void update_key_state(unsigned int keycode, bool down);
+
 		std::mutex _mutex;
 		window_handle _window;
 		bool _block_mouse = false;
 		bool _block_keyboard = false;
 		uint8_t _keys[256] = {};
 		unsigned int _keys_time[256] = {};
+		std::vector<unsigned int> _changed_keys;
 		short _mouse_wheel_delta = 0;
 		unsigned int _mouse_position[2] = {};
 		unsigned int _last_mouse_position[2] = {};
@@ -4,23 +4,17 @@
  */
 
 #include "buffer_detection.hpp"
-#include <cmath>
 #include <cassert>
 
 void reshade::opengl::buffer_detection::reset(GLuint default_width, GLuint default_height, GLenum default_format)
 {
-	// Reset statistics for next frame
-	_stats.vertices = 0;
-	_stats.drawcalls = 0;
+	// Do not clear depth source table, since FBO attachments are usually only created during startup
+	// Instead only reset the draw call statistics for next frame
+	reset_core_stats();
 
 #if RESHADE_DEPTH
 	// Initialize information for the default depth buffer
-	_depth_source_table[0] = { 0, 0, default_width, default_height, 0, default_format };
-
-	// Do not clear depth source table, since FBO attachments are usually only created during startup
-	for (auto &source : _depth_source_table)
-		// Instead only reset the draw call statistics
-		source.second.stats = { 0, 0 };
+	static_cast<depthstencil_data &>(_counters_per_used_depthstencil[0]) = { 0, 0, default_width, default_height, 0, default_format };
 #else
 	UNREFERENCED_PARAMETER(default_width);
 	UNREFERENCED_PARAMETER(default_height);
@@ -33,8 +27,7 @@ void reshade::opengl::buffer_detection::on_draw(GLsizei vertices)
 	vertices += _current_vertex_count;
 	_current_vertex_count = 0;
 
-	_stats.vertices += vertices;
-	_stats.drawcalls += 1;
+	count_draw(vertices);
 
 #if RESHADE_DEPTH
 	GLint object = 0;
@@ -47,12 +40,10 @@ void reshade::opengl::buffer_detection::on_draw(GLsizei vertices)
 		glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &object);
 	}
 
-	if (const auto it = _depth_source_table.find(object | (target == GL_RENDERBUFFER ? 0x80000000 : 0));
-		it != _depth_source_table.end())
-	{
-		it->second.stats.vertices += vertices;
-		it->second.stats.drawcalls += 1;
-	}
+	// Only count draw calls to depth-stencils that were attached through a tracked FBO
+	if (const GLuint id = object | (target == GL_RENDERBUFFER ? 0x80000000 : 0);
+		_counters_per_used_depthstencil.find(id) != nullptr)
+		count_draw(id, vertices);
 #endif
 }
 
@@ -63,10 +54,10 @@ void reshade::opengl::buffer_detection::on_fbo_attachment(GLenum attachment, GLe
 		return;
 
 	const GLuint id = object | (target == GL_RENDERBUFFER ? 0x80000000 : 0);
-	if (_depth_source_table.find(id) != _depth_source_table.end())
+	if (_counters_per_used_depthstencil.find(id) != nullptr)
 		return;
 
-	depthstencil_info info = { object, static_cast<GLuint>(level), 0, 0, target, GL_NONE };
+	depthstencil_data info = { object, static_cast<GLuint>(level), 0, 0, target, GL_NONE };
 
 	if (target == GL_RENDERBUFFER)
 	{
@@ -146,7 +137,7 @@ void reshade::opengl::buffer_detection::on_fbo_attachment(GLenum attachment, GLe
 		glBindTexture(target, previous_tex);
 	}
 
-	_depth_source_table.emplace(id, info);
+	static_cast<depthstencil_data &>(_counters_per_used_depthstencil[id]) = info;
 }
 void reshade::opengl::buffer_detection::on_delete_fbo_attachment(GLenum target, GLuint object)
 {
@@ -154,47 +145,29 @@ void reshade::opengl::buffer_detection::on_delete_fbo_attachment(GLenum target,
 		return;
 
 	const GLuint id = object | (target == GL_RENDERBUFFER ? 0x80000000 : 0);
-	_depth_source_table.erase(id);
+	_counters_per_used_depthstencil.erase(id);
 }
 
-reshade::opengl::buffer_detection::depthstencil_info reshade::opengl::buffer_detection::find_best_depth_texture(GLuint width, GLuint height, GLuint override) const
+reshade::opengl::buffer_detection::depthstencil_info reshade::opengl::buffer_detection::find_best_depth_texture(GLuint width, GLuint height, GLuint override)
 {
-	depthstencil_info best_snapshot = _depth_source_table.at(0); // Always fall back to default depth buffer if no better match is found
+	// Always fall back to default depth buffer if no better match is found (it is also a candidate for selection itself)
+	const depthstencil_info &default_snapshot = *_counters_per_used_depthstencil.find(0);
 
 	if (override != std::numeric_limits<GLuint>::max())
 	{
-		const auto source_it = _depth_source_table.find(override);
-		if (source_it != _depth_source_table.end())
-			return source_it->second;
+		const auto source = _counters_per_used_depthstencil.find(override);
+		if (source != nullptr)
+			return *source;
 		else
-			return best_snapshot;
+			return default_snapshot;
 	}
 
-	for (const auto &[image, snapshot] : _depth_source_table)
-	{
-		if (snapshot.stats.drawcalls == 0 || snapshot.stats.vertices == 0)
-			continue; // Skip unused
-
-		if (width != 0 && height != 0)
-		{
-			const float w = static_cast<float>(width);
-			const float w_ratio = w / snapshot.width;
-			const float h = static_cast<float>(height);
-			const float h_ratio = h / snapshot.height;
-			const float aspect_ratio = (w / h) - (static_cast<float>(snapshot.width) / snapshot.height);
-
-			if (std::fabs(aspect_ratio) > 0.1f || w_ratio > 1.85f || h_ratio > 1.85f || w_ratio < 0.5f || h_ratio < 0.5f)
-				continue; // Not a good fit
-		}
-
-		const auto curr_weight = snapshot.stats.vertices * (1.2f - static_cast<float>(snapshot.stats.drawcalls) / _stats.drawcalls);
-		const auto best_weight = best_snapshot.stats.vertices * (1.2f - static_cast<float>(best_snapshot.stats.drawcalls) / _stats.vertices);
-		if (curr_weight >= best_weight)
-		{
-			best_snapshot = snapshot;
-		}
-	}
+	const auto best = select_best(width, height, depthstencil_selection::weighted_vertices,
+		[](GLuint, const depthstencil_info &snapshot, depthstencil_desc &result) {
+			result = { snapshot.width, snapshot.height };
+			return true;
+		});
 
-	return best_snapshot;
+	return best != nullptr ? best->second : default_snapshot;
 }
 #endif
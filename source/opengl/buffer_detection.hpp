@@ -5,32 +5,23 @@
 
 #pragma once
 
-#include <map>
 #include "opengl.hpp"
+#include "buffer_detection_core.hpp"
 
 namespace reshade::opengl
 {
-	class buffer_detection
+	struct depthstencil_data
 	{
-	public:
-		struct draw_stats
-		{
-			GLuint vertices = 0;
-			GLuint drawcalls = 0;
-		};
-		struct depthstencil_info
-		{
-			GLuint obj, level;
-			GLuint width, height;
-			GLenum target, format;
-			draw_stats stats;
-		};
+		GLuint obj, level;
+		GLuint width, height;
+		GLenum target, format;
+	};
 
+	class buffer_detection : public buffer_detection_core<GLuint, depthstencil_data>
+	{
+	public:
 		void reset(GLuint default_width, GLuint default_height, GLenum default_format);
 
-		GLuint total_vertices() const { return _stats.vertices; }
-		GLuint total_drawcalls() const { return _stats.drawcalls; }
-
 		void on_draw(GLsizei vertices);
 		void on_draw_vertex(GLsizei vertices) { _current_vertex_count += vertices; }
 
@@ -38,17 +29,11 @@ namespace reshade::opengl
 		void on_fbo_attachment(GLenum attachment, GLenum target, GLuint object, GLint level);
 		void on_delete_fbo_attachment(GLenum target, GLuint object);
 
-		const auto &depth_buffer_counters() const { return _depth_source_table; }
-
 		depthstencil_info find_best_depth_texture(GLuint width, GLuint height,
-			GLuint override = std::numeric_limits<GLuint>::max()) const;
+			GLuint override = std::numeric_limits<GLuint>::max());
 #endif
 
 	private:
 		GLuint _current_vertex_count = 0; // Used to calculate vertex count inside glBegin/glEnd pairs
-		draw_stats _stats;
-#if RESHADE_DEPTH
-		std::map<GLuint, depthstencil_info> _depth_source_table;
-#endif
 	};
 }
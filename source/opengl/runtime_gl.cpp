@@ -7,8 +7,12 @@
 #include "runtime_gl.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "frame_profiler.hpp"
+#include "pixel_conversion.hpp"
 #include <imgui.h>
 
+extern std::filesystem::path g_reshade_dll_path;
+
 namespace reshade::opengl
 {
 	struct opengl_tex_data
@@ -303,20 +307,8 @@ bool reshade::opengl::runtime_gl::capture_screenshot(uint8_t *buffer) const
 	glReadBuffer(_current_fbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
 	glReadPixels(0, 0, GLsizei(_width), GLsizei(_height), GL_RGBA, GL_UNSIGNED_BYTE, buffer);
 
-	// Flip image horizontally
-	for (unsigned int y = 0, pitch = _width * 4; y * 2 < _height; ++y)
-	{
-		const auto i1 = y * pitch;
-		const auto i2 = (_height - 1 - y) * pitch;
-
-		for (unsigned int x = 0; x < pitch; x += 4)
-		{
-			std::swap(buffer[i1 + x + 0], buffer[i2 + x + 0]);
-			std::swap(buffer[i1 + x + 1], buffer[i2 + x + 1]);
-			std::swap(buffer[i1 + x + 2], buffer[i2 + x + 2]);
-			std::swap(buffer[i1 + x + 3], buffer[i2 + x + 3]);
-		}
-	}
+	// Flip image vertically
+	pixel::flip_vertically(buffer, _width * 4, _height);
 
 	return true;
 }
@@ -878,19 +870,8 @@ void reshade::opengl::runtime_gl::upload_texture(const texture &texture, const u
 	unsigned int upload_pitch = texture.width * 4;
 	std::vector<uint8_t> upload_data(pixels, pixels + upload_pitch * texture.height);
 
-	// Flip image data horizontally
-	std::vector<uint8_t> temp_image_line(upload_pitch);
-	for (uint32_t y = 0; 2 * y < texture.height; y++)
-	{
-		const auto temp  = temp_image_line.data();
-		const auto line1 = upload_data.data() + upload_pitch * (y);
-		const auto line2 = upload_data.data() + upload_pitch * (texture.height - 1 - y);
-
-		std::memcpy(temp,  line1, upload_pitch);
-		std::memcpy(line1, line2, upload_pitch);
-		std::memcpy(line2, temp,  upload_pitch);
-	}
-	temp_image_line.clear(); // Free up temporary memory now
+	// Flip image data vertically
+	pixel::flip_vertically(upload_data.data(), upload_pitch, texture.height);
 
 	// Get current state
 	GLint previous_tex = 0;
@@ -973,6 +954,8 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 		{
 			glGetQueryObjectui64v(impl->query, GL_QUERY_RESULT, &elapsed_time);
 			technique.average_gpu_duration.append(elapsed_time);
+			technique.gpu_statistics.append(elapsed_time);
+			_profiler->add_gpu_event(technique.name, elapsed_time);
 			impl->query_in_flight = false; // Reset query status
 		}
 	}
@@ -995,7 +978,13 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 	if (_effect_ubos[technique.effect_index] != 0)
 	{
 		glBindBufferBase(GL_UNIFORM_BUFFER, 0, _effect_ubos[technique.effect_index]);
-		glBufferSubData(GL_UNIFORM_BUFFER, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+
+		// Only upload the range that was modified since the last technique of this effect was rendered
+		if (effect &effect = _effects[technique.effect_index]; effect.is_uniform_data_dirty())
+		{
+			glBufferSubData(GL_UNIFORM_BUFFER, effect.uniform_data_dirty_begin, effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin, effect.uniform_data_storage.data() + effect.uniform_data_dirty_begin);
+			effect.clear_uniform_data_dirty();
+		}
 	}
 
 	// Set up shader resources
@@ -1019,6 +1008,11 @@ void reshade::opengl::runtime_gl::render_technique(technique &technique)
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
+		if (technique.culled_passes[pass_index])
+			continue; // Skip passes whose output is never used
+
+		const frame_profiler::scope profile(*_profiler, "Pass", static_cast<uint32_t>(pass_index));
+
 		if (needs_implicit_backbuffer_copy)
 		{
 			// Copy back buffer of previous pass to texture
@@ -1303,6 +1297,15 @@ void reshade::opengl::runtime_gl::draw_depth_debug_menu()
 	if (ImGui::Checkbox("Use aspect ratio heuristics", &_use_aspect_ratio_heuristics))
 		runtime::save_config();
 
+	if (_buffer_detection.is_tracing())
+		ImGui::TextUnformatted("Recording depth buffer detection trace ...");
+	else if (ImGui::Button("Record trace of the next 300 frames", ImVec2(-1, 0)))
+	{
+		// Traces can be replayed with the "buffer_detection_replay" tool in the tests, to find out how changes to the heuristics would affect the selection
+		if (const std::filesystem::path trace_path = g_reshade_dll_path.parent_path() / L"ReShade_depth.trace"; !_buffer_detection.start_trace(trace_path, 300))
+			LOG(ERROR) << "Failed to create depth buffer detection trace " << trace_path << '.';
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
@@ -1321,7 +1324,7 @@ void reshade::opengl::runtime_gl::draw_depth_debug_menu()
 
 		ImGui::SameLine();
 		ImGui::Text("| %4ux%-4u | %5u draw calls ==> %8u vertices |%s",
-			snapshot.width, snapshot.height, snapshot.stats.drawcalls, snapshot.stats.vertices,
+			snapshot.width, snapshot.height, snapshot.total_stats.drawcalls, snapshot.total_stats.vertices,
 			(depth_source & 0x80000000) != 0 ? " RBO" : depth_source != 0 ? " FBO" : "");
 	}
 
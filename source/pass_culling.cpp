@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "pass_culling.hpp"
+
+std::vector<std::vector<bool>> reshade::find_culled_passes(const std::vector<const std::vector<reshadefx::pass_info> *> &techniques, std::unordered_set<std::string_view> live_textures)
+{
+	// Start with every pass culled and then mark passes as needed as long as new dependencies are discovered
+	std::vector<std::vector<bool>> culled_passes(techniques.size());
+	for (size_t technique_index = 0; technique_index < techniques.size(); ++technique_index)
+		culled_passes[technique_index].assign(techniques[technique_index]->size(), true);
+
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+
+		for (size_t technique_index = 0; technique_index < techniques.size(); ++technique_index)
+		{
+			const std::vector<reshadefx::pass_info> &passes = *techniques[technique_index];
+
+			for (size_t pass_index = 0; pass_index < passes.size(); ++pass_index)
+			{
+				if (!culled_passes[technique_index][pass_index])
+					continue;
+
+				const reshadefx::pass_info &pass_info = passes[pass_index];
+
+				// Passes that write to the back buffer or the stencil buffer have visible side effects
+				bool is_live = (pass_info.cs_entry_point.empty() && pass_info.render_target_names[0].empty()) || pass_info.stencil_enable;
+				for (const std::string &name : pass_info.render_target_names)
+					is_live |= !name.empty() && live_textures.find(name) != live_textures.end();
+				for (const std::string &name : pass_info.storage_texture_names)
+					is_live |= live_textures.find(name) != live_textures.end();
+
+				if (!is_live)
+					continue;
+
+				culled_passes[technique_index][pass_index] = false;
+				changed = true;
+
+				// Everything this pass reads is needed too now
+				live_textures.insert(pass_info.sampled_texture_names.begin(), pass_info.sampled_texture_names.end());
+				live_textures.insert(pass_info.storage_texture_names.begin(), pass_info.storage_texture_names.end());
+			}
+		}
+	}
+
+	return culled_passes;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <string_view>
+#include <unordered_set>
+
+namespace reshade
+{
+	/// <summary>
+	/// Find the passes whose outputs are never used, so that they can be skipped.
+	/// Passes that write to the back buffer or the stencil buffer are always needed, as is every pass writing a texture that a needed pass reads (in any technique, since textures keep their contents across frames).
+	/// </summary>
+	/// <param name="techniques">The passes of all enabled techniques.</param>
+	/// <param name="live_textures">Names of textures that have to be kept up to date even if no pass reads them (like the texture currently previewed in the overlay).</param>
+	/// <returns>For every entry in <paramref name="techniques"/> a flag per pass that is set if that pass can be skipped.</returns>
+	std::vector<std::vector<bool>> find_culled_passes(const std::vector<const std::vector<reshadefx::pass_info> *> &techniques, std::unordered_set<std::string_view> live_textures = {});
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "pixel_conversion.hpp"
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#include <cpuid.h>
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+static bool has_avx2_support()
+{
+	static const bool supported = []() {
+#ifdef _MSC_VER
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		// Check that the OS saves YMM registers on context switches (OSXSAVE and AVX bits)
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}();
+	return supported;
+}
+
+static std::atomic<reshade::pixel::instruction_set> s_instruction_set_limit = reshade::pixel::instruction_set::avx2;
+
+reshade::pixel::instruction_set reshade::pixel::current_instruction_set()
+{
+	// SSE2 is part of every x64 CPU, so only AVX2 needs to be checked
+	const instruction_set supported = has_avx2_support() ? instruction_set::avx2 : instruction_set::sse2;
+	return std::min(supported, s_instruction_set_limit.load(std::memory_order_relaxed));
+}
+void reshade::pixel::limit_instruction_set(instruction_set max)
+{
+	s_instruction_set_limit.store(max, std::memory_order_relaxed);
+}
+
+// All kernels below operate on 32-bit pixels, with the first byte in memory being the lowest byte of the 32-bit value (little-endian)
+
+static inline uint32_t swap_red_blue(uint32_t v)
+{
+	return (v & 0xFF00FF00) | ((v & 0x00FF0000) >> 16) | ((v & 0x000000FF) << 16);
+}
+static inline uint32_t convert_rgb10a2_to_rgba8(uint32_t v)
+{
+	uint32_t a = v & 0xC0000000;
+	// Replicate the two alpha bits into all eight (equivalent to multiplying by 85)
+	a |= a >> 2;
+	a |= a >> 4;
+	// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
+	return ((v >> 2) & 0x000000FF) | ((v >> 4) & 0x0000FF00) | ((v >> 6) & 0x00FF0000) | (a & 0xFF000000);
+}
+
+static inline __m128i swap_red_blue_sse2(__m128i v)
+{
+	const __m128i rb = _mm_and_si128(v, _mm_set1_epi32(0x00FF00FF));
+	return _mm_or_si128(_mm_and_si128(v, _mm_set1_epi32(0xFF00FF00)), _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+}
+static inline __m128i convert_rgb10a2_to_rgba8_sse2(__m128i v)
+{
+	__m128i a = _mm_and_si128(v, _mm_set1_epi32(0xC0000000));
+	a = _mm_or_si128(a, _mm_srli_epi32(a, 2));
+	a = _mm_or_si128(a, _mm_srli_epi32(a, 4));
+	return _mm_or_si128(
+		_mm_or_si128(
+			_mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi32(0x000000FF)),
+			_mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi32(0x0000FF00))),
+		_mm_or_si128(
+			_mm_and_si128(_mm_srli_epi32(v, 6), _mm_set1_epi32(0x00FF0000)),
+			_mm_and_si128(a, _mm_set1_epi32(0xFF000000))));
+}
+
+AVX2_FUNCTION static inline __m256i swap_red_blue_avx2(__m256i v)
+{
+	const __m256i mask = _mm256_setr_epi8(
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	return _mm256_shuffle_epi8(v, mask);
+}
+AVX2_FUNCTION static inline __m256i convert_rgb10a2_to_rgba8_avx2(__m256i v)
+{
+	__m256i a = _mm256_and_si256(v, _mm256_set1_epi32(0xC0000000));
+	a = _mm256_or_si256(a, _mm256_srli_epi32(a, 2));
+	a = _mm256_or_si256(a, _mm256_srli_epi32(a, 4));
+	return _mm256_or_si256(
+		_mm256_or_si256(
+			_mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi32(0x000000FF)),
+			_mm256_and_si256(_mm256_srli_epi32(v, 4), _mm256_set1_epi32(0x0000FF00))),
+		_mm256_or_si256(
+			_mm256_and_si256(_mm256_srli_epi32(v, 6), _mm256_set1_epi32(0x00FF0000)),
+			_mm256_and_si256(a, _mm256_set1_epi32(0xFF000000))));
+}
+
+AVX2_FUNCTION static size_t swap_red_blue_avx2(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), swap_red_blue_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4))));
+	return i;
+}
+AVX2_FUNCTION static size_t clear_alpha_avx2(uint8_t *data, size_t count)
+{
+	const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i * 4), _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 4)), alpha));
+	return i;
+}
+AVX2_FUNCTION static size_t convert_rgb10a2_to_rgba8_avx2(uint8_t *dst, const uint8_t *src, size_t count, bool swap_rb)
+{
+	size_t i = 0;
+	if (swap_rb)
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), swap_red_blue_avx2(convert_rgb10a2_to_rgba8_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4)))));
+	else
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), convert_rgb10a2_to_rgba8_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4))));
+	return i;
+}
+
+void reshade::pixel::swap_red_blue(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	const instruction_set isa = current_instruction_set();
+	if (isa >= instruction_set::avx2)
+		i = swap_red_blue_avx2(dst, src, count);
+	if (isa >= instruction_set::sse2)
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), swap_red_blue_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4))));
+
+	for (uint32_t v; i < count; ++i)
+	{
+		std::memcpy(&v, src + i * 4, 4);
+		v = ::swap_red_blue(v);
+		std::memcpy(dst + i * 4, &v, 4);
+	}
+}
+
+void reshade::pixel::clear_alpha(uint8_t *data, size_t count)
+{
+	size_t i = 0;
+	const instruction_set isa = current_instruction_set();
+	if (isa >= instruction_set::avx2)
+		i = clear_alpha_avx2(data, count);
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+	if (isa >= instruction_set::sse2)
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(data + i * 4), _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 4)), alpha));
+
+	for (; i < count; ++i)
+		data[i * 4 + 3] = 0xFF;
+}
+
+void reshade::pixel::convert_rgb10a2_to_rgba8(uint8_t *dst, const uint8_t *src, size_t count, bool swap_rb)
+{
+	size_t i = 0;
+	const instruction_set isa = current_instruction_set();
+	if (isa >= instruction_set::avx2)
+		i = convert_rgb10a2_to_rgba8_avx2(dst, src, count, swap_rb);
+	if (isa >= instruction_set::sse2)
+	{
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i v = convert_rgb10a2_to_rgba8_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4)));
+			if (swap_rb)
+				v = swap_red_blue_sse2(v);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), v);
+		}
+	}
+
+	for (uint32_t v; i < count; ++i)
+	{
+		std::memcpy(&v, src + i * 4, 4);
+		v = ::convert_rgb10a2_to_rgba8(v);
+		if (swap_rb)
+			v = ::swap_red_blue(v);
+		std::memcpy(dst + i * 4, &v, 4);
+	}
+}
+
+void reshade::pixel::convert_rgba8_to_r8(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	const __m128i mask = _mm_set1_epi32(0x000000FF);
+	const instruction_set isa = current_instruction_set();
+	for (; isa >= instruction_set::sse2 && i + 16 <= count; i += 16)
+	{
+		const auto src_vec = reinterpret_cast<const __m128i *>(src + i * 4);
+		// Values are in range 0-255, so signed saturation when packing to 16-bit does not modify them
+		const __m128i lo = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(src_vec + 0), mask), _mm_and_si128(_mm_loadu_si128(src_vec + 1), mask));
+		const __m128i hi = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(src_vec + 2), mask), _mm_and_si128(_mm_loadu_si128(src_vec + 3), mask));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+	}
+
+	for (; i < count; ++i)
+		dst[i] = src[i * 4];
+}
+void reshade::pixel::convert_rgba8_to_rg8(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	size_t i = 0;
+	const instruction_set isa = current_instruction_set();
+	for (; isa >= instruction_set::sse2 && i + 8 <= count; i += 8)
+	{
+		const auto src_vec = reinterpret_cast<const __m128i *>(src + i * 4);
+		// Sign extend the lower 16 bits, so that signed saturation when packing to 16-bit keeps the bit pattern intact
+		const __m128i lo = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(src_vec + 0), 16), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128(src_vec + 1), 16), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), _mm_packs_epi32(lo, hi));
+	}
+
+	for (; i < count; ++i)
+	{
+		dst[i * 2 + 0] = src[i * 4 + 0];
+		dst[i * 2 + 1] = src[i * 4 + 1];
+	}
+}
+
+void reshade::pixel::flip_vertically(uint8_t *data, size_t pitch, size_t height)
+{
+	for (size_t y = 0; 2 * y + 1 < height; ++y)
+	{
+		uint8_t *const line1 = data + pitch * y;
+		uint8_t *const line2 = data + pitch * (height - 1 - y);
+		std::swap_ranges(line1, line1 + pitch, line2);
+	}
+}
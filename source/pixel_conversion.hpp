@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace reshade::pixel
+{
+	/// <summary>
+	/// The instruction sets the conversion functions below can make use of.
+	/// </summary>
+	enum class instruction_set
+	{
+		scalar,
+		sse2,
+		avx2,
+	};
+
+	/// <summary>
+	/// Return the best instruction set that is supported by the CPU and not excluded by <see cref="limit_instruction_set"/>.
+	/// </summary>
+	instruction_set current_instruction_set();
+	/// <summary>
+	/// Prevent the conversion functions from using instruction sets above the specified one (e.g. to compare the results of the different code paths).
+	/// </summary>
+	void limit_instruction_set(instruction_set max);
+
+	/// <summary>
+	/// Swap red and blue channels of 32bpp pixels (converts BGRA8 to RGBA8 and vice versa).
+	/// Source and destination may point to the same memory.
+	/// </summary>
+	/// <param name="dst">The output buffer, which must fit <paramref name="count"/> 32bpp pixels.</param>
+	/// <param name="src">The input 32bpp pixels.</param>
+	/// <param name="count">The number of pixels to convert.</param>
+	void swap_red_blue(uint8_t *dst, const uint8_t *src, size_t count);
+
+	/// <summary>
+	/// Set alpha channel of 32bpp RGBA8 or BGRA8 pixels to fully opaque.
+	/// </summary>
+	/// <param name="data">The pixels to update in place.</param>
+	/// <param name="count">The number of pixels to update.</param>
+	void clear_alpha(uint8_t *data, size_t count);
+
+	/// <summary>
+	/// Convert RGB10A2 (or BGR10A2 with <paramref name="swap_rb"/> set) pixels to RGBA8 by truncating each channel.
+	/// Source and destination may point to the same memory.
+	/// </summary>
+	/// <param name="dst">The output buffer, which must fit <paramref name="count"/> 32bpp pixels.</param>
+	/// <param name="src">The input 32bpp packed pixels.</param>
+	/// <param name="count">The number of pixels to convert.</param>
+	/// <param name="swap_rb">Set to <c>true</c> to swap red and blue channels in the output.</param>
+	void convert_rgb10a2_to_rgba8(uint8_t *dst, const uint8_t *src, size_t count, bool swap_rb = false);
+
+	/// <summary>
+	/// Extract the red channel of RGBA8 pixels into a tightly packed R8 buffer.
+	/// </summary>
+	void convert_rgba8_to_r8(uint8_t *dst, const uint8_t *src, size_t count);
+	/// <summary>
+	/// Extract the red and green channels of RGBA8 pixels into a tightly packed RG8 buffer.
+	/// </summary>
+	void convert_rgba8_to_rg8(uint8_t *dst, const uint8_t *src, size_t count);
+
+	/// <summary>
+	/// Flip an image vertically in place.
+	/// </summary>
+	/// <param name="data">The image data.</param>
+	/// <param name="pitch">The size of a single row in bytes.</param>
+	/// <param name="height">The number of rows.</param>
+	void flip_vertically(uint8_t *data, size_t pitch, size_t height);
+}
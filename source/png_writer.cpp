@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "png_writer.hpp"
+#include <array>
+#include <vector>
+#include <thread>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static const std::array<uint32_t, 256> s_crc_table = []() {
+	std::array<uint32_t, 256> table;
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : (c >> 1);
+		table[i] = c;
+	}
+	return table;
+}();
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = s_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t adler32(const uint8_t *data, size_t size)
+{
+	uint32_t s1 = 1, s2 = 0;
+	while (size > 0)
+	{
+		// Largest number of bytes that can be summed up before the 32-bit sums could overflow
+		const size_t block_size = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < block_size; ++i)
+			s2 += (s1 += data[i]);
+		s1 %= 65521;
+		s2 %= 65521;
+		data += block_size;
+		size -= block_size;
+	}
+	return (s2 << 16) | s1;
+}
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+	const uint32_t base = 65521;
+	const uint32_t rem = static_cast<uint32_t>(size2 % base);
+	uint32_t sum1 = adler1 & 0xFFFF;
+	uint32_t sum2 = (rem * sum1) % base;
+	sum1 += (adler2 & 0xFFFF) + base - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+	if (sum1 >= base) sum1 -= base;
+	if (sum1 >= base) sum1 -= base;
+	if (sum2 >= (base << 1)) sum2 -= (base << 1);
+	if (sum2 >= base) sum2 -= base;
+	return sum1 | (sum2 << 16);
+}
+
+static void append_u32_be(std::vector<uint8_t> &out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+static void begin_chunk(std::vector<uint8_t> &out, const char type[4])
+{
+	append_u32_be(out, 0); // Length is filled in by 'end_chunk'
+	out.insert(out.end(), type, type + 4);
+}
+static void end_chunk(std::vector<uint8_t> &out, size_t chunk_offset)
+{
+	const size_t length = out.size() - chunk_offset - 8;
+	for (int i = 0; i < 4; ++i)
+		out[chunk_offset + i] = static_cast<uint8_t>(length >> (24 - i * 8));
+	// The CRC covers the chunk type and data, but not the length
+	append_u32_be(out, crc32(0, out.data() + chunk_offset + 4, length + 4));
+}
+
+struct bit_writer
+{
+	explicit bit_writer(std::vector<uint8_t> &out) : out(out) {}
+
+	void put(uint32_t value, unsigned int count)
+	{
+		bits |= static_cast<uint64_t>(value) << bit_count;
+		bit_count += count;
+		while (bit_count >= 8)
+		{
+			out.push_back(static_cast<uint8_t>(bits));
+			bits >>= 8;
+			bit_count -= 8;
+		}
+	}
+	void align()
+	{
+		if (bit_count != 0)
+			put(0, 8 - bit_count);
+	}
+
+	std::vector<uint8_t> &out;
+	uint64_t bits = 0;
+	unsigned int bit_count = 0;
+};
+
+// Fixed Huffman codes as defined by the deflate specification (RFC 1951, section 3.2.6), stored bit-reversed since deflate emits codes starting at the most significant bit
+struct fixed_huffman_table
+{
+	fixed_huffman_table()
+	{
+		for (uint32_t i = 0; i < 288; ++i)
+		{
+			uint32_t code; unsigned int length;
+			if (i < 144)
+				code = 0x30 + i, length = 8;
+			else if (i < 256)
+				code = 0x190 + (i - 144), length = 9;
+			else if (i < 280)
+				code = i - 256, length = 7;
+			else
+				code = 0xC0 + (i - 280), length = 8;
+
+			uint32_t reversed = 0;
+			for (unsigned int k = 0; k < length; ++k)
+				reversed |= ((code >> k) & 1) << (length - 1 - k);
+			literal_codes[i] = reversed;
+			literal_lengths[i] = length;
+		}
+		for (uint32_t i = 0; i < 30; ++i)
+		{
+			uint32_t reversed = 0;
+			for (unsigned int k = 0; k < 5; ++k)
+				reversed |= ((i >> k) & 1) << (4 - k);
+			distance_codes[i] = reversed;
+		}
+		for (uint32_t code = 0; code < 29; ++code)
+			for (uint32_t length = length_base[code]; length < (code == 28 ? 259u : length_base[code + 1]); ++length)
+				length_symbols[length] = static_cast<uint8_t>(code);
+	}
+
+	uint32_t literal_codes[288];
+	unsigned int literal_lengths[288];
+	uint32_t distance_codes[30];
+	uint8_t length_symbols[259] = {};
+
+	static constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+};
+
+static const fixed_huffman_table s_fixed_huffman;
+
+static void deflate_strip(std::vector<uint8_t> &out, const uint8_t *data, size_t size, unsigned int level, bool last)
+{
+	bit_writer writer(out);
+
+	if (level == 0)
+	{
+		// Emit stored blocks without any compression, these always end on a byte boundary
+		size_t offset = 0;
+		do
+		{
+			const uint32_t length = static_cast<uint32_t>(std::min<size_t>(size - offset, 0xFFFF));
+			writer.put(last && offset + length == size ? 1 : 0, 3);
+			writer.align();
+			writer.put(length, 16);
+			writer.put(~length & 0xFFFF, 16);
+			out.insert(out.end(), data + offset, data + offset + length);
+			offset += length;
+		} while (offset < size);
+		return;
+	}
+
+	constexpr size_t window_size = 32768;
+	constexpr unsigned int hash_bits = 15;
+	// Maximum number of hash chain entries to search and match length after which to stop searching, per compression level
+	const unsigned int max_chain_lengths[10] = { 0, 4, 6, 8, 12, 16, 32, 128, 256, 1024 };
+	const size_t nice_lengths[10] = { 0, 8, 12, 16, 16, 32, 64, 128, 258, 258 };
+	const unsigned int max_chain_length = max_chain_lengths[std::min(level, 9u)];
+	const size_t nice_length = nice_lengths[std::min(level, 9u)];
+
+	std::vector<int32_t> head(1 << hash_bits, -1);
+	std::vector<int32_t> prev(window_size, -1);
+
+	const auto hash = [data](size_t i) {
+		return ((data[i] << 16 | data[i + 1] << 8 | data[i + 2]) * 2654435761u) >> (32 - hash_bits);
+	};
+	const auto insert = [&](size_t i) {
+		const uint32_t h = hash(i);
+		prev[i & (window_size - 1)] = head[h];
+		head[h] = static_cast<int32_t>(i);
+	};
+
+	writer.put(last ? 1 : 0, 1);
+	writer.put(1, 2); // Fixed Huffman codes
+
+	for (size_t i = 0; i < size;)
+	{
+		size_t best_length = 0, best_distance = 0;
+
+		if (i + 3 <= size)
+		{
+			const size_t max_length = std::min<size_t>(258, size - i);
+			const size_t good_length = std::min(nice_length, max_length);
+
+			unsigned int chain_length = max_chain_length;
+			for (int32_t candidate = head[hash(i)];
+				candidate >= 0 && i - candidate <= window_size && chain_length-- != 0;
+				candidate = prev[candidate & (window_size - 1)])
+			{
+				const uint8_t *const match = data + candidate;
+				if (match[best_length] != data[i + best_length])
+					continue;
+
+				size_t length = 0;
+				while (length < max_length && match[length] == data[i + length])
+					++length;
+
+				if (length > best_length)
+				{
+					best_length = length;
+					best_distance = i - candidate;
+					if (length >= good_length)
+						break;
+				}
+			}
+
+			insert(i);
+		}
+
+		if (best_length >= 3)
+		{
+			const uint32_t length_symbol = s_fixed_huffman.length_symbols[best_length];
+			writer.put(s_fixed_huffman.literal_codes[257 + length_symbol], s_fixed_huffman.literal_lengths[257 + length_symbol]);
+			writer.put(static_cast<uint32_t>(best_length - fixed_huffman_table::length_base[length_symbol]), fixed_huffman_table::length_extra[length_symbol]);
+
+			const uint32_t distance = static_cast<uint32_t>(best_distance - 1);
+			if (distance < 4)
+			{
+				writer.put(s_fixed_huffman.distance_codes[distance], 5);
+			}
+			else
+			{
+				unsigned int log2 = 2;
+				while ((distance >> (log2 + 1)) != 0)
+					++log2;
+				writer.put(s_fixed_huffman.distance_codes[2 * log2 + ((distance >> (log2 - 1)) & 1)], 5);
+				writer.put(distance & ((1u << (log2 - 1)) - 1), log2 - 1);
+			}
+
+			// Skip hashing the positions inside the match on low levels, which is faster at the cost of fewer matches found later on
+			if (level > 3)
+				for (size_t k = i + 1; k < i + best_length && k + 3 <= size; ++k)
+					insert(k);
+
+			i += best_length;
+		}
+		else
+		{
+			writer.put(s_fixed_huffman.literal_codes[data[i]], s_fixed_huffman.literal_lengths[data[i]]);
+			i += 1;
+		}
+	}
+
+	writer.put(s_fixed_huffman.literal_codes[256], s_fixed_huffman.literal_lengths[256]); // End of block
+
+	if (last)
+	{
+		writer.align();
+	}
+	else
+	{
+		// Sync flush (empty stored block), so that the next strip can start a new block on a byte boundary
+		writer.put(0, 3);
+		writer.align();
+		writer.put(0x0000, 16);
+		writer.put(0xFFFF, 16);
+	}
+}
+
+static inline uint8_t paeth_predictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return static_cast<uint8_t>(a);
+	return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+static void filter_row(uint8_t *out, const uint8_t *row, const uint8_t *prev_row, size_t row_size, unsigned int bpp, unsigned int type)
+{
+	out[0] = static_cast<uint8_t>(type);
+	out += 1;
+
+	// The first row has no previous row, which is equivalent to a previous row of all zeros
+	if (prev_row == nullptr && (type == 2 || type == 3 || type == 4))
+		type = (type == 2) ? 0 : (type == 3) ? 5 : 1;
+
+	switch (type)
+	{
+	case 0: // None
+		std::memcpy(out, row, row_size);
+		break;
+	case 1: // Sub
+		std::memcpy(out, row, bpp);
+		for (size_t i = bpp; i < row_size; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+		break;
+	case 2: // Up
+		for (size_t i = 0; i < row_size; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - prev_row[i]);
+		break;
+	case 3: // Average
+		for (size_t i = 0; i < bpp; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - (prev_row[i] >> 1));
+		for (size_t i = bpp; i < row_size; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - ((row[i - bpp] + prev_row[i]) >> 1));
+		break;
+	case 4: // Paeth
+		for (size_t i = 0; i < bpp; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - prev_row[i]);
+		for (size_t i = bpp; i < row_size; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - paeth_predictor(row[i - bpp], prev_row[i], prev_row[i - bpp]));
+		break;
+	case 5: // Average on the first row
+		std::memcpy(out, row, bpp);
+		for (size_t i = bpp; i < row_size; ++i)
+			out[i] = static_cast<uint8_t>(row[i] - (row[i - bpp] >> 1));
+		break;
+	}
+}
+
+static void filter_strip(uint8_t *out, const uint8_t *pixels, size_t first_row, size_t num_rows, size_t row_size, unsigned int bpp, unsigned int level)
+{
+	for (size_t y = first_row; y < first_row + num_rows; ++y, out += row_size + 1)
+	{
+		const uint8_t *const row = pixels + y * row_size;
+		// Filters may reference the previous row even across strip boundaries, since they operate on the unfiltered input
+		const uint8_t *const prev_row = y > 0 ? pixels + (y - 1) * row_size : nullptr;
+
+		if (level == 0)
+		{
+			filter_row(out, row, prev_row, row_size, bpp, 0);
+			continue;
+		}
+
+		// Pick the filter with the minimum sum of absolute differences, which is a good heuristic for the best compression
+		unsigned int best_type = 0;
+		size_t best_sum = std::numeric_limits<size_t>::max();
+		for (unsigned int type = 0; type < 5; ++type)
+		{
+			filter_row(out, row, prev_row, row_size, bpp, type);
+
+			size_t sum = 0;
+			for (size_t i = 1; i <= row_size; ++i)
+				sum += std::abs(static_cast<int8_t>(out[i]));
+
+			if (sum < best_sum)
+				best_sum = sum, best_type = type;
+		}
+
+		if (best_type != 4)
+			filter_row(out, row, prev_row, row_size, bpp, best_type);
+	}
+}
+
+bool reshade::png::write_to_func(write_func *func, void *context, unsigned int width, unsigned int height, unsigned int channels, const uint8_t *pixels, unsigned int compression_level, unsigned int max_threads)
+{
+	if (width == 0 || height == 0 || channels == 0 || channels > 4)
+		return false;
+
+	const size_t row_size = static_cast<size_t>(width) * channels;
+
+	// Split image into horizontal strips (with at least a couple rows each, so that the per-strip overhead does not become noticeable)
+	if (max_threads == 0)
+		max_threads = std::thread::hardware_concurrency();
+	size_t num_strips = std::max<size_t>(1, std::min<size_t>(max_threads, (height + 15) / 16));
+	const size_t rows_per_strip = (height + num_strips - 1) / num_strips;
+	// Rounding up the rows per strip can leave the last strips without any rows (e.g. 48 strips of 23 rows for 1080 rows), so only use as many as are actually needed
+	num_strips = (height + rows_per_strip - 1) / rows_per_strip;
+
+	std::vector<std::vector<uint8_t>> strip_chunks(num_strips);
+	std::vector<uint32_t> strip_checksums(num_strips);
+	std::vector<size_t> strip_sizes(num_strips);
+
+	const auto encode_strip = [&](size_t strip) {
+		const size_t first_row = strip * rows_per_strip;
+		const size_t num_rows = std::min<size_t>(rows_per_strip, height - first_row);
+
+		std::vector<uint8_t> filtered((row_size + 1) * num_rows);
+		filter_strip(filtered.data(), pixels, first_row, num_rows, row_size, channels, compression_level);
+
+		strip_sizes[strip] = filtered.size();
+		strip_checksums[strip] = adler32(filtered.data(), filtered.size());
+
+		// Each strip is written to its own IDAT chunk, which are concatenated to form the zlib stream on decoding
+		std::vector<uint8_t> &chunk = strip_chunks[strip];
+		chunk.reserve(filtered.size() / 2 + 64);
+		begin_chunk(chunk, "IDAT");
+		if (strip == 0)
+			chunk.push_back(0x78), // Add zlib header (deflate with 32K window, no preset dictionary)
+			chunk.push_back(0x01);
+		deflate_strip(chunk, filtered.data(), filtered.size(), compression_level, strip == num_strips - 1);
+		end_chunk(chunk, 0);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_strips - 1);
+	for (size_t strip = 1; strip < num_strips; ++strip)
+		threads.emplace_back(encode_strip, strip);
+	encode_strip(0);
+	for (std::thread &thread : threads)
+		thread.join();
+
+	std::vector<uint8_t> header;
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	header.insert(header.end(), signature, signature + 8);
+	begin_chunk(header, "IHDR");
+	append_u32_be(header, width);
+	append_u32_be(header, height);
+	header.push_back(8); // Bit depth
+	const uint8_t color_types[4] = { 0 /* Grayscale */, 4 /* Grayscale with alpha */, 2 /* RGB */, 6 /* RGBA */ };
+	header.push_back(color_types[channels - 1]);
+	header.push_back(0); // Compression method
+	header.push_back(0); // Filter method
+	header.push_back(0); // Interlace method
+	end_chunk(header, 8);
+	func(context, header.data(), static_cast<int>(header.size()));
+
+	uint32_t checksum = strip_checksums[0];
+	for (size_t strip = 0; strip < num_strips; ++strip)
+	{
+		if (strip != 0)
+			checksum = adler32_combine(checksum, strip_checksums[strip], strip_sizes[strip]);
+
+		func(context, strip_chunks[strip].data(), static_cast<int>(strip_chunks[strip].size()));
+		strip_chunks[strip].clear();
+		strip_chunks[strip].shrink_to_fit();
+	}
+
+	// Finish the zlib stream with the checksum of all the uncompressed data in a separate IDAT chunk, since it is only known after all strips were processed
+	std::vector<uint8_t> trailer;
+	begin_chunk(trailer, "IDAT");
+	append_u32_be(trailer, checksum);
+	end_chunk(trailer, 0);
+	const size_t end_chunk_offset = trailer.size();
+	begin_chunk(trailer, "IEND");
+	end_chunk(trailer, end_chunk_offset);
+	func(context, trailer.data(), static_cast<int>(trailer.size()));
+
+	return true;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace reshade::png
+{
+	/// <summary>
+	/// Callback function which receives the encoded file data (same signature as 'stbi_write_func').
+	/// </summary>
+	typedef void write_func(void *context, void *data, int size);
+
+	/// <summary>
+	/// Encode an image to PNG, filtering and compressing horizontal strips of it on multiple threads.
+	/// Each strip is compressed into an independent deflate stream terminated with a sync flush, so that they can simply be concatenated into a standard zlib stream.
+	/// </summary>
+	/// <param name="func">The callback function that is called with the encoded data.</param>
+	/// <param name="context">User data passed to the callback function.</param>
+	/// <param name="width">The width of the image in pixels.</param>
+	/// <param name="height">The height of the image in pixels.</param>
+	/// <param name="channels">The number of 8-bit channels per pixel (1 to 4).</param>
+	/// <param name="pixels">The tightly packed image data.</param>
+	/// <param name="compression_level">Trade-off between speed and size, from 0 (no compression) to 9 (smallest file).</param>
+	/// <param name="max_threads">The maximum number of threads to encode on, or zero to use all hardware threads.</param>
+	/// <returns><c>true</c> if the image was encoded successfully, <c>false</c> otherwise.</returns>
+	bool write_to_func(write_func *func, void *context, unsigned int width, unsigned int height, unsigned int channels, const uint8_t *pixels, unsigned int compression_level = 6, unsigned int max_threads = 0);
+}
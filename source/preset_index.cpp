@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "preset_index.hpp"
+#include <algorithm>
+#include <Windows.h>
+
+extern bool resolve_preset_path(std::filesystem::path &path);
+
+reshade::preset_index::~preset_index()
+{
+	if (_notification_handle != nullptr)
+		FindCloseChangeNotification(_notification_handle);
+}
+
+const std::vector<std::filesystem::path> &reshade::preset_index::presets(const std::filesystem::path &directory)
+{
+	if (directory != _directory)
+	{
+		if (_notification_handle != nullptr)
+			FindCloseChangeNotification(_notification_handle);
+
+		_directory = directory;
+
+		// Watch for files being added, removed, renamed or written, since any of that can change which of them are valid presets
+		if (const HANDLE handle = FindFirstChangeNotificationW(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+			handle != INVALID_HANDLE_VALUE)
+			_notification_handle = handle;
+		else
+			_notification_handle = nullptr;
+
+		rebuild();
+	}
+	// Always rebuild if the directory cannot be watched (e.g. because it does not exist)
+	else if (_notification_handle == nullptr || WaitForSingleObject(_notification_handle, 0) == WAIT_OBJECT_0)
+	{
+		// Wait for the next change before rebuilding, so that changes made while doing so are not missed
+		if (_notification_handle != nullptr)
+			FindNextChangeNotification(_notification_handle);
+
+		rebuild();
+	}
+
+	return _presets;
+}
+
+void reshade::preset_index::rebuild()
+{
+	std::error_code ec; // This is here to ignore file system errors below
+
+	_presets.clear();
+
+	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(_directory, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		// Skip anything that is not a valid preset file
+		if (resolve_preset_path(preset_path))
+			_presets.push_back(std::move(preset_path));
+	}
+
+	// Sort by name, so that the order does not depend on the file system
+	std::sort(_presets.begin(), _presets.end(),
+		[](const std::filesystem::path &lhs, const std::filesystem::path &rhs) {
+			return _wcsicmp(lhs.c_str(), rhs.c_str()) < 0;
+		});
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <vector>
+#include <filesystem>
+
+namespace reshade
+{
+	/// <summary>
+	/// A sorted list of the preset files in a directory, which is only rebuilt after the file system notified about a change to it.
+	/// </summary>
+	class preset_index
+	{
+	public:
+		preset_index() = default;
+		~preset_index();
+
+		preset_index(const preset_index &) = delete;
+		preset_index &operator=(const preset_index &) = delete;
+
+		/// <summary>
+		/// Get the list of valid preset files in the specified directory, sorted by their name.
+		/// </summary>
+		/// <param name="directory">The absolute path to the directory to list the presets of.</param>
+		/// <returns>A reference to the list, which is valid until the next call with a different directory or after the directory changed.</returns>
+		const std::vector<std::filesystem::path> &presets(const std::filesystem::path &directory);
+
+	private:
+		void rebuild();
+
+		void *_notification_handle = nullptr;
+		std::filesystem::path _directory;
+		std::vector<std::filesystem::path> _presets;
+	};
+}
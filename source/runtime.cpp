@@ -13,9 +13,18 @@
 #include "effect_preprocessor.hpp"
 #include "input.hpp"
 #include "input_freepie.hpp"
+#include "frame_capture.hpp"
+#include "frame_profiler.hpp"
+#include "preset_index.hpp"
+#include "file_index.hpp"
+#include "png_writer.hpp"
+#include "pixel_conversion.hpp"
+#include "pass_culling.hpp"
+#include "texture_aliasing.hpp"
 #include <thread>
 #include <cassert>
 #include <algorithm>
+#include <unordered_set>
 #include <stb_image.h>
 #include <stb_image_dds.h>
 #include <stb_image_write.h>
@@ -47,42 +56,33 @@ bool resolve_preset_path(std::filesystem::path &path)
 	return !resolve_path(path) || reshade::ini_file::load_cache(path).has({}, "Techniques");
 }
 
-static bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path)
+static inline bool force_floating_point_value(const reshadefx::type &type, uint32_t renderer_id)
 {
-	std::error_code ec;
-	// Do not have to perform a search if the path is already absolute
-	if (path.is_absolute())
-		return std::filesystem::exists(path, ec);
-	for (std::filesystem::path search_path : search_paths)
-		// Append relative file path to absolute search path
-		if (search_path /= path; resolve_path(search_path))
-			return path = std::move(search_path), true;
+	if (renderer_id == 0x9000)
+		return true; // All uniform variables are floating-point in D3D9
+	if (type.is_matrix() && (renderer_id & 0x10000))
+		return true; // All matrices are floating-point in GLSL
 	return false;
 }
-static std::vector<std::filesystem::path> find_files(const std::vector<std::filesystem::path> &search_paths, std::initializer_list<std::filesystem::path> extensions)
-{
-	std::error_code ec;
-	std::vector<std::filesystem::path> files;
-	for (std::filesystem::path search_path : search_paths)
-		if (resolve_path(search_path))
-			for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(search_path, std::filesystem::directory_options::skip_permission_denied, ec))
-				if (!entry.is_directory(ec) &&
-					std::find(extensions.begin(), extensions.end(), entry.path().extension()) != extensions.end())
-					files.emplace_back(entry); // Construct path from directory entry in-place
-	return files;
-}
 
 reshade::runtime::runtime() :
+	_profiler(std::make_unique<frame_profiler>()),
 	_start_time(std::chrono::high_resolution_clock::now()),
 	_last_present_time(std::chrono::high_resolution_clock::now()),
 	_last_frame_duration(std::chrono::milliseconds(1)),
 	_effect_search_paths({ L".\\" }),
 	_texture_search_paths({ L".\\" }),
+	_file_index(std::make_unique<file_index>()),
 	_reload_key_data(),
 	_effects_key_data(),
 	_screenshot_key_data(),
+	_frame_capture_key_data(),
+	_frame_capture(std::make_unique<frame_capture>()),
+	_profiler_key_data(),
+	_statistics_window_start_time(std::chrono::high_resolution_clock::now()),
 	_prev_preset_key_data(),
 	_next_preset_key_data(),
+	_preset_index(std::make_unique<preset_index>()),
 	_configuration_path(g_reshade_config_path),
 	_screenshot_path(g_target_executable_path.parent_path())
 {
@@ -104,6 +104,9 @@ reshade::runtime::~runtime()
 #if RESHADE_GUI
 	deinit_ui();
 #endif
+
+	// Finish writing INI files in the background before the module may be unloaded
+	ini_file::stop_background_threads();
 }
 
 bool reshade::runtime::on_init(input::window_handle window)
@@ -133,6 +136,9 @@ void reshade::runtime::on_reset()
 	else
 		return; // Nothing to do if the runtime was already destroyed or not successfully initialized in the first place
 
+	// Frame dimensions may change after a reset, so any running capture cannot continue
+	_frame_capture->stop();
+
 	unload_effects();
 
 	_width = _height = 0;
@@ -146,6 +152,8 @@ void reshade::runtime::on_reset()
 }
 void reshade::runtime::on_present()
 {
+	const frame_profiler::scope profile(*_profiler, "Present");
+
 	// Get current time and date
 	const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 	tm tm; localtime_s(&tm, &t);
@@ -157,8 +165,12 @@ void reshade::runtime::on_present()
 	_framecount++;
 	const auto current_time = std::chrono::high_resolution_clock::now();
 	_last_frame_duration = current_time - _last_present_time;
+	// Effects are rendered right before presenting, so the time since then is the overhead they added to this frame
+	const auto effects_duration = _effects_start_time > _last_present_time ? current_time - _effects_start_time : std::chrono::high_resolution_clock::duration::zero();
 	_last_present_time = current_time;
 
+	update_statistics(std::chrono::duration_cast<std::chrono::nanoseconds>(effects_duration));
+
 #ifdef NDEBUG
 	// Lock input so it cannot be modified by other threads while we are reading it here
 	const auto input_lock = _input->lock();
@@ -178,38 +190,54 @@ void reshade::runtime::on_present()
 	// Handle keyboard shortcuts
 	if (!_ignore_shortcuts)
 	{
-		if (_input->is_key_pressed(_effects_key_data, _force_shortcut_modifiers))
-			_effects_enabled = !_effects_enabled;
-
-		if (_input->is_key_pressed(_screenshot_key_data, _force_shortcut_modifiers))
-			_should_save_screenshot = true; // Notify 'update_and_render_effects' that we want to save a screenshot next frame
-
-		// Do not allow the next shortcuts while effects are being loaded or compiled (since they affect that state)
-		if (!is_loading() && _reload_compile_queue.empty())
+		for (const key_binding &binding : pressed_key_bindings())
 		{
-			if (_input->is_key_pressed(_reload_key_data, _force_shortcut_modifiers))
-				load_effects();
-
-			if (const bool reversed = _input->is_key_pressed(_prev_preset_key_data, _force_shortcut_modifiers);
-				reversed || _input->is_key_pressed(_next_preset_key_data, _force_shortcut_modifiers))
+			switch (binding.type)
 			{
+			case key_binding::binding_type::toggle_effects:
+				_effects_enabled = !_effects_enabled;
+				break;
+			case key_binding::binding_type::take_screenshot:
+				_should_save_screenshot = true; // Notify 'update_and_render_effects' that we want to save a screenshot next frame
+				break;
+			case key_binding::binding_type::toggle_frame_capture:
+				if (_frame_capture->is_active())
+					_frame_capture->stop();
+				else
+					start_frame_capture();
+				break;
+			case key_binding::binding_type::save_profiler_trace:
+				save_profiler_trace();
+				break;
+			case key_binding::binding_type::reload_effects:
+				// Do not allow this while effects are being loaded or compiled (since it affects that state)
+				if (!is_loading() && _reload_compile_queue.empty())
+					load_effects();
+				break;
+			case key_binding::binding_type::previous_preset:
+			case key_binding::binding_type::next_preset:
 				// The preset shortcut key was pressed down, so start the transition
-				if (switch_to_next_preset(_current_preset_path.parent_path(), reversed))
+				if (!is_loading() && _reload_compile_queue.empty() &&
+					switch_to_next_preset(_current_preset_path.parent_path(), binding.type == key_binding::binding_type::previous_preset))
 				{
 					_last_preset_switching_time = current_time;
 					_is_in_between_presets_transition = true;
+					// Make sure the preset is loaded again, so that the transition starts from the current values
+					_compiled_preset.clear();
 					save_config();
 				}
+				break;
 			}
-
-			// Continuously update preset values while a transition is in progress
-			if (_is_in_between_presets_transition)
-				load_current_preset();
 		}
+
+		// Continuously update preset values while a transition is in progress
+		if (_is_in_between_presets_transition && !is_loading() && _reload_compile_queue.empty())
+			update_preset_transition();
 	}
 
 	// Reset input status
 	_input->next_frame();
+	_pressed_key_bindings_valid = false;
 
 	// Save modified INI files
 	if (!ini_file::flush_cache())
@@ -317,7 +345,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		reshadefx::parser parser;
 
 		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		if (!parser.parse(std::move(pp.output()), codegen.get()) || !effect.compile_sucess)
+		if (!parser.parse(std::move(pp.output()), codegen.get(), _color_bit_depth) || !effect.compile_sucess)
 		{
 			LOG(ERROR) << "Failed to compile " << path << ":\n" << pp.errors() << parser.errors();
 			effect.compile_sucess = false;
@@ -399,6 +427,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 
 	// Create space for all variables (aligned to 16 bytes)
 	effect.uniform_data_storage.resize((effect.module.total_uniform_size + 15) & ~15);
+	// Unchanged values are not marked dirty later on, so the whole buffer has to be uploaded once (including padding and values that are zero)
+	effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 
 	for (uniform var : effect.module.uniforms)
 	{
@@ -436,59 +466,91 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		else if (special == "bufready_depth")
 			var.special = special_uniform::bufready_depth;
 
+		// Build the lists of uniforms that need to be updated every frame, with any annotations that are needed for that looked up in advance
+		if (var.special != special_uniform::none)
+		{
+			special_uniform_slot &slot = effect.special_uniforms.emplace_back();
+			slot.uniform_index = effect.uniforms.size();
+			slot.source = var.special;
+
+			switch (var.special)
+			{
+			case special_uniform::key:
+			case special_uniform::mouse_button:
+				if (const std::string_view mode = var.annotation_as_string("mode");
+					mode == "toggle" || var.annotation_as_int("toggle"))
+					slot.mode = special_uniform_slot::key_mode::toggle;
+				else if (mode == "press")
+					slot.mode = special_uniform_slot::key_mode::press;
+				slot.keycode = var.annotation_as_int("keycode");
+				break;
+			case special_uniform::freepie:
+				slot.keycode = var.annotation_as_int("index");
+				break;
+			}
+		}
+		else if (var.supports_toggle_key())
+		{
+			uniform_toggle_binding &binding = effect.toggle_key_uniforms.emplace_back();
+			binding.uniform_index = effect.uniforms.size();
+
+			const std::string_view ui_items = var.annotation_as_string("ui_items");
+			for (size_t offset = 0, next; (next = ui_items.find('\0', offset)) != std::string::npos; offset = next + 1)
+				binding.num_items++;
+		}
+
 		effect.uniforms.push_back(std::move(var));
 	}
 
-	std::vector<texture> new_textures;
-	new_textures.reserve(effect.module.textures.size());
 	std::vector<technique> new_techniques;
 	new_techniques.reserve(effect.module.techniques.size());
 
+	// Protect access to global texture list and the lookup tables into it
+	// Only lock once for all textures, since every check below is just a hash table lookup
+	std::unique_lock<std::mutex> textures_lock(_reload_mutex);
+
 	for (texture texture : effect.module.textures)
 	{
 		texture.effect_index = index;
 
-		{	const std::lock_guard<std::mutex> lock(_reload_mutex); // Protect access to global texture list
+		// Try to share textures with the same name across effects
+		if (size_t existing_index; _texture_registry.find_by_name(texture.unique_name, existing_index))
+		{
+			const auto existing_texture = _textures.begin() + existing_index;
 
-			// Try to share textures with the same name across effects
-			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-				[&texture](const auto &item) { return item.unique_name == texture.unique_name; });
-				existing_texture != _textures.end())
+			// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
+			if (texture.semantic.empty() != (existing_texture->impl_reference == texture_reference::none))
 			{
-				// Cannot share texture if this is a normal one, but the existing one is a reference and vice versa
-				if (texture.semantic.empty() != (existing_texture->impl_reference == texture_reference::none))
-				{
-					effect.errors += "error: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
-					effect.errors += ") already created a texture with the same name but different usage; rename the variable to fix this error\n";
-					effect.compile_sucess = false;
-					break;
-				}
-				else if (texture.semantic.empty() && !existing_texture->matches_description(texture))
-				{
-					effect.errors += "warning: " + texture.unique_name + ": another effect (";
-					effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
-					effect.errors += ") already created a texture with the same name but different dimensions; textures are shared across all effects, so either rename the variable or adjust the dimensions so they match\n";
-				}
+				effect.errors += "error: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") already created a texture with the same name but different usage; rename the variable to fix this error\n";
+				effect.compile_sucess = false;
+				break;
+			}
+			else if (texture.semantic.empty() && !existing_texture->matches_description(texture))
+			{
+				effect.errors += "warning: " + texture.unique_name + ": another effect (";
+				effect.errors += _effects[existing_texture->effect_index].source_file.filename().u8string();
+				effect.errors += ") already created a texture with the same name but different dimensions; textures are shared across all effects, so either rename the variable or adjust the dimensions so they match\n";
+			}
 
-				existing_texture->shared = true;
+			existing_texture->shared = true;
 
-				// Always make shared textures render targets, since they may be used as such in a different effect
-				existing_texture->render_target = true;
-				existing_texture->storage_access = true;
-				continue;
-			}
+			// Always make shared textures render targets, since they may be used as such in a different effect
+			existing_texture->render_target = true;
+			existing_texture->storage_access = true;
+			continue;
 		}
 
-		if (texture.annotation_as_int("pooled"))
-		{
-			const std::lock_guard<std::mutex> lock(_reload_mutex);
+		const bool pooled = texture.annotation_as_int("pooled") != 0;
 
-			// Try to find another pooled texture to share with
-			if (const auto existing_texture = std::find_if(_textures.begin(), _textures.end(),
-				[&texture](const auto &item) { return item.annotation_as_int("pooled") && item.matches_description(texture); });
-				existing_texture != _textures.end())
+		if (pooled)
+		{
+			// Try to find another pooled texture to share with (but not one from this effect, since those are in use at the same time)
+			if (size_t existing_index; _texture_registry.find_pooled(_textures, texture, index, existing_index))
 			{
+				const auto existing_texture = _textures.begin() + existing_index;
+
 				// Overwrite referenced texture in samplers with the pooled one
 				for (auto &sampler_info : effect.module.samplers)
 					if (sampler_info.texture_name == texture.unique_name)
@@ -496,8 +558,12 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 				// Overwrite referenced texture in render targets with the pooled one
 				for (auto &technique_info : effect.module.techniques)
 					for (auto &pass_info : technique_info.passes)
+					{
 						std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
 							texture.unique_name, existing_texture->unique_name);
+						std::replace(pass_info.sampled_texture_names.begin(), pass_info.sampled_texture_names.end(),
+							texture.unique_name, existing_texture->unique_name);
+					}
 
 				existing_texture->shared = true;
 				continue;
@@ -511,9 +577,13 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 		else if (!texture.semantic.empty())
 			effect.errors += "warning: " + texture.unique_name + ": unknown semantic '" + texture.semantic + "'\n";
 
-		new_textures.push_back(std::move(texture));
+		// Add texture to the global list right away, so that effects that are loaded in parallel can share it too
+		_texture_registry.add(texture, _textures.size());
+		_textures.push_back(std::move(texture));
 	}
 
+	textures_lock.unlock();
+
 	for (technique technique : effect.module.techniques)
 	{
 		technique.effect_index = index;
@@ -533,8 +603,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 			LOG(WARN) << "Successfully loaded " << path << " with warnings:\n" << effect.errors;
 
 	{	const std::lock_guard<std::mutex> lock(_reload_mutex);
-		std::move(new_textures.begin(), new_textures.end(), std::back_inserter(_textures));
 		std::move(new_techniques.begin(), new_techniques.end(), std::back_inserter(_techniques));
+		_pass_culling_dirty = true;
 
 		_last_shader_reload_successful &= effect.compile_sucess;
 		_reload_remaining_effects--;
@@ -544,6 +614,8 @@ bool reshade::runtime::load_effect(const std::filesystem::path &path, size_t ind
 }
 void reshade::runtime::load_effects()
 {
+	const frame_profiler::scope profile(*_profiler, "Reload");
+
 	// Clear out any previous effects
 	unload_effects();
 
@@ -561,9 +633,10 @@ void reshade::runtime::load_effects()
 		preset.get({}, "PreprocessorDefinitions", _preset_preprocessor_definitions);
 	}
 
-	// Build a list of effect files by walking through the effect search paths
+	// Build a list of effect files by walking through the effect search paths (only those directories that changed since the last reload are actually listed again)
+	_file_index->invalidate();
 	const std::vector<std::filesystem::path> effect_files =
-		find_files(_effect_search_paths, { L".fx" });
+		_file_index->find_files(_effect_search_paths, { L".fx" });
 
 	_reload_total_effects = effect_files.size();
 	_reload_remaining_effects = _reload_total_effects;
@@ -587,12 +660,110 @@ void reshade::runtime::load_effects()
 					load_effect(effect_files[i], i);
 		});
 }
+void reshade::runtime::alias_transient_textures()
+{
+	std::vector<size_t> candidates;
+	std::vector<texture_lifetime> lifetimes;
+
+	// Technique indices are only unique within an effect, so offset them to make them unique across all effects
+	std::vector<size_t> technique_offsets(_effects.size());
+	for (size_t effect_index = 1; effect_index < _effects.size(); ++effect_index)
+		technique_offsets[effect_index] = technique_offsets[effect_index - 1] + _effects[effect_index - 1].module.techniques.size();
+
+	for (size_t texture_index = 0; texture_index < _textures.size(); ++texture_index)
+	{
+		const texture &texture = _textures[texture_index];
+
+		// Only consider textures that have not been created yet and that are not referenced by name from elsewhere
+		if (texture.impl != nullptr || !is_alias_candidate(texture) || !_effects[texture.effect_index].compile_sucess)
+			continue;
+
+		texture_lifetime lifetime;
+		if (!find_transient_lifetime(_effects[texture.effect_index].module.techniques, texture, lifetime))
+			continue;
+
+		lifetime.technique += technique_offsets[texture.effect_index];
+
+		candidates.push_back(texture_index);
+		lifetimes.push_back(lifetime);
+	}
+
+	const std::vector<size_t> aliases = assign_texture_aliases(lifetimes);
+
+	uint64_t memory_size_before = 0;
+	for (const texture &texture : _textures)
+		if (texture.render_target && texture.impl_reference == texture_reference::none)
+			memory_size_before += texture_memory_size(texture);
+	uint64_t memory_size_after = memory_size_before;
+
+	std::vector<bool> removed_textures(_textures.size());
+
+	for (size_t i = 0; i < candidates.size(); ++i)
+	{
+		if (aliases[i] == i)
+			continue;
+
+		memory_size_after -= lifetimes[i].memory_size;
+
+		const texture &aliased_texture = _textures[candidates[i]];
+		texture &existing_texture = _textures[candidates[aliases[i]]];
+
+		// Overwrite referenced texture in samplers and passes with the one whose memory is reused, the same way pooled textures are handled
+		effect &effect = _effects[aliased_texture.effect_index];
+		for (auto &sampler_info : effect.module.samplers)
+			if (sampler_info.texture_name == aliased_texture.unique_name)
+				sampler_info.texture_name  = existing_texture.unique_name;
+
+		const auto replace_in_passes = [&aliased_texture, &existing_texture](std::vector<reshadefx::pass_info> &passes) {
+			for (auto &pass_info : passes)
+			{
+				std::replace(std::begin(pass_info.render_target_names), std::end(pass_info.render_target_names),
+					aliased_texture.unique_name, existing_texture.unique_name);
+				std::replace(pass_info.sampled_texture_names.begin(), pass_info.sampled_texture_names.end(),
+					aliased_texture.unique_name, existing_texture.unique_name);
+			}
+		};
+
+		for (auto &technique_info : effect.module.techniques)
+			replace_in_passes(technique_info.passes);
+		// The technique list holds copies of the passes, so need to update those too
+		for (technique &technique : _techniques)
+			if (technique.effect_index == aliased_texture.effect_index)
+				replace_in_passes(technique.passes);
+
+		// Keep the texture alive when its own effect is unloaded, since it may be used by other effects now
+		existing_texture.shared = true;
+
+		removed_textures[candidates[i]] = true;
+	}
+
+	if (memory_size_before == memory_size_after)
+		return;
+
+	const size_t num_textures = _textures.size();
+	_textures.erase(std::remove_if(_textures.begin(), _textures.end(),
+		[this, &removed_textures](const texture &tex) {
+			return removed_textures[&tex - _textures.data()];
+		}), _textures.end());
+	const size_t num_removed_textures = num_textures - _textures.size();
+
+	// Indices into the texture list have changed, so rebuild lookup tables
+	_texture_registry.rebuild(_textures);
+
+	_pass_culling_dirty = true;
+
+	LOG(INFO) << "Aliased " << num_removed_textures << " transient render targets, which reduced render target memory from "
+		<< (memory_size_before / 1024) << " KiB to " << (memory_size_after / 1024) << " KiB.";
+}
+
 void reshade::runtime::load_textures()
 {
 	_last_texture_reload_successful = true;
 
 	LOG(INFO) << "Loading image files for textures ...";
 
+	_file_index->invalidate();
+
 	for (texture &texture : _textures)
 	{
 		if (texture.impl == nullptr || texture.impl_reference != texture_reference::none)
@@ -605,7 +776,7 @@ void reshade::runtime::load_textures()
 			continue;
 
 		// Search for image file using the provided search paths unless the path provided is already absolute
-		if (!find_file(_texture_search_paths, source_path))
+		if (!_file_index->find_file(_texture_search_paths, source_path))
 		{
 			LOG(ERROR) << "Source " << source_path << " for texture '" << texture.unique_name << "' could not be found in any of the texture search paths.";
 			_last_texture_reload_successful = false;
@@ -655,6 +826,8 @@ void reshade::runtime::load_textures()
 	}
 
 	_textures_loaded = true;
+
+	_file_index->log_statistics();
 }
 
 void reshade::runtime::unload_effect(size_t index)
@@ -677,6 +850,8 @@ void reshade::runtime::unload_effect(size_t index)
 			}
 			return false;
 		}), _textures.end());
+	// Indices into the texture list have changed, so rebuild lookup tables
+	_texture_registry.rebuild(_textures);
 	// Clean up techniques belonging to this effect
 	_techniques.erase(std::remove_if(_techniques.begin(), _techniques.end(),
 		[index](const technique &tech) {
@@ -694,6 +869,13 @@ void reshade::runtime::unload_effect(size_t index)
 	effect.assembly.clear();
 	effect.uniforms.clear();
 	effect.uniform_data_storage.clear();
+	effect.clear_uniform_data_dirty();
+	effect.special_uniforms.clear();
+	effect.toggle_key_uniforms.clear();
+
+	_key_bindings_dirty = true;
+	_pass_culling_dirty = true;
+	_compiled_preset.clear();
 }
 void reshade::runtime::unload_effects()
 {
@@ -713,28 +895,45 @@ void reshade::runtime::unload_effects()
 	for (texture &tex : _textures)
 		destroy_texture(tex);
 	_textures.clear();
+	_texture_registry.clear();
 	_textures_loaded = false;
 	// Clean up all techniques
 	_techniques.clear();
 
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
+
+	_key_bindings_dirty = true;
+	_compiled_preset.clear();
 }
 
 void reshade::runtime::update_and_render_effects()
 {
+	_effects_start_time = std::chrono::high_resolution_clock::now();
+
+	// Every frame starts with rendering the effects, since 'on_present' is called right after
+	_profiler->next_frame(_framecount);
+
+	const frame_profiler::scope profile(*_profiler, "Effects");
+
 	// Delay first load to the first render call to avoid loading while the application is still initializing
 	if (_framecount == 0 && !_no_reload_on_init)
 		load_effects();
 
 	if (_reload_remaining_effects == 0)
 	{
+		const frame_profiler::scope profile_reload(*_profiler, "Finish reload");
+
 		// Clear the thread list now that they all have finished
 		for (std::thread &thread : _worker_threads)
 			if (thread.joinable())
 				thread.join(); // Threads have exited, but still need to join them prior to destruction
 		_worker_threads.clear();
 
+		// Share memory between intermediate render targets before any of them are created during compilation
+		if (!_no_texture_aliasing)
+			alias_transient_textures();
+
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
 
@@ -765,6 +964,8 @@ void reshade::runtime::update_and_render_effects()
 		_reload_compile_queue.pop_back();
 		effect &effect = _effects[effect_index];
 
+		const frame_profiler::scope profile_compile(*_profiler, "Compile effect", static_cast<uint32_t>(effect_index));
+
 		// Create textures now, since they are referenced when building samplers in the 'init_effect' call below
 		for (texture &texture : _textures)
 		{
@@ -850,17 +1051,28 @@ void reshade::runtime::update_and_render_effects()
 	if (!_effects_enabled)
 		return;
 
-	// Update special uniform variables
-	for (effect &effect : _effects)
+	// Handle keyboard shortcuts bound to techniques and uniform variables
+	if (!_ignore_shortcuts)
 	{
-		if (!effect.rendering)
-			continue;
-
-		for (uniform &variable : effect.uniforms)
+		for (const key_binding &binding : pressed_key_bindings())
 		{
-			if (!_ignore_shortcuts && variable.toggle_key_data[0] != 0 && _input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+			if (binding.type == key_binding::binding_type::toggle_technique)
+			{
+				technique &technique = _techniques[binding.index];
+
+				if (!technique.enabled)
+					enable_technique(technique);
+				else
+					disable_technique(technique);
+			}
+			else if (binding.type == key_binding::binding_type::toggle_uniform)
 			{
-				assert(variable.supports_toggle_key());
+				effect &effect = _effects[binding.index];
+				if (!effect.rendering)
+					continue;
+
+				const uniform_toggle_binding &toggle = effect.toggle_key_uniforms[binding.uniform_binding_index];
+				uniform &variable = effect.uniforms[toggle.uniform_index];
 
 				// Change to next value if the associated shortcut key was pressed
 				switch (variable.type.base)
@@ -877,19 +1089,29 @@ void reshade::runtime::update_and_render_effects()
 					{
 						int data[4];
 						get_uniform_value(variable, data, 4);
-						const std::string_view ui_items = variable.annotation_as_string("ui_items");
-						int num_items = 0;
-						for (size_t offset = 0, next; (next = ui_items.find('\0', offset)) != std::string::npos; offset = next + 1)
-							num_items++;
-						data[0] = (data[0] + 1 >= num_items) ? 0 : data[0] + 1;
+						data[0] = (data[0] + 1 >= toggle.num_items) ? 0 : data[0] + 1;
 						set_uniform_value(variable, data, 4);
 						break;
 					}
 				}
 				save_current_preset();
 			}
+		}
+	}
 
-			switch (variable.special)
+	// Update special uniform variables
+	for (effect &effect : _effects)
+	{
+		if (!effect.rendering)
+			continue;
+
+		const frame_profiler::scope profile_uniforms(*_profiler, "Update uniforms");
+
+		for (const special_uniform_slot &slot : effect.special_uniforms)
+		{
+			uniform &variable = effect.uniforms[slot.uniform_index];
+
+			switch (slot.source)
 			{
 				case special_uniform::frame_time:
 				{
@@ -954,24 +1176,22 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::key:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					if (slot.keycode > 7 && slot.keycode < 256)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+						if (slot.mode == special_uniform_slot::key_mode::toggle)
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_key_pressed(keycode))
+							if (_input->is_key_pressed(slot.keycode))
 								set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
+						else if (slot.mode == special_uniform_slot::key_mode::press)
+							set_uniform_value(variable, _input->is_key_pressed(slot.keycode));
 						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+							set_uniform_value(variable, _input->is_key_down(slot.keycode));
 					}
 					break;
-					}
+				}
 				case special_uniform::mouse_point:
 					set_uniform_value(variable, _input->mouse_position_x(), _input->mouse_position_y());
 					break;
@@ -980,27 +1200,25 @@ void reshade::runtime::update_and_render_effects()
 					break;
 				case special_uniform::mouse_button:
 				{
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					if (slot.keycode >= 0 && slot.keycode < 5)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+						if (slot.mode == special_uniform_slot::key_mode::toggle)
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value, 1);
-							if (_input->is_mouse_button_pressed(keycode))
+							if (_input->is_mouse_button_pressed(slot.keycode))
 								set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
+						else if (slot.mode == special_uniform_slot::key_mode::press)
+							set_uniform_value(variable, _input->is_mouse_button_pressed(slot.keycode));
 						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+							set_uniform_value(variable, _input->is_mouse_button_down(slot.keycode));
 					}
 					break;
 				}
 				case special_uniform::freepie:
 					if (freepie_io_data data;
-						freepie_io_read(variable.annotation_as_int("index"), &data))
+						freepie_io_read(slot.keycode, &data))
 					{
 						// Assign as float4 array, since float3 arrays are padded to float4 anyway
 						const float array_values[] = {
@@ -1022,25 +1240,25 @@ void reshade::runtime::update_and_render_effects()
 		}
 	}
 
+	if (_pass_culling_dirty)
+		update_pass_culling();
+
 	// Render all enabled techniques
 	for (technique &technique : _techniques)
 	{
-		if (!_ignore_shortcuts && _input->is_key_pressed(technique.toggle_key_data, _force_shortcut_modifiers))
-		{
-			if (!technique.enabled)
-				enable_technique(technique);
-			else
-				disable_technique(technique);
-		}
-
 		if (technique.impl == nullptr || !technique.enabled)
 			continue; // Ignore techniques that are not fully loaded or currently disabled
 
 		const auto time_technique_started = std::chrono::high_resolution_clock::now();
-		render_technique(technique);
+		{
+			const frame_profiler::scope profile_technique(*_profiler, technique.name);
+			render_technique(technique);
+		}
 		const auto time_technique_finished = std::chrono::high_resolution_clock::now();
 
-		technique.average_cpu_duration.append(std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count());
+		const uint64_t cpu_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(time_technique_finished - time_technique_started).count();
+		technique.average_cpu_duration.append(cpu_duration);
+		technique.cpu_statistics.append(cpu_duration);
 
 		if (technique.time_left > 0)
 		{
@@ -1052,6 +1270,39 @@ void reshade::runtime::update_and_render_effects()
 
 	if (_should_save_screenshot)
 		save_screenshot(std::wstring(), true);
+
+	if (_frame_capture->is_active())
+		capture_frame();
+}
+void reshade::runtime::update_pass_culling()
+{
+	_pass_culling_dirty = false;
+
+	std::unordered_set<std::string_view> live_textures;
+
+#if RESHADE_GUI
+	// The texture currently previewed in the overlay has to stay up to date
+	if (_preview_texture != nullptr)
+		for (const texture &texture : _textures)
+			if (texture.impl == _preview_texture)
+				live_textures.insert(texture.unique_name);
+#endif
+
+	std::vector<const std::vector<reshadefx::pass_info> *> enabled_techniques;
+	for (technique &technique : _techniques)
+	{
+		// Passes of disabled techniques are not rendered anyway, so do not need to be culled
+		technique.culled_passes.assign(technique.passes.size(), false);
+		if (technique.enabled)
+			enabled_techniques.push_back(&technique.passes);
+	}
+
+	std::vector<std::vector<bool>> culled_passes = find_culled_passes(enabled_techniques, std::move(live_textures));
+
+	size_t enabled_index = 0;
+	for (technique &technique : _techniques)
+		if (technique.enabled)
+			technique.culled_passes = std::move(culled_passes[enabled_index++]);
 }
 
 void reshade::runtime::enable_technique(technique &technique)
@@ -1074,7 +1325,8 @@ void reshade::runtime::enable_technique(technique &technique)
 	}
 
 	if (status_changed) // Increase rendering reference count
-		_effects[technique.effect_index].rendering++;
+		_effects[technique.effect_index].rendering++,
+		_pass_culling_dirty = true;
 }
 void reshade::runtime::disable_technique(technique &technique)
 {
@@ -1085,9 +1337,98 @@ void reshade::runtime::disable_technique(technique &technique)
 	technique.time_left = 0;
 	technique.average_cpu_duration.clear();
 	technique.average_gpu_duration.clear();
+	technique.cpu_statistics.clear();
+	technique.gpu_statistics.clear();
 
 	if (status_changed) // Decrease rendering reference count
-		_effects[technique.effect_index].rendering--;
+		_effects[technique.effect_index].rendering--,
+		_pass_culling_dirty = true;
+}
+
+static inline uint32_t pack_key_combination(unsigned int keycode, bool ctrl, bool shift, bool alt)
+{
+	return keycode | (ctrl ? 0x100 : 0) | (shift ? 0x200 : 0) | (alt ? 0x400 : 0);
+}
+
+void reshade::runtime::update_key_bindings()
+{
+	if (!_key_bindings_dirty)
+		return;
+
+	_key_bindings.clear();
+
+	const auto add_binding = [this](const unsigned int key[4], key_binding::binding_type type, size_t index = 0, size_t uniform_binding_index = 0) {
+		if (key[0] != 0) // Ignore unbound shortcuts
+			_key_bindings.emplace(pack_key_combination(key[0], key[1] != 0, key[2] != 0, key[3] != 0), key_binding { type, index, uniform_binding_index });
+	};
+
+	add_binding(_effects_key_data, key_binding::binding_type::toggle_effects);
+	add_binding(_screenshot_key_data, key_binding::binding_type::take_screenshot);
+	add_binding(_frame_capture_key_data, key_binding::binding_type::toggle_frame_capture);
+	add_binding(_profiler_key_data, key_binding::binding_type::save_profiler_trace);
+	add_binding(_reload_key_data, key_binding::binding_type::reload_effects);
+	add_binding(_prev_preset_key_data, key_binding::binding_type::previous_preset);
+	add_binding(_next_preset_key_data, key_binding::binding_type::next_preset);
+
+	// Techniques and uniform variables are still being added by the loading threads, so only add those after loading finished
+	if (is_loading())
+		return;
+
+	for (size_t technique_index = 0; technique_index < _techniques.size(); ++technique_index)
+		add_binding(_techniques[technique_index].toggle_key_data, key_binding::binding_type::toggle_technique, technique_index);
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+
+		for (size_t binding_index = 0; binding_index < effect.toggle_key_uniforms.size(); ++binding_index)
+			add_binding(effect.uniforms[effect.toggle_key_uniforms[binding_index].uniform_index].toggle_key_data, key_binding::binding_type::toggle_uniform, effect_index, binding_index);
+	}
+
+	_key_bindings_dirty = false;
+}
+const std::vector<reshade::key_binding> &reshade::runtime::pressed_key_bindings()
+{
+	// The result is the same for the entire frame, so only need to look it up once
+	if (_pressed_key_bindings_valid)
+		return _pressed_key_bindings;
+
+	update_key_bindings();
+
+	_pressed_key_bindings.clear();
+	_pressed_key_bindings_valid = true;
+
+#ifndef NDEBUG
+	// Release builds hold the input lock for the entire frame already (see 'on_present' and 'update_and_render_effects'), but debug builds do not
+	// The window message thread appends to the list of changed keys, so it must not be modified while iterating over it here
+	const auto input_lock = _input->lock();
+#endif
+
+	const bool ctrl_down = _input->is_key_down(0x11); // VK_CONTROL
+	const bool shift_down = _input->is_key_down(0x10); // VK_SHIFT
+	const bool alt_down = _input->is_key_down(0x12); // VK_MENU
+
+	for (const unsigned int keycode : _input->changed_keys())
+	{
+		if (!_input->is_key_pressed(keycode))
+			continue;
+
+		// Bindings only have to match the modifiers they require (unless modifiers are forced to match exactly), so look up every combination of the modifiers that are currently down
+		for (unsigned int modifiers = 0; modifiers < 8; ++modifiers)
+		{
+			const bool ctrl = (modifiers & 0x1) != 0, shift = (modifiers & 0x2) != 0, alt = (modifiers & 0x4) != 0;
+			if ((ctrl && !ctrl_down) || (shift && !shift_down) || (alt && !alt_down))
+				continue;
+			if (_force_shortcut_modifiers && (ctrl != ctrl_down || shift != shift_down || alt != alt_down))
+				continue;
+
+			const auto range = _key_bindings.equal_range(pack_key_combination(keycode, ctrl, shift, alt));
+			for (auto it = range.first; it != range.second; ++it)
+				_pressed_key_bindings.push_back(it->second);
+		}
+	}
+
+	return _pressed_key_bindings;
 }
 
 void reshade::runtime::subscribe_to_load_config(std::function<void(const ini_file &)> function)
@@ -1107,9 +1448,13 @@ void reshade::runtime::load_config()
 {
 	const ini_file &config = ini_file::load_cache(_configuration_path);
 
+	_key_bindings_dirty = true;
+
 	config.get("INPUT", "KeyReload", _reload_key_data);
 	config.get("INPUT", "KeyEffects", _effects_key_data);
 	config.get("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.get("INPUT", "KeyFrameCapture", _frame_capture_key_data);
+	config.get("INPUT", "KeyProfilerTrace", _profiler_key_data);
 	config.get("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.get("INPUT", "KeyNextPreset", _next_preset_key_data);
 	config.get("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
@@ -1119,16 +1464,25 @@ void reshade::runtime::load_config()
 	config.get("GENERAL", "TextureSearchPaths", _texture_search_paths);
 	config.get("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
 	config.get("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+	config.get("GENERAL", "PresetTransitionInterpolate", _preset_transition_interpolate);
 	config.get("GENERAL", "ScreenshotPath", _screenshot_path);
 	config.get("GENERAL", "ScreenshotFormat", _screenshot_format);
 	config.get("GENERAL", "ScreenshotSaveUI", _screenshot_save_ui);
 	config.get("GENERAL", "ScreenshotSaveBefore", _screenshot_save_before);
 	config.get("GENERAL", "ScreenshotIncludePreset", _screenshot_include_preset);
 	config.get("GENERAL", "ScreenshotJPEGQuality", _screenshot_jpeg_quality);
+	config.get("GENERAL", "ScreenshotPNGCompression", _screenshot_png_compression);
 	config.get("GENERAL", "ScreenshotClearAlpha", _screenshot_clear_alpha);
+	config.get("GENERAL", "FrameCaptureDuration", _frame_capture_duration);
+	config.get("GENERAL", "FrameCaptureBuffers", _frame_capture_buffers);
+	config.get("GENERAL", "ProfilerEnabled", _profiler_enabled);
+	config.get("GENERAL", "ProfilerTraceFrames", _profiler_trace_frames);
+	config.get("GENERAL", "StatisticsWindow", _statistics_window);
+	config.get("GENERAL", "StutterThreshold", _stutter_threshold);
 
 	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.get("GENERAL", "NoTextureAliasing", _no_texture_aliasing);
 
 	// Check if the preset uses the new preset path option
 	if (!config.get("GENERAL", "CurrentPresetPath", _current_preset_path))
@@ -1147,6 +1501,8 @@ void reshade::runtime::load_config()
 	if (!resolve_preset_path(_current_preset_path))
 		_current_preset_path = g_target_executable_path.parent_path() / L"DefaultPreset.ini";
 
+	_profiler->set_enabled(_profiler_enabled);
+
 	for (const auto &callback : _load_config_callables)
 		callback(config);
 }
@@ -1154,9 +1510,14 @@ void reshade::runtime::save_config() const
 {
 	ini_file &config = ini_file::load_cache(_configuration_path);
 
+	// Shortcuts may have been changed in the settings, so the lookup table needs to be rebuilt
+	_key_bindings_dirty = true;
+
 	config.set("INPUT", "KeyReload", _reload_key_data);
 	config.set("INPUT", "KeyEffects", _effects_key_data);
 	config.set("INPUT", "KeyScreenshot", _screenshot_key_data);
+	config.set("INPUT", "KeyFrameCapture", _frame_capture_key_data);
+	config.set("INPUT", "KeyProfilerTrace", _profiler_key_data);
 	config.set("INPUT", "KeyPreviousPreset", _prev_preset_key_data);
 	config.set("INPUT", "KeyNextPreset", _next_preset_key_data);
 	config.set("INPUT", "ForceShortcutModifiers", _force_shortcut_modifiers);
@@ -1167,16 +1528,25 @@ void reshade::runtime::save_config() const
 	config.set("GENERAL", "PreprocessorDefinitions", _global_preprocessor_definitions);
 	config.set("GENERAL", "CurrentPresetPath", _current_preset_path);
 	config.set("GENERAL", "PresetTransitionDelay", _preset_transition_delay);
+	config.set("GENERAL", "PresetTransitionInterpolate", _preset_transition_interpolate);
 	config.set("GENERAL", "ScreenshotPath", _screenshot_path);
 	config.set("GENERAL", "ScreenshotFormat", _screenshot_format);
 	config.set("GENERAL", "ScreenshotSaveUI", _screenshot_save_ui);
 	config.set("GENERAL", "ScreenshotSaveBefore", _screenshot_save_before);
 	config.set("GENERAL", "ScreenshotIncludePreset", _screenshot_include_preset);
 	config.set("GENERAL", "ScreenshotJPEGQuality", _screenshot_jpeg_quality);
+	config.set("GENERAL", "ScreenshotPNGCompression", _screenshot_png_compression);
 	config.set("GENERAL", "ScreenshotClearAlpha", _screenshot_clear_alpha);
+	config.set("GENERAL", "FrameCaptureDuration", _frame_capture_duration);
+	config.set("GENERAL", "FrameCaptureBuffers", _frame_capture_buffers);
+	config.set("GENERAL", "ProfilerEnabled", _profiler_enabled);
+	config.set("GENERAL", "ProfilerTraceFrames", _profiler_trace_frames);
+	config.set("GENERAL", "StatisticsWindow", _statistics_window);
+	config.set("GENERAL", "StutterThreshold", _stutter_threshold);
 
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "NoTextureAliasing", _no_texture_aliasing);
 
 	for (const auto &callback : _save_config_callables)
 		callback(config);
@@ -1185,6 +1555,7 @@ void reshade::runtime::save_config() const
 void reshade::runtime::load_current_preset()
 {
 	_preset_save_success = true;
+	_key_bindings_dirty = true;
 
 	ini_file config = ini_file::load_cache(_configuration_path); // Copy config, because reference becomes invalid in the next line
 	const ini_file &preset = ini_file::load_cache(_current_preset_path);
@@ -1217,21 +1588,17 @@ void reshade::runtime::load_current_preset()
 			       (std::find(sorted_technique_list.begin(), sorted_technique_list.end(), rhs.name) - sorted_technique_list.begin());
 		});
 
-	// Compute times since the transition has started and how much is left till it should end
-	auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
-	auto transition_ms_left = _preset_transition_delay - transition_time / 1000;
-	auto transition_ms_left_from_last_frame = transition_ms_left + std::chrono::duration_cast<std::chrono::microseconds>(_last_frame_duration).count() / 1000;
-
-	if (_is_in_between_presets_transition && transition_ms_left <= 0)
-		_is_in_between_presets_transition = false;
+	// Resolve all values of the preset against the loaded effects once, so that a transition does not have to look up and parse them again every frame
+	compile_current_preset(preset);
 
 	for (effect &effect : _effects)
 	{
+		const std::string section = effect.source_file.filename().u8string();
+
 		for (uniform &variable : effect.uniforms)
 		{
 			if (variable.special != special_uniform::none)
 				continue;
-			const std::string section = effect.source_file.filename().u8string();
 
 			if (variable.supports_toggle_key())
 			{
@@ -1243,40 +1610,27 @@ void reshade::runtime::load_current_preset()
 			if (!_is_in_between_presets_transition)
 				// Reset values to defaults before loading from a new preset
 				reset_uniform_value(variable);
-
-			reshadefx::constant values, values_old;
-			switch (variable.type.base)
-			{
-			case reshadefx::type::t_int:
-				get_uniform_value(variable, values.as_int, variable.type.components());
-				preset.get(section, variable.name, values.as_int);
-				set_uniform_value(variable, values.as_int, variable.type.components());
-				break;
-			case reshadefx::type::t_bool:
-			case reshadefx::type::t_uint:
-				get_uniform_value(variable, values.as_uint, variable.type.components());
-				preset.get(section, variable.name, values.as_uint);
-				set_uniform_value(variable, values.as_uint, variable.type.components());
-				break;
-			case reshadefx::type::t_float:
-				get_uniform_value(variable, values.as_float, variable.type.components());
-				values_old = values;
-				preset.get(section, variable.name, values.as_float);
-				if (_is_in_between_presets_transition)
-				{
-					// Perform smooth transition on floating point values
-					for (unsigned int i = 0; i < variable.type.components(); i++)
-					{
-						const auto transition_ratio = (values.as_float[i] - values_old.as_float[i]) / transition_ms_left_from_last_frame;
-						values.as_float[i] = values.as_float[i] - transition_ratio * transition_ms_left;
-					}
-				}
-				set_uniform_value(variable, values.as_float, variable.type.components());
-				break;
-			}
 		}
 	}
 
+	if (_is_in_between_presets_transition)
+	{
+		// Blend from the values that are currently set
+		for (const compiled_preset::value &value : _compiled_preset.interpolated_values)
+			get_uniform_value(_effects[value.effect_index].uniforms[value.uniform_index],
+				reinterpret_cast<uint8_t *>(_compiled_preset.float_start_data.data() + value.offset), value.size, 0);
+
+		// Only floating-point values are blended, so switch all others right away
+		if (_preset_transition_interpolate)
+			apply_compiled_preset(false);
+
+		update_preset_transition();
+	}
+	else
+	{
+		apply_compiled_preset(true);
+	}
+
 	for (technique &technique : _techniques)
 	{
 		// Ignore preset if "enabled" annotation is set
@@ -1298,6 +1652,9 @@ void reshade::runtime::save_current_preset() const
 {
 	ini_file &preset = ini_file::load_cache(_current_preset_path);
 
+	// Technique or variable shortcuts may have been changed, or techniques reordered, so the lookup table needs to be rebuilt
+	_key_bindings_dirty = true;
+
 	// Build list of active techniques and effects
 	std::vector<std::string> technique_list, sorted_technique_list;
 	std::unordered_set<size_t> effect_list;
@@ -1370,6 +1727,110 @@ void reshade::runtime::save_current_preset() const
 		}
 	}
 }
+void reshade::runtime::compile_current_preset(const ini_file &preset)
+{
+	_compiled_preset.clear();
+	_compiled_preset.path = _current_preset_path;
+
+	for (size_t effect_index = 0; effect_index < _effects.size(); ++effect_index)
+	{
+		const effect &effect = _effects[effect_index];
+		const std::string section = effect.source_file.filename().u8string();
+
+		for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+		{
+			const uniform &variable = effect.uniforms[uniform_index];
+			if (variable.special != special_uniform::none)
+				continue;
+
+			const unsigned int components = variable.type.components();
+			compiled_preset::value value = { effect_index, uniform_index, 0, components * 4 };
+
+			// Start with the default value, so that variables that are missing from the preset are reset
+			reshadefx::constant values = {};
+			if (variable.has_initializer_value)
+				std::memcpy(values.as_uint, (variable.type.is_array() ? variable.initializer_value.array_data[0] : variable.initializer_value).as_uint, sizeof(values.as_uint));
+
+			switch (variable.type.base)
+			{
+			case reshadefx::type::t_int:
+				preset.get(section, variable.name, values.as_int);
+				break;
+			case reshadefx::type::t_bool:
+			case reshadefx::type::t_uint:
+				preset.get(section, variable.name, values.as_uint);
+				break;
+			case reshadefx::type::t_float:
+				preset.get(section, variable.name, values.as_float);
+				// Floating-point values are always stored as such, so no conversion is needed
+				value.offset = static_cast<uint32_t>(_compiled_preset.float_data.size());
+				_compiled_preset.float_data.insert(_compiled_preset.float_data.end(), values.as_float, values.as_float + components);
+				_compiled_preset.interpolated_values.push_back(value);
+				continue;
+			default:
+				continue;
+			}
+
+			// Convert to the layout the value is stored in, so that it can be copied as-is
+			if (force_floating_point_value(variable.type, _renderer_id))
+				for (unsigned int i = 0; i < components; ++i)
+					values.as_float[i] = variable.type.is_signed() ? static_cast<float>(values.as_int[i]) : static_cast<float>(values.as_uint[i]);
+
+			value.offset = static_cast<uint32_t>(_compiled_preset.data.size());
+			_compiled_preset.data.insert(_compiled_preset.data.end(), reinterpret_cast<const uint8_t *>(values.as_uint), reinterpret_cast<const uint8_t *>(values.as_uint + components));
+			_compiled_preset.values.push_back(value);
+		}
+	}
+
+	_compiled_preset.float_start_data = _compiled_preset.float_data;
+	_compiled_preset.float_current_data.resize(_compiled_preset.float_data.size());
+}
+void reshade::runtime::apply_compiled_preset(bool include_interpolated)
+{
+	for (const compiled_preset::value &value : _compiled_preset.values)
+		set_uniform_value(_effects[value.effect_index].uniforms[value.uniform_index], _compiled_preset.data.data() + value.offset, value.size, 0);
+
+	if (!include_interpolated)
+		return;
+
+	for (const compiled_preset::value &value : _compiled_preset.interpolated_values)
+		set_uniform_value(_effects[value.effect_index].uniforms[value.uniform_index],
+			reinterpret_cast<const uint8_t *>(_compiled_preset.float_data.data() + value.offset), value.size, 0);
+}
+void reshade::runtime::update_preset_transition()
+{
+	// Preset was switched or effects were reloaded since it was last compiled, so need to load it again (which calls back into here)
+	if (_compiled_preset.path != _current_preset_path)
+	{
+		load_current_preset();
+		return;
+	}
+
+	const auto transition_time = std::chrono::duration_cast<std::chrono::microseconds>(_last_present_time - _last_preset_switching_time).count();
+	const float transition_ratio = _preset_transition_delay != 0 ? std::min(transition_time / (_preset_transition_delay * 1000.0f), 1.0f) : 1.0f;
+
+	if (transition_ratio >= 1.0f)
+	{
+		apply_compiled_preset(true);
+		_is_in_between_presets_transition = false;
+		return;
+	}
+
+	// Keep the previous values until the transition has finished if blending is disabled
+	if (!_preset_transition_interpolate)
+		return;
+
+	// Blend all floating-point values in a single pass over contiguous arrays, which the compiler can vectorize
+	const float *const start_data = _compiled_preset.float_start_data.data();
+	const float *const end_data = _compiled_preset.float_data.data();
+	float *const current_data = _compiled_preset.float_current_data.data();
+	for (size_t i = 0, count = _compiled_preset.float_data.size(); i < count; ++i)
+		current_data[i] = start_data[i] + (end_data[i] - start_data[i]) * transition_ratio;
+
+	for (const compiled_preset::value &value : _compiled_preset.interpolated_values)
+		set_uniform_value(_effects[value.effect_index].uniforms[value.uniform_index],
+			reinterpret_cast<const uint8_t *>(current_data + value.offset), value.size, 0);
+}
 
 bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path, bool reversed)
 {
@@ -1383,16 +1844,13 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 	size_t current_preset_index = std::numeric_limits<size_t>::max();
 	std::vector<std::filesystem::path> preset_paths;
 
-	for (std::filesystem::path preset_path : std::filesystem::directory_iterator(filter_path, std::filesystem::directory_options::skip_permission_denied, ec))
+	// The index is only rebuilt when the directory changed, so this does not have to touch the file system on every switch
+	for (const std::filesystem::path &preset_path : _preset_index->presets(filter_path))
 	{
-		// Skip anything that is not a valid preset file
-		if (!resolve_preset_path(preset_path))
-			continue;
-
 		// Keep track of the index of the current preset in the list of found preset files that is being build
-		if (std::filesystem::equivalent(preset_path, _current_preset_path, ec)) {
+		if (preset_path == _current_preset_path) {
 			current_preset_index = preset_paths.size();
-			preset_paths.push_back(std::move(preset_path));
+			preset_paths.push_back(preset_path);
 			continue;
 		}
 
@@ -1400,7 +1858,7 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 		// Only add those files that are matching the filter text
 		if (filter_text.empty() || std::search(preset_name.begin(), preset_name.end(), filter_text.native().begin(), filter_text.native().end(),
 			[](wchar_t c1, wchar_t c2) { return towlower(c1) == towlower(c2); }) != preset_name.end())
-			preset_paths.push_back(std::move(preset_path));
+			preset_paths.push_back(preset_path);
 	}
 
 	if (preset_paths.begin() == preset_paths.end())
@@ -1428,6 +1886,8 @@ bool reshade::runtime::switch_to_next_preset(std::filesystem::path filter_path,
 
 void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool should_save_preset)
 {
+	const frame_profiler::scope profile(*_profiler, "Screenshot");
+
 	const int hour = _date[3] / 3600;
 	const int minute = (_date[3] - hour * 3600) / 60;
 	const int seconds = _date[3] - hour * 3600 - minute * 60;
@@ -1453,9 +1913,7 @@ void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool s
 		// Clear alpha channel
 		// The alpha channel doesn't need to be cleared if we're saving a JPEG, stbi ignores it
 		if (_screenshot_clear_alpha && _screenshot_format != 2)
-			for (uint32_t h = 0; h < _height; ++h)
-				for (uint32_t w = 0; w < _width; ++w)
-					data[(h * _width + w) * 4 + 3] = 0xFF;
+			pixel::clear_alpha(data.data(), _width * _height);
 
 		if (FILE *file; _wfopen_s(&file, screenshot_path.c_str(), L"wb") == 0)
 		{
@@ -1469,7 +1927,8 @@ void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool s
 				_screenshot_save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, 4, data.data()) != 0;
 				break;
 			case 1:
-				_screenshot_save_success = stbi_write_png_to_func(write_callback, file, _width, _height, 4, data.data(), 0) != 0;
+				// Use multi-threaded encoder instead of 'stbi_write_png_to_func', since compression dominates the time it takes to save large screenshots
+				_screenshot_save_success = png::write_to_func(write_callback, file, _width, _height, 4, data.data(), _screenshot_png_compression);
 				break;
 			case 2:
 				_screenshot_save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, 4, data.data(), _screenshot_jpeg_quality) != 0;
@@ -1494,13 +1953,164 @@ void reshade::runtime::save_screenshot(const std::wstring &postfix, const bool s
 	}
 }
 
-static inline bool force_floating_point_value(const reshadefx::type &type, uint32_t renderer_id)
+void reshade::runtime::start_frame_capture()
 {
-	if (renderer_id == 0x9000)
-		return true; // All uniform variables are floating-point in D3D9
-	if (type.is_matrix() && (renderer_id & 0x10000))
-		return true; // All matrices are floating-point in GLSL
-	return false;
+	const int hour = _date[3] / 3600;
+	const int minute = (_date[3] - hour * 3600) / 60;
+	const int seconds = _date[3] - hour * 3600 - minute * 60;
+
+	char timestamp[21];
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", _date[0], _date[1], _date[2], hour, minute, seconds);
+
+	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
+	filename += L".rsfc";
+
+	const std::filesystem::path capture_path = g_target_executable_path.parent_path() / _screenshot_path / filename;
+
+	if (_frame_capture->start(capture_path, _width, _height, std::max(_frame_capture_buffers, 2u)))
+		_frame_capture_start_time = _last_present_time;
+}
+void reshade::runtime::capture_frame()
+{
+	const frame_profiler::scope profile(*_profiler, "Frame capture");
+
+	// Stop automatically once the configured duration has passed (a duration of zero means to capture until the shortcut is pressed again)
+	if (_frame_capture_duration != 0 && _last_present_time - _frame_capture_start_time >= std::chrono::seconds(_frame_capture_duration))
+	{
+		_frame_capture->stop();
+		return;
+	}
+
+	if (uint8_t *const buffer = _frame_capture->begin_frame())
+	{
+		const auto time_capture_started = std::chrono::high_resolution_clock::now();
+		const bool success = capture_screenshot(buffer);
+		const auto time_capture_finished = std::chrono::high_resolution_clock::now();
+
+		_frame_capture->end_frame(_framecount, time_capture_finished - time_capture_started, success);
+	}
+}
+
+bool reshade::runtime::save_profiler_trace(const std::filesystem::path &path, size_t num_frames)
+{
+	return _profiler->export_trace(path, num_frames);
+}
+void reshade::runtime::save_profiler_trace()
+{
+	const int hour = _date[3] / 3600;
+	const int minute = (_date[3] - hour * 3600) / 60;
+	const int seconds = _date[3] - hour * 3600 - minute * 60;
+
+	char timestamp[21];
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", _date[0], _date[1], _date[2], hour, minute, seconds);
+
+	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
+	filename += L" trace.json";
+
+	if (!_profiler->is_enabled())
+		LOG(WARN) << "Profiler is disabled, so the trace only contains frames from before it was disabled.";
+
+	save_profiler_trace(g_target_executable_path.parent_path() / _screenshot_path / filename, _profiler_trace_frames);
+}
+
+void reshade::runtime::update_statistics(std::chrono::nanoseconds overhead)
+{
+	const uint64_t frame_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(_last_frame_duration).count();
+
+	// Compare against the median of recent frames rather than a fixed limit, so that a steady low frame rate is not reported as stuttering
+	if (const duration_histogram &baseline = _frame_time_statistics.results(); baseline.count() >= 30)
+	{
+		if (const uint64_t median_duration = baseline.percentile(0.5); frame_duration > median_duration * static_cast<double>(_stutter_threshold))
+		{
+			// Only keep the most recent events
+			if (_stutter_events.size() >= 100)
+				_stutter_events.erase(_stutter_events.begin());
+
+			_stutter_events.push_back({ _framecount, _last_present_time - _start_time, frame_duration, median_duration });
+		}
+	}
+
+	_frame_time_statistics.append(frame_duration);
+	_overhead_statistics.append(overhead.count());
+
+	if (_statistics_window == 0 || _last_present_time - _statistics_window_start_time < std::chrono::seconds(_statistics_window))
+		return;
+
+	_statistics_window_start_time = _last_present_time;
+
+	_frame_time_statistics.next_window();
+	_overhead_statistics.next_window();
+
+	for (technique &technique : _techniques)
+	{
+		technique.cpu_statistics.next_window();
+		technique.gpu_statistics.next_window();
+	}
+}
+void reshade::runtime::reset_statistics()
+{
+	_statistics_window_start_time = _last_present_time;
+
+	_frame_time_statistics.clear();
+	_overhead_statistics.clear();
+	_stutter_events.clear();
+
+	for (technique &technique : _techniques)
+	{
+		technique.cpu_statistics.clear();
+		technique.gpu_statistics.clear();
+	}
+}
+void reshade::runtime::save_statistics()
+{
+	const int hour = _date[3] / 3600;
+	const int minute = (_date[3] - hour * 3600) / 60;
+	const int seconds = _date[3] - hour * 3600 - minute * 60;
+
+	char timestamp[21];
+	sprintf_s(timestamp, " %.4d-%.2d-%.2d %.2d-%.2d-%.2d", _date[0], _date[1], _date[2], hour, minute, seconds);
+
+	std::wstring filename = g_target_executable_path.stem().concat(timestamp);
+	filename += L" statistics.csv";
+
+	const std::filesystem::path statistics_path = g_target_executable_path.parent_path() / _screenshot_path / filename;
+
+	FILE *file = nullptr;
+	if (_wfopen_s(&file, statistics_path.c_str(), L"w") != 0)
+	{
+		LOG(ERROR) << "Failed to open " << statistics_path << " for writing statistics!";
+		return;
+	}
+
+	const auto write_row = [file](const char *name, const char *type, const duration_histogram &results) {
+		fprintf(file, "%s,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n", name, type, results.count(),
+			results.mean() * 1e-6, results.percentile(0.50) * 1e-6, results.percentile(0.95) * 1e-6, results.percentile(0.99) * 1e-6, results.max() * 1e-6);
+	};
+
+	fputs("Name,Type,Samples,Mean (ms),p50 (ms),p95 (ms),p99 (ms),Max (ms)\n", file);
+	write_row("Frame", "Frame time", _frame_time_statistics.results());
+	write_row("Effects", "Overhead", _overhead_statistics.results());
+
+	for (const technique &technique : _techniques)
+	{
+		if (technique.cpu_statistics.results().count() != 0)
+			write_row(technique.name.c_str(), "CPU", technique.cpu_statistics.results());
+		// GPU timings are not available for all APIs
+		if (technique.gpu_statistics.results().count() != 0)
+			write_row(technique.name.c_str(), "GPU", technique.gpu_statistics.results());
+	}
+
+	fputs("\nStutter Frame,Time (s),Duration (ms),Median (ms)\n", file);
+	for (const stutter_event &event : _stutter_events)
+		fprintf(file, "%llu,%.3f,%.3f,%.3f\n", event.frame, event.time.count() * 1e-9, event.duration * 1e-6, event.median_duration * 1e-6);
+
+	const bool success = ferror(file) == 0;
+	fclose(file);
+
+	if (success)
+		LOG(INFO) << "Saved statistics to " << statistics_path << '.';
+	else
+		LOG(ERROR) << "Failed to write statistics to " << statistics_path << '!';
 }
 
 void reshade::runtime::get_uniform_value(const uniform &variable, uint8_t *data, size_t size, size_t base_index) const
@@ -1595,7 +2205,8 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 	size = std::min(size, static_cast<size_t>(variable.size));
 	assert(data != nullptr && (size % 4) == 0);
 
-	auto &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	effect &effect = _effects[variable.effect_index];
+	auto &data_storage = effect.uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1);
@@ -1622,8 +2233,14 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 	}
 	else
 	{
+		// Many special uniforms are set to the same value every frame (date, key states, ...), so avoid marking those as modified
+		if (std::memcmp(data_storage.data() + variable.offset, data, size) == 0)
+			return;
+
 		std::memcpy(data_storage.data() + variable.offset, data, size);
 	}
+
+	effect.mark_uniform_data_dirty(variable.offset, variable.size);
 }
 void reshade::runtime::set_uniform_value(uniform &variable, const bool *values, size_t count, size_t array_index)
 {
@@ -1695,6 +2312,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	if (!variable.has_initializer_value)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		_effects[variable.effect_index].mark_uniform_data_dirty(variable.offset, variable.size);
 		return;
 	}
 
@@ -1722,8 +2340,8 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 
 reshade::texture &reshade::runtime::look_up_texture_by_name(const std::string &unique_name)
 {
-	const auto it = std::find_if(_textures.begin(), _textures.end(),
-		[&unique_name](const auto &item) { return item.unique_name == unique_name && item.impl != nullptr; });
-	assert(it != _textures.end());
-	return *it;
+	size_t index = std::numeric_limits<size_t>::max();
+	_texture_registry.find_by_name(unique_name, index);
+	assert(index < _textures.size() && _textures[index].impl != nullptr);
+	return _textures[index];
 }
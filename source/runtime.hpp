@@ -11,6 +11,9 @@
 #include <chrono>
 #include <functional>
 #include <filesystem>
+#include <unordered_map>
+#include "frame_statistics.hpp"
+#include "texture_registry.hpp"
 
 #if RESHADE_GUI
 #include "imgui_editor.hpp"
@@ -26,6 +29,67 @@ namespace reshade
 	struct uniform;
 	struct texture;
 	struct technique;
+	class frame_capture;
+	class frame_profiler;
+	class preset_index;
+	class file_index;
+
+	/// <summary>
+	/// Something a keyboard shortcut is bound to: Either a global action, or toggling a technique or uniform variable.
+	/// </summary>
+	struct key_binding
+	{
+		enum class binding_type
+		{
+			toggle_effects,
+			take_screenshot,
+			toggle_frame_capture,
+			save_profiler_trace,
+			reload_effects,
+			previous_preset,
+			next_preset,
+			toggle_technique,
+			toggle_uniform,
+		};
+
+		binding_type type;
+		size_t index = 0; // Index of the technique or the effect the uniform variable belongs to
+		size_t uniform_binding_index = 0; // Index into the 'toggle_key_uniforms' list of that effect
+	};
+
+	/// <summary>
+	/// The uniform variable values of a preset, resolved against the loaded effects once, so that they can be applied every frame without any string handling.
+	/// </summary>
+	struct compiled_preset
+	{
+		struct value
+		{
+			size_t effect_index;
+			size_t uniform_index;
+			uint32_t offset; // Offset into 'data' in bytes, or into 'float_data' in elements for interpolated values
+			uint32_t size; // Size in bytes, in the packed layout used by 'get_uniform_value' and 'set_uniform_value'
+		};
+
+		std::filesystem::path path;
+		std::vector<value> values;
+		std::vector<uint8_t> data;
+		// Floating-point values are kept separately, so that they can be blended in a single pass during a preset transition
+		std::vector<value> interpolated_values;
+		std::vector<float> float_data;
+		std::vector<float> float_start_data;
+		std::vector<float> float_current_data;
+
+		void clear()
+		{
+			path.clear();
+			values.clear();
+			data.clear();
+			interpolated_values.clear();
+			float_data.clear();
+			float_start_data.clear();
+			float_current_data.clear();
+		}
+	};
 
 	/// <summary>
 	/// Platform independent base class for the main ReShade runtime.
@@ -59,6 +123,14 @@ namespace reshade
 		/// </summary>
 		void save_config() const;
 
+		/// <summary>
+		/// Write the profiling data of the last frames to a file in the Chrome trace event format.
+		/// This only contains data if the profiler is enabled in the settings. The file is written on a separate thread, so it may not exist yet when this returns.
+		/// </summary>
+		/// <param name="path">The path to the JSON file to create.</param>
+		/// <param name="num_frames">The number of frames to include, counting back from the current one.</param>
+		bool save_profiler_trace(const std::filesystem::path &path, size_t num_frames);
+
 		/// <summary>
 		/// Create a new texture with the specified dimensions.
 		/// </summary>
@@ -162,6 +234,11 @@ namespace reshade
 		/// </summary>
 		void load_effects();
 		/// <summary>
+		/// Let render targets that only hold intermediate results share memory with other ones whose lifetime does not overlap.
+		/// This has to be called after all effects finished loading, but before any of their textures are created.
+		/// </summary>
+		void alias_transient_textures();
+		/// <summary>
 		/// Initialize resources for the effect and load the effect module.
 		/// </summary>
 		/// <param name="index">The ID of the effect.</param>
@@ -186,6 +263,10 @@ namespace reshade
 		/// </summary>
 		void update_and_render_effects();
 		/// <summary>
+		/// Find the passes of enabled techniques that only write to textures which nothing else reads, so that they can be skipped during rendering.
+		/// </summary>
+		void update_pass_culling();
+		/// <summary>
 		/// Render all passes in a technique.
 		/// </summary>
 		/// <param name="technique">The technique to render.</param>
@@ -223,7 +304,9 @@ namespace reshade
 
 		std::vector<effect> _effects;
 		std::vector<texture> _textures;
+		texture_registry _texture_registry;
 		std::vector<technique> _techniques;
+		std::unique_ptr<frame_profiler> _profiler;
 
 	private:
 		/// <summary>
@@ -249,6 +332,16 @@ namespace reshade
 		/// <param name="technique"></param>
 		void disable_technique(technique &technique);
 
+		/// <summary>
+		/// Rebuild the lookup table from key combinations to the actions, techniques and uniform variables bound to them, if any of those changed.
+		/// </summary>
+		void update_key_bindings();
+		/// <summary>
+		/// Get the list of bindings whose key combination was pressed in the current frame.
+		/// This only looks at the keys that actually changed state, so its cost does not depend on the number of bindings.
+		/// </summary>
+		const std::vector<key_binding> &pressed_key_bindings();
+
 		/// <summary>
 		/// Load user configuration from disk.
 		/// </summary>
@@ -262,6 +355,19 @@ namespace reshade
 		/// Save the current value configuration to the currently selected preset.
 		/// </summary>
 		void save_current_preset() const;
+		/// <summary>
+		/// Resolve the values in the specified preset against the loaded effects and store them in <see cref="_compiled_preset"/>.
+		/// </summary>
+		void compile_current_preset(const ini_file &preset);
+		/// <summary>
+		/// Copy the values of the compiled preset into the uniform storage of the effects.
+		/// </summary>
+		/// <param name="include_interpolated">Set to <c>false</c> to skip floating-point values, which are blended during a transition instead.</param>
+		void apply_compiled_preset(bool include_interpolated);
+		/// <summary>
+		/// Blend between the values at the start of the preset transition and the compiled preset, based on the time that has passed since it started.
+		/// </summary>
+		void update_preset_transition();
 
 		/// <summary>
 		/// Find next preset is the directory and switch to it.
@@ -276,6 +382,34 @@ namespace reshade
 		/// </summary>
 		void save_screenshot(const std::wstring &postfix = std::wstring(), bool should_save_preset = false);
 
+		/// <summary>
+		/// Begin streaming every frame to a file on disk, until the configured duration has passed or the capture is stopped again.
+		/// </summary>
+		void start_frame_capture();
+		/// <summary>
+		/// Copy the current frame into the frame capture ring, or drop it if the writer has not caught up yet.
+		/// </summary>
+		void capture_frame();
+
+		/// <summary>
+		/// Write the profiling data of the configured number of frames to a file next to the screenshots.
+		/// </summary>
+		void save_profiler_trace();
+
+		/// <summary>
+		/// Add the timings of the current frame to the statistics and detect stutters.
+		/// </summary>
+		/// <param name="overhead">The time it took to render effects this frame.</param>
+		void update_statistics(std::chrono::nanoseconds overhead);
+		/// <summary>
+		/// Remove all collected timings and stutter events.
+		/// </summary>
+		void reset_statistics();
+		/// <summary>
+		/// Write the collected timings and stutter events to a CSV file next to the screenshots.
+		/// </summary>
+		void save_statistics();
+
 		// === Status ===
 		int _date[4] = {};
 		bool _effects_enabled = true;
@@ -287,6 +421,12 @@ namespace reshade
 		std::chrono::high_resolution_clock::time_point _start_time;
 		std::chrono::high_resolution_clock::time_point _last_present_time;
 
+		// === Key Bindings ===
+		mutable bool _key_bindings_dirty = true;
+		bool _pressed_key_bindings_valid = false;
+		std::unordered_multimap<uint32_t, key_binding> _key_bindings;
+		std::vector<key_binding> _pressed_key_bindings;
+
 		// == Configuration ===
 		bool _needs_update = false;
 		unsigned long _latest_version[3] = {};
@@ -297,9 +437,11 @@ namespace reshade
 		// === Effect Loading ===
 		bool _no_debug_info = 0;
 		bool _no_reload_on_init = false;
+		bool _no_texture_aliasing = false;
 		bool _last_shader_reload_successful = true;
 		bool _last_texture_reload_successful = true;
 		bool _textures_loaded = false;
+		bool _pass_culling_dirty = true;
 		unsigned int _reload_key_data[4];
 		size_t _reload_total_effects = 1;
 		std::vector<size_t> _reload_compile_queue;
@@ -310,6 +452,7 @@ namespace reshade
 		std::vector<std::string> _preset_preprocessor_definitions;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
+		std::unique_ptr<file_index> _file_index;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
 
 		// === Screenshots ===
@@ -326,6 +469,28 @@ namespace reshade
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
 		unsigned int _screenshot_jpeg_quality = 90;
+		unsigned int _screenshot_png_compression = 6;
+
+		// === Frame Capture ===
+		unsigned int _frame_capture_key_data[4];
+		unsigned int _frame_capture_duration = 10;
+		unsigned int _frame_capture_buffers = 8;
+		std::unique_ptr<frame_capture> _frame_capture;
+		std::chrono::high_resolution_clock::time_point _frame_capture_start_time;
+
+		// === Profiler ===
+		bool _profiler_enabled = false;
+		unsigned int _profiler_key_data[4];
+		unsigned int _profiler_trace_frames = 60;
+
+		// === Statistics ===
+		unsigned int _statistics_window = 5;
+		float _stutter_threshold = 2.0f;
+		duration_statistics _frame_time_statistics;
+		duration_statistics _overhead_statistics;
+		std::vector<stutter_event> _stutter_events;
+		std::chrono::high_resolution_clock::time_point _effects_start_time;
+		std::chrono::high_resolution_clock::time_point _statistics_window_start_time;
 
 		// === Preset Switching ===
 		bool _preset_save_success = true;
@@ -333,8 +498,11 @@ namespace reshade
 		unsigned int _prev_preset_key_data[4];
 		unsigned int _next_preset_key_data[4];
 		unsigned int _preset_transition_delay = 1000;
+		bool _preset_transition_interpolate = true;
 		std::filesystem::path _current_preset_path;
 		std::chrono::high_resolution_clock::time_point _last_preset_switching_time;
+		compiled_preset _compiled_preset;
+		std::unique_ptr<preset_index> _preset_index;
 
 #if RESHADE_GUI
 		void init_ui();
@@ -405,8 +573,10 @@ namespace reshade
 
 		// === User Interface - Log ===
 		bool _log_wordwrap = false;
-		uintmax_t _last_log_size;
+		uint64_t _log_generation = 0;
 		std::vector<std::string> _log_lines;
+		std::vector<unsigned int> _log_line_levels; // Level of every line (see 'log::level'), classified once when it is added
+		std::vector<size_t> _log_filtered_lines; // Indices into '_log_lines' of all lines that pass the filter
 
 		// === User Interface - Code Editor ===
 		imgui_code_editor _editor, _viewer;
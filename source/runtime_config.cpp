@@ -3,14 +3,47 @@
  * License: https://github.com/crosire/reshade#license
  */
 
+#include "dll_log.hpp"
 #include "runtime_config.hpp"
+#include <mutex>
+#include <thread>
+#include <utility>
 #include <fstream>
-#include <sstream>
-
-static std::unordered_map<std::wstring, reshade::ini_file> g_ini_cache;
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
+
+static std::mutex g_write_mutex;
+static std::condition_variable g_write_signal;
+static std::thread g_write_thread;
+static bool g_write_thread_running = false;
+static std::vector<std::filesystem::path> g_write_failed; // Files the background thread failed to write, which are saved again on the next flush
+static std::filesystem::path g_write_in_progress;
+static std::vector<std::pair<std::filesystem::path, std::unique_ptr<reshade::ini_file>>> g_write_queue;
+
+static std::unordered_map<std::filesystem::path::string_type, reshade::ini_file> g_ini_cache;
+
+// Declared after the cache, so that it is destroyed first and pending snapshots are written before the cache destructor saves any newer changes
+static struct write_queue_guard
+{
+	~write_queue_guard()
+	{
+		// This runs while the loader lock is held, so cannot wait on the thread here (it would never be able to exit)
+		// It was already stopped in 'ini_file::stop_background_threads' when the module is unloaded, so if it is left it was terminated during process exit
+		if (g_write_thread.joinable())
+			g_write_thread.detach();
+
+		// The thread may have been terminated before it could finish, so write what is left here
+		g_write_in_progress.clear();
+		while (!g_write_queue.empty())
+			if (const std::filesystem::path path = g_write_queue.front().first; !reshade::ini_file::flush_cache(path))
+				g_write_queue.erase(std::remove_if(g_write_queue.begin(), g_write_queue.end(),
+					[&path](const auto &queued) { return queued.first == path; }), g_write_queue.end());
+	}
+} g_write_queue_guard;
 
 reshade::ini_file::ini_file(const std::filesystem::path &path)
-	: _path(path)
+	: _path(path), _storage(std::make_shared<storage>())
 {
 	load();
 }
@@ -19,6 +52,14 @@ reshade::ini_file::~ini_file()
 	save();
 }
 
+static inline std::string_view trim_view(std::string_view str, const char *chars = " \t\r")
+{
+	const size_t first = str.find_first_not_of(chars);
+	if (first == std::string_view::npos)
+		return std::string_view();
+	return str.substr(first, str.find_last_not_of(chars) - first + 1);
+}
+
 void reshade::ini_file::load()
 {
 	enum class condition { open, not_found, blocked, unknown };
@@ -38,12 +79,14 @@ void reshade::ini_file::load()
 	std::ifstream file;
 
 	if (condition == condition::open)
-		if (file.open(_path); file.fail())
+		if (file.open(_path, std::ios::binary); file.fail())
 			condition = condition::blocked;
 
 	if (condition == condition::blocked || condition == condition::unknown)
 		return;
 
+	// Create new storage instead of reusing the existing one, since copies of this INI file may still reference it
+	_storage = std::make_shared<storage>();
 	_sections.clear();
 	_modified = false;
 
@@ -53,16 +96,26 @@ void reshade::ini_file::load()
 	assert(std::filesystem::file_size(_path, ec) > 0);
 
 	_modified_at = modified_at;
-	file.imbue(std::locale("en-us.UTF-8"));
+
+	// Read the entire file at once, all sections, keys and values then reference this buffer
+	std::string &data = _storage->data;
+	data.resize(static_cast<size_t>(std::filesystem::file_size(_path, ec)));
+	file.read(data.data(), data.size());
+	data.resize(static_cast<size_t>(file.gcount()));
 
 	// Remove BOM (0xefbbbf means 0xfeff)
-	if (file.get() != 0xef || file.get() != 0xbb || file.get() != 0xbf)
-		file.seekg(0, std::ios::beg);
+	const size_t data_begin = data.compare(0, 3, "\xef\xbb\xbf") == 0 ? 3 : 0;
 
-	std::string line, section;
-	while (std::getline(file, line))
+	// Sections are only created once they contain a key, so look them up lazily
+	std::string_view current_section_name;
+	section *current_section = nullptr;
+
+	for (size_t line_offset = data_begin, line_end; line_offset < data.size(); line_offset = line_end + 1)
 	{
-		trim(line);
+		if (line_end = data.find('\n', line_offset); line_end == std::string::npos)
+			line_end = data.size();
+
+		const std::string_view line = trim_view(std::string_view(data).substr(line_offset, line_end - line_offset));
 
 		if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
 			continue;
@@ -70,154 +123,356 @@ void reshade::ini_file::load()
 		// Read section name
 		if (line[0] == '[')
 		{
-			section = trim(line.substr(0, line.find(']')), " \t[]");
+			current_section_name = trim_view(line.substr(0, line.find(']')), " \t[]");
+			current_section = nullptr;
 			continue;
 		}
 
+		if (current_section == nullptr)
+			current_section = &_sections[current_section_name];
+
 		// Read section content
-		const auto assign_index = line.find('=');
+		const size_t assign_index = line.find('=');
 
-		if (assign_index != std::string::npos)
+		if (assign_index != std::string_view::npos)
 		{
-			const auto key = trim(line.substr(0, assign_index));
-			const auto value = trim(line.substr(assign_index + 1));
-			std::vector<std::string> value_splitted;
+			const std::string_view key = trim_view(line.substr(0, assign_index));
+			const std::string_view item_list = trim_view(line.substr(assign_index + 1));
 
-			for (size_t i = 0, len = value.size(), found; i < len; i = found + 1)
-			{
-				found = value.find_first_of(',', i);
+			value &v = (*current_section)[key];
+			v = value();
 
-				if (found == std::string::npos)
+			// Split value into its items by storing their offsets into the file buffer
+			const size_t base_offset = item_list.data() - data.data();
+			for (size_t i = 0, len = item_list.size(), found; i < len; i = found + 1)
+			{
+				if (found = item_list.find(',', i); found == std::string_view::npos)
 					found = len;
 
-				value_splitted.push_back(value.substr(i, found - i));
+				v.items.emplace_back(static_cast<uint32_t>(base_offset + i), static_cast<uint32_t>(found - i));
 			}
-
-			_sections[section][key] = value_splitted;
 		}
 		else
 		{
-			_sections[section][line] = {};
+			(*current_section)[line] = value();
 		}
 	}
 }
 bool reshade::ini_file::save()
 {
-	if (!_modified)
+	if (!can_save())
 		return true;
 
+	// Keep the modified flag if saving was not successful, so to try again later
+	_modified = !write();
+
+	return !_modified;
+}
+void reshade::ini_file::save_async()
+{
+	if (!can_save())
+		return;
+
+	// Copy the current state, so that it can be written while this file continues to be modified
+	auto snapshot = std::make_unique<ini_file>(*this);
+	_modified = false;
+	snapshot->_modified = false;
+
+	const std::lock_guard<std::mutex> lock(g_write_mutex);
+
+	// Coalesce with an older snapshot of the same file that was not written yet
+	if (const auto it = std::find_if(g_write_queue.begin(), g_write_queue.end(),
+			[this](const auto &queued) { return queued.first == _path; });
+		it != g_write_queue.end())
+		it->second = std::move(snapshot);
+	else
+		g_write_queue.emplace_back(_path, std::move(snapshot));
+
+	if (!g_write_thread_running)
+	{
+		// A previous thread has already finished its work at this point (or is about to), so this does not block for long
+		if (g_write_thread.joinable())
+			g_write_thread.join();
+
+		g_write_thread = std::thread(&ini_file::write_queued_files);
+		g_write_thread_running = true;
+	}
+}
+bool reshade::ini_file::can_save()
+{
+	if (!_modified)
+		return false;
+
 	std::error_code ec;
-	std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
+	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(_path, ec);
 	if (ec.value() == 0 && modified_at >= _modified_at)
 	{
 		// File exists and was modified on disk and may have different data, so cannot save
 		_modified = false;
-		return true;
+		return false;
 	}
 
-	std::stringstream data;
-	std::vector<std::string> section_names, key_names;
+	return true;
+}
+bool reshade::ini_file::write() const
+{
+	std::string data;
 
-	section_names.reserve(_sections.size());
+	// Sort sections and keys to generate consistent files (only the views are sorted, the names are not copied)
+	std::vector<const std::pair<const std::string_view, section> *> sorted_sections;
+	sorted_sections.reserve(_sections.size());
 	for (const auto &section : _sections)
-		section_names.push_back(section.first);
+		sorted_sections.push_back(&section);
+	std::sort(sorted_sections.begin(), sorted_sections.end(),
+		[](const auto lhs, const auto rhs) { return name_less()(lhs->first, rhs->first); });
 
-	// Sort sections to generate consistent files
-	std::sort(section_names.begin(), section_names.end(),
-		[](std::string a, std::string b) {
-			std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-			std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-			return a < b;
-		});
+	std::vector<const std::pair<const std::string_view, value> *> sorted_keys;
 
-	for (const std::string &section_name : section_names)
+	for (const auto section : sorted_sections)
 	{
-		const auto &keys = _sections.at(section_name);
+		const auto &[section_name, keys] = *section;
 
-		key_names.clear();
-		key_names.reserve(keys.size());
+		sorted_keys.clear();
+		sorted_keys.reserve(keys.size());
 		for (const auto &key : keys)
-			key_names.push_back(key.first);
-
-		std::sort(key_names.begin(), key_names.end(),
-			[](std::string a, std::string b) {
-				std::transform(a.begin(), a.end(), a.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-				std::transform(b.begin(), b.end(), b.begin(), [](std::string::value_type c) { return static_cast<std::string::value_type>(toupper(c)); });
-				return a < b;
-			});
+			sorted_keys.push_back(&key);
+		std::sort(sorted_keys.begin(), sorted_keys.end(),
+			[](const auto lhs, const auto rhs) { return name_less()(lhs->first, rhs->first); });
 
 		// Empty section should have been sorted to the top, so do not need to append it before keys
 		if (!section_name.empty())
-			data << '[' << section_name << ']' << '\n';
+			data += '[', data += section_name, data += "]\n";
 
-		for (const std::string &key_name : key_names)
+		for (const auto key : sorted_keys)
 		{
-			data << key_name << '=';
+			const auto &[key_name, v] = *key;
 
-			size_t i = 0;
-			for (const std::string &item : keys.at(key_name))
+			data += key_name;
+			data += '=';
+
+			for (size_t i = 0; i < v.items.size(); ++i)
 			{
-				if (i++ != 0) // Separate multiple values with a comma
-					data << ',';
-				data << item;
+				if (i != 0) // Separate multiple values with a comma
+					data += ',';
+				data += item(v, i);
 			}
 
-			data << '\n';
+			data += '\n';
 		}
 
-		data << '\n';
+		data += '\n';
 	}
 
-	std::ofstream file(_path);
+	// Write to a temporary file first and then replace the original, so that it is never left partially written
+	std::filesystem::path temp_path = _path;
+	temp_path += L".tmp";
+
+	std::ofstream file(temp_path, std::ios::binary);
 	if (!file.is_open() || file.fail())
+		return false;
+
+	file.write(data.data(), data.size());
+	file.close();
+
+	std::error_code ec;
+
+	if (file.fail())
 	{
-		// Reset state to avoid cache flushing to repeatedly save the file
-		_modified = false;
+		std::filesystem::remove(temp_path, ec);
 		return false;
 	}
 
-	file.rdbuf()->pubsetbuf(nullptr, 0);
-
-	const std::string str = data.str();
-	file.imbue(std::locale("en-us.UTF-8"));
-	file.write(str.data(), str.size());
+	// Give the file the time of the last modification included in it, so that 'load' does not reload it again, but detects any later external changes
+	std::filesystem::last_write_time(temp_path, _modified_at, ec);
 
-	// Keep the modified flag if saving was not successful, so to try again later
-	if (_modified = file.fail(); _modified)
-		std::filesystem::last_write_time(_path, modified_at, ec);
-	else if (modified_at = std::filesystem::last_write_time(_path, ec); ec.value() == 0)
-		_modified_at = modified_at;
+	if (std::filesystem::rename(temp_path, _path, ec); ec)
+	{
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
 
 	assert(std::filesystem::file_size(_path, ec) > 0);
 
 	return true;
 }
+void reshade::ini_file::write_queued_files()
+{
+	std::unique_lock<std::mutex> lock(g_write_mutex);
+
+	while (!g_write_queue.empty())
+	{
+		const std::unique_ptr<ini_file> file = std::move(g_write_queue.front().second);
+		g_write_queue.erase(g_write_queue.begin());
+		g_write_in_progress = file->_path;
+
+		lock.unlock();
+		const bool success = file->write();
+		lock.lock();
+
+		if (!success)
+		{
+			// The cached file was already marked as saved when this snapshot was taken, so remember to mark it modified again, or the changes would be lost
+			// Cannot do that from here, since the cache is only accessed from the thread flushing it
+			if (std::find(g_write_failed.begin(), g_write_failed.end(), file->_path) == g_write_failed.end())
+				g_write_failed.push_back(file->_path);
+
+			LOG(ERROR) << "Failed to write " << file->_path << ", will try again.";
+		}
+
+		g_write_in_progress.clear();
+		g_write_signal.notify_all();
+	}
+
+	g_write_thread_running = false;
+}
+
+reshade::ini_file::value &reshade::ini_file::assign(std::string_view section_name, std::string_view key)
+{
+	auto section_it = _sections.find(section_name);
+	if (section_it == _sections.end())
+		section_it = _sections.emplace(intern(section_name), section()).first;
+
+	auto key_it = section_it->second.find(key);
+	if (key_it == section_it->second.end())
+		key_it = section_it->second.emplace(intern(key), value()).first;
+
+	_modified = true;
+	_modified_at = std::filesystem::file_time_type::clock::now();
+
+	value &v = key_it->second;
+	v.clear();
+	return v;
+}
+std::string_view reshade::ini_file::intern(std::string_view name)
+{
+	if (name.empty())
+		return std::string_view();
+
+	// Names are stored in a deque, which never moves existing elements, so views to them stay valid
+	return _storage->names.emplace_back(name);
+}
+
+long long reshade::ini_file::integer_item(const value &v, size_t i) const
+{
+	if (i >= v.items.size())
+		return 0;
+
+	if (v.integer_cache.empty())
+	{
+		v.integer_cache.reserve(v.items.size());
+		for (size_t k = 0; k < v.items.size(); ++k)
+		{
+			// Items are not null-terminated, so copy them before parsing
+			char buffer[32] = "";
+			const std::string_view str = item(v, k);
+			if (str.size() < sizeof(buffer))
+				str.copy(buffer, str.size());
+			v.integer_cache.push_back(str.size() < sizeof(buffer) ? std::strtoll(buffer, nullptr, 10) : std::strtoll(std::string(str).c_str(), nullptr, 10));
+		}
+	}
+
+	return v.integer_cache[i];
+}
+double reshade::ini_file::float_item(const value &v, size_t i) const
+{
+	if (i >= v.items.size())
+		return 0.0;
+
+	if (v.float_cache.empty())
+	{
+		v.float_cache.reserve(v.items.size());
+		for (size_t k = 0; k < v.items.size(); ++k)
+		{
+			// Items are not null-terminated, so copy them before parsing
+			char buffer[64] = "";
+			const std::string_view str = item(v, k);
+			if (str.size() < sizeof(buffer))
+				str.copy(buffer, str.size());
+			v.float_cache.push_back(str.size() < sizeof(buffer) ? std::strtod(buffer, nullptr) : std::strtod(std::string(str).c_str(), nullptr));
+		}
+	}
+
+	return v.float_cache[i];
+}
 
 reshade::ini_file &reshade::ini_file::load_cache(const std::filesystem::path &path)
 {
-	const auto it = g_ini_cache.try_emplace(path, path);
-	if (it.second || (std::filesystem::file_time_type::clock::now() - it.first->second._modified_at) < std::chrono::seconds(1))
+	const auto it = g_ini_cache.try_emplace(path.native(), path);
+	if (it.second || it.first->second._modified_at > std::filesystem::file_time_type::clock::now() - std::chrono::seconds(1))
 		return it.first->second; // Don't need to reload file when it was just loaded or there are still modifications pending
 	else
 		return it.first->second.load(), it.first->second;
 }
 
+void reshade::ini_file::stop_background_threads()
+{
+	// Take the thread out under the lock, so that any files queued concurrently are either still written by it or start a new thread
+	std::thread write_thread;
+	{ const std::lock_guard<std::mutex> lock(g_write_mutex);
+		write_thread = std::move(g_write_thread);
+	}
+
+	// The thread exits on its own once the queue is empty, so this waits for all pending files to be written
+	if (write_thread.joinable())
+		write_thread.join();
+}
+
 bool reshade::ini_file::flush_cache()
 {
 	bool success = true;
 	const auto now = std::filesystem::file_time_type::clock::now();
 
+	std::vector<std::filesystem::path> failed_paths;
+	{ const std::lock_guard<std::mutex> lock(g_write_mutex);
+		failed_paths.swap(g_write_failed);
+	}
+
+	// The cached files contain at least the changes of the snapshots that failed to be written, so save them again
+	// This pretends they were modified just now, so that a file that keeps failing is only attempted about once a second
+	for (const std::filesystem::path &path : failed_paths)
+	{
+		success = false;
+
+		if (const auto it = g_ini_cache.find(path.native()); it != g_ini_cache.end())
+		{
+			it->second._modified = true;
+			it->second._modified_at = now;
+		}
+	}
+
 	// Save all files that were modified in one second intervals
-	for (std::pair<const std::wstring, ini_file> &file : g_ini_cache)
+	for (std::pair<const std::filesystem::path::string_type, ini_file> &file : g_ini_cache)
 	{
 		if (file.second._modified && (now - file.second._modified_at) > std::chrono::seconds(1))
-			success &= file.second.save();
+			file.second.save_async();
 	}
 
 	return success;
 }
 bool reshade::ini_file::flush_cache(const std::filesystem::path &path)
 {
-	const auto it = g_ini_cache.find(path);
-	return it != g_ini_cache.end() && it->second.save();
+	const auto it = g_ini_cache.find(path.native());
+	if (it == g_ini_cache.end())
+		return false;
+
+	std::unique_ptr<ini_file> queued;
+
+	{ std::unique_lock<std::mutex> lock(g_write_mutex);
+		// Wait for the file to be written if that is currently in progress on the background thread
+		g_write_signal.wait(lock, [&path]() { return g_write_in_progress != path; });
+
+		// Take over an older snapshot that was not written yet, since the caller expects the file to be on disk after this returns
+		if (const auto queued_it = std::find_if(g_write_queue.begin(), g_write_queue.end(),
+				[&path](const auto &queued) { return queued.first == path; });
+			queued_it != g_write_queue.end())
+		{
+			queued = std::move(queued_it->second);
+			g_write_queue.erase(queued_it);
+		}
+	}
+
+	if (queued != nullptr && !it->second._modified && !queued->write())
+		return false;
+
+	return it->second.save();
 }
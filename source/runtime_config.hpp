@@ -5,10 +5,13 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cassert>
 #include <filesystem>
+#include <string_view>
 #include <unordered_map>
 
 extern std::filesystem::path g_reshade_config_path;
@@ -29,6 +32,54 @@ namespace reshade
 {
 	class ini_file
 	{
+		/// <summary>
+		/// Describes a single value in an INI file.
+		/// The comma-separated items are stored as offsets into the file buffer (or into the value itself after it was assigned), so that loading does not need to copy any strings.
+		/// </summary>
+		struct value
+		{
+			bool owns_items = false; // Items point into 'storage' instead of the file buffer
+			std::string storage;
+			std::vector<std::pair<uint32_t, uint32_t>> items; // Offset and length of each item
+			// Numeric interpretations of the items, which are only parsed when first requested
+			mutable std::vector<long long> integer_cache;
+			mutable std::vector<double> float_cache;
+
+			void clear()
+			{
+				owns_items = true;
+				storage.clear();
+				items.clear();
+				integer_cache.clear();
+				float_cache.clear();
+			}
+			void append(std::string_view item)
+			{
+				assert(owns_items);
+				items.emplace_back(static_cast<uint32_t>(storage.size()), static_cast<uint32_t>(item.size()));
+				storage += item;
+			}
+		};
+		/// <summary>
+		/// Orders names case-insensitively (which is the order they are saved in), falling back to a case-sensitive comparison so that the order is stable.
+		/// </summary>
+		struct name_less
+		{
+			bool operator()(std::string_view a, std::string_view b) const
+			{
+				// Only fold ASCII letters, which is what 'toupper' does in the "C" locale, but without the overhead of a locale lookup per character
+				for (size_t i = 0, size = std::min(a.size(), b.size()); i < size; ++i)
+					if (const char ca = a[i] >= 'a' && a[i] <= 'z' ? a[i] - ('a' - 'A') : a[i], cb = b[i] >= 'a' && b[i] <= 'z' ? b[i] - ('a' - 'A') : b[i]; ca != cb)
+						return static_cast<unsigned char>(ca) < static_cast<unsigned char>(cb);
+				return a.size() != b.size() ? a.size() < b.size() : a < b;
+			}
+		};
+
+		/// <summary>
+		/// Describes a section of multiple key/value pairs in an INI file.
+		/// </summary>
+		using section = std::unordered_map<std::string_view, value>;
+
 	public:
 		/// <summary>
 		/// Opens the INI file at the specified <paramref name="path"/>.
@@ -39,52 +90,37 @@ namespace reshade
 
 		bool has(const std::string &section, const std::string &key) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
-				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
-				return false;
-			return true;
+			return find(section, key) != nullptr;
 		}
 
 		template <typename T>
 		bool get(const std::string &section, const std::string &key, T &value) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
-				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
+			const auto v = find(section, key);
+			if (v == nullptr)
 				return false;
-			value = convert<T>(it2->second, 0);
+			value = convert<T>(*v, 0);
 			return true;
 		}
 		template <typename T, size_t SIZE>
 		bool get(const std::string &section, const std::string &key, T(&values)[SIZE]) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
-				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
+			const auto v = find(section, key);
+			if (v == nullptr)
 				return false;
 			for (size_t i = 0; i < SIZE; ++i)
-				values[i] = convert<T>(it2->second, i);
+				values[i] = convert<T>(*v, i);
 			return true;
 		}
 		template <typename T>
 		bool get(const std::string &section, const std::string &key, std::vector<T> &values) const
 		{
-			const auto it1 = _sections.find(section);
-			if (it1 == _sections.end())
+			const auto v = find(section, key);
+			if (v == nullptr)
 				return false;
-			const auto it2 = it1->second.find(key);
-			if (it2 == it1->second.end())
-				return false;
-			values.resize(it2->second.size());
-			for (size_t i = 0; i < it2->second.size(); ++i)
-				values[i] = convert<T>(it2->second, i);
+			values.resize(v->items.size());
+			for (size_t i = 0; i < v->items.size(); ++i)
+				values[i] = convert<T>(*v, i);
 			return true;
 		}
 
@@ -93,68 +129,14 @@ namespace reshade
 		{
 			set(section, key, std::to_string(value));
 		}
-		template <>
-		void set(const std::string &section, const std::string &key, const bool &value)
-		{
-			set<std::string>(section, key, value ? "1" : "0");
-		}
-		template <>
-		void set(const std::string &section, const std::string &key, const std::string &value)
-		{
-			auto &v = _sections[section][key];
-			v.assign(1, value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		void set(const std::string &section, const std::string &key, std::string &&value)
-		{
-			auto &v = _sections[section][key];
-			v.resize(1);
-			v[0] = std::forward<std::string>(value);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		template <>
-		void set(const std::string &section, const std::string &key, const std::filesystem::path &value)
-		{
-			set(section, key, value.u8string());
-		}
 		template <typename T, size_t SIZE>
 		void set(const std::string &section, const std::string &key, const T(&values)[SIZE], const size_t size = SIZE)
 		{
 			assert(size <= SIZE);
 
-			auto &v = _sections[section][key];
-			v.resize(size);
+			auto &v = assign(section, key);
 			for (size_t i = 0; i < size; ++i)
-				v[i] = std::to_string(values[i]);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		template <>
-		void set(const std::string &section, const std::string &key, const std::vector<std::string> &values)
-		{
-			auto &v = _sections[section][key];
-			v = values;
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		void set(const std::string &section, const std::string &key, std::vector<std::string> &&values)
-		{
-			auto &v = _sections[section][key];
-			v = std::forward<std::vector<std::string>>(values);
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
-		}
-		template <>
-		void set(const std::string &section, const std::string &key, const std::vector<std::filesystem::path> &values)
-		{
-			auto &v = _sections[section][key];
-			v.resize(values.size());
-			for (size_t i = 0; i < values.size(); ++i)
-				v[i] = values[i].u8string();
-			_modified = true;
-			_modified_at = std::filesystem::file_time_type::clock::now();
+				v.append(std::to_string(values[i]));
 		}
 
 		/// <summary>
@@ -165,83 +147,168 @@ namespace reshade
 		/// <returns>A reference to the cached data. This reference is valid until the next call to <see cref="load_cache"/>.</returns>
 		static reshade::ini_file &load_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Saves all cached INI files that were modified more than a second ago.
+		/// The files are written on a background thread, so this only has to copy their contents.
+		/// Files that failed to be written are marked modified again, so that they are saved again on a later call.
+		/// </summary>
+		/// <returns><c>false</c> if writing any file failed since the last call, <c>true</c> otherwise.</returns>
 		static bool flush_cache();
+		/// <summary>
+		/// Saves the specified cached INI file immediately and waits for it to be written to disk.
+		/// </summary>
+		/// <param name="path">The path to the INI file to save.</param>
 		static bool flush_cache(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Waits for all queued INI files to be written and the background thread to exit.
+		/// Call this before the module is unloaded, since threads cannot exit anymore while the loader lock is held during 'DllMain'.
+		/// </summary>
+		static void stop_background_threads();
+
 	private:
 		void load();
 		bool save();
+		void save_async();
+		bool can_save();
+		bool write() const;
+		static void write_queued_files();
 
-		template <typename T>
-		static const T convert(const std::vector<std::string> &values, size_t i) = delete;
-		template <>
-		static const bool convert(const std::vector<std::string> &values, size_t i)
-		{
-			return convert<int>(values, i) != 0 || i < values.size() && (values[i] == "true" || values[i] == "True" || values[i] == "TRUE");
-		}
-		template <>
-		static const int convert(const std::vector<std::string> &values, size_t i)
-		{
-			return static_cast<int>(convert<long>(values, i));
-		}
-		template <>
-		static const unsigned int convert(const std::vector<std::string> &values, size_t i)
-		{
-			return static_cast<unsigned int>(convert<unsigned long>(values, i));
-		}
-		template <>
-		static const long convert(const std::vector<std::string> &values, size_t i)
-		{
-			return i < values.size() ? std::strtol(values[i].c_str(), nullptr, 10) : 0l;
-		}
-		template <>
-		static const unsigned long convert(const std::vector<std::string> &values, size_t i)
-		{
-			return i < values.size() ? std::strtoul(values[i].c_str(), nullptr, 10) : 0ul;
-		}
-		template <>
-		static const long long convert(const std::vector<std::string> &values, size_t i)
+		const value *find(std::string_view section, std::string_view key) const
 		{
-			return i < values.size() ? std::strtoll(values[i].c_str(), nullptr, 10) : 0ll;
-		}
-		template <>
-		static const unsigned long long convert(const std::vector<std::string> &values, size_t i)
-		{
-			return i < values.size() ? std::strtoull(values[i].c_str(), nullptr, 10) : 0ull;
-		}
-		template <>
-		static const float convert(const std::vector<std::string> &values, size_t i)
-		{
-			return static_cast<float>(convert<double>(values, i));
-		}
-		template <>
-		static const double convert(const std::vector<std::string> &values, size_t i)
-		{
-			return i < values.size() ? std::strtod(values[i].c_str(), nullptr) : 0.0;
-		}
-		template <>
-		static const std::string convert(const std::vector<std::string> &values, size_t i)
-		{
-			return i < values.size() ? values[i] : std::string();
+			const auto it1 = _sections.find(section);
+			if (it1 == _sections.end())
+				return nullptr;
+			const auto it2 = it1->second.find(key);
+			if (it2 == it1->second.end())
+				return nullptr;
+			return &it2->second;
 		}
-		template <>
-		static const std::filesystem::path convert(const std::vector<std::string> &values, size_t i)
+		value &assign(std::string_view section, std::string_view key);
+		std::string_view intern(std::string_view name);
+
+		std::string_view item(const value &v, size_t i) const
 		{
-			return i < values.size() ? std::filesystem::u8path(values[i]) : std::filesystem::path();
+			const auto &[offset, length] = v.items[i];
+			return std::string_view((v.owns_items ? v.storage.data() : _storage->data.data()) + offset, length);
 		}
+		long long integer_item(const value &v, size_t i) const;
+		double float_item(const value &v, size_t i) const;
+
+		template <typename T>
+		const T convert(const value &v, size_t i) const = delete;
 
 		/// <summary>
-		/// Describes a single value in an INI file.
-		/// </summary>
-		using value = std::vector<std::string>;
-		/// <summary>
-		/// Describes a section of multiple key/value pairs in an INI file.
+		/// Owns the file contents and any section or key names added afterwards, which are referenced by the views in '_sections'.
+		/// It is shared between copies of an INI file, so that those views stay valid.
 		/// </summary>
-		using section = std::unordered_map<std::string, value>;
+		struct storage
+		{
+			std::string data;
+			std::deque<std::string> names;
+		};
 
 		bool _modified = false;
 		std::filesystem::path _path;
-		std::filesystem::file_time_type _modified_at;
-		std::unordered_map<std::string, section> _sections;
+		// Start out older than any file, since the epoch of the file clock is not the same on all platforms and may be more recent than the file
+		std::filesystem::file_time_type _modified_at = std::filesystem::file_time_type::min();
+		std::shared_ptr<storage> _storage;
+		std::unordered_map<std::string_view, section> _sections;
 	};
+
+	// Explicit specializations have to be declared at namespace scope (declaring them in the class is a Microsoft extension)
+
+	template <>
+	inline void ini_file::set(const std::string &section, const std::string &key, const std::string &value)
+	{
+		auto &v = assign(section, key);
+		v.append(value);
+	}
+	template <>
+	inline void ini_file::set(const std::string &section, const std::string &key, const bool &value)
+	{
+		set<std::string>(section, key, value ? "1" : "0");
+	}
+	template <>
+	inline void ini_file::set(const std::string &section, const std::string &key, const std::filesystem::path &value)
+	{
+		set(section, key, value.u8string());
+	}
+	template <>
+	inline void ini_file::set(const std::string &section, const std::string &key, const std::vector<std::string> &values)
+	{
+		auto &v = assign(section, key);
+		for (const std::string &item : values)
+			v.append(item);
+	}
+	template <>
+	inline void ini_file::set(const std::string &section, const std::string &key, const std::vector<std::filesystem::path> &values)
+	{
+		auto &v = assign(section, key);
+		for (const std::filesystem::path &item : values)
+			v.append(item.u8string());
+	}
+	template <>
+	inline const long ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<long>(integer_item(v, i));
+	}
+	template <>
+	inline const unsigned long ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<unsigned long>(integer_item(v, i));
+	}
+	template <>
+	inline const long long ini_file::convert(const value &v, size_t i) const
+	{
+		return integer_item(v, i);
+	}
+	template <>
+	inline const unsigned long long ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<unsigned long long>(integer_item(v, i));
+	}
+	template <>
+	inline const int ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<int>(convert<long>(v, i));
+	}
+	template <>
+	inline const unsigned int ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<unsigned int>(convert<unsigned long>(v, i));
+	}
+	template <>
+	inline const bool ini_file::convert(const value &v, size_t i) const
+	{
+		if (convert<int>(v, i) != 0)
+			return true;
+		if (i >= v.items.size())
+			return false;
+		const std::string_view str = item(v, i);
+		return str == "true" || str == "True" || str == "TRUE";
+	}
+	template <>
+	inline const double ini_file::convert(const value &v, size_t i) const
+	{
+		return float_item(v, i);
+	}
+	template <>
+	inline const float ini_file::convert(const value &v, size_t i) const
+	{
+		return static_cast<float>(convert<double>(v, i));
+	}
+	template <>
+	inline const std::string ini_file::convert(const value &v, size_t i) const
+	{
+		return i < v.items.size() ? std::string(item(v, i)) : std::string();
+	}
+	template <>
+	inline const std::filesystem::path ini_file::convert(const value &v, size_t i) const
+	{
+		if (i >= v.items.size())
+			return std::filesystem::path();
+		const std::string_view str = item(v, i);
+		return std::filesystem::u8path(str.begin(), str.end());
+	}
 }
@@ -12,6 +12,9 @@
 #include "runtime_objects.hpp"
 #include "input.hpp"
 #include "imgui_widgets.hpp"
+#include "frame_capture.hpp"
+#include "frame_profiler.hpp"
+#include "texture_aliasing.hpp"
 #include <cassert>
 #include <fstream>
 #include <algorithm>
@@ -443,6 +446,8 @@ void reshade::runtime::draw_ui()
 {
 	assert(_is_initialized);
 
+	const frame_profiler::scope profile(*_profiler, "UI");
+
 	const bool show_splash = _show_splash && (is_loading() || !_reload_compile_queue.empty() || (_last_present_time - _last_reload_time) < std::chrono::seconds(5));
 	// Do not show this message in the same frame the screenshot is taken (so that it won't show up on the UI screenshot)
 	const bool show_screenshot_message = (_show_screenshot_message || !_screenshot_save_success) && !_should_save_screenshot && (_last_present_time - _last_screenshot_time) < std::chrono::seconds(_screenshot_save_success ? 3 : 5);
@@ -1083,6 +1088,9 @@ void reshade::runtime::draw_ui_settings()
 		modified |= ImGui::SliderInt("Preset transition", reinterpret_cast<int *>(&_preset_transition_delay), 0, 10 * 1000);
 		if (ImGui::IsItemHovered())
 			ImGui::SetTooltip("Makes a smooth transition, but only for floating point values.\nRecommended for multiple presets that contain the same shaders, otherwise set this to zero.\nValues are in milliseconds.");
+		modified |= ImGui::Checkbox("Blend preset values", &_preset_transition_interpolate);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Blends floating point values during the preset transition.\nWhen disabled, all values switch at once after the transition time has passed.");
 
 		modified |= ImGui::Combo("Input processing", &_input_processing_mode,
 			"Pass on all input\0"
@@ -1119,6 +1127,8 @@ void reshade::runtime::draw_ui_settings()
 
 		modified |= ImGui::Combo("Screenshot Format", reinterpret_cast<int *>(&_screenshot_format), "Bitmap (*.bmp)\0Portable Network Graphics (*.png)\0JPEG (*.jpeg)\0");
 
+		if (_screenshot_format == 1)
+			modified |= ImGui::SliderInt("PNG Compression", reinterpret_cast<int *>(&_screenshot_png_compression), 0, 9);
 		if (_screenshot_format == 2)
 			modified |= ImGui::SliderInt("JPEG Quality", reinterpret_cast<int *>(&_screenshot_jpeg_quality), 1, 100);
 		else
@@ -1129,6 +1139,45 @@ void reshade::runtime::draw_ui_settings()
 		modified |= ImGui::Checkbox("Save separate user interface image", &_screenshot_save_ui);
 	}
 
+	if (ImGui::CollapsingHeader("Frame Capture", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		modified |= imgui_key_input("Frame Capture Key", _frame_capture_key_data, *_input);
+		_ignore_shortcuts |= ImGui::IsItemActive();
+
+		modified |= ImGui::SliderInt("Capture Duration", reinterpret_cast<int *>(&_frame_capture_duration), 0, 600, _frame_capture_duration == 0 ? "Until stopped" : "%d s");
+		modified |= ImGui::SliderInt("Capture Buffers", reinterpret_cast<int *>(&_frame_capture_buffers), 2, 64);
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Number of frames that can wait to be written to disk before new ones are dropped.\nEach buffer takes up a full uncompressed frame in memory.");
+	}
+
+	if (ImGui::CollapsingHeader("Profiler", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		if (ImGui::Checkbox("Record frame timeline", &_profiler_enabled))
+		{
+			modified = true;
+			_profiler->set_enabled(_profiler_enabled);
+		}
+
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Records how long each part of a frame takes, so that the last frames can be saved in the Chrome trace event format.\nOpen the resulting file in \"chrome://tracing\" or Perfetto to view it.");
+
+		modified |= imgui_key_input("Profiler Trace Key", _profiler_key_data, *_input);
+		_ignore_shortcuts |= ImGui::IsItemActive();
+
+		modified |= ImGui::SliderInt("Trace Frames", reinterpret_cast<int *>(&_profiler_trace_frames), 1, 600);
+
+		if (ImGui::Button("Save trace", ImVec2(ImGui::CalcItemWidth(), 0)))
+			save_profiler_trace();
+
+		modified |= ImGui::SliderInt("Statistics Window", reinterpret_cast<int *>(&_statistics_window), 0, 60, _statistics_window == 0 ? "Since reset" : "%d s");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Time span over which the frame time percentiles on the statistics page are collected.");
+		modified |= ImGui::SliderFloat("Stutter Threshold", &_stutter_threshold, 1.5f, 10.0f, "%.1fx median");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Frames that take this much longer than the median frame time are reported as stutters.");
+	}
+
 	if (ImGui::CollapsingHeader("User Interface", ImGuiTreeNodeFlags_DefaultOpen))
 	{
 		modified |= ImGui::Checkbox("Show screenshot message", &_show_screenshot_message);
@@ -1296,6 +1345,12 @@ void reshade::runtime::draw_ui_settings()
 	if (reload_style) // Style is applied in "load_config()".
 		load_config();
 }
+static void draw_percentile_tooltip(const reshade::duration_histogram &results)
+{
+	ImGui::SetTooltip("p50 %.3f ms\np95 %.3f ms\np99 %.3f ms\nmax %.3f ms",
+		results.percentile(0.50) * 1e-6, results.percentile(0.95) * 1e-6, results.percentile(0.99) * 1e-6, results.max() * 1e-6);
+}
+
 void reshade::runtime::draw_ui_statistics()
 {
 	unsigned int cpu_digits = 1;
@@ -1370,6 +1425,76 @@ void reshade::runtime::draw_ui_statistics()
 		ImGui::EndGroup();
 	}
 
+	if (ImGui::CollapsingHeader("Frame Timing", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		const duration_histogram &frame_time = _frame_time_statistics.results();
+		const duration_histogram &overhead = _overhead_statistics.results();
+
+		ImGui::BeginGroup();
+
+		ImGui::NewLine();
+		ImGui::TextUnformatted("Frame time:");
+		ImGui::TextUnformatted("Effects overhead:");
+		ImGui::TextUnformatted("Stutters:");
+
+		ImGui::EndGroup();
+
+		const double percentiles[] = { 0.50, 0.95, 0.99, 1.00 };
+		const char *const percentile_names[] = { "p50", "p95", "p99", "max" };
+
+		for (size_t i = 0; i < std::size(percentiles); ++i)
+		{
+			ImGui::SameLine(ImGui::GetWindowWidth() * (0.33333333f + static_cast<float>(i) * 0.16666666f));
+			ImGui::BeginGroup();
+
+			ImGui::TextUnformatted(percentile_names[i]);
+			ImGui::Text("%.3f ms", frame_time.percentile(percentiles[i]) * 1e-6);
+			ImGui::Text("%.3f ms", overhead.percentile(percentiles[i]) * 1e-6);
+			if (i == 0)
+				ImGui::Text("%zu", _stutter_events.size());
+
+			ImGui::EndGroup();
+		}
+
+		// Show the most recent stutters first
+		for (auto it = _stutter_events.rbegin(); it != _stutter_events.rend() && it - _stutter_events.rbegin() < 5; ++it)
+			ImGui::Text("Frame %llu at %.3f s took %.3f ms (%.1fx median)", it->frame, it->time.count() * 1e-9, it->duration * 1e-6, it->median_duration != 0 ? static_cast<double>(it->duration) / it->median_duration : 0.0);
+
+		const float button_width = (ImGui::GetContentRegionAvail().x - ImGui::GetStyle().ItemSpacing.x) / 2;
+		if (ImGui::Button("Reset", ImVec2(button_width, 0)))
+			reset_statistics();
+		ImGui::SameLine();
+		if (ImGui::Button("Export CSV", ImVec2(button_width, 0)))
+			save_statistics();
+	}
+
+	if (_frame_capture->frames_captured() + _frame_capture->frames_dropped() != 0 && ImGui::CollapsingHeader("Frame Capture", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::BeginGroup();
+
+		ImGui::TextUnformatted(_frame_capture->is_active() ? "Capturing:" : _frame_capture->is_writing() ? "Writing:" : "Last capture:");
+		ImGui::TextUnformatted("Frames:");
+		ImGui::TextUnformatted("Latency:");
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+
+		ImGui::TextUnformatted(_frame_capture->path().filename().u8string().c_str());
+		ImGui::Text("%llu captured", _frame_capture->frames_captured());
+		ImGui::Text("%.3f ms average", _frame_capture->average_latency().count() * 1e-6f);
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+
+		ImGui::Text("%llu written", _frame_capture->frames_written());
+		ImGui::Text("%llu dropped", _frame_capture->frames_dropped());
+		ImGui::Text("%.3f ms maximum", _frame_capture->max_latency().count() * 1e-6f);
+
+		ImGui::EndGroup();
+	}
+
 	if (ImGui::CollapsingHeader("Techniques", ImGuiTreeNodeFlags_DefaultOpen) && !is_loading() && _effects_enabled)
 	{
 		ImGui::BeginGroup();
@@ -1379,7 +1504,9 @@ void reshade::runtime::draw_ui_statistics()
 			if (!technique.enabled)
 				continue;
 
-			if (technique.passes.size() > 1)
+			if (const size_t num_culled_passes = static_cast<size_t>(std::count(technique.culled_passes.begin(), technique.culled_passes.end(), true)); num_culled_passes != 0)
+				ImGui::Text("%s (%zu passes, %zu culled)", technique.name.c_str(), technique.passes.size(), num_culled_passes);
+			else if (technique.passes.size() > 1)
 				ImGui::Text("%s (%zu passes)", technique.name.c_str(), technique.passes.size());
 			else
 				ImGui::TextUnformatted(technique.name.c_str());
@@ -1395,7 +1522,12 @@ void reshade::runtime::draw_ui_statistics()
 				continue;
 
 			if (technique.average_cpu_duration != 0)
+			{
 				ImGui::Text("%*.3f ms CPU", cpu_digits + 4, technique.average_cpu_duration * 1e-6f);
+
+				if (ImGui::IsItemHovered())
+					draw_percentile_tooltip(technique.cpu_statistics.results());
+			}
 			else
 				ImGui::NewLine();
 		}
@@ -1411,7 +1543,12 @@ void reshade::runtime::draw_ui_statistics()
 
 			// GPU timings are not available for all APIs
 			if (technique.average_gpu_duration != 0)
+			{
 				ImGui::Text("%*.3f ms GPU", gpu_digits + 4, technique.average_gpu_duration * 1e-6f);
+
+				if (ImGui::IsItemHovered())
+					draw_percentile_tooltip(technique.gpu_statistics.results());
+			}
 			else
 				ImGui::NewLine();
 		}
@@ -1425,10 +1562,6 @@ void reshade::runtime::draw_ui_statistics()
 			"unknown",
 			"R8", "R16F", "R32F", "RG8", "RG16", "RG16F", "RG32F", "RGBA8", "RGBA16", "RGBA16F", "RGBA32F", "RGB10A2"
 		};
-		const unsigned int pixel_sizes[] = {
-			0,
-			1 /*R8*/, 2 /*R16F*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
-		};
 
 		static_assert(std::size(texture_formats) - 1 == static_cast<size_t>(reshadefx::texture_format::rgb10a2));
 
@@ -1450,9 +1583,7 @@ void reshade::runtime::draw_ui_statistics()
 			ImGui::PushID(texture_index);
 			ImGui::BeginGroup();
 
-			uint32_t memory_size = 0;
-			for (uint32_t level = 0, width = texture.width, height = texture.height; level < texture.levels; ++level, width /= 2, height /= 2)
-				memory_size += width * height * pixel_sizes[static_cast<unsigned int>(texture.format)];
+			const uint32_t memory_size = static_cast<uint32_t>(texture_memory_size(texture));
 
 			post_processing_memory_size += memory_size;
 
@@ -1503,12 +1634,14 @@ void reshade::runtime::draw_ui_statistics()
 				_preview_size[0] = 0;
 				_preview_size[1] = 0;
 				_preview_texture = !check ? texture.impl : nullptr;
+				_pass_culling_dirty = true;
 			}
 			ImGui::SameLine();
 			if (bool check = _preview_texture == texture.impl && _preview_size[0] != 0; ImGui::RadioButton("Preview original", check)) {
 				_preview_size[0] = texture.width;
 				_preview_size[1] = texture.height;
 				_preview_texture = !check ? texture.impl : nullptr;
+				_pass_culling_dirty = true;
 			}
 
 			bool r = (_preview_size[2] & 0x000000FF) != 0;
@@ -1582,42 +1715,90 @@ void reshade::runtime::draw_ui_log()
 
 	if (ImGui::BeginChild("log", ImVec2(0, 0), true, _log_wordwrap ? 0 : ImGuiWindowFlags_AlwaysHorizontalScrollbar))
 	{
-		// Limit number of log lines to read, to avoid stalling when log gets too big
-		const size_t line_limit = 1000;
+		// Limit number of log lines to keep, to avoid stalling when log gets too big
+		const size_t line_limit = 4000;
 
-		std::error_code ec;
-		const auto last_log_size = std::filesystem::file_size(log_path, ec);
-		if (filter_changed || _last_log_size != last_log_size)
+		bool filter_index_invalid = filter_changed;
+
+		// Only append messages that were written since the last update, instead of reading the entire log file again
+		if (log::generation() != _log_generation)
 		{
-			_log_lines.clear();
-			std::ifstream log_file(log_path);
-			for (std::string line; std::getline(log_file, line) && _log_lines.size() < line_limit;)
-				if (filter.PassFilter(line.c_str()))
-					_log_lines.push_back(line);
-			_last_log_size = last_log_size;
+			std::vector<log::record> records;
+			if (!log::read_history(_log_generation, records))
+			{
+				_log_lines.clear();
+				_log_line_levels.clear();
+				filter_index_invalid = true;
+			}
+
+			for (const log::record &record : records)
+			{
+				// Messages may span multiple lines (e.g. compiler output), so classify every line on its own
+				for (size_t offset = 0, next; offset != std::string::npos; offset = next != std::string::npos ? next + 1 : next)
+				{
+					next = record.text.find('\n', offset);
+					std::string line = record.text.substr(offset, next != std::string::npos ? next - offset : std::string::npos);
+
+					log::level level = record.level;
+					if (level == log::level::error || line.find("error") != std::string::npos)
+						level = log::level::error;
+					else if (level == log::level::warning || line.find("warning") != std::string::npos)
+						level = log::level::warning;
+
+					if (!filter_index_invalid && filter.PassFilter(line.c_str()))
+						_log_filtered_lines.push_back(_log_lines.size());
 
-			if (_log_lines.size() == line_limit)
-				_log_lines.push_back("Log was truncated to reduce memory footprint!");
+					_log_lines.push_back(std::move(line));
+					_log_line_levels.push_back(static_cast<unsigned int>(level));
+				}
+			}
+
+			if (_log_lines.size() > line_limit)
+			{
+				// Remove a larger batch of the oldest lines at once, so that this does not have to happen again on every new line
+				const size_t num_removed_lines = _log_lines.size() - line_limit / 2;
+				_log_lines.erase(_log_lines.begin(), _log_lines.begin() + num_removed_lines);
+				_log_line_levels.erase(_log_line_levels.begin(), _log_line_levels.begin() + num_removed_lines);
+				filter_index_invalid = true;
+			}
 		}
 
-		ImGuiListClipper clipper(static_cast<int>(_log_lines.size()), ImGui::GetTextLineHeightWithSpacing());
+		if (filter_index_invalid)
+		{
+			_log_filtered_lines.clear();
+			for (size_t line_index = 0; line_index < _log_lines.size(); ++line_index)
+				if (filter.PassFilter(_log_lines[line_index].c_str()))
+					_log_filtered_lines.push_back(line_index);
+		}
+
+		ImGuiListClipper clipper(static_cast<int>(_log_filtered_lines.size()), ImGui::GetTextLineHeightWithSpacing());
 		while (clipper.Step())
 		{
 			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
 			{
+				const size_t line_index = _log_filtered_lines[i];
+
 				ImVec4 textcol = ImGui::GetStyleColorVec4(ImGuiCol_Text);
 
-				if (_log_lines[i].find("ERROR |") != std::string::npos || _log_lines[i].find("error") != std::string::npos)
+				switch (static_cast<log::level>(_log_line_levels[line_index]))
+				{
+				case log::level::error:
 					textcol = COLOR_RED;
-				else if (_log_lines[i].find("WARN  |") != std::string::npos || _log_lines[i].find("warning") != std::string::npos || i == line_limit)
+					break;
+				case log::level::warning:
 					textcol = COLOR_YELLOW;
-				else if (_log_lines[i].find("DEBUG |") != std::string::npos)
+					break;
+				case log::level::debug:
 					textcol = ImColor(100, 100, 255);
+					break;
+				default:
+					break;
+				}
 
 				ImGui::PushStyleColor(ImGuiCol_Text, textcol);
 				if (_log_wordwrap) ImGui::PushTextWrapPos();
 
-				ImGui::TextUnformatted(_log_lines[i].c_str());
+				ImGui::TextUnformatted(_log_lines[line_index].c_str());
 
 				if (_log_wordwrap) ImGui::PopTextWrapPos();
 				ImGui::PopStyleColor();
@@ -6,6 +6,10 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include "frame_statistics.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
 
 namespace reshade
 {
@@ -146,9 +150,30 @@ namespace reshade
 		uint32_t toggle_key_data[4] = {};
 	};
 
+	struct special_uniform_slot
+	{
+		enum class key_mode
+		{
+			down,
+			press,
+			toggle
+		};
+
+		size_t uniform_index;
+		special_uniform source;
+		key_mode mode = key_mode::down;
+		int keycode = 0; // Value of the "keycode" annotation (or "index" for FreePIE)
+	};
+
+	struct uniform_toggle_binding
+	{
+		size_t uniform_index;
+		int num_items = 0; // Number of items in the "ui_items" annotation of integer variables
+	};
+
 	struct technique final : reshadefx::technique_info
 	{
-		technique(const reshadefx::technique_info &init) : technique_info(init) {}
+		technique(const reshadefx::technique_info &init) : technique_info(init), culled_passes(init.passes.size()) {}
 
 		int annotation_as_int(const char *ann_name, size_t i = 0) const
 		{
@@ -180,6 +205,10 @@ namespace reshade
 		uint32_t toggle_key_data[4] = {};
 		moving_average<uint64_t, 60> average_cpu_duration;
 		moving_average<uint64_t, 60> average_gpu_duration;
+		duration_statistics cpu_statistics;
+		duration_statistics gpu_statistics;
+		// Passes whose output is not read by any enabled technique, so that rendering them can be skipped
+		std::vector<bool> culled_passes;
 	};
 
 	struct effect final
@@ -195,5 +224,26 @@ namespace reshade
 		std::unordered_map<std::string, std::string> assembly;
 		std::vector<uniform> uniforms;
 		std::vector<unsigned char> uniform_data_storage;
+		// Byte range of 'uniform_data_storage' that was modified since the last upload by the backend
+		size_t uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+		size_t uniform_data_dirty_end = 0;
+		// Lists of uniforms that need to be looked at every frame, so that the others can be skipped
+		std::vector<special_uniform_slot> special_uniforms;
+		std::vector<uniform_toggle_binding> toggle_key_uniforms;
+
+		bool is_uniform_data_dirty() const
+		{
+			return uniform_data_dirty_end > uniform_data_dirty_begin;
+		}
+		void mark_uniform_data_dirty(size_t offset, size_t size)
+		{
+			uniform_data_dirty_begin = std::min(uniform_data_dirty_begin, offset);
+			uniform_data_dirty_end = std::max(uniform_data_dirty_end, offset + size);
+		}
+		void clear_uniform_data_dirty()
+		{
+			uniform_data_dirty_begin = std::numeric_limits<size_t>::max();
+			uniform_data_dirty_end = 0;
+		}
 	};
 }
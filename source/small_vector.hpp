@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <new>
+#include <limits>
+#include <memory>
+#include <cassert>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+
+/// <summary>
+/// A vector that stores up to <typeparamref name="N"/> elements inline, and only goes to the heap once it grows beyond that.
+/// Offers the same interface as "std::vector", but iterators and references are also invalidated when the vector is moved while it is still stored inline.
+/// </summary>
+template <typename T, size_t N>
+class small_vector
+{
+	static_assert(N > 0, "inline capacity has to be at least one element");
+
+public:
+	using value_type = T;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using pointer = T *;
+	using const_pointer = const T *;
+	using iterator = T *;
+	using const_iterator = const T *;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	small_vector() = default;
+	explicit small_vector(size_t count)
+	{
+		resize(count);
+	}
+	small_vector(size_t count, const T &value)
+	{
+		resize(count, value);
+	}
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	small_vector(InputIt first, InputIt last)
+	{
+		assign(first, last);
+	}
+	small_vector(std::initializer_list<T> list)
+	{
+		assign(list.begin(), list.end());
+	}
+	small_vector(const small_vector &other)
+	{
+		assign(other.begin(), other.end());
+	}
+	small_vector(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+	{
+		steal(std::move(other));
+	}
+	~small_vector()
+	{
+		clear();
+		free_heap();
+	}
+
+	small_vector &operator=(const small_vector &other)
+	{
+		if (this != &other)
+			assign(other.begin(), other.end());
+		return *this;
+	}
+	small_vector &operator=(small_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+	{
+		if (this != &other)
+		{
+			clear();
+			free_heap();
+			steal(std::move(other));
+		}
+		return *this;
+	}
+	small_vector &operator=(std::initializer_list<T> list)
+	{
+		assign(list.begin(), list.end());
+		return *this;
+	}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void assign(InputIt first, InputIt last)
+	{
+		clear();
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>)
+			reserve(static_cast<size_t>(std::distance(first, last)));
+		for (; first != last; ++first)
+			emplace_back(*first);
+	}
+	void assign(size_t count, const T &value)
+	{
+		clear();
+		resize(count, value);
+	}
+
+	iterator begin() { return _data; }
+	const_iterator begin() const { return _data; }
+	const_iterator cbegin() const { return _data; }
+	iterator end() { return _data + _size; }
+	const_iterator end() const { return _data + _size; }
+	const_iterator cend() const { return _data + _size; }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	bool empty() const { return _size == 0; }
+	size_t size() const { return _size; }
+	size_t capacity() const { return _capacity; }
+	size_t max_size() const { return std::numeric_limits<size_t>::max() / sizeof(T); }
+	/// <summary>
+	/// Returns whether the elements are currently stored inline, instead of on the heap.
+	/// </summary>
+	bool is_inline() const { return _data == inline_data(); }
+
+	T *data() { return _data; }
+	const T *data() const { return _data; }
+
+	T &operator[](size_t index) { assert(index < _size); return _data[index]; }
+	const T &operator[](size_t index) const { assert(index < _size); return _data[index]; }
+	T &at(size_t index)
+	{
+		if (index >= _size)
+			throw std::out_of_range("small_vector index out of range");
+		return _data[index];
+	}
+	const T &at(size_t index) const
+	{
+		if (index >= _size)
+			throw std::out_of_range("small_vector index out of range");
+		return _data[index];
+	}
+
+	T &front() { assert(_size != 0); return _data[0]; }
+	const T &front() const { assert(_size != 0); return _data[0]; }
+	T &back() { assert(_size != 0); return _data[_size - 1]; }
+	const T &back() const { assert(_size != 0); return _data[_size - 1]; }
+
+	void reserve(size_t new_capacity)
+	{
+		if (new_capacity > _capacity)
+			reallocate(new_capacity);
+	}
+	void shrink_to_fit()
+	{
+		if (is_inline())
+			return;
+		// Move back into the inline storage if everything fits there again
+		reallocate(std::max(_size, N));
+	}
+
+	void resize(size_t new_size)
+	{
+		reserve(new_size);
+		while (_size > new_size)
+			pop_back();
+		for (; _size < new_size; ++_size)
+			new (_data + _size) T();
+	}
+	void resize(size_t new_size, const T &value)
+	{
+		if (new_size > _capacity)
+		{
+			// Copy the value before growing, since it may be an element of this vector
+			const T copy = value;
+			reserve(std::max(new_size, _capacity * 2));
+			resize(new_size, copy);
+			return;
+		}
+
+		while (_size > new_size)
+			pop_back();
+		for (; _size < new_size; ++_size)
+			new (_data + _size) T(value);
+	}
+
+	void clear()
+	{
+		std::destroy_n(_data, _size);
+		_size = 0;
+	}
+
+	void push_back(const T &value) { emplace_back(value); }
+	void push_back(T &&value) { emplace_back(std::move(value)); }
+	template <typename... Args>
+	T &emplace_back(Args &&... args)
+	{
+		if (_size == _capacity)
+		{
+			// Construct the new element before moving the old ones, since the arguments may reference them
+			T *const new_data = allocate(_capacity * 2);
+			new (new_data + _size) T(std::forward<Args>(args)...);
+			adopt(new_data, _capacity * 2);
+		}
+		else
+		{
+			new (_data + _size) T(std::forward<Args>(args)...);
+		}
+
+		return _data[_size++];
+	}
+	void pop_back()
+	{
+		assert(_size != 0);
+		_data[--_size].~T();
+	}
+
+	iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+	iterator insert(const_iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+	template <typename... Args>
+	iterator emplace(const_iterator pos, Args &&... args)
+	{
+		assert(pos >= begin() && pos <= end());
+		const size_t index = static_cast<size_t>(pos - begin());
+
+		// Append and rotate into place, which handles growing and arguments that reference elements of this vector
+		emplace_back(std::forward<Args>(args)...);
+		std::rotate(_data + index, _data + _size - 1, _data + _size);
+		return _data + index;
+	}
+
+	iterator erase(const_iterator pos)
+	{
+		return erase(pos, pos + 1);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		assert(first >= begin() && first <= last && last <= end());
+		T *const it = _data + (first - begin());
+		T *const new_end = std::move(it + (last - first), end(), it);
+		std::destroy(new_end, end());
+		_size = static_cast<size_t>(new_end - _data);
+		return it;
+	}
+
+	void swap(small_vector &other)
+	{
+		small_vector temp(std::move(other));
+		other = std::move(*this);
+		*this = std::move(temp);
+	}
+
+	friend bool operator==(const small_vector &lhs, const small_vector &rhs)
+	{
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+	}
+	friend bool operator!=(const small_vector &lhs, const small_vector &rhs)
+	{
+		return !(lhs == rhs);
+	}
+
+private:
+	T *inline_data() { return reinterpret_cast<T *>(_inline); }
+	const T *inline_data() const { return reinterpret_cast<const T *>(_inline); }
+
+	static T *allocate(size_t capacity)
+	{
+		return static_cast<T *>(::operator new(capacity * sizeof(T), std::align_val_t(alignof(T))));
+	}
+	void free_heap()
+	{
+		if (!is_inline())
+			::operator delete(_data, std::align_val_t(alignof(T)));
+		_data = inline_data();
+		_capacity = N;
+	}
+
+	void reallocate(size_t new_capacity)
+	{
+		assert(new_capacity >= _size);
+		adopt(new_capacity > N ? allocate(new_capacity) : inline_data(), std::max(new_capacity, N));
+	}
+	void adopt(T *new_data, size_t new_capacity)
+	{
+		if (new_data == _data)
+			return;
+
+		std::uninitialized_move_n(_data, _size, new_data);
+		std::destroy_n(_data, _size);
+		free_heap();
+
+		_data = new_data;
+		_capacity = new_capacity;
+	}
+
+	void steal(small_vector &&other)
+	{
+		if (other.is_inline())
+		{
+			std::uninitialized_move_n(other._data, other._size, _data);
+			_size = other._size;
+			other.clear();
+		}
+		else
+		{
+			// Take over the heap allocation as is
+			_data = other._data;
+			_size = other._size;
+			_capacity = other._capacity;
+			other._data = other.inline_data();
+			other._size = 0;
+			other._capacity = N;
+		}
+	}
+
+	T *_data = inline_data();
+	size_t _size = 0;
+	size_t _capacity = N;
+	alignas(T) unsigned char _inline[N * sizeof(T)];
+};
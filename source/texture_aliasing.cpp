@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "texture_aliasing.hpp"
+#include "runtime_objects.hpp"
+#include <tuple>
+#include <numeric>
+#include <iterator>
+#include <algorithm>
+
+uint64_t reshade::texture_description_key(const reshadefx::texture_info &info)
+{
+	// Pack the description into a single integer (which does not lose any information for the dimensions textures can actually have)
+	return (uint64_t(info.width) & 0xFFFFFF) | (uint64_t(info.height) & 0xFFFFFF) << 24 | (uint64_t(info.levels) & 0xFF) << 48 | uint64_t(info.format) << 56;
+}
+
+uint64_t reshade::texture_memory_size(const reshadefx::texture_info &info)
+{
+	const unsigned int pixel_sizes[] = {
+		0,
+		1 /*R8*/, 2 /*R16F*/, 4 /*R32F*/, 2 /*RG8*/, 4 /*RG16*/, 4 /*RG16F*/, 8 /*RG32F*/, 4 /*RGBA8*/, 8 /*RGBA16*/, 8 /*RGBA16F*/, 16 /*RGBA32F*/, 4 /*RGB10A2*/
+	};
+
+	static_assert(std::size(pixel_sizes) - 1 == static_cast<size_t>(reshadefx::texture_format::rgb10a2));
+
+	uint64_t memory_size = 0;
+	for (uint32_t level = 0, width = info.width, height = info.height; level < info.levels; ++level, width /= 2, height /= 2)
+		memory_size += uint64_t(width) * uint64_t(height) * pixel_sizes[static_cast<unsigned int>(info.format)];
+	return memory_size;
+}
+
+bool reshade::is_alias_candidate(const texture &texture)
+{
+	return !texture.shared && texture.impl_reference == texture_reference::none &&
+		texture.annotation_as_string("source").empty() && !texture.annotation_as_int("pooled");
+}
+
+bool reshade::find_transient_lifetime(const std::vector<reshadefx::technique_info> &techniques, const reshadefx::texture_info &info, texture_lifetime &lifetime)
+{
+	// Textures that reference external data or are written by compute shaders are never transient
+	if (!info.semantic.empty() || !info.render_target || info.storage_access)
+		return false;
+
+	bool accessed = false;
+
+	for (size_t technique_index = 0; technique_index < techniques.size(); ++technique_index)
+	{
+		const std::vector<reshadefx::pass_info> &passes = techniques[technique_index].passes;
+
+		for (size_t pass_index = 0; pass_index < passes.size(); ++pass_index)
+		{
+			const reshadefx::pass_info &pass = passes[pass_index];
+
+			const bool is_written = std::find(std::begin(pass.render_target_names), std::end(pass.render_target_names), info.unique_name) != std::end(pass.render_target_names);
+			const bool is_sampled = std::find(pass.sampled_texture_names.begin(), pass.sampled_texture_names.end(), info.unique_name) != pass.sampled_texture_names.end();
+			const bool is_storage = std::find(pass.storage_texture_names.begin(), pass.storage_texture_names.end(), info.unique_name) != pass.storage_texture_names.end();
+
+			if (!is_written && !is_sampled && !is_storage)
+				continue;
+
+			if (accessed)
+			{
+				// Contents have to survive from one technique to the next, which may not even run in the same frame
+				if (lifetime.technique != technique_index)
+					return false;
+
+				lifetime.last_pass = pass_index;
+				continue;
+			}
+
+			// The first pass accessing the texture has to replace every pixel without depending on what was there before
+			if (!is_written || is_sampled || is_storage)
+				return false;
+			if (pass.blend_enable || pass.stencil_enable || (pass.color_write_mask & 0xF) != 0xF)
+				return false;
+			// Cannot tell from the vertex count whether the geometry actually covers every pixel (the vertex shader may place it anywhere), so require a clear
+			if (!pass.clear_render_targets)
+				return false;
+
+			accessed = true;
+			lifetime.technique = technique_index;
+			lifetime.first_pass = pass_index;
+			lifetime.last_pass = pass_index;
+		}
+	}
+
+	lifetime.description = texture_description_key(info);
+	lifetime.memory_size = texture_memory_size(info);
+
+	return accessed;
+}
+
+std::vector<size_t> reshade::assign_texture_aliases(const std::vector<texture_lifetime> &lifetimes)
+{
+	// Visit lifetimes in order of their start, which makes the greedy assignment below optimal for the intervals within each technique
+	std::vector<size_t> order(lifetimes.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&lifetimes](size_t lhs, size_t rhs) {
+		return std::tie(lifetimes[lhs].technique, lifetimes[lhs].first_pass) < std::tie(lifetimes[rhs].technique, lifetimes[rhs].first_pass);
+	});
+
+	std::vector<size_t> result(lifetimes.size());
+	// List of the lifetimes sharing each allocation, with the first one being the owner of the allocation
+	std::vector<std::vector<size_t>> allocations;
+
+	for (const size_t index : order)
+	{
+		const texture_lifetime &lifetime = lifetimes[index];
+
+		const auto allocation_it = std::find_if(allocations.begin(), allocations.end(),
+			[&lifetimes, &lifetime](const std::vector<size_t> &users) {
+				return lifetimes[users.front()].description == lifetime.description &&
+					std::none_of(users.begin(), users.end(), [&lifetimes, &lifetime](size_t user) { return lifetimes_overlap(lifetimes[user], lifetime); });
+			});
+
+		if (allocation_it != allocations.end())
+		{
+			allocation_it->push_back(index);
+			result[index] = allocation_it->front();
+		}
+		else
+		{
+			allocations.push_back({ index });
+			result[index] = index;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+
+namespace reshade
+{
+	struct texture;
+
+	/// <summary>
+	/// The range of passes in which a render target holds data that is still needed.
+	/// </summary>
+	struct texture_lifetime
+	{
+		size_t technique = 0;
+		size_t first_pass = 0;
+		size_t last_pass = 0;
+		uint64_t description = 0;
+		uint64_t memory_size = 0;
+	};
+
+	/// <summary>
+	/// Pack the description (dimensions and format) of a texture into a single integer, so that textures can be matched with a single comparison.
+	/// </summary>
+	uint64_t texture_description_key(const reshadefx::texture_info &info);
+	/// <summary>
+	/// Calculate the amount of memory a texture occupies, including all its mipmap levels.
+	/// </summary>
+	uint64_t texture_memory_size(const reshadefx::texture_info &info);
+
+	/// <summary>
+	/// Check whether a texture may share memory with others at all, which is not the case for textures whose contents are referenced from outside their effect.
+	/// This excludes textures shared between effects (since another effect may read them before this one writes them), pooled textures, textures loaded from an image file and those referencing a special resource.
+	/// </summary>
+	bool is_alias_candidate(const texture &texture);
+
+	/// <summary>
+	/// Check whether a texture is only used for intermediate results within a single technique and find the passes that access it.
+	/// This is the case if all passes accessing it are part of the same technique and the first of those clears it (via "ClearRenderTargets") without reading it,
+	/// so that its contents are neither needed before that pass nor after the last one (and in particular not carried over to the next frame).
+	/// </summary>
+	/// <param name="techniques">The techniques of the effect the texture belongs to.</param>
+	/// <param name="info">The texture to check.</param>
+	/// <param name="lifetime">Receives the technique index (into <paramref name="techniques"/>) and range of passes the texture is alive in.</param>
+	/// <returns><c>true</c> if the texture is transient and can share memory with others, <c>false</c> otherwise.</returns>
+	bool find_transient_lifetime(const std::vector<reshadefx::technique_info> &techniques, const reshadefx::texture_info &info, texture_lifetime &lifetime);
+
+	/// <summary>
+	/// Check whether two textures are alive at the same time.
+	/// </summary>
+	inline bool lifetimes_overlap(const texture_lifetime &lhs, const texture_lifetime &rhs)
+	{
+		// Techniques are executed one after another, so only textures within the same technique can ever be in use at the same time
+		return lhs.technique == rhs.technique && lhs.first_pass <= rhs.last_pass && rhs.first_pass <= lhs.last_pass;
+	}
+
+	/// <summary>
+	/// Distribute textures onto as few allocations as possible, so that each allocation is only shared by textures with matching descriptions and lifetimes that do not overlap.
+	/// </summary>
+	/// <param name="lifetimes">The lifetimes of all textures to consider.</param>
+	/// <returns>For every entry in <paramref name="lifetimes"/> the index of the entry whose allocation it shares (which is its own index for those that need a new allocation).</returns>
+	std::vector<size_t> assign_texture_aliases(const std::vector<texture_lifetime> &lifetimes);
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "runtime_objects.hpp"
+#include "texture_registry.hpp"
+#include "texture_aliasing.hpp"
+
+bool reshade::texture_registry::find_by_name(const std::string &unique_name, size_t &index) const
+{
+	const auto it = _names.find(unique_name);
+	if (it == _names.end())
+		return false;
+	index = it->second;
+	return true;
+}
+
+bool reshade::texture_registry::find_pooled(const std::vector<texture> &textures, const reshadefx::texture_info &desc, size_t effect_index, size_t &index) const
+{
+	const auto [begin, end] = _pooled.equal_range(texture_description_key(desc));
+	for (auto it = begin; it != end; ++it)
+	{
+		if (textures[it->second].effect_index != effect_index && textures[it->second].matches_description(desc))
+		{
+			index = it->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+void reshade::texture_registry::add(const texture &tex, size_t index)
+{
+	_names.emplace(tex.unique_name, index);
+	if (tex.annotation_as_int("pooled"))
+		_pooled.emplace(texture_description_key(tex), index);
+}
+
+void reshade::texture_registry::rebuild(const std::vector<texture> &textures)
+{
+	clear();
+	for (size_t i = 0; i < textures.size(); ++i)
+		add(textures[i], i);
+}
+
+void reshade::texture_registry::clear()
+{
+	_names.clear();
+	_pooled.clear();
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace reshadefx
+{
+	struct texture_info; // Forward declarations to avoid excessive #include
+}
+
+namespace reshade
+{
+	struct texture;
+
+	/// <summary>
+	/// Lookup tables into the global texture list of a runtime, so that textures to share by name or to pool by description can be found without searching the entire list.
+	/// This does not do any synchronization, so access has to be protected by the same lock as the texture list.
+	/// </summary>
+	class texture_registry
+	{
+	public:
+		/// <summary>
+		/// Find the texture with the specified unique name.
+		/// </summary>
+		/// <param name="unique_name">The unique name of the texture to find.</param>
+		/// <param name="index">Receives the index of the texture in the texture list.</param>
+		/// <returns><c>true</c> if a texture with that name exists, <c>false</c> otherwise.</returns>
+		bool find_by_name(const std::string &unique_name, size_t &index) const;
+		/// <summary>
+		/// Find a pooled texture with the same description as the specified one, which does not belong to the specified effect (since textures of the same effect are in use at the same time).
+		/// </summary>
+		/// <param name="textures">The texture list the registry was built from.</param>
+		/// <param name="desc">The texture to find a match for.</param>
+		/// <param name="effect_index">The index of the effect the texture to find a match for belongs to.</param>
+		/// <param name="index">Receives the index of the matching texture in the texture list.</param>
+		/// <returns><c>true</c> if a matching pooled texture exists, <c>false</c> otherwise.</returns>
+		bool find_pooled(const std::vector<texture> &textures, const reshadefx::texture_info &desc, size_t effect_index, size_t &index) const;
+
+		/// <summary>
+		/// Register a texture that was added to the texture list at the specified index.
+		/// </summary>
+		void add(const texture &tex, size_t index);
+		/// <summary>
+		/// Rebuild all lookup tables, which is necessary after textures were removed from the texture list, since that changes the indices.
+		/// </summary>
+		void rebuild(const std::vector<texture> &textures);
+		/// <summary>
+		/// Remove all textures from the lookup tables.
+		/// </summary>
+		void clear();
+
+	private:
+		std::unordered_map<std::string, size_t> _names;
+		std::unordered_multimap<uint64_t, size_t> _pooled;
+	};
+}
@@ -5,26 +5,20 @@
 
 #pragma once
 
-#include <map>
 #include <vulkan.h>
+#include "buffer_detection_core.hpp"
 
 namespace reshade::vulkan
 {
-	class buffer_detection
+	struct depthstencil_data
 	{
-	public:
-		struct draw_stats
-		{
-			uint32_t vertices = 0;
-			uint32_t drawcalls = 0;
-		};
-		struct depthstencil_info
-		{
-			draw_stats stats;
-			VkImage image = VK_NULL_HANDLE;
-			VkImageCreateInfo image_info = {};
-		};
+		VkImage image = VK_NULL_HANDLE;
+		VkImageCreateInfo image_info = {};
+	};
 
+	class buffer_detection : public buffer_detection_core<VkImage, depthstencil_data>
+	{
+	public:
 		void reset();
 
 		void merge(const buffer_detection &source);
@@ -34,26 +28,13 @@ namespace reshade::vulkan
 #if RESHADE_DEPTH
 		void on_set_depthstencil(VkImage depthstencil, VkImageLayout layout, const VkImageCreateInfo &create_info);
 #endif
-
-	protected:
-		draw_stats _stats;
-#if RESHADE_DEPTH
-		VkImage _current_depthstencil = VK_NULL_HANDLE;
-		// Use "std::map" instead of "std::unordered_map" so that the iteration order is guaranteed
-		std::map<VkImage, depthstencil_info> _counters_per_used_depth_image;
-#endif
 	};
 
 	class buffer_detection_context : public buffer_detection
 	{
 	public:
-		uint32_t total_vertices() const { return _stats.vertices; }
-		uint32_t total_drawcalls() const { return _stats.drawcalls; }
-
 #if RESHADE_DEPTH
-		const auto &depth_buffer_counters() const { return _counters_per_used_depth_image; }
-
-		depthstencil_info find_best_depth_texture(VkExtent2D dimensions = {}, VkImage override = VK_NULL_HANDLE) const;
+		depthstencil_info find_best_depth_texture(VkExtent2D dimensions = {}, VkImage override = VK_NULL_HANDLE);
 #endif
 	};
 }
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <thread>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+/// <summary>
+/// A lock-free allocator for objects of a single type, which hands out slots from large slabs of memory instead of going to the heap for every object.
+/// Freed slots are kept in a lock-free list and reused by the next allocation.
+/// </summary>
+/// <remarks>
+/// Every slot is aligned to a cache line, so that objects used by different threads never share one.
+/// Slabs double in size every time a new one is needed and are only freed on destruction, so the number of heap allocations only grows logarithmically with the peak number of live objects.
+/// The first slab has <typeparamref name="FIRST_SLAB_SIZE"/> slots, every following slab has twice as many as the one before.
+/// </remarks>
+template <typename T, size_t FIRST_SLAB_SIZE>
+class lockfree_slab
+{
+	static_assert(FIRST_SLAB_SIZE != 0 && (FIRST_SLAB_SIZE & (FIRST_SLAB_SIZE - 1)) == 0 && FIRST_SLAB_SIZE <= 0x80000000, "first slab size has to be a power of two that fits into 32 bits");
+
+	static constexpr size_t cache_line_size = 64;
+	static constexpr size_t first_slab_size = FIRST_SLAB_SIZE;
+	// Enough slabs to cover all slot indices that fit into 32 bits (slab k starts at index 'first_slab_size * (2^k - 1)')
+	static constexpr size_t max_slabs = []() {
+		size_t count = 32;
+		for (size_t size = first_slab_size; size > 1; size /= 2)
+			count--;
+		return count;
+	}();
+
+public:
+	lockfree_slab() = default;
+	lockfree_slab(const lockfree_slab &) = delete;
+	lockfree_slab &operator=(const lockfree_slab &) = delete;
+	~lockfree_slab()
+	{
+		// This does not call any destructors, so all objects have to be destroyed before
+		for (size_t k = 0; k < max_slabs; ++k)
+			delete[] _slabs[k].load(std::memory_order_acquire);
+	}
+
+	/// <summary>
+	/// Constructs a new object in a free slot.
+	/// </summary>
+	/// <param name="args">The arguments to pass to the constructor.</param>
+	/// <returns>A pointer to the new object, which has to be freed again with <see cref="destroy"/>.</returns>
+	template <typename... Args>
+	T *create(Args &&... args)
+	{
+		slot *const s = pop();
+		return new (s->storage) T(std::forward<Args>(args)...);
+	}
+
+	/// <summary>
+	/// Destroys an object that was created by this allocator and makes its slot available again.
+	/// </summary>
+	/// <param name="object">The object to destroy.</param>
+	void destroy(T *object)
+	{
+		if (object == nullptr)
+			return;
+
+		object->~T();
+
+		// The storage is the first member, so the object address is also the slot address
+		push(reinterpret_cast<slot *>(object));
+	}
+
+private:
+	struct alignas(cache_line_size) slot
+	{
+		alignas(T) unsigned char storage[sizeof(T)];
+		// Index of the slot following this one in the free list (plus one, so that zero can mean the end of the list)
+		// This is kept outside the storage, since a thread may still read it after another thread already popped the slot and constructed an object in it
+		std::atomic<uint32_t> next = 0;
+		uint32_t index = 0;
+	};
+
+	static size_t slab_size(size_t k) { return size_t(first_slab_size) << k; }
+	static size_t slab_offset(size_t k) { return size_t(first_slab_size) * ((size_t(1) << k) - 1); }
+
+	slot &slot_at(uint32_t index) const
+	{
+		// Find the slab that contains this index, which is the most significant bit of the index in units of the first slab size
+		size_t k = 0;
+		while ((size_t(index) / first_slab_size + 1) >> (k + 1))
+			k++;
+
+		slot *const slab = _slabs[k].load(std::memory_order_acquire);
+		assert(slab != nullptr);
+		return slab[index - slab_offset(k)];
+	}
+
+	slot *pop()
+	{
+		for (uint64_t head = _head.load(std::memory_order_acquire);;)
+		{
+			if (static_cast<uint32_t>(head) == 0)
+			{
+				// The list is empty, so add a new slab and take the first slot of it
+				if (slot *const s = grow(); s != nullptr)
+					return s;
+
+				head = _head.load(std::memory_order_acquire);
+				continue;
+			}
+
+			slot &s = slot_at(static_cast<uint32_t>(head) - 1);
+
+			// The list head carries a counter in its upper bits that changes with every update, so that the CAS fails if the slot was popped and pushed again in the meantime (which would make "next" stale)
+			const uint64_t new_head = ((head >> 32) + 1) << 32 | s.next.load(std::memory_order_relaxed);
+			if (_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire))
+				return &s;
+		}
+	}
+
+	void push(slot *s)
+	{
+		push(s, s);
+	}
+	void push(slot *first, slot *last)
+	{
+		// Slots between the first and the last one have to be linked already
+		const uint32_t first_index = first->index + 1;
+
+		for (uint64_t head = _head.load(std::memory_order_relaxed);;)
+		{
+			last->next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+
+			const uint64_t new_head = ((head >> 32) + 1) << 32 | first_index;
+			if (_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed))
+				break;
+		}
+	}
+
+	slot *grow()
+	{
+		const size_t k = _num_slabs.load(std::memory_order_acquire);
+		if (k >= max_slabs)
+			throw std::bad_alloc();
+
+		const size_t size = slab_size(k);
+		slot *const slab = new slot[size];
+
+		// Multiple threads may find the list empty at the same time, in which case all but one throw their new slab away again and wait for the slots of the winner to appear
+		if (slot *expected = nullptr; !_slabs[k].compare_exchange_strong(expected, slab, std::memory_order_acq_rel))
+		{
+			delete[] slab;
+			std::this_thread::yield();
+			return nullptr;
+		}
+
+		const uint32_t offset = static_cast<uint32_t>(slab_offset(k));
+		for (size_t i = 0; i < size; ++i)
+		{
+			slab[i].index = offset + static_cast<uint32_t>(i);
+			slab[i].next.store(offset + static_cast<uint32_t>(i) + 2, std::memory_order_relaxed);
+		}
+
+		_num_slabs.store(k + 1, std::memory_order_release);
+
+		// Keep the first slot for this thread and link all others into the free list at once
+		if (size > 1)
+			push(&slab[1], &slab[size - 1]);
+
+		return &slab[0];
+	}
+
+	std::atomic<uint64_t> _head = 0;
+	std::atomic<size_t> _num_slabs = 0;
+	std::atomic<slot *> _slabs[max_slabs] = {};
+};
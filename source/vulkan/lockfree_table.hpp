@@ -5,30 +5,53 @@
 
 #pragma once
 
+#include "lockfree_slab.hpp"
 #include <atomic>
+#include <memory>
+#include <cassert>
 #include <utility>
+#include <functional>
 
 /// <summary>
-/// A simple lock-free linear search table.
-/// The key values "one" and "zero" hold a special meaning (see <see cref="no_value"/> and <see cref="update_value"/>), so do not use them.
+/// A lock-free hash table using open addressing with linear probing.
+/// The key values "zero", "one" and "minus one" hold a special meaning (see <see cref="no_value"/>, <see cref="update_value"/> and <see cref="erased_value"/>), so do not use them.
 /// </summary>
+/// <remarks>
+/// When a table becomes too full, new entries are added to a larger table that is chained after it, instead of moving existing entries (which could not be done without locking out readers).
+/// Chained tables are only freed on destruction, so references returned by <see cref="at"/> and <see cref="emplace"/> stay valid until the entry is erased.
+/// Values are allocated from a slab owned by the table, so that adding and removing entries does not go to the heap once the table has warmed up.
+/// </remarks>
 template <typename TKey, typename TValue, size_t MAX_ENTRIES>
 class lockfree_table
 {
+	static_assert((MAX_ENTRIES & (MAX_ENTRIES - 1)) == 0, "initial table size has to be a power of two");
+
 public:
+	lockfree_table() : _first(MAX_ENTRIES) {}
 	~lockfree_table()
 	{
 		clear(); // Free all pointers
+
+		for (table *chained = _first.next.load(std::memory_order_acquire); chained != nullptr;)
+		{
+			table *const next = chained->next.load(std::memory_order_acquire);
+			delete chained;
+			chained = next;
+		}
 	}
 
 	/// <summary>
-	/// Special key indicating that the entry is empty.
+	/// Special key indicating that the entry is empty and was never used, which ends a search.
 	/// </summary>
 	static constexpr TKey no_value = (TKey)0;
 	/// <summary>
 	/// Special key indicating that the entry is currently being updated.
 	/// </summary>
 	static constexpr TKey update_value = (TKey)1;
+	/// <summary>
+	/// Special key indicating that the entry was erased, which does not end a search, since keys after it may have been placed there while it was still in use.
+	/// </summary>
+	static constexpr TKey erased_value = (TKey)-1;
 
 	/// <summary>
 	/// Gets the value associated with the specified <paramref name="key"/>.
@@ -38,19 +61,19 @@ public:
 	/// <returns>A reference to the associated value.</returns>
 	TValue &at(TKey key) const
 	{
-		assert(key != no_value && key != update_value);
+		assert(key != no_value && key != update_value && key != erased_value);
 
-		size_t start_index = 0;
-		// If the table is really big, reduce search time by using hash as start index
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (const table *current = &_first; current != nullptr; current = current->next.load(std::memory_order_acquire))
 		{
-			if (_data[i].first.load(std::memory_order_acquire) == key)
+			for (size_t i = 0, index = hash(key) & (current->capacity - 1); i < current->capacity; ++i, index = (index + 1) & (current->capacity - 1))
 			{
-				// The pointer is guaranteed to be value at this point, or else key would have been in update mode
-				return *_data[i].second;
+				const TKey test_key = current->entries[index].first.load(std::memory_order_acquire);
+
+				if (test_key == key)
+					// The pointer is guaranteed to be value at this point, or else key would have been in update mode
+					return *current->entries[index].second;
+				if (test_key == no_value)
+					break; // The key would have been placed here if it was in this table
 			}
 		}
 
@@ -65,35 +88,8 @@ public:
 	/// <returns>A reference to the newly added value.</returns>
 	TValue &emplace(TKey key)
 	{
-		assert(key != no_value && key != update_value);
-
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
 		// Create a pointer to the new value
-		TValue *new_value = new TValue();
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
-		{
-			// Load and check before doing an expensive CAS
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == no_value && // Check if the entry is empty and then do the CAS to occupy it
-				_data[i].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
-			{
-				_data[i].second = new_value;
-
-				// Now that the new value is stored, make this entry available
-				_data[i].first.store(key, std::memory_order_release);
-
-				return *new_value;
-			}
-		}
-
-		delete new_value;
-
-		assert(false);
-		return _default; // Fall back if table is full
+		return insert(key, _values.create());
 	}
 	/// <summary>
 	/// Adds the specified key-value pair to the table.
@@ -103,33 +99,8 @@ public:
 	/// <returns>A reference to the newly added value.</returns>
 	TValue &emplace(TKey key, const TValue &value)
 	{
-		assert(key != no_value && key != update_value);
-
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
 		// Create a pointer to the new value using copy construction
-		TValue *new_value = new TValue(value);
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
-		{
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == no_value &&
-				_data[i].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
-			{
-				_data[i].second = new_value;
-
-				_data[i].first.store(key, std::memory_order_release);
-
-				return *new_value;
-			}
-		}
-
-		delete new_value;
-
-		assert(false);
-		return _default; // Fall back if table is full
+		return insert(key, _values.create(value));
 	}
 
 	/// <summary>
@@ -139,31 +110,12 @@ public:
 	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
 	bool erase(TKey key)
 	{
-		if (key == no_value || key == update_value) // Cannot remove special keys
+		TValue *const old_value = remove(key);
+		if (old_value == nullptr)
 			return false;
 
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
-
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
-		{
-			// Load and check before doing an expensive CAS
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == key)
-			{
-				// Get the value before freeing the entry up for other threads to fill again
-				TValue *const old_value = _data[i].second;
-
-				if (_data[i].first.compare_exchange_strong(test_key, no_value, std::memory_order_relaxed))
-				{
-					delete old_value;
-					return true;
-				}
-			}
-		}
-
-		return false;
+		_values.destroy(old_value);
+		return true;
 	}
 	/// <summary>
 	/// Removes and returns the value associated with the specified <paramref name="key"/> from the table.
@@ -173,55 +125,155 @@ public:
 	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
 	bool erase(TKey key, TValue &value)
 	{
-		if (key == no_value || key == update_value)
+		TValue *const old_value = remove(key);
+		if (old_value == nullptr)
 			return false;
 
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+		// Move value to output argument and free its slot (which is no longer in use now)
+		value = std::move(*old_value);
 
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		_values.destroy(old_value);
+		return true;
+	}
+
+	/// <summary>
+	/// Clears the entire table and deletes all keys.
+	/// Note that another thread may add new values while this operation is in progress, so do not rely on it.
+	/// </summary>
+	void clear()
+	{
+		for (table *current = &_first; current != nullptr; current = current->next.load(std::memory_order_acquire))
 		{
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == key)
+			for (size_t i = 0; i < current->capacity; ++i)
 			{
-				TValue *const old_value = _data[i].second;
+				TValue *const old_value = current->entries[i].second;
 
-				if (_data[i].first.compare_exchange_strong(test_key, no_value, std::memory_order_relaxed))
+				// Clear this entry so it can be used again
+				if (TKey current_key = current->entries[i].first.exchange(no_value);
+					current_key != no_value && current_key != update_value && current_key != erased_value) // If this in update mode, we can assume the thread updating will reset the key to its intended value
 				{
-					// Move value to output argument and delete its pointer (which is no longer in use now)
-					value = std::move(*old_value);
-
-					delete old_value;
-					return true;
+					// Delete any value attached to the entry, but only if there was one to begin with
+					_values.destroy(old_value);
 				}
 			}
+
+			current->num_used.store(0, std::memory_order_relaxed);
 		}
+	}
+
+private:
+	struct table
+	{
+		explicit table(size_t capacity) : capacity(capacity), entries(new std::pair<std::atomic<TKey>, TValue *>[capacity]()) {}
+
+		const size_t capacity;
+		// Number of entries that are not empty anymore, which includes erased ones (since those are never turned back into empty ones)
+		std::atomic<size_t> num_used = 0;
+		std::atomic<table *> next = nullptr;
+		const std::unique_ptr<std::pair<std::atomic<TKey>, TValue *>[]> entries;
+	};
 
-		return false;
+	static size_t hash(TKey key)
+	{
+		// Handles are usually pointers or indices with little entropy in the low bits, so mix all bits into them
+		uint64_t h = static_cast<uint64_t>(std::hash<TKey>()(key));
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
 	}
 
-	/// <summary>
-	/// Clears the entire table and deletes all keys.
-	/// Note that another thread may add new values while this operation is in progress, so do not rely on it.
-	/// </summary>
-	void clear()
+	TValue &insert(TKey key, TValue *new_value)
 	{
-		for (size_t i = 0; i < MAX_ENTRIES; ++i)
+		assert(key != no_value && key != update_value && key != erased_value);
+
+		for (table *current = &_first; ; current = next_table(current))
 		{
-			TValue *const old_value = _data[i].second;
+			// Erased entries count toward the load too, since searches have to walk past them just like past entries that hold a value
+			// Once a table is too full, no more empty entries are taken from it (so that searches in it stay short), but erased entries on the way are still reused
+			const bool is_full = current->num_used.load(std::memory_order_relaxed) >= current->capacity * 3 / 4;
 
-			// Clear this entry so it can be used again
-			if (TKey current_key = _data[i].first.exchange(no_value);
-				current_key != no_value && current_key != update_value) // If this in update mode, we can assume the thread updating will reset the key to its intended value
+			for (size_t i = 0, index = hash(key) & (current->capacity - 1); i < current->capacity; ++i, index = (index + 1) & (current->capacity - 1))
 			{
-				// Delete any value attached to the entry, but only if there was one to begin with
-				delete old_value;
+				auto &entry = current->entries[index];
+
+				// Load and check before doing an expensive CAS
+				TKey test_key = entry.first.load(std::memory_order_relaxed);
+				if (test_key == no_value && is_full)
+					break; // Continue in the next table
+
+				if ((test_key == no_value || test_key == erased_value) && // Check if the entry is free and then do the CAS to occupy it
+					entry.first.compare_exchange_strong(test_key, update_value, std::memory_order_acquire)) // Synchronize with the thread that erased the previous value
+				{
+					if (test_key == no_value)
+						current->num_used.fetch_add(1, std::memory_order_relaxed);
+
+					entry.second = new_value;
+
+					// Now that the new value is stored, make this entry available
+					entry.first.store(key, std::memory_order_release);
+
+					return *new_value;
+				}
 			}
 		}
 	}
 
-private:
+	TValue *remove(TKey key)
+	{
+		if (key == no_value || key == update_value || key == erased_value) // Cannot remove special keys
+			return nullptr;
+
+		for (table *current = &_first; current != nullptr; current = current->next.load(std::memory_order_acquire))
+		{
+			for (size_t i = 0, index = hash(key) & (current->capacity - 1); i < current->capacity; ++i, index = (index + 1) & (current->capacity - 1))
+			{
+				auto &entry = current->entries[index];
+
+				// Load and check before doing an expensive CAS
+				if (TKey test_key = entry.first.load(std::memory_order_relaxed);
+					test_key == key)
+				{
+					// Lock the entry while taking the value, so that it cannot be reused before that is done
+					if (entry.first.compare_exchange_strong(test_key, update_value, std::memory_order_acquire))
+					{
+						TValue *const old_value = entry.second;
+
+						// Keep the entry marked as used, so that searches for keys placed after it do not stop here
+						// Erased entries are never turned back into empty ones, since that could not be done without racing against concurrent insertions that already passed them
+						entry.first.store(erased_value, std::memory_order_release);
+
+						return old_value;
+					}
+				}
+				else if (test_key == no_value)
+				{
+					break;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	table *next_table(table *current)
+	{
+		if (table *const next = current->next.load(std::memory_order_acquire); next != nullptr)
+			return next;
+
+		// Multiple threads may try to grow at the same time, in which case all but one throw their new table away again
+		table *const new_table = new table(current->capacity * 2);
+		if (table *expected = nullptr; !current->next.compare_exchange_strong(expected, new_table, std::memory_order_acq_rel))
+		{
+			delete new_table;
+			return expected;
+		}
+
+		return new_table;
+	}
+
 	mutable TValue _default = {};
-	std::pair<std::atomic<TKey>, TValue *> _data[MAX_ENTRIES];
+	table _first;
+	// Start with as many slots as the first table has entries, which is usually sized for the expected number of objects already
+	lockfree_slab<TValue, MAX_ENTRIES> _values;
 };
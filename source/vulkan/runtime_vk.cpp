@@ -8,10 +8,14 @@
 #include "runtime_vk.hpp"
 #include "runtime_config.hpp"
 #include "runtime_objects.hpp"
+#include "frame_profiler.hpp"
+#include "pixel_conversion.hpp"
 #include "format_utils.hpp"
 #include <imgui.h>
 #include <imgui_internal.h>
 
+extern std::filesystem::path g_reshade_dll_path;
+
 #define check_result(call) \
 	if ((call) != VK_SUCCESS) \
 		return
@@ -238,7 +242,10 @@ bool reshade::vulkan::runtime_vk::on_init(VkSwapchainKHR swapchain, const VkSwap
 	_height = desc.imageExtent.height;
 	_window_width = window_rect.right;
 	_window_height = window_rect.bottom;
-	_color_bit_depth = desc.imageFormat >= VK_FORMAT_A2R10G10B10_UNORM_PACK32 && desc.imageFormat <= VK_FORMAT_A2B10G10R10_SINT_PACK32 ? 10 : 8;
+	// Report zero for other formats (e.g. floating-point ones), like 'dxgi_format_color_depth' does
+	_color_bit_depth =
+		desc.imageFormat >= VK_FORMAT_A2R10G10B10_UNORM_PACK32 && desc.imageFormat <= VK_FORMAT_A2B10G10R10_SINT_PACK32 ? 10 :
+		(desc.imageFormat >= VK_FORMAT_R8G8B8A8_UNORM && desc.imageFormat <= VK_FORMAT_B8G8R8A8_SRGB) ? 8 : 0;
 	_backbuffer_format = desc.imageFormat;
 
 	if (_queue == VK_NULL_HANDLE)
@@ -705,30 +712,18 @@ bool reshade::vulkan::runtime_vk::capture_screenshot(uint8_t *buffer) const
 		{
 			if (_color_bit_depth == 10)
 			{
-				for (uint32_t x = 0; x < data_pitch; x += 4)
-				{
-					const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_data + x);
-					// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-					buffer[x + 0] = ( (rgba & 0x000003FF)        /  4) & 0xFF;
-					buffer[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-					buffer[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-					buffer[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-					if (_backbuffer_format >= VK_FORMAT_A2B10G10R10_UNORM_PACK32 &&
-						_backbuffer_format <= VK_FORMAT_A2B10G10R10_SINT_PACK32)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
+				pixel::convert_rgb10a2_to_rgba8(buffer, mapped_data, _width,
+					_backbuffer_format >= VK_FORMAT_A2B10G10R10_UNORM_PACK32 && _backbuffer_format <= VK_FORMAT_A2B10G10R10_SINT_PACK32);
+			}
+			else if (_backbuffer_format >= VK_FORMAT_B8G8R8A8_UNORM &&
+				_backbuffer_format <= VK_FORMAT_B8G8R8A8_SRGB)
+			{
+				// Format is BGRA, but output should be RGBA, so flip channels
+				pixel::swap_red_blue(buffer, mapped_data, _width);
 			}
 			else
 			{
 				std::memcpy(buffer, mapped_data, data_pitch);
-
-				if (_backbuffer_format >= VK_FORMAT_B8G8R8A8_UNORM &&
-					_backbuffer_format <= VK_FORMAT_B8G8R8A8_SRGB)
-				{
-					// Format is BGRA, but output should be RGBA, so flip channels
-					for (uint32_t x = 0; x < data_pitch; x += 4)
-						std::swap(buffer[x + 0], buffer[x + 2]);
-				}
 			}
 		}
 
@@ -911,6 +906,9 @@ bool reshade::vulkan::runtime_vk::init_effect(size_t index)
 			0, 0, &effect_data.ubo_mem);
 		if (effect_data.ubo == VK_NULL_HANDLE)
 			return false;
+
+		// The buffer is created without initial data, so upload everything before it is used the first time
+		effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 	}
 
 	// Initialize image and sampler bindings
@@ -1707,15 +1705,10 @@ void reshade::vulkan::runtime_vk::upload_texture(const texture &texture, const u
 		switch (texture.format)
 		{
 		case reshadefx::texture_format::r8:
-			for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 1, pixels += texture.width * 4)
-				for (uint32_t x = 0; x < texture.width; ++x)
-					mapped_data[x] = pixels[x * 4];
+			pixel::convert_rgba8_to_r8(mapped_data, pixels, texture.width * texture.height);
 			break;
 		case reshadefx::texture_format::rg8:
-			for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 2, pixels += texture.width * 4)
-				for (uint32_t x = 0; x < texture.width; ++x)
-					mapped_data[x * 2 + 0] = pixels[x * 4 + 0],
-					mapped_data[x * 2 + 1] = pixels[x * 4 + 1];
+			pixel::convert_rgba8_to_rg8(mapped_data, pixels, texture.width * texture.height);
 			break;
 		case reshadefx::texture_format::rgba8:
 			for (uint32_t y = 0; y < texture.height; ++y, mapped_data += texture.width * 4, pixels += texture.width * 4)
@@ -1817,7 +1810,10 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 			impl->query_base_index + ((_cmd_index + 1) % NUM_COMMAND_FRAMES) * 2, 2,
 		sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
 	{
-		technique.average_gpu_duration.append(timestamps[1] - timestamps[0]);
+		const uint64_t duration = timestamps[1] - timestamps[0];
+		technique.average_gpu_duration.append(duration);
+		technique.gpu_statistics.append(duration);
+		_profiler->add_gpu_event(technique.name, duration);
 	}
 
 	if (!begin_command_buffer())
@@ -1848,8 +1844,12 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 		vk.CmdBindDescriptorSets(cmd_list, VK_PIPELINE_BIND_POINT_COMPUTE, effect_data.pipeline_layout, 0, effect_data.storage_layout ? 3 : 2, effect_data.set, 0, nullptr);
 
 	// Setup shader constants
-	if (effect_data.ubo != VK_NULL_HANDLE)
-		vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, 0, _effects[technique.effect_index].uniform_data_storage.size(), _effects[technique.effect_index].uniform_data_storage.data());
+	// Only upload the range that was modified since the last technique of this effect was rendered (offsets and sizes are multiples of four, as required)
+	if (effect &effect = _effects[technique.effect_index]; effect_data.ubo != VK_NULL_HANDLE && effect.is_uniform_data_dirty())
+	{
+		vk.CmdUpdateBuffer(cmd_list, effect_data.ubo, effect.uniform_data_dirty_begin, effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin, effect.uniform_data_storage.data() + effect.uniform_data_dirty_begin);
+		effect.clear_uniform_data_dirty();
+	}
 
 #if RESHADE_DEPTH
 	if (_depth_image != VK_NULL_HANDLE)
@@ -1864,6 +1864,11 @@ void reshade::vulkan::runtime_vk::render_technique(technique &technique)
 
 	for (size_t pass_index = 0; pass_index < technique.passes.size(); ++pass_index)
 	{
+		if (technique.culled_passes[pass_index])
+			continue; // Skip passes whose output is never used
+
+		const frame_profiler::scope profile(*_profiler, "Pass", static_cast<uint32_t>(pass_index));
+
 		if (needs_implicit_backbuffer_copy)
 		{
 			// Save back buffer of previous pass
@@ -2458,6 +2463,15 @@ void reshade::vulkan::runtime_vk::draw_depth_debug_menu(buffer_detection_context
 	if (ImGui::Checkbox("Use aspect ratio heuristics", &_use_aspect_ratio_heuristics))
 		runtime::save_config();
 
+	if (tracker.is_tracing())
+		ImGui::TextUnformatted("Recording depth buffer detection trace ...");
+	else if (ImGui::Button("Record trace of the next 300 frames", ImVec2(-1, 0)))
+	{
+		// Traces can be replayed with the "buffer_detection_replay" tool in the tests, to find out how changes to the heuristics would affect the selection
+		if (const std::filesystem::path trace_path = g_reshade_dll_path.parent_path() / L"ReShade_depth.trace"; !tracker.start_trace(trace_path, 300))
+			LOG(ERROR) << "Failed to create depth buffer detection trace " << trace_path << '.';
+	}
+
 	ImGui::Spacing();
 	ImGui::Separator();
 	ImGui::Spacing();
@@ -2480,7 +2494,7 @@ void reshade::vulkan::runtime_vk::draw_depth_debug_menu(buffer_detection_context
 
 		ImGui::SameLine();
 		ImGui::Text("| %4ux%-4u | %5u draw calls ==> %8u vertices |%s",
-			snapshot.image_info.extent.width, snapshot.image_info.extent.height, snapshot.stats.drawcalls, snapshot.stats.vertices, (msaa ? " MSAA" : ""));
+			snapshot.image_info.extent.width, snapshot.image_info.extent.height, snapshot.total_stats.drawcalls, snapshot.total_stats.vertices, (msaa ? " MSAA" : ""));
 
 		if (msaa)
 		{
@@ -10,6 +10,7 @@
 #include <vk_layer_dispatch_table.h>
 #include "format_utils.hpp"
 #include "lockfree_table.hpp"
+#include "small_vector.hpp"
 
 struct device_data
 {
@@ -40,9 +41,9 @@ static lockfree_table<VkSurfaceKHR, HWND, 16> s_surface_windows;
 static lockfree_table<VkSwapchainKHR, reshade::vulkan::runtime_vk *, 16> s_vulkan_runtimes;
 static lockfree_table<VkImage, VkImageCreateInfo, 4096> s_image_data;
 static lockfree_table<VkImageView, VkImage, 4096> s_image_view_mapping;
-static lockfree_table<VkFramebuffer, std::vector<VkImage>, 4096> s_framebuffer_data;
+static lockfree_table<VkFramebuffer, small_vector<VkImage, 8>, 4096> s_framebuffer_data;
 static lockfree_table<VkCommandBuffer, command_buffer_data, 4096> s_command_buffer_data;
-static lockfree_table<VkRenderPass, std::vector<render_pass_data>, 4096> s_renderpass_data;
+static lockfree_table<VkRenderPass, small_vector<render_pass_data, 4>, 4096> s_renderpass_data;
 
 template <typename T>
 static T *find_layer_info(const void *structure_chain, VkStructureType type, VkLayerFunction function)
@@ -851,7 +852,7 @@ VkResult VKAPI_CALL vkCreateFramebuffer(VkDevice device, const VkFramebufferCrea
 	}
 
 	// Look up the depth-stencil images associated with their image views
-	std::vector<VkImage> attachment_images(pCreateInfo->attachmentCount);
+	small_vector<VkImage, 8> attachment_images(pCreateInfo->attachmentCount);
 	for (const auto &subpass_data : s_renderpass_data.at(pCreateInfo->renderPass))
 		if (subpass_data.depthstencil_attachment_index < pCreateInfo->attachmentCount)
 			attachment_images[subpass_data.depthstencil_attachment_index] = s_image_view_mapping.at(
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+// Replaces the global allocation functions to count heap allocations, so only include this in one source file per executable
+
+#include <new>
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace reshade::test
+{
+	/// <summary>
+	/// Number of heap allocations the calling thread made so far.
+	/// </summary>
+	inline thread_local size_t num_allocations = 0;
+}
+
+void *operator new(size_t size)
+{
+	reshade::test::num_allocations++;
+	if (void *const p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	reshade::test::num_allocations++;
+#ifdef _WIN32
+	if (void *const p = _aligned_malloc(size, size_t(alignment)))
+#else
+	if (void *const p = std::aligned_alloc(size_t(alignment), (size + size_t(alignment) - 1) / size_t(alignment) * size_t(alignment)))
+#endif
+		return p;
+	throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void *p) noexcept
+{
+	std::free(p);
+}
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+void operator delete[](void *p, size_t) noexcept
+{
+	std::free(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+void operator delete[](void *p, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+void operator delete(void *p, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+void operator delete[](void *p, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
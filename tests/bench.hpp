@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace reshade::bench
+{
+	/// <summary>
+	/// Return <c>true</c> if the benchmark was started with "--quick", which is how CTest runs it (to only check that it still works, not to measure anything).
+	/// </summary>
+	inline bool is_quick_run(int argc, char *argv[])
+	{
+		for (int i = 1; i < argc; ++i)
+			if (std::strcmp(argv[i], "--quick") == 0)
+				return true;
+		return false;
+	}
+
+	/// <summary>
+	/// Call the specified function the specified number of times and return the best time of a single call in seconds.
+	/// </summary>
+	template <typename F>
+	double measure(unsigned int repetitions, F &&func)
+	{
+		double best = 1e30;
+		for (unsigned int i = 0; i < repetitions; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const auto end = std::chrono::steady_clock::now();
+			const double seconds = std::chrono::duration<double>(end - start).count();
+			if (seconds < best)
+				best = seconds;
+		}
+		return best;
+	}
+
+	/// <summary>
+	/// Prevent the compiler from optimizing away a result that is only computed for the benchmark.
+	/// </summary>
+	template <typename T>
+	inline void do_not_optimize(const T &value)
+	{
+#ifdef __GNUC__
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		static const void *volatile s_sink;
+		s_sink = &value;
+#endif
+	}
+}
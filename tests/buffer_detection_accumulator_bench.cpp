@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "buffer_detection_core.hpp"
+#include "buffer_detection_accumulator.hpp"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// Executes command lists from a number of threads (like an engine submitting to multiple queues) and measures the time per frame it takes to merge their depth statistics
+// This compares merging every command list into the device tracker under a global lock (like ExecuteCommandLists did before) against the per-thread trackers that are merged once on present
+
+class command_list_tracker : public reshade::buffer_detection_core<uint64_t>
+{
+public:
+	void reset() { reset_core(); }
+	void merge(const command_list_tracker &source) { merge_core(source); }
+
+	void record(uint64_t depthstencil, uint32_t num_draws)
+	{
+		set_current_depthstencil(depthstencil);
+		for (uint32_t i = 0; i < num_draws; ++i)
+		{
+			count_draw(300 * (i + 1));
+			count_draw_current(300 * (i + 1));
+		}
+	}
+};
+
+/// <summary>
+/// Lets the queue threads and the presenting thread wait on each other at the start and end of every frame.
+/// </summary>
+class frame_barrier
+{
+public:
+	explicit frame_barrier(unsigned int num_threads) : _num_threads(num_threads) {}
+
+	void arrive_and_wait()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		const unsigned int generation = _generation;
+		if (++_num_arrived == _num_threads)
+		{
+			_num_arrived = 0;
+			_generation++;
+			_condition.notify_all();
+		}
+		else
+		{
+			_condition.wait(lock, [this, generation]() { return _generation != generation; });
+		}
+	}
+
+private:
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	const unsigned int _num_threads;
+	unsigned int _num_arrived = 0;
+	unsigned int _generation = 0;
+};
+
+struct global_lock
+{
+	void execute(const command_list_tracker &list)
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+		device.merge(list);
+	}
+	void present()
+	{
+		device.reset();
+	}
+
+	std::mutex mutex;
+	command_list_tracker device;
+};
+
+struct per_thread
+{
+	void execute(const command_list_tracker &list)
+	{
+		deferred.merge(list);
+	}
+	void present()
+	{
+		deferred.flush(device);
+		device.reset();
+	}
+
+	reshade::buffer_detection_accumulator<command_list_tracker> deferred;
+	command_list_tracker device;
+};
+
+template <typename T>
+static void run(const char *name, unsigned int num_threads, const std::vector<command_list_tracker> &command_lists, unsigned int num_frames)
+{
+	T *const method = new T();
+
+	frame_barrier barrier(num_threads + 1);
+	std::vector<std::thread> threads;
+	for (unsigned int t = 0; t < num_threads; ++t)
+	{
+		threads.emplace_back([&, t]() {
+			for (unsigned int frame = 0; frame < num_frames; ++frame)
+			{
+				barrier.arrive_and_wait();
+				// Every thread executes its share of the command lists, one at a time like separate ExecuteCommandLists calls
+				for (size_t i = t; i < command_lists.size(); i += num_threads)
+					method->execute(command_lists[i]);
+				barrier.arrive_and_wait();
+			}
+		});
+	}
+
+	uint64_t total_drawcalls = 0;
+	const double seconds = reshade::bench::measure(1, [&]() {
+		for (unsigned int frame = 0; frame < num_frames; ++frame)
+		{
+			barrier.arrive_and_wait();
+			barrier.arrive_and_wait();
+			method->present();
+		}
+	});
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Count what the last frame merged, to check that both methods end up with the same statistics
+	for (const command_list_tracker &list : command_lists)
+		method->execute(list);
+	if constexpr (std::is_same_v<T, per_thread>)
+		method->deferred.flush(method->device);
+	total_drawcalls = method->device.total_drawcalls();
+
+	delete method;
+
+	std::printf("%-12s %-8u %-14zu %14.3f %16llu\n", name, num_threads, command_lists.size(), seconds * 1e3 / num_frames, static_cast<unsigned long long>(total_drawcalls));
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+	const unsigned int num_frames = quick ? 5 : 500;
+
+	// Command lists that each render to a few of 24 depth-stencils
+	std::vector<command_list_tracker> command_lists(quick ? 64 : 1600);
+	for (size_t i = 0; i < command_lists.size(); ++i)
+	{
+		command_lists[i].record(0x1000 + (i % 24) * 0x40, 20);
+		command_lists[i].record(0x1000 + ((i * 7) % 24) * 0x40, 10);
+		command_lists[i].record(0, 5);
+	}
+
+	std::printf("%-12s %-8s %-14s %14s %16s\n", "", "threads", "command lists", "ms per frame", "draw calls/frame");
+
+	for (const unsigned int num_threads : { 1, 4, 8 })
+	{
+		run<global_lock>("global lock", num_threads, command_lists, num_frames);
+		run<per_thread>("per thread", num_threads, command_lists, num_frames);
+	}
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "buffer_detection_core.hpp"
+#include "buffer_detection_accumulator.hpp"
+#include <atomic>
+#include <thread>
+
+/// <summary>
+/// Tracker of a command list with fake handles, which inherits the bound depth-stencil on a merge like "reshade::d3d12::buffer_detection".
+/// </summary>
+class command_list_tracker : public reshade::buffer_detection_core<uint64_t>
+{
+public:
+	void reset()
+	{
+		reset_core();
+		_current_depthstencil = 0;
+	}
+
+	void merge(const command_list_tracker &source)
+	{
+		merge_core(source);
+
+		// Executing a command list in a different command list inherits state
+		_current_depthstencil = source._current_depthstencil;
+	}
+
+	void record(uint64_t depthstencil, uint32_t num_draws)
+	{
+		set_current_depthstencil(depthstencil);
+		for (uint32_t i = 0; i < num_draws; ++i)
+		{
+			count_draw(100);
+			count_draw_current(100);
+		}
+	}
+
+	uint32_t drawcalls_of(uint64_t depthstencil) const
+	{
+		const depthstencil_info *const info = _counters_per_used_depthstencil.find(depthstencil);
+		return info != nullptr ? info->total_stats.drawcalls : 0;
+	}
+};
+
+using accumulator = reshade::buffer_detection_accumulator<command_list_tracker>;
+
+TEST_CASE(last_executed_command_list_wins)
+{
+	accumulator deferred;
+	command_list_tracker device;
+
+	command_list_tracker list_a, list_b, list_c;
+	list_a.record(0xa, 1);
+	list_b.record(0xb, 1);
+	list_c.record(0xc, 1);
+
+	std::atomic<int> step = 0;
+
+	// A second queue thread executes the first command list, then the main thread one, and then the second queue thread executes another one
+	// So the second thread gets its tracker first, but also executes the last command list of the frame
+	std::thread queue_thread([&]() {
+		deferred.merge(list_a);
+		step = 1;
+		while (step != 2)
+			std::this_thread::yield();
+		deferred.merge(list_c);
+	});
+
+	while (step != 1)
+		std::this_thread::yield();
+	deferred.merge(list_b);
+	step = 2;
+	queue_thread.join();
+
+	deferred.flush(device);
+
+	CHECK(device.current_depthstencil() == 0xc);
+	CHECK(device.total_drawcalls() == 3);
+	CHECK(device.drawcalls_of(0xa) == 1 && device.drawcalls_of(0xb) == 1 && device.drawcalls_of(0xc) == 1);
+
+	// The next frame in the opposite order
+	device.reset();
+	std::thread([&]() { deferred.merge(list_a); }).join();
+	deferred.merge(list_b);
+	deferred.flush(device);
+	CHECK(device.current_depthstencil() == 0xb);
+}
+
+TEST_CASE(threads_that_exited_are_removed)
+{
+	accumulator deferred;
+	command_list_tracker device;
+
+	command_list_tracker list;
+	list.record(0xd, 10);
+
+	deferred.merge(list);
+
+	// Engines often execute command lists from short lived task threads
+	for (int i = 0; i < 8; ++i)
+		std::thread([&]() { deferred.merge(list); }).join();
+	CHECK(deferred.num_threads() == 9);
+
+	// Statistics of threads that exited are still merged before their tracker is dropped
+	deferred.flush(device);
+	CHECK(device.total_drawcalls() == 9 * 10);
+	CHECK(deferred.num_threads() == 1);
+
+	// The thread that is still alive keeps its tracker, and can continue to use it through its cache
+	device.reset();
+	deferred.merge(list);
+	CHECK(deferred.num_threads() == 1);
+	deferred.flush(device);
+	CHECK(device.total_drawcalls() == 10);
+}
+
+TEST_CASE(clear_drops_pending_statistics)
+{
+	accumulator deferred;
+	command_list_tracker device;
+
+	command_list_tracker list;
+	list.record(0xe, 5);
+	deferred.merge(list);
+
+	deferred.clear();
+	deferred.flush(device);
+	CHECK(device.total_drawcalls() == 0);
+}
+
+TEST_CASE(concurrent_merge_and_flush)
+{
+	accumulator deferred;
+	command_list_tracker device;
+
+	const int num_threads = 8;
+	const int num_lists = 2000;
+
+	std::atomic<int> num_running = num_threads;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads.emplace_back([&deferred, &num_running, t]() {
+			command_list_tracker list;
+			list.record(0x100 + t % 3, 2);
+
+			for (int i = 0; i < num_lists; ++i)
+				deferred.merge(list);
+
+			num_running--;
+		});
+	}
+
+	// Present repeatedly while the other threads keep executing command lists, which must not lose or duplicate any
+	uint32_t total_drawcalls = 0;
+	while (num_running != 0)
+	{
+		deferred.flush(device);
+		total_drawcalls += device.total_drawcalls();
+		device.reset();
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	deferred.flush(device);
+	total_drawcalls += device.total_drawcalls();
+
+	CHECK(total_drawcalls == uint32_t(num_threads) * num_lists * 2);
+	CHECK(deferred.num_threads() == 0);
+}
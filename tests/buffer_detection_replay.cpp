@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Replays a depth buffer detection trace (recorded with the "Record trace" button in the "Depth Buffers" section of the overlay), to see how the heuristics in this tree decide on it
+// Usage: buffer_detection_replay [path/to/trace] [--quick]
+// Prints the depth-stencil chosen in every frame by the heuristics at the time of recording, the ones in this tree and the ones from before they were shared between the backends, followed by how fast events are processed
+
+#include "bench.hpp"
+#include "buffer_detection_replay.hpp"
+
+using reshade::test::replayed_frame;
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+
+	std::filesystem::path path = RESHADE_TEST_DATA_DIR "/buffer_detection_reference.trace";
+	for (int i = 1; i < argc; ++i)
+		if (argv[i][0] != '-')
+			path = argv[i];
+
+	std::vector<reshade::trace_event> events;
+	std::ifstream file(path);
+	if (std::string errors; !file || !reshade::read_buffer_detection_trace(file, events, errors))
+	{
+		std::fprintf(stderr, "Failed to read trace '%s': %s\n", path.u8string().c_str(), file ? errors.c_str() : "could not open file");
+		return 1;
+	}
+
+	const std::vector<replayed_frame> frames = reshade::test::buffer_detection_replay().run(events);
+
+	std::printf("%-6s %18s %18s %18s\n", "frame", "recorded", "current", "legacy");
+	for (size_t i = 0; i < frames.size(); ++i)
+		std::printf("%-6zu %18llx %18llx %18llx%s\n", i,
+			static_cast<unsigned long long>(frames[i].recorded),
+			static_cast<unsigned long long>(frames[i].current),
+			static_cast<unsigned long long>(frames[i].legacy),
+			frames[i].current != frames[i].recorded ? "  <- differs from recording" : "");
+
+	size_t num_frames_different = 0;
+	for (const replayed_frame &frame : frames)
+		if (frame.current != frame.recorded)
+			num_frames_different++;
+
+	std::printf("\n%zu events in %zu frames, %zu frames differ from the recording\n", events.size(), frames.size(), num_frames_different);
+	std::printf("selection changes: %u recorded, %u current, %u legacy\n",
+		reshade::test::count_selection_changes(frames, &replayed_frame::recorded),
+		reshade::test::count_selection_changes(frames, &replayed_frame::current),
+		reshade::test::count_selection_changes(frames, &replayed_frame::legacy));
+
+	// Replay the whole trace a number of times to get the cost per event, which includes the legacy selection, so this is an upper bound
+	const unsigned int repetitions = quick ? 1 : 20;
+	const double seconds = reshade::bench::measure(repetitions, [&events]() {
+		reshade::bench::do_not_optimize(reshade::test::buffer_detection_replay().run(events));
+	});
+
+	std::printf("%.1f million events/s (%.1f ns per event, best of %u runs)\n", events.size() / seconds * 1e-6, seconds * 1e9 / events.size(), repetitions);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "buffer_detection_core.hpp"
+#include <algorithm>
+
+namespace reshade::test
+{
+	/// <summary>
+	/// The depth-stencils that were selected in a frame of a replayed trace (zero if there was none).
+	/// </summary>
+	struct replayed_frame
+	{
+		// Selection at the time the trace was recorded
+		uint64_t recorded = 0;
+		// Selection of the heuristics in this tree
+		uint64_t current = 0;
+		// Selection of the heuristics before they were shared between the backends, which looked at every frame in isolation
+		uint64_t legacy = 0;
+	};
+
+	/// <summary>
+	/// Replays a trace written by <see cref="buffer_detection_trace"/> into the depth buffer detection core, with the handles in the trace standing in for the resources.
+	/// </summary>
+	class buffer_detection_replay : public buffer_detection_core<uint64_t>
+	{
+	public:
+		/// <summary>
+		/// Replays the specified events and returns the selections of every frame in them.
+		/// </summary>
+		std::vector<replayed_frame> run(const std::vector<trace_event> &events)
+		{
+			std::vector<replayed_frame> frames;
+
+			for (size_t i = 0; i < events.size(); ++i)
+			{
+				const trace_event &event = events[i];
+
+				switch (event.type)
+				{
+				case trace_event_type::reset:
+					reset_core();
+					break;
+				case trace_event_type::reset_stats:
+					reset_core_stats();
+					break;
+				case trace_event_type::set:
+					set_current_depthstencil(event.handle);
+					break;
+				case trace_event_type::draw:
+					count_draw(event.args[0]);
+					break;
+				case trace_event_type::draw_current:
+					count_draw_current(event.args[0], event.args[1] != 0);
+					break;
+				case trace_event_type::draw_to:
+					count_draw(event.handle, event.args[0], event.args[1] != 0);
+					break;
+				case trace_event_type::clear:
+				{
+					// Backends may adjust the statistics right before a clear (e.g. for clears done with a fullscreen draw call), so use the ones that were recorded
+					depthstencil_info &counters = _counters_per_used_depthstencil[event.handle];
+					counters.current_stats.vertices = event.args[0];
+					counters.current_stats.drawcalls = event.args[1];
+					count_clear(event.handle, counters);
+					counters.current_stats = { 0, 0 };
+					break;
+				}
+				case trace_event_type::merge_totals:
+					merge_core(draw_stats { event.args[0], event.args[1] }, event.args[2] != 0);
+					break;
+				case trace_event_type::merge:
+				{
+					depthstencil_info snapshot;
+					snapshot.total_stats = { event.args[0], event.args[1] };
+					snapshot.current_stats = { event.args[2], event.args[3] };
+					merge_core(event.handle, snapshot);
+					break;
+				}
+				case trace_event_type::select:
+				{
+					// The descriptions of the candidates follow the selection, up to its result
+					const size_t desc_begin = i + 1;
+					size_t desc_end = desc_begin;
+					while (desc_end < events.size() && events[desc_end].type != trace_event_type::selected)
+						desc_end++;
+
+					const auto describe = [&events, desc_begin, desc_end](uint64_t handle, const depthstencil_info &, depthstencil_desc &desc) {
+						for (size_t k = desc_begin; k < desc_end; ++k)
+						{
+							if (events[k].handle != handle)
+								continue;
+							if (events[k].type != trace_event_type::desc)
+								return false;
+							desc = { events[k].args[0], events[k].args[1], events[k].args[2] };
+							return true;
+						}
+						// This depth-stencil was not a candidate when the trace was recorded, so there is nothing known about it
+						return false;
+					};
+
+					const auto selection = static_cast<depthstencil_selection>(event.args[2]);
+
+					replayed_frame &frame = frames.emplace_back();
+					frame.recorded = desc_end < events.size() ? events[desc_end].handle : 0;
+					frame.legacy = select_legacy(event.args[0], event.args[1], selection, describe);
+					const auto best = select_best(event.args[0], event.args[1], selection, describe);
+					frame.current = best != nullptr ? best->first : 0;
+
+					i = desc_end;
+					break;
+				}
+				default:
+					// Descriptions are only expected right after a selection, which consumes them
+					break;
+				}
+			}
+
+			return frames;
+		}
+
+	private:
+		template <typename F>
+		uint64_t select_legacy(uint32_t width, uint32_t height, depthstencil_selection selection, F describe) const
+		{
+			// Depth-stencils used to be kept in a "std::map", so they were visited in the order of their handles
+			std::vector<const std::pair<uint64_t, depthstencil_info> *> candidates;
+			for (const auto &entry : _counters_per_used_depthstencil)
+				candidates.push_back(&entry);
+			std::sort(candidates.begin(), candidates.end(),
+				[](const auto *lhs, const auto *rhs) { return lhs->first < rhs->first; });
+
+			uint64_t best = 0;
+			draw_stats best_stats;
+
+			for (const auto *const entry : candidates)
+			{
+				const draw_stats &stats = entry->second.total_stats;
+				if (stats.drawcalls == 0 || (selection == depthstencil_selection::weighted_vertices && stats.vertices == 0))
+					continue;
+
+				depthstencil_desc desc;
+				if (!describe(entry->first, entry->second, desc))
+					continue;
+				if (desc.samples > 1)
+					continue;
+				if (width != 0 && height != 0 && !check_depthstencil_fit(width, height, desc.width, desc.height))
+					continue;
+
+				bool is_better;
+				if (selection == depthstencil_selection::weighted_vertices)
+				{
+					// The weight of the best candidate was divided by the total number of vertices instead of draw calls, so it was nearly always just its number of vertices times 1.2
+					const float curr_weight = stats.vertices * (1.2f - static_cast<float>(stats.drawcalls) / _stats.drawcalls);
+					const float best_weight = best_stats.vertices * (1.2f - static_cast<float>(best_stats.drawcalls) / _stats.vertices);
+					is_better = curr_weight >= best_weight;
+				}
+				else
+				{
+					is_better = !_has_indirect_drawcalls ? stats.vertices > best_stats.vertices : stats.drawcalls > best_stats.drawcalls;
+				}
+
+				if (is_better)
+				{
+					best = entry->first;
+					best_stats = stats;
+				}
+			}
+
+			return best;
+		}
+	};
+
+	/// <summary>
+	/// Returns how often the selection changed from one frame to the next, which is how often the runtime had to recreate the resources it binds the depth-stencil to.
+	/// </summary>
+	inline unsigned int count_selection_changes(const std::vector<replayed_frame> &frames, uint64_t replayed_frame::*member)
+	{
+		unsigned int changes = 0;
+		for (size_t i = 1; i < frames.size(); ++i)
+			if (frames[i].*member != frames[i - 1].*member)
+				changes++;
+		return changes;
+	}
+}
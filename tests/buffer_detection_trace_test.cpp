@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "buffer_detection_replay.hpp"
+#include <random>
+#include <sstream>
+
+using reshade::depthstencil_desc;
+using reshade::depthstencil_selection;
+using reshade::trace_event;
+using reshade::trace_event_type;
+using reshade::test::replayed_frame;
+
+// The depth-stencils of the synthetic scene, which renders at 1920x1080
+static const uint64_t s_shadow_map = 0x1a00; // 2048x2048, which does not fit the aspect ratio of the frame
+static const uint64_t s_first_person = 0x2b00; // A first person view with few but detailed models, that comes close to the main scene in some frames
+static const uint64_t s_main_scene = 0x3c00;
+static const uint64_t s_particles = 0x4d00; // Half resolution, which is too small
+static const uint64_t s_msaa = 0x5e00; // Multisampled, which cannot be used without a resolve
+static const uint64_t s_released = 0x6f00; // Released by the application before the end of the frame, so it cannot be described anymore
+static const uint64_t s_main_scene_resized = 0x7a00; // The main scene depth-stencil after the application recreated it
+
+// The frame in which the application recreates its main scene depth-stencil
+static const uint32_t s_resize_frame = 40;
+
+/// <summary>
+/// A deterministic workload that drives the depth buffer detection like a backend would, using all the events a trace can contain.
+/// </summary>
+class synthetic_scene : public reshade::buffer_detection_core<uint64_t>
+{
+public:
+	uint64_t run_frame(uint32_t frame)
+	{
+		reset_core();
+
+		// Two shadow cascades rendered to the same depth-stencil without binding it as the current one (like the D3D9 backend counts draws to its replacement surface), with a clear in between
+		for (int cascade = 0; cascade < 2; ++cascade)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				const uint32_t vertices = random(1500, 2500);
+				count_draw(vertices);
+				count_draw(s_shadow_map, vertices);
+			}
+
+			depthstencil_info &counters = _counters_per_used_depthstencil[s_shadow_map];
+			count_clear(s_shadow_map, counters);
+			counters.current_stats = { 0, 0 };
+		}
+
+		const uint64_t main_scene = frame < s_resize_frame ? s_main_scene : s_main_scene_resized;
+		draw_pass(main_scene, 16, 6000, 12000);
+		// The first person view only appears after the intro
+		if (frame >= 5)
+			draw_pass(s_first_person, 4, 15000, 35000);
+		draw_pass(s_particles, 4, 500, 4000);
+		draw_pass(s_msaa, 3, 20000, 60000);
+		if (frame % 3 == 0)
+			draw_pass(s_released, 2, 1000, 2000);
+
+		// User interface, which is drawn without a depth-stencil
+		set_current_depthstencil(0);
+		for (int i = 0; i < 6; ++i)
+		{
+			count_draw(random(6, 600));
+			count_draw_current(6);
+		}
+
+		// More of the main scene, which was drawn by a command list recorded on another thread
+		synthetic_scene command_list;
+		command_list.draw_pass(main_scene, 8, 3000, 5000);
+		merge_core(command_list);
+
+		const auto best = select_best(1920, 1080, depthstencil_selection::weighted_vertices, describe);
+		return best != nullptr ? best->first : 0;
+	}
+
+	static bool describe(uint64_t handle, const depthstencil_info &, depthstencil_desc &desc)
+	{
+		switch (handle)
+		{
+		case s_shadow_map:
+			desc = { 2048, 2048, 1 };
+			return true;
+		case s_particles:
+			desc = { 960, 540, 1 };
+			return true;
+		case s_msaa:
+			desc = { 1920, 1080, 4 };
+			return true;
+		case s_released:
+			return false;
+		default:
+			desc = { 1920, 1080, 1 };
+			return true;
+		}
+	}
+
+private:
+	void draw_pass(uint64_t depthstencil, int num_draws, uint32_t min_vertices, uint32_t max_vertices)
+	{
+		set_current_depthstencil(depthstencil);
+		for (int i = 0; i < num_draws; ++i)
+		{
+			const uint32_t vertices = random(min_vertices, max_vertices);
+			count_draw(vertices);
+			count_draw_current(vertices);
+		}
+	}
+
+	uint32_t random(uint32_t min, uint32_t max)
+	{
+		return std::uniform_int_distribution<uint32_t>(min, max)(_rng);
+	}
+
+	std::mt19937 _rng;
+};
+
+static std::vector<trace_event> read_trace(const std::filesystem::path &path)
+{
+	std::vector<trace_event> events;
+	std::ifstream file(path);
+	std::string errors;
+	if (!reshade::read_buffer_detection_trace(file, events, errors))
+		std::fprintf(stderr, "%s\n", errors.c_str());
+	return events;
+}
+
+TEST_CASE(record_and_replay)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_buffer_detection_trace_test.trace";
+
+	std::vector<uint64_t> selections;
+	{
+		synthetic_scene scene;
+		REQUIRE(scene.start_trace(path, 20));
+		CHECK(scene.is_tracing());
+
+		// Recording stops on its own after the requested number of frames
+		for (uint32_t frame = 0; frame < 25; ++frame)
+			selections.push_back(scene.run_frame(frame));
+		CHECK(!scene.is_tracing());
+	}
+
+	const std::vector<trace_event> events = read_trace(path);
+	std::filesystem::remove(path);
+	REQUIRE(!events.empty());
+
+	const auto count_events = [&events](trace_event_type type) {
+		return std::count_if(events.begin(), events.end(), [type](const trace_event &event) { return event.type == type; });
+	};
+	CHECK(count_events(trace_event_type::reset) == 20);
+	CHECK(count_events(trace_event_type::select) == 20);
+	CHECK(count_events(trace_event_type::selected) == 20);
+	CHECK(count_events(trace_event_type::clear) == 2 * 20);
+	CHECK(count_events(trace_event_type::merge_totals) == 20);
+	CHECK(count_events(trace_event_type::skip) == 7);
+	CHECK(count_events(trace_event_type::draw_to) == 6 * 20);
+
+	reshade::test::buffer_detection_replay replay;
+	const std::vector<replayed_frame> frames = replay.run(events);
+	REQUIRE(frames.size() == 20);
+
+	// Replaying the trace makes the same decisions as the live detection did
+	for (uint32_t frame = 0; frame < 20; ++frame)
+	{
+		CHECK(frames[frame].recorded == selections[frame]);
+		CHECK(frames[frame].current == frames[frame].recorded);
+	}
+}
+
+TEST_CASE(reference_trace)
+{
+	const std::vector<trace_event> events = read_trace(RESHADE_TEST_DATA_DIR "/buffer_detection_reference.trace");
+	REQUIRE(!events.empty());
+
+	reshade::test::buffer_detection_replay replay;
+	const std::vector<replayed_frame> frames = replay.run(events);
+	REQUIRE(frames.size() == 60);
+
+	unsigned int num_frames_different = 0;
+	for (uint32_t frame = 0; frame < frames.size(); ++frame)
+	{
+		// The reference trace was recorded with the heuristics in this tree, so a different result here means they changed
+		CHECK(frames[frame].current == frames[frame].recorded);
+		CHECK(frames[frame].current == (frame < s_resize_frame ? s_main_scene : s_main_scene_resized));
+
+		if (frames[frame].legacy != frames[frame].current)
+			num_frames_different++;
+	}
+
+	const unsigned int current_changes = reshade::test::count_selection_changes(frames, &replayed_frame::current);
+	const unsigned int legacy_changes = reshade::test::count_selection_changes(frames, &replayed_frame::legacy);
+
+	std::printf("selection changes in %zu frames: %u before, %u now (%u frames with a different selection)\n", frames.size(), legacy_changes, current_changes, num_frames_different);
+
+	// The only change is the switch to the recreated depth-stencil, while the old heuristics flip between the main scene and the first person view
+	CHECK(current_changes == 1);
+	CHECK(legacy_changes > 10);
+}
+
+TEST_CASE(invalid_trace)
+{
+	const auto parse = [](const char *text, std::string &errors) {
+		std::istringstream stream(text);
+		std::vector<trace_event> events;
+		return reshade::read_buffer_detection_trace(stream, events, errors);
+	};
+
+	std::string errors;
+	CHECK(parse("# ReShade depth buffer detection trace 1\r\nreset\r\n# comment\r\n\r\nset 1a00\r\nselected 0\r\n", errors));
+
+	CHECK(!parse("reset\n", errors));
+	CHECK(errors == "line 1: not a trace of a supported version");
+	CHECK(!parse("# ReShade depth buffer detection trace 1\nreset\nbogus 1\n", errors));
+	CHECK(errors == "line 3: unknown event 'bogus'");
+	CHECK(!parse("# ReShade depth buffer detection trace 1\ndraw_to 1a00 300\n", errors));
+	CHECK(errors == "line 2: invalid arguments for event 'draw_to'");
+	CHECK(!parse("# ReShade depth buffer detection trace 1\ndraw 300 1\n", errors));
+	CHECK(errors == "line 2: invalid arguments for event 'draw'");
+}
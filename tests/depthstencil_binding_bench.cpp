@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "fake_device_context.hpp"
+
+// Replays a stream of draw calls and render target changes like a D3D11 application submits them, through the depth buffer detection that queries the bound depth-stencil on every draw call against the one that remembers it when it is bound
+// The fake device context only counts calls, so the time here is the cost of the virtual calls and reference counting alone (real drivers take a lock in some of these calls too)
+
+using namespace reshade::test;
+
+template <typename TTracker>
+static void run(const char *name, const std::vector<command> &commands, unsigned int repetitions)
+{
+	fake_device_context device_context(12, 3);
+	TTracker tracker(device_context);
+
+	size_t num_draws = 0;
+	for (const command &command : commands)
+		num_draws += command.type == command::draw;
+
+	const double seconds = reshade::bench::measure(repetitions, [&]() {
+		for (const command &command : commands)
+			apply_command(command, device_context, tracker);
+		reshade::bench::do_not_optimize(tracker.total_vertices());
+	});
+
+	const double num_runs = static_cast<double>(repetitions);
+	std::printf("%-8s %12.2f %16.2f %18.2f\n", name, seconds * 1e9 / num_draws,
+		device_context.counters.calls / num_runs / num_draws,
+		device_context.counters.refcount_operations / num_runs / num_draws);
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+	const unsigned int repetitions = quick ? 1 : 5;
+
+	// Frames of 4000 commands, which is around 3500 draw calls
+	const std::vector<command> commands = generate_commands(1, quick ? 40000 : 4000000, 12 * 3, 4000);
+
+	std::printf("%-8s %12s %16s %18s\n", "", "ns per draw", "API calls/draw", "AddRef+Release/draw");
+	run<queried_tracker>("queried", commands, repetitions);
+	run<cached_tracker>("cached", commands, repetitions);
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "fake_device_context.hpp"
+
+using namespace reshade::test;
+
+template <typename TTracker>
+static uint32_t drawcalls_of(const TTracker &tracker, uint64_t depthstencil)
+{
+	for (const auto &[handle, snapshot] : tracker.depth_buffer_counters())
+		if (handle == depthstencil)
+			return snapshot.total_stats.drawcalls;
+	return 0;
+}
+
+TEST_CASE(binding_is_remembered)
+{
+	fake_device_context device_context(2, 2);
+	cached_tracker tracker(device_context);
+
+	const uint64_t texture_0 = 0x10000;
+	const uint64_t texture_1 = 0x10100;
+
+	// Different views of the same texture count toward the same depth-stencil
+	apply_command({ command::set_render_targets, 0 }, device_context, tracker);
+	CHECK(tracker.current_depthstencil() == texture_0);
+	apply_command({ command::draw, 300 }, device_context, tracker);
+	apply_command({ command::set_render_targets, 1 }, device_context, tracker);
+	apply_command({ command::draw, 300 }, device_context, tracker);
+	CHECK(drawcalls_of(tracker, texture_0) == 2);
+
+	// Binding only unordered access views keeps the depth-stencil
+	apply_command({ command::set_render_targets, 2 }, device_context, tracker);
+	apply_command({ command::set_unordered_access_views, 0 }, device_context, tracker);
+	apply_command({ command::draw, 300 }, device_context, tracker);
+	CHECK(drawcalls_of(tracker, texture_1) == 1);
+
+	// Executing a command list without restoring the state unbinds it, just like clearing the state
+	apply_command({ command::execute_command_list, 1 }, device_context, tracker);
+	CHECK(tracker.current_depthstencil() == texture_1);
+	apply_command({ command::execute_command_list, 0 }, device_context, tracker);
+	CHECK(tracker.current_depthstencil() == 0);
+	apply_command({ command::draw, 300 }, device_context, tracker);
+	CHECK(drawcalls_of(tracker, texture_1) == 1);
+	CHECK(tracker.total_drawcalls() == 4);
+
+	apply_command({ command::set_render_targets, 3 }, device_context, tracker);
+	apply_command({ command::clear_state, 0 }, device_context, tracker);
+	CHECK(tracker.current_depthstencil() == 0);
+
+	// The binding survives the end of a frame, since the device context still has it bound
+	apply_command({ command::set_render_targets, 0 }, device_context, tracker);
+	apply_command({ command::present, 0 }, device_context, tracker);
+	CHECK(tracker.current_depthstencil() == texture_0);
+	CHECK(tracker.total_drawcalls() == 0);
+}
+
+TEST_CASE(same_statistics_as_querying_every_draw)
+{
+	fake_device_context device_context(12, 3);
+	queried_tracker queried(device_context);
+	cached_tracker cached(device_context);
+
+	const std::vector<command> commands = generate_commands(0, 800000, device_context.num_views(), 4000);
+
+	size_t num_draws = 0;
+	size_t num_binds = 0;
+	api_call_counters queried_calls, cached_calls;
+
+	for (const command &command : commands)
+	{
+		if (command.type == command::present)
+		{
+			// Both have to have seen exactly the same draw calls to every depth-stencil in the frame, in the same order
+			REQUIRE(queried.total_vertices() == cached.total_vertices() && queried.total_drawcalls() == cached.total_drawcalls());
+			REQUIRE(queried.depth_buffer_counters().size() == cached.depth_buffer_counters().size());
+			for (auto queried_it = queried.depth_buffer_counters().begin(), cached_it = cached.depth_buffer_counters().begin(); queried_it != queried.depth_buffer_counters().end(); ++queried_it, ++cached_it)
+			{
+				REQUIRE(queried_it->first == cached_it->first);
+				REQUIRE(queried_it->second.total_stats.vertices == cached_it->second.total_stats.vertices);
+				REQUIRE(queried_it->second.total_stats.drawcalls == cached_it->second.total_stats.drawcalls);
+				REQUIRE(queried_it->second.current_stats.drawcalls == cached_it->second.current_stats.drawcalls);
+			}
+		}
+
+		num_draws += command.type == command::draw;
+		num_binds += command.type == command::set_render_targets;
+
+		// The device context is shared, so attribute the calls by looking at the counters before and after
+		api_call_counters before = device_context.counters;
+		apply_command(command, device_context, queried);
+		queried_calls.calls += device_context.counters.calls - before.calls;
+		queried_calls.refcount_operations += device_context.counters.refcount_operations - before.refcount_operations;
+
+		before = device_context.counters;
+		apply_command(command, device_context, cached);
+		cached_calls.calls += device_context.counters.calls - before.calls;
+		cached_calls.refcount_operations += device_context.counters.refcount_operations - before.refcount_operations;
+	}
+
+	std::printf("API calls per draw call: %.2f before, %.2f now (%.2f and %.2f reference count operations, %.1f draw calls per bind)\n",
+		double(queried_calls.calls) / num_draws, double(cached_calls.calls) / num_draws,
+		double(queried_calls.refcount_operations) / num_draws, double(cached_calls.refcount_operations) / num_draws,
+		double(num_draws) / num_binds);
+
+	// Binding a view costs two calls (GetResource and QueryInterface), while draw calls do not call into the device context anymore
+	CHECK(cached_calls.calls <= 2 * num_binds);
+	CHECK(queried_calls.calls > 2 * num_draws);
+}
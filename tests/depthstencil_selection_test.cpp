@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "buffer_detection_replay.hpp"
+#include <random>
+
+using reshade::depthstencil_desc;
+using reshade::depthstencil_selection;
+using reshade::trace_event;
+using reshade::trace_event_type;
+using reshade::test::replayed_frame;
+
+using core = reshade::buffer_detection_core<uint64_t>;
+
+static const uint64_t s_a = 0xa00;
+static const uint64_t s_b = 0xb00;
+static const uint64_t s_c = 0xc00;
+
+/// <summary>
+/// Tracker with fake handles, that renders one draw call per depth-stencil and frame, so that the score of a depth-stencil is just the number of vertices it received.
+/// </summary>
+class selection_tracker : public core
+{
+public:
+	uint64_t frame(std::initializer_list<std::pair<uint64_t, uint32_t>> vertices_per_depthstencil, uint64_t multisampled = 0)
+	{
+		reset_core();
+
+		for (const auto &[depthstencil, vertices] : vertices_per_depthstencil)
+		{
+			count_draw(vertices);
+			count_draw(depthstencil, vertices);
+		}
+
+		const auto best = select_best(1920, 1080, depthstencil_selection::most_vertices,
+			[multisampled](uint64_t depthstencil, const depthstencil_info &, depthstencil_desc &desc) {
+				desc = { 1920, 1080, depthstencil == multisampled ? 4u : 1u };
+				return true;
+			});
+		return best != nullptr ? best->first : 0;
+	}
+};
+
+TEST_CASE(small_differences_do_not_switch)
+{
+	selection_tracker tracker;
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 900 } }) == s_a);
+
+	// Ten percent is within the margin, no matter how long it lasts
+	for (int frame = 0; frame < 100; ++frame)
+		CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 1100 } }) == s_a);
+}
+
+TEST_CASE(switch_after_a_number_of_frames)
+{
+	selection_tracker tracker;
+	for (int frame = 0; frame < 20; ++frame)
+		tracker.frame({ { s_a, 1000 }, { s_b, 500 } });
+
+	// Another depth-stencil has to be better for a number of frames in a row
+	for (uint32_t frame = 0; frame < core::selection_switch_frames - 1; ++frame)
+		CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 3000 } }) == s_a);
+
+	// Not being used for a frame interrupts that
+	CHECK(tracker.frame({ { s_a, 1000 } }) == s_a);
+	for (uint32_t frame = 0; frame < core::selection_switch_frames - 1; ++frame)
+		CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 3000 } }) == s_a);
+
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 3000 } }) == s_b);
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 3000 } }) == s_b);
+}
+
+TEST_CASE(switch_right_away_when_selection_is_unusable)
+{
+	selection_tracker tracker;
+	for (int frame = 0; frame < 20; ++frame)
+		tracker.frame({ { s_a, 1000 }, { s_b, 900 } });
+
+	// Not used in this frame
+	CHECK(tracker.frame({ { s_b, 900 } }) == s_b);
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 900 } }) == s_b);
+
+	// Not a candidate anymore (e.g. because the application recreated it with multisampling at the same address)
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 900 } }, s_b) == s_a);
+
+	// No candidates at all
+	CHECK(tracker.frame({}) == 0);
+	CHECK(tracker.frame({ { s_b, 900 } }) == s_b);
+}
+
+TEST_CASE(recreated_depthstencil_starts_with_its_score)
+{
+	selection_tracker tracker;
+	for (int frame = 0; frame < 50; ++frame)
+		CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 900 } }) == s_a);
+
+	// The application recreates the main depth-stencil (e.g. after a resize), which should not lose against one it was ahead of before
+	for (int frame = 0; frame < 50; ++frame)
+		CHECK(tracker.frame({ { s_c, 1000 }, { s_b, 900 } }) == s_c);
+}
+
+TEST_CASE(reset_selection_starts_from_scratch)
+{
+	selection_tracker tracker;
+	for (int frame = 0; frame < 20; ++frame)
+		tracker.frame({ { s_a, 1000 }, { s_b, 900 } });
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 1100 } }) == s_a);
+
+	tracker.reset_selection();
+	CHECK(tracker.frame({ { s_a, 1000 }, { s_b, 1100 } }) == s_b);
+}
+
+/// <summary>
+/// Appends the events of a frame to a trace, in which every depth-stencil receives a single draw call and fits a 1920x1080 frame.
+/// </summary>
+static void append_frame(std::vector<trace_event> &events, const std::vector<std::pair<uint64_t, uint32_t>> &vertices_per_depthstencil, depthstencil_selection selection)
+{
+	events.push_back({ trace_event_type::reset });
+	for (const auto &[depthstencil, vertices] : vertices_per_depthstencil)
+	{
+		events.push_back({ trace_event_type::draw, { vertices } });
+		events.push_back({ trace_event_type::draw_to, { vertices, 1 }, depthstencil });
+	}
+
+	events.push_back({ trace_event_type::select, { 1920, 1080, static_cast<uint32_t>(selection) } });
+	for (const auto &[depthstencil, vertices] : vertices_per_depthstencil)
+		events.push_back({ trace_event_type::desc, { 1920, 1080, 1 }, depthstencil });
+	// What was selected is not known for a synthetic trace
+	events.push_back({ trace_event_type::selected });
+}
+
+TEST_CASE(similar_workloads_do_not_cause_reallocations)
+{
+	for (const depthstencil_selection selection : { depthstencil_selection::weighted_vertices, depthstencil_selection::most_vertices })
+	{
+		std::mt19937 rng(0);
+		const auto noisy = [&rng](uint32_t vertices) { return vertices * 9 / 10 + static_cast<uint32_t>(rng() % (vertices / 5)); };
+
+		// Two depth-stencils with the same number of draw calls and noisy vertex counts that differ by a few percent on average, over a minute at 60 frames per second
+		std::vector<trace_event> events;
+		for (int frame = 0; frame < 3600; ++frame)
+			append_frame(events, { { s_a, noisy(100000) }, { s_b, noisy(103000) } }, selection);
+
+		const std::vector<replayed_frame> frames = reshade::test::buffer_detection_replay().run(events);
+		REQUIRE(frames.size() == 3600);
+
+		// Every change of the selection makes the runtime recreate the resources it copies the depth-stencil to and update the descriptors that reference it
+		const unsigned int legacy_reallocations = reshade::test::count_selection_changes(frames, &replayed_frame::legacy);
+		const unsigned int current_reallocations = reshade::test::count_selection_changes(frames, &replayed_frame::current);
+
+		std::printf("%s: %u reallocations before, %u now, %d avoided in %zu frames\n", selection == depthstencil_selection::weighted_vertices ? "weighted vertices" : "most vertices",
+			legacy_reallocations, current_reallocations, static_cast<int>(legacy_reallocations) - static_cast<int>(current_reallocations), frames.size());
+
+		CHECK(current_reallocations == 0);
+		// The weighted heuristic used to favor the depth-stencil it visited first (see 'select_legacy'), which kept it stable in this case too, but for the wrong reason
+		if (selection == depthstencil_selection::most_vertices)
+			CHECK(legacy_reallocations > 1000);
+	}
+}
+
+TEST_CASE(scene_changes_are_followed)
+{
+	std::vector<trace_event> events;
+	for (int frame = 0; frame < 300; ++frame)
+		append_frame(events, { { s_a, 10000 }, { s_b, 5000 } }, depthstencil_selection::most_vertices);
+	// The scene changes and renders most to the other depth-stencil from now on
+	for (int frame = 0; frame < 300; ++frame)
+		append_frame(events, { { s_a, 10000 }, { s_b, 20000 } }, depthstencil_selection::most_vertices);
+
+	const std::vector<replayed_frame> frames = reshade::test::buffer_detection_replay().run(events);
+	REQUIRE(frames.size() == 600);
+
+	CHECK(frames.front().current == s_a && frames.back().current == s_b);
+	CHECK(reshade::test::count_selection_changes(frames, &replayed_frame::current) == 1);
+
+	size_t switch_frame = 0;
+	while (switch_frame < frames.size() && frames[switch_frame].current == s_a)
+		switch_frame++;
+
+	std::printf("switched %zu frames after the scene changed\n", switch_frame - 300);
+
+	// It takes a frame or two until the smoothed score is far enough ahead, and then the switch frames to confirm it
+	CHECK(switch_frame >= 300 + core::selection_switch_frames - 1);
+	CHECK(switch_frame <= 300 + core::selection_switch_frames + 2);
+}
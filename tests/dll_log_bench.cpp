@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "dll_log.hpp"
+#include <thread>
+#include <vector>
+#include <Windows.h>
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+	const int num_messages = quick ? 100 : 50000;
+
+	reshade::log::open(std::filesystem::temp_directory_path() / "reshade_bench_log.log");
+
+	std::printf("%-8s %14s %12s %18s\n", "threads", "messages/s", "ns/message", "wakes/1k messages");
+
+	for (const int num_threads : { 1, 4, 16 })
+	{
+#ifndef _WIN32
+		const unsigned int num_waits_before = reshade::test::platform::num_waits;
+#endif
+
+		// All threads log as fast as they can, which is the worst case for contention between producers and with the writer thread
+		const double seconds = reshade::bench::measure(1, [num_threads, num_messages]() {
+			std::vector<std::thread> threads;
+			for (int t = 0; t < num_threads; ++t)
+				threads.emplace_back([t, num_messages]() {
+					for (int i = 0; i < num_messages; ++i)
+						LOG(INFO) << "thread " << t << " message " << i << " value " << 3.14 * i;
+				});
+			for (std::thread &thread : threads)
+				thread.join();
+		});
+
+		const double total_messages = double(num_threads) * num_messages;
+#ifndef _WIN32
+		const double wakes = 1000.0 * (reshade::test::platform::num_waits - num_waits_before) / total_messages;
+#else
+		const double wakes = 0.0;
+#endif
+		std::printf("%-8d %14.0f %12.1f %18.2f\n", num_threads, total_messages / seconds, seconds * 1e9 / total_messages, wakes);
+	}
+
+	reshade::log::stop_writer_thread();
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "dll_log.hpp"
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <Windows.h>
+
+static std::string read_file(const std::filesystem::path &path)
+{
+	std::stringstream contents;
+	contents << std::ifstream(path, std::ios::binary).rdbuf();
+	return contents.str();
+}
+
+/// <summary>
+/// Wait for the log file to contain the specified text, since it is written by the writer thread at some point after logging.
+/// </summary>
+static bool wait_for_file_contents(const std::filesystem::path &path, const std::string &text, std::chrono::milliseconds timeout)
+{
+	for (const auto start_time = std::chrono::steady_clock::now(); std::chrono::steady_clock::now() - start_time < timeout; std::this_thread::sleep_for(std::chrono::milliseconds(5)))
+		if (read_file(path).find(text) != std::string::npos)
+			return true;
+	return false;
+}
+
+static const std::filesystem::path s_log_path = std::filesystem::temp_directory_path() / "reshade_test_log.log";
+
+TEST_CASE(single_message_is_written)
+{
+	REQUIRE(reshade::log::open(s_log_path));
+
+	// Nothing else is logged afterwards, so the message has to reach the file without the writer thread being woken up again
+	LOG(INFO) << "single message";
+	CHECK(wait_for_file_contents(s_log_path, "single message", std::chrono::seconds(3)));
+}
+
+TEST_CASE(writer_sleeps_while_idle)
+{
+	LOG(INFO) << "before idle";
+	REQUIRE(wait_for_file_contents(s_log_path, "before idle", std::chrono::seconds(3)));
+	// Let the writer thread finish flushing
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+#ifndef _WIN32
+	// Only the stand-in for the Windows API counts how often the writer thread waited
+	const unsigned int num_waits_before = reshade::test::platform::num_waits;
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	CHECK(reshade::test::platform::num_waits == num_waits_before);
+#endif
+
+	// Errors are written out immediately
+	LOG(ERROR) << "after idle";
+	CHECK(wait_for_file_contents(s_log_path, "after idle", std::chrono::milliseconds(500)));
+}
+
+TEST_CASE(messages_from_many_threads)
+{
+	constexpr int num_threads = 16, num_messages = 2000;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; ++t)
+		threads.emplace_back([t]() {
+			for (int i = 0; i < num_messages; ++i)
+				LOG(INFO) << "thread " << t << " message " << i;
+		});
+	for (std::thread &thread : threads)
+		thread.join();
+
+	LOG(ERROR) << "all threads done";
+	REQUIRE(wait_for_file_contents(s_log_path, "all threads done", std::chrono::seconds(3)));
+
+	// Every message has to be there, and the ones of each thread in the order they were logged
+	const std::string contents = read_file(s_log_path);
+	for (int t = 0; t < num_threads; ++t)
+	{
+		size_t offset = 0;
+		for (int i = 0; i < num_messages; ++i)
+		{
+			const std::string text = "thread " + std::to_string(t) + " message " + std::to_string(i) + '\n';
+			offset = contents.find(text, offset);
+			REQUIRE(offset != std::string::npos);
+		}
+	}
+
+	reshade::log::stop_writer_thread();
+
+	// Messages are written by the logging thread itself after the writer thread was stopped
+	LOG(INFO) << "after stop";
+	CHECK(read_file(s_log_path).find("after stop") != std::string::npos);
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include <memory>
+#include <algorithm>
+
+using namespace reshadefx;
+
+static const char s_common_source[] = R"(
+texture BackBufferTex : COLOR; sampler BackBuffer { Texture = BackBufferTex; };
+texture TexA { Width = 64; Height = 64; Format = RGBA16F; }; sampler SamplerA { Texture = TexA; };
+texture TexB { Width = 64; Height = 64; }; sampler SamplerB { Texture = TexB; };
+texture TexHistory { Width = 64; Height = 64; }; sampler SamplerHistory { Texture = TexHistory; };
+
+void PostProcessVS(uint id : SV_VertexID, out float4 position : SV_Position, out float2 texcoord : TEXCOORD)
+{
+	texcoord = float2(id == 2 ? 2.0 : 0.0, id == 1 ? 2.0 : 0.0);
+	position = float4(texcoord * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+}
+
+float4 Brighten(float4 vpos : SV_Position, float2 texcoord : TEXCOORD) : SV_Target { return tex2D(BackBuffer, texcoord) * 2.0; }
+float4 ReadA(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { float4 c = tex2D(SamplerA, tc); return c + tex2D(SamplerA, tc).x; }
+float4 Darken(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { return tex2D(BackBuffer, tc) * 0.5; }
+float4 Offset(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { return tex2D(BackBuffer, tc + 0.1); }
+float4 ModifyTexcoord(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { tc.x += 0.1; return tex2D(BackBuffer, tc); }
+float4 Accumulate(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { return tex2D(BackBuffer, tc) + tex2D(SamplerHistory, tc); }
+float4 StoreHistory(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { return tex2D(SamplerB, tc) * 0.9; }
+)";
+
+enum class backend
+{
+	hlsl_sm3,
+	hlsl_sm5,
+	glsl,
+	spirv,
+};
+
+struct compile_result
+{
+	bool success = false;
+	std::string errors;
+	reshadefx::module module;
+
+	const std::vector<pass_info> &passes() const { return module.techniques.at(0).passes; }
+
+	/// <summary>
+	/// Count the functions in the generated code whose name contains the specified string.
+	/// </summary>
+	size_t count_functions(const std::string &name) const
+	{
+		if (module.spirv.empty())
+		{
+			// Function definitions start with the return type followed by the name (calls assign the result to a variable instead)
+			// Skip the entry point wrappers the HLSL code generator adds for shader model 3, which are prefixed with 'E'
+			size_t count = 0;
+			for (size_t line_offset = 0, next_line_offset; line_offset < module.hlsl.size(); line_offset = next_line_offset + 1)
+			{
+				next_line_offset = std::min(module.hlsl.find('\n', line_offset), module.hlsl.size());
+				const std::string line = module.hlsl.substr(line_offset, next_line_offset - line_offset);
+				if (const size_t name_offset = line.find(' ') + 1; name_offset != 0 && line[name_offset] != 'E' && line.find(' ', name_offset) == std::string::npos && line.back() == '(' && line.find(name, name_offset) != std::string::npos)
+					++count;
+			}
+			return count;
+		}
+		else
+		{
+			// Look up the debug names of all functions in the SPIR-V module
+			std::vector<std::pair<uint32_t, std::string>> names;
+			size_t count = 0;
+			for (size_t offset = 5; offset < module.spirv.size(); offset += module.spirv[offset] >> 16)
+			{
+				const uint32_t op = module.spirv[offset] & 0xFFFF;
+				if (op == 5 /* OpName */)
+					names.emplace_back(module.spirv[offset + 1], reinterpret_cast<const char *>(&module.spirv[offset + 2]));
+				if (op == 54 /* OpFunction */)
+					count += std::any_of(names.begin(), names.end(), [this, offset, &name](const auto &entry) {
+						return entry.first == module.spirv[offset + 2] && entry.second.find(name) != std::string::npos; });
+				if ((module.spirv[offset] >> 16) == 0)
+					break;
+			}
+			return count;
+		}
+	}
+};
+
+static std::vector<backend> available_backends()
+{
+	std::vector<backend> backends = { backend::hlsl_sm3, backend::hlsl_sm5, backend::glsl };
+#if RESHADE_TEST_HAVE_SPIRV
+	backends.push_back(backend::spirv);
+#endif
+	return backends;
+}
+
+static compile_result compile(backend backend, const std::string &techniques, unsigned int backbuffer_color_bit_depth = 8)
+{
+	std::unique_ptr<codegen> codegen;
+	switch (backend)
+	{
+	case backend::hlsl_sm3:
+		codegen.reset(create_codegen_hlsl(30, true, false));
+		break;
+	case backend::hlsl_sm5:
+		codegen.reset(create_codegen_hlsl(50, true, false));
+		break;
+	case backend::glsl:
+		codegen.reset(create_codegen_glsl(true, false));
+		break;
+	case backend::spirv:
+#if RESHADE_TEST_HAVE_SPIRV
+		codegen.reset(create_codegen_spirv(true, true, false, false));
+#endif
+		break;
+	}
+
+	compile_result result;
+	parser parser;
+	result.success = parser.parse(s_common_source + techniques, codegen.get(), backbuffer_color_bit_depth);
+	result.errors = parser.errors();
+	codegen->write_result(result.module);
+	return result;
+}
+
+TEST_CASE(fuse_into_render_target)
+{
+	for (const backend backend : available_backends())
+	{
+		const compile_result result = compile(backend, R"(
+technique T
+{
+	pass { VertexShader = PostProcessVS; PixelShader = Brighten; RenderTarget = TexA; }
+	pass { VertexShader = PostProcessVS; PixelShader = ReadA; RenderTarget = TexB; }
+})");
+		REQUIRE(result.success);
+		REQUIRE(result.passes().size() == 2);
+
+		// The first pass is kept (pass culling removes it when nothing else reads its target), the second calls its pixel shader instead of sampling the target
+		CHECK(result.passes()[0].ps_entry_point.find("Brighten") != std::string::npos);
+		CHECK(result.passes()[1].ps_entry_point.find("ReadA_fused") != std::string::npos);
+		CHECK(result.passes()[1].sampled_texture_names == std::vector<std::string> { "V__BackBufferTex" });
+		CHECK(result.count_functions("_fused") == 1);
+	}
+}
+
+TEST_CASE(fuse_into_back_buffer)
+{
+	const std::string techniques = R"(
+technique T
+{
+	pass { VertexShader = PostProcessVS; PixelShader = Brighten; }
+	pass { VertexShader = PostProcessVS; PixelShader = Darken; }
+	pass { VertexShader = PostProcessVS; PixelShader = Darken; }
+})";
+
+	for (const backend backend : available_backends())
+	{
+		compile_result result = compile(backend, techniques);
+		REQUIRE(result.success);
+		// Passes writing to the back buffer are merged repeatedly
+		REQUIRE(result.passes().size() == 1);
+		CHECK(result.passes()[0].ps_entry_point.find("Darken_fused") != std::string::npos);
+		CHECK(result.count_functions("_fused") == 2);
+
+		// Only unsigned normalized back buffers clamp like the fused shader does
+		result = compile(backend, techniques, 0);
+		REQUIRE(result.success);
+		CHECK(result.passes().size() == 3);
+		CHECK(result.count_functions("_fused") == 0);
+	}
+}
+
+TEST_CASE(rejected_fusion_leaves_no_code)
+{
+	for (const backend backend : available_backends())
+	{
+		// Both of these only turn out to not be fusable while generating the fused pixel shader
+		const compile_result result = compile(backend, R"(
+technique T
+{
+	pass { VertexShader = PostProcessVS; PixelShader = Brighten; }
+	pass { VertexShader = PostProcessVS; PixelShader = Offset; }
+	pass { VertexShader = PostProcessVS; PixelShader = ModifyTexcoord; }
+})");
+		REQUIRE(result.success);
+		CHECK(result.errors.empty());
+		CHECK(result.passes().size() == 3);
+		CHECK(result.count_functions("_fused") == 0);
+		CHECK(result.count_functions("Offset") == 1);
+		CHECK(result.count_functions("ModifyTexcoord") == 1);
+	}
+}
+
+TEST_CASE(history_textures_are_not_fused)
+{
+	for (const backend backend : available_backends())
+	{
+		// The fused shader would sample the history texture while it is bound as render target
+		const compile_result result = compile(backend, R"(
+technique T
+{
+	pass { VertexShader = PostProcessVS; PixelShader = Accumulate; RenderTarget = TexB; }
+	pass { VertexShader = PostProcessVS; PixelShader = StoreHistory; RenderTarget = TexHistory; }
+})");
+		REQUIRE(result.success);
+		REQUIRE(result.passes().size() == 2);
+		CHECK(result.passes()[1].ps_entry_point.find("_fused") == std::string::npos);
+		CHECK(result.count_functions("_fused") == 0);
+	}
+}
+
+TEST_CASE(failed_reparse_keeps_diagnostics)
+{
+	for (const backend backend : available_backends())
+	{
+		// The body is parsed again at the technique, where the second overload is visible too, which makes the call ambiguous
+		const compile_result result = compile(backend, R"(
+float4 Helper(float a, int b) { return a; }
+float4 CallHelper(float4 vpos : SV_Position, float2 tc : TEXCOORD) : SV_Target { return tex2D(BackBuffer, tc) + Helper(1, 1); }
+float4 Helper(int a, float b) { return b; }
+
+technique T
+{
+	pass { VertexShader = PostProcessVS; PixelShader = Brighten; }
+	pass { VertexShader = PostProcessVS; PixelShader = CallHelper; }
+})");
+		REQUIRE(result.success);
+		CHECK(result.passes().size() == 2);
+		CHECK(result.count_functions("_fused") == 0);
+		// The reason is reported, but only as a warning, since the effect still works without fusing the passes
+		CHECK(result.errors.find("could not fuse pixel shader 'CallHelper'") != std::string::npos);
+		CHECK(result.errors.find("ambiguous") != std::string::npos);
+		CHECK(result.errors.find(": error") == std::string::npos);
+	}
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "buffer_detection_core.hpp"
+#include <random>
+#include <atomic>
+
+// A stand-in for a D3D10/D3D11 device context with depth-stencil views of textures, which counts how often the depth buffer detection calls into it
+// Together with two trackers that find the bound depth-stencil the way the D3D11 backend did before ("queried_tracker") and does now ("cached_tracker")
+
+namespace reshade::test
+{
+	struct api_call_counters
+	{
+		// Calls like OMGetRenderTargets, GetResource and QueryInterface
+		size_t calls = 0;
+		// AddRef and Release
+		size_t refcount_operations = 0;
+	};
+
+	/// <summary>
+	/// Object with virtual methods and an atomic reference count, like a COM object.
+	/// </summary>
+	class fake_object
+	{
+	public:
+		explicit fake_object(api_call_counters &counters) : _counters(counters) {}
+		virtual ~fake_object() = default;
+
+		virtual unsigned long AddRef() { _counters.refcount_operations++; return ++_ref; }
+		virtual unsigned long Release() { _counters.refcount_operations++; return --_ref; } // Objects are owned by the device context, so this never destroys them
+
+	protected:
+		api_call_counters &_counters;
+
+	private:
+		std::atomic<unsigned long> _ref = 1;
+	};
+
+	class fake_texture : public fake_object
+	{
+	public:
+		fake_texture(api_call_counters &counters, uint64_t handle) : fake_object(counters), handle(handle) {}
+
+		virtual fake_texture *QueryInterface() { _counters.calls++; AddRef(); return this; }
+
+		const uint64_t handle;
+	};
+
+	class fake_depthstencil_view : public fake_object
+	{
+	public:
+		fake_depthstencil_view(api_call_counters &counters, fake_texture *texture) : fake_object(counters), _texture(texture) {}
+
+		virtual fake_texture *GetResource() { _counters.calls++; _texture->AddRef(); return _texture; }
+
+	private:
+		fake_texture *const _texture;
+	};
+
+	class fake_device_context
+	{
+	public:
+		/// <summary>
+		/// Creates the specified number of textures, with multiple depth-stencil views each (e.g. for different array slices).
+		/// </summary>
+		fake_device_context(size_t num_textures, size_t num_views_per_texture)
+		{
+			for (size_t i = 0; i < num_textures; ++i)
+			{
+				fake_texture *const texture = _textures.emplace_back(std::make_unique<fake_texture>(counters, 0x10000 + i * 0x100)).get();
+				for (size_t k = 0; k < num_views_per_texture; ++k)
+					_views.push_back(std::make_unique<fake_depthstencil_view>(counters, texture));
+			}
+		}
+
+		size_t num_views() const { return _views.size(); }
+		fake_depthstencil_view *view(size_t index) const { return _views[index].get(); }
+
+		void OMSetRenderTargets(fake_depthstencil_view *dsv) { _bound_dsv = dsv; }
+		fake_depthstencil_view *OMGetRenderTargets() { counters.calls++; if (_bound_dsv != nullptr) _bound_dsv->AddRef(); return _bound_dsv; }
+		void ClearState() { _bound_dsv = nullptr; }
+
+		/// <summary>
+		/// Returns the handle of the texture of a depth-stencil view, like "texture_from_dsv" in the D3D10 and D3D11 backends.
+		/// </summary>
+		uint64_t texture_from_dsv(fake_depthstencil_view *dsv)
+		{
+			if (dsv == nullptr)
+				return 0;
+			fake_texture *const resource = dsv->GetResource();
+			fake_texture *const texture = resource->QueryInterface();
+			resource->Release();
+			const uint64_t handle = texture->handle;
+			texture->Release();
+			return handle;
+		}
+
+		api_call_counters counters;
+
+	private:
+		fake_depthstencil_view *_bound_dsv = nullptr;
+		std::vector<std::unique_ptr<fake_texture>> _textures;
+		std::vector<std::unique_ptr<fake_depthstencil_view>> _views;
+	};
+
+	/// <summary>
+	/// Queries the bound depth-stencil from the device context on every draw call, which is what the D3D10 and D3D11 backends used to do.
+	/// </summary>
+	class queried_tracker : public buffer_detection_core<uint64_t>
+	{
+	public:
+		explicit queried_tracker(fake_device_context &device_context) : _device_context(device_context) {}
+
+		void reset() { reset_core(); }
+
+		void on_set_depthstencil(fake_depthstencil_view *) {}
+
+		void on_draw(uint32_t vertices)
+		{
+			count_draw(vertices);
+
+			fake_depthstencil_view *const dsv = _device_context.OMGetRenderTargets();
+			if (dsv == nullptr)
+				return;
+			const uint64_t texture = _device_context.texture_from_dsv(dsv);
+			dsv->Release();
+
+			count_draw(texture, vertices);
+		}
+
+	private:
+		fake_device_context &_device_context;
+	};
+
+	/// <summary>
+	/// Remembers the depth-stencil when it is bound and uses that on draw calls, which is what the D3D10 and D3D11 backends do now.
+	/// </summary>
+	class cached_tracker : public buffer_detection_core<uint64_t>
+	{
+	public:
+		explicit cached_tracker(fake_device_context &device_context) : _device_context(device_context) {}
+
+		void reset() { reset_core(); }
+
+		void on_set_depthstencil(fake_depthstencil_view *dsv)
+		{
+			set_current_depthstencil(_device_context.texture_from_dsv(dsv));
+		}
+
+		void on_draw(uint32_t vertices)
+		{
+			count_draw(vertices);
+			count_draw_current(vertices);
+		}
+
+	private:
+		fake_device_context &_device_context;
+	};
+
+	/// <summary>
+	/// The calls of an application that change the bound depth-stencil or draw.
+	/// </summary>
+	struct command
+	{
+		enum type
+		{
+			set_render_targets, // OMSetRenderTargets
+			set_unordered_access_views, // OMSetRenderTargetsAndUnorderedAccessViews with D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, which keeps the depth-stencil
+			clear_state, // ClearState
+			execute_command_list, // ExecuteCommandList, which resets the state afterwards unless it is restored
+			draw,
+			present,
+		} type;
+
+		// The view to bind (or none if out of range), whether to restore state after executing a command list or the number of vertices to draw
+		uint32_t value;
+	};
+
+	/// <summary>
+	/// Generates a random stream of commands, with mostly draw calls between state changes like in a typical frame.
+	/// </summary>
+	inline std::vector<command> generate_commands(uint32_t seed, size_t num_commands, size_t num_views, size_t commands_per_frame)
+	{
+		std::mt19937 rng(seed);
+		std::vector<command> commands;
+		commands.reserve(num_commands);
+
+		for (size_t i = 0; i < num_commands; ++i)
+		{
+			if (i % commands_per_frame == commands_per_frame - 1)
+			{
+				commands.push_back({ command::present, 0 });
+				continue;
+			}
+
+			const uint32_t choice = rng() % 100;
+			if (choice < 8)
+				// Some render passes have no depth-stencil bound
+				commands.push_back({ command::set_render_targets, static_cast<uint32_t>(rng() % (num_views + num_views / 4 + 1)) });
+			else if (choice < 10)
+				commands.push_back({ command::set_unordered_access_views, 0 });
+			else if (choice < 11)
+				commands.push_back({ command::clear_state, 0 });
+			else if (choice < 12)
+				commands.push_back({ command::execute_command_list, static_cast<uint32_t>(rng() % 2) });
+			else
+				// Some draw calls are indirect, which do not report a vertex count
+				commands.push_back({ command::draw, rng() % 16 == 0 ? 0u : static_cast<uint32_t>(3 + rng() % 3000) });
+		}
+
+		return commands;
+	}
+
+	/// <summary>
+	/// Applies a command to the device context and reports it to the tracker, like the D3D11 hooks do.
+	/// </summary>
+	template <typename TTracker>
+	inline void apply_command(const command &command, fake_device_context &device_context, TTracker &tracker)
+	{
+		switch (command.type)
+		{
+		case command::set_render_targets:
+		{
+			fake_depthstencil_view *const dsv = command.value < device_context.num_views() ? device_context.view(command.value) : nullptr;
+			device_context.OMSetRenderTargets(dsv);
+			tracker.on_set_depthstencil(dsv);
+			break;
+		}
+		case command::set_unordered_access_views:
+			break;
+		case command::clear_state:
+			device_context.ClearState();
+			tracker.on_set_depthstencil(nullptr);
+			break;
+		case command::execute_command_list:
+			if (command.value == 0)
+			{
+				device_context.ClearState();
+				tracker.on_set_depthstencil(nullptr);
+			}
+			break;
+		case command::draw:
+			tracker.on_draw(command.value);
+			break;
+		case command::present:
+			tracker.reset();
+			break;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "lockfree_slab.hpp"
+#include "allocation_counter.hpp"
+#include <thread>
+#include <vector>
+
+struct object
+{
+	uint64_t payload[11];
+};
+
+struct heap_allocator
+{
+	object *create() { return new object(); }
+	void destroy(object *obj) { delete obj; }
+};
+
+/// <summary>
+/// Keep a number of objects alive per thread and replace one of them at a time, like the Vulkan hooks do with the data they track per handle.
+/// </summary>
+template <typename T>
+static void run(const char *name, unsigned int num_threads, size_t num_objects, unsigned int num_operations)
+{
+	T *const allocator = new T();
+
+	std::vector<std::vector<object *>> objects(num_threads);
+	for (std::vector<object *> &thread_objects : objects)
+	{
+		thread_objects.reserve(num_objects);
+		for (size_t i = 0; i < num_objects; ++i)
+			thread_objects.push_back(allocator->create());
+	}
+
+	std::atomic<size_t> num_allocations = 0;
+
+	const double seconds = reshade::bench::measure(1, [&]() {
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < num_threads; ++t)
+		{
+			threads.emplace_back([allocator, &thread_objects = objects[t], &num_allocations, num_operations]() {
+				const size_t num_allocations_before = reshade::test::num_allocations;
+
+				for (unsigned int i = 0; i < num_operations; ++i)
+				{
+					object *&obj = thread_objects[(i * 2654435761u) % thread_objects.size()];
+					allocator->destroy(obj);
+					obj = allocator->create();
+					reshade::bench::do_not_optimize(obj);
+				}
+
+				num_allocations += reshade::test::num_allocations - num_allocations_before;
+			});
+		}
+		for (std::thread &thread : threads)
+			thread.join();
+	});
+
+	for (std::vector<object *> &thread_objects : objects)
+		for (object *const obj : thread_objects)
+			allocator->destroy(obj);
+	delete allocator;
+
+	const double total_operations = double(num_threads) * num_operations;
+	std::printf("%-6s %-8u %-8zu %18.1f %22.1f\n", name, num_threads, num_objects, seconds * 1e9 / total_operations, 1e6 * num_allocations / total_operations);
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+	const unsigned int num_operations = quick ? 1000 : 5000000;
+
+	std::printf("%-6s %-8s %-8s %18s %22s\n", "", "threads", "objects", "ns/create+destroy", "heap allocations/1M");
+
+	for (const unsigned int num_threads : { 1, 4 })
+	{
+		for (const size_t num_objects : { 100, 3000 })
+		{
+			run<heap_allocator>("heap", num_threads, num_objects, num_operations);
+			run<lockfree_slab<object, 4096>>("slab", num_threads, num_objects, num_operations);
+		}
+	}
+}
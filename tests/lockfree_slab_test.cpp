@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "lockfree_slab.hpp"
+#include "allocation_counter.hpp"
+#include <random>
+#include <thread>
+#include <vector>
+
+static std::atomic<long> s_num_live_objects = 0;
+
+struct object
+{
+	object(uint64_t owner) : owner(owner) { s_num_live_objects++; }
+	~object() { s_num_live_objects--; }
+
+	uint64_t owner;
+	uint64_t payload[5];
+};
+
+TEST_CASE(create_and_destroy)
+{
+	lockfree_slab<object, 16> slab;
+
+	object *const a = slab.create(1);
+	object *const b = slab.create(2);
+	CHECK(a != b && a->owner == 1 && b->owner == 2);
+	CHECK(s_num_live_objects == 2);
+
+	// Every object gets its own cache line
+	CHECK(reinterpret_cast<uintptr_t>(a) % 64 == 0 && reinterpret_cast<uintptr_t>(b) % 64 == 0);
+
+	// The slot that was freed last is reused first
+	slab.destroy(a);
+	CHECK(s_num_live_objects == 1);
+	CHECK(slab.create(3) == a && a->owner == 3);
+
+	slab.destroy(a);
+	slab.destroy(b);
+	slab.destroy(nullptr);
+	CHECK(s_num_live_objects == 0);
+}
+
+TEST_CASE(slabs_grow_geometrically)
+{
+	std::vector<object *> objects;
+	objects.reserve(16 * 100);
+
+	lockfree_slab<object, 16> slab;
+
+	// Slabs double in size, so 1600 objects fit into 7 of them (16 + 32 + ... + 1024 = 2032 slots)
+	const size_t num_allocations_before = reshade::test::num_allocations;
+	for (size_t i = 0; i < 16 * 100; ++i)
+		objects.push_back(slab.create(i));
+	CHECK(reshade::test::num_allocations - num_allocations_before == 7);
+
+	for (size_t i = 0; i < objects.size(); ++i)
+		CHECK(objects[i]->owner == i);
+
+	// Once warmed up, the slots are reused without going to the heap again
+	for (object *const obj : objects)
+		slab.destroy(obj);
+	for (object *&obj : objects)
+		obj = slab.create(0);
+	CHECK(reshade::test::num_allocations - num_allocations_before == 7);
+
+	for (object *const obj : objects)
+		slab.destroy(obj);
+}
+
+TEST_CASE(concurrent_create_and_destroy)
+{
+	lockfree_slab<object, 16> slab;
+
+	const int num_threads = 16;
+	std::vector<std::thread> threads;
+	std::vector<unsigned int> num_errors(num_threads);
+
+	for (int t = 0; t < num_threads; ++t)
+	{
+		// Every thread starts by creating objects, so that multiple threads find the free list empty and try to add a slab at the same time
+		threads.emplace_back([&slab, &errors = num_errors[t], t]() {
+			std::mt19937 rng(t);
+			std::vector<object *> objects;
+
+			for (int i = 0; i < 100000; ++i)
+			{
+				if (objects.size() < 32 || rng() % 2)
+				{
+					object *const obj = slab.create(t);
+					if (reinterpret_cast<uintptr_t>(obj) % 64 != 0)
+						errors++;
+					objects.push_back(obj);
+				}
+				else
+				{
+					// If the same slot was handed out twice, another thread would have overwritten the owner
+					const size_t index = rng() % objects.size();
+					if (objects[index]->owner != uint64_t(t))
+						errors++;
+					slab.destroy(objects[index]);
+					objects[index] = objects.back();
+					objects.pop_back();
+				}
+			}
+
+			for (object *const obj : objects)
+			{
+				if (obj->owner != uint64_t(t))
+					errors++;
+				slab.destroy(obj);
+			}
+		});
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	for (int t = 0; t < num_threads; ++t)
+		CHECK(num_errors[t] == 0);
+	CHECK(s_num_live_objects == 0);
+}
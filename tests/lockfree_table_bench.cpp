@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "lockfree_table.hpp"
+#include <thread>
+#include <vector>
+
+namespace legacy
+{
+	// The table before it used open addressing, which searched linearly from the start (or from a hash into the first half for big tables) and allocated every value on the heap
+	template <typename TKey, typename TValue, size_t MAX_ENTRIES>
+	class lockfree_table
+	{
+	public:
+		~lockfree_table()
+		{
+			for (size_t i = 0; i < MAX_ENTRIES; ++i)
+				if (const TKey key = _data[i].first.load(); key != no_value && key != update_value)
+					delete _data[i].second;
+		}
+
+		static constexpr TKey no_value = (TKey)0;
+		static constexpr TKey update_value = (TKey)1;
+
+		TValue &at(TKey key) const
+		{
+			for (size_t i = start_index(key); i < MAX_ENTRIES; ++i)
+				if (_data[i].first.load(std::memory_order_acquire) == key)
+					return *_data[i].second;
+
+			return _default;
+		}
+
+		TValue &emplace(TKey key, const TValue &value)
+		{
+			TValue *const new_value = new TValue(value);
+
+			for (size_t i = start_index(key); i < MAX_ENTRIES; ++i)
+			{
+				if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
+					test_key == no_value &&
+					_data[i].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
+				{
+					_data[i].second = new_value;
+					_data[i].first.store(key, std::memory_order_release);
+					return *new_value;
+				}
+			}
+
+			delete new_value;
+			return _default;
+		}
+
+		bool erase(TKey key)
+		{
+			for (size_t i = start_index(key); i < MAX_ENTRIES; ++i)
+			{
+				if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
+					test_key == key)
+				{
+					TValue *const old_value = _data[i].second;
+
+					if (_data[i].first.compare_exchange_strong(test_key, no_value, std::memory_order_relaxed))
+					{
+						delete old_value;
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+	private:
+		static size_t start_index(TKey key)
+		{
+			if constexpr (MAX_ENTRIES > 512)
+				return std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+			else
+				return 0;
+		}
+
+		mutable TValue _default = {};
+		std::pair<std::atomic<TKey>, TValue *> _data[MAX_ENTRIES] = {};
+	};
+}
+
+struct value
+{
+	uint64_t key;
+	uint64_t payload[10];
+};
+
+/// <summary>
+/// Look up handles from multiple threads, while some are destroyed and replaced by new ones, similar to what the Vulkan hooks do with the handles of an application.
+/// </summary>
+template <typename T>
+static double run(unsigned int num_threads, size_t num_handles, unsigned int erase_interval, unsigned int num_operations)
+{
+	T *const table = new T();
+
+	// Handles are usually pointers, which are aligned, so have little entropy in their low bits
+	std::vector<std::vector<uint64_t>> handles(num_threads);
+	for (unsigned int t = 0; t < num_threads; ++t)
+	{
+		handles[t].resize(num_handles / num_threads);
+		for (size_t i = 0; i < handles[t].size(); ++i)
+			table->emplace(handles[t][i] = ((uint64_t(t) + 1) << 40) | (i + 1) << 6, value { handles[t][i] });
+	}
+
+	const double seconds = reshade::bench::measure(1, [&]() {
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < num_threads; ++t)
+		{
+			threads.emplace_back([table, &keys = handles[t], t, erase_interval, num_operations]() {
+				uint64_t next_key = ((uint64_t(t) + 1) << 40) | (keys.size() + 1) << 6;
+				uint64_t sum = 0;
+				for (unsigned int i = 0; i < num_operations; ++i)
+				{
+					uint64_t &key = keys[(i * 2654435761u) % keys.size()];
+					sum += table->at(key).key;
+
+					if (i % erase_interval == 0)
+					{
+						table->erase(key);
+						table->emplace(key = next_key, value { next_key });
+						next_key += 1 << 6;
+					}
+				}
+				reshade::bench::do_not_optimize(sum);
+			});
+		}
+		for (std::thread &thread : threads)
+			thread.join();
+	});
+
+	delete table;
+
+	return seconds * 1e9 / (double(num_threads) * num_operations);
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+	const unsigned int num_operations = quick ? 1000 : 2000000;
+
+	std::printf("%-8s %-8s %-14s %18s %18s\n", "threads", "handles", "erase every", "legacy ns/op", "current ns/op");
+
+	for (const unsigned int num_threads : { 1, 4 })
+	{
+		for (const size_t num_handles : { 256, 3000 })
+		{
+			for (const unsigned int erase_interval : { 2, 16 })
+			{
+				const double legacy_time = run<legacy::lockfree_table<uint64_t, value, 4096>>(num_threads, num_handles, erase_interval, num_operations);
+				const double current_time = run<lockfree_table<uint64_t, value, 4096>>(num_threads, num_handles, erase_interval, num_operations);
+
+				std::printf("%-8u %-8zu %-14u %18.1f %18.1f\n", num_threads, num_handles, erase_interval, legacy_time, current_time);
+			}
+		}
+	}
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "lockfree_table.hpp"
+#include <random>
+#include <thread>
+#include <vector>
+
+struct value
+{
+	uint64_t key;
+	uint64_t payload[3];
+};
+
+/// <summary>
+/// A key that counts how often it is compared, which is how many entries a search looked at (plus a few checks for special keys per entry).
+/// </summary>
+struct counted_key
+{
+	static inline size_t num_comparisons = 0;
+
+	counted_key() = default;
+	constexpr counted_key(int64_t value) : value(static_cast<uint64_t>(value)) {}
+
+	bool operator==(const counted_key &other) const { ++num_comparisons; return value == other.value; }
+	bool operator!=(const counted_key &other) const { return !(*this == other); }
+
+	uint64_t value;
+};
+
+template <>
+struct std::hash<counted_key>
+{
+	size_t operator()(const counted_key &key) const { return std::hash<uint64_t>()(key.value); }
+};
+
+TEST_CASE(emplace_at_erase)
+{
+	lockfree_table<uint64_t, value, 16> table;
+
+	// Add more keys than fit into the first table, so that some end up in a chained one
+	for (uint64_t key = 2; key < 100; ++key)
+		table.emplace(key, value { key });
+	for (uint64_t key = 2; key < 100; ++key)
+		CHECK(table.at(key).key == key);
+
+	value erased = {};
+	CHECK(table.erase(50, erased) && erased.key == 50);
+	CHECK(!table.erase(50));
+	CHECK(!table.erase(1000));
+
+	// Erased entries are reused
+	table.emplace(1000, value { 1000 });
+	CHECK(table.at(1000).key == 1000);
+	CHECK(table.at(51).key == 51);
+
+	table.clear();
+	CHECK(!table.erase(2));
+	table.emplace(2, value { 2 });
+	CHECK(table.at(2).key == 2);
+}
+
+TEST_CASE(erased_entries_count_toward_load)
+{
+	lockfree_table<counted_key, value, 1024> table;
+
+	// Keep the number of live keys well below the growth threshold, but add and erase lots of them, which leaves erased entries behind all over the table
+	std::vector<uint64_t> live;
+	uint64_t next_key = 2;
+	for (; live.size() < 512; ++next_key)
+	{
+		table.emplace(next_key, value { next_key });
+		live.push_back(next_key);
+	}
+
+	std::mt19937_64 rng(0);
+	for (int i = 0; i < 100000; ++i, ++next_key)
+	{
+		uint64_t &key = live[rng() % live.size()];
+		CHECK(table.erase(key));
+		table.emplace(next_key, value { next_key });
+		key = next_key;
+	}
+
+	for (const uint64_t key : live)
+		CHECK(table.at(key).key == key);
+
+	// Searches for keys that are not in the table stop at the first empty entry, so that needs to be close by
+	// When erased entries do not count toward the load, the table fills up with them and every one of these searches walks all entries instead
+	counted_key::num_comparisons = 0;
+	for (uint64_t key = next_key; key < next_key + 1000; ++key)
+		CHECK(!table.erase(key));
+	const double comparisons_per_search = counted_key::num_comparisons / 1000.0;
+	CHECK(comparisons_per_search < 100);
+}
+
+TEST_CASE(concurrent_access)
+{
+	// A small table, so that it has to grow while the threads are using it
+	lockfree_table<uint64_t, value, 64> table;
+
+	const int num_threads = 16;
+	std::vector<std::thread> threads;
+	std::vector<unsigned int> num_errors(num_threads);
+
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads.emplace_back([&table, &errors = num_errors[t], t]() {
+			std::mt19937_64 rng(t);
+			std::vector<uint64_t> live;
+
+			// Every thread owns its own range of keys, so it knows which ones are in the table
+			uint64_t next_key = (uint64_t(t) + 1) << 40;
+			for (int i = 0; i < 50000; ++i)
+			{
+				switch (live.empty() ? 0 : rng() % 3)
+				{
+				case 0:
+					table.emplace(next_key, value { next_key, { next_key * 2, next_key * 3, next_key * 4 } });
+					live.push_back(next_key++);
+					break;
+				case 1:
+					if (const uint64_t key = live[rng() % live.size()];
+						table.at(key).key != key || table.at(key).payload[2] != key * 4)
+						errors++;
+					break;
+				case 2:
+					const size_t index = rng() % live.size();
+					if (value erased; !table.erase(live[index], erased) || erased.key != live[index] || erased.payload[0] != live[index] * 2)
+						errors++;
+					live[index] = live.back();
+					live.pop_back();
+					break;
+				}
+			}
+
+			for (const uint64_t key : live)
+				if (!table.erase(key))
+					errors++;
+		});
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	for (int t = 0; t < num_threads; ++t)
+		CHECK(num_errors[t] == 0);
+}
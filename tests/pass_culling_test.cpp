@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "pass_culling.hpp"
+
+using namespace reshade;
+
+static reshadefx::pass_info make_pass(const char *render_target, std::vector<std::string> sampled = {})
+{
+	reshadefx::pass_info pass;
+	pass.vs_entry_point = "PostProcessVS";
+	pass.ps_entry_point = "main";
+	pass.render_target_names[0] = render_target;
+	pass.sampled_texture_names = std::move(sampled);
+	return pass;
+}
+
+static reshadefx::pass_info make_compute_pass(std::vector<std::string> storage, std::vector<std::string> sampled = {})
+{
+	reshadefx::pass_info pass;
+	pass.cs_entry_point = "main";
+	pass.storage_texture_names = std::move(storage);
+	pass.sampled_texture_names = std::move(sampled);
+	return pass;
+}
+
+TEST_CASE(back_buffer_passes_are_live)
+{
+	const std::vector<reshadefx::pass_info> passes = {
+		make_pass("Unused"),
+		make_pass("Input"),
+		make_pass("", { "Input" }), // Writes to the back buffer
+		make_pass("Unused", { "Input" }),
+	};
+
+	const auto culled = find_culled_passes({ &passes });
+	REQUIRE(culled.size() == 1 && culled[0].size() == 4);
+	CHECK(culled[0][0]);
+	CHECK(!culled[0][1]);
+	CHECK(!culled[0][2]);
+	CHECK(culled[0][3]);
+}
+
+TEST_CASE(stencil_passes_are_live)
+{
+	reshadefx::pass_info stencil_pass = make_pass("Unused");
+	stencil_pass.stencil_enable = true;
+
+	const std::vector<reshadefx::pass_info> passes = { make_pass("Unused"), stencil_pass };
+
+	// The stencil buffer is shared with the back buffer, so writing it affects later passes (even if nothing samples the render target)
+	const auto culled = find_culled_passes({ &passes });
+	CHECK(culled[0][0]);
+	CHECK(!culled[0][1]);
+}
+
+TEST_CASE(live_textures_across_techniques)
+{
+	// A texture written in a later technique and read in an earlier one is read in the next frame, so is still needed
+	const std::vector<reshadefx::pass_info> reader = { make_pass("", { "History" }) };
+	const std::vector<reshadefx::pass_info> writer = { make_pass("Temp"), make_pass("History", { "Temp" }), make_pass("Unused", { "Temp" }) };
+
+	auto culled = find_culled_passes({ &reader, &writer });
+	REQUIRE(culled.size() == 2);
+	CHECK(!culled[0][0]);
+	CHECK(!culled[1][0]);
+	CHECK(!culled[1][1]);
+	CHECK(culled[1][2]);
+
+	// Without the reader (e.g. because its technique was disabled) the writer has no visible output anymore
+	culled = find_culled_passes({ &writer });
+	CHECK(culled[0][0] && culled[0][1] && culled[0][2]);
+}
+
+TEST_CASE(multiple_render_targets)
+{
+	reshadefx::pass_info mrt_pass = make_pass("Unused");
+	mrt_pass.render_target_names[1] = "Used";
+
+	const std::vector<reshadefx::pass_info> passes = { mrt_pass, make_pass("", { "Used" }) };
+
+	// One of the render targets being read is enough to keep the pass
+	const auto culled = find_culled_passes({ &passes });
+	CHECK(!culled[0][0]);
+	CHECK(!culled[0][1]);
+}
+
+TEST_CASE(compute_passes)
+{
+	const std::vector<reshadefx::pass_info> passes = {
+		make_compute_pass({ "Histogram" }, { "Input" }),
+		make_compute_pass({ "Unused" }),
+		make_pass("Input"),
+		make_pass("", { "Histogram" }),
+	};
+
+	// Compute passes are only live through the storages they write, but do not count as writing to the back buffer
+	const auto culled = find_culled_passes({ &passes });
+	CHECK(!culled[0][0]);
+	CHECK(culled[0][1]);
+	CHECK(!culled[0][2]);
+	CHECK(!culled[0][3]);
+}
+
+TEST_CASE(preview_texture)
+{
+	const std::vector<reshadefx::pass_info> passes = { make_pass("Temp"), make_pass("Preview", { "Temp" }), make_pass("Unused") };
+
+	// The texture previewed in the overlay is passed in as live, which keeps its writers and their dependencies
+	const auto culled = find_culled_passes({ &passes }, { "Preview" });
+	CHECK(!culled[0][0]);
+	CHECK(!culled[0][1]);
+	CHECK(culled[0][2]);
+}
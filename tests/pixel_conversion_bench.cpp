@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "pixel_conversion.hpp"
+#include <vector>
+
+using namespace reshade::pixel;
+
+static const char *const s_instruction_set_names[] = { "scalar", "sse2", "avx2" };
+
+template <typename F>
+static void run(const char *name, size_t bytes_per_call, unsigned int repetitions, F &&func)
+{
+	limit_instruction_set(instruction_set::avx2);
+	const instruction_set best = current_instruction_set();
+
+	std::printf("%-26s", name);
+	for (int isa = 0; isa <= static_cast<int>(best); ++isa)
+	{
+		limit_instruction_set(static_cast<instruction_set>(isa));
+		const double seconds = reshade::bench::measure(repetitions, func);
+		std::printf("  %s %6.2f GB/s", s_instruction_set_names[isa], bytes_per_call / seconds / 1e9);
+	}
+	std::printf("\n");
+
+	limit_instruction_set(instruction_set::avx2);
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+
+	// A 4K frame, which is the worst case for a screenshot
+	const size_t count = quick ? 64 * 1024 : 3840 * 2160;
+	const unsigned int repetitions = quick ? 2 : 20;
+
+	std::vector<uint8_t> src(count * 4), dst(count * 4);
+	for (size_t i = 0; i < src.size(); ++i)
+		src[i] = static_cast<uint8_t>(i * 7);
+
+	std::printf("%zu pixels, best of %u runs (bytes read + written per second)\n", count, repetitions);
+
+	run("swap_red_blue", count * 8, repetitions, [&]() {
+		swap_red_blue(dst.data(), src.data(), count);
+		reshade::bench::do_not_optimize(dst[count / 2]);
+	});
+	run("clear_alpha", count * 8, repetitions, [&]() {
+		clear_alpha(dst.data(), count);
+		reshade::bench::do_not_optimize(dst[count / 2]);
+	});
+	run("convert_rgb10a2_to_rgba8", count * 8, repetitions, [&]() {
+		convert_rgb10a2_to_rgba8(dst.data(), src.data(), count, true);
+		reshade::bench::do_not_optimize(dst[count / 2]);
+	});
+	run("convert_rgba8_to_r8", count * 5, repetitions, [&]() {
+		convert_rgba8_to_r8(dst.data(), src.data(), count);
+		reshade::bench::do_not_optimize(dst[count / 2]);
+	});
+	run("convert_rgba8_to_rg8", count * 6, repetitions, [&]() {
+		convert_rgba8_to_rg8(dst.data(), src.data(), count);
+		reshade::bench::do_not_optimize(dst[count / 2]);
+	});
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "pixel_conversion.hpp"
+#include <random>
+#include <cstring>
+
+using namespace reshade::pixel;
+
+// Pixel counts around the 4 (SSE2) and 8 (AVX2) pixel vector widths, plus some larger odd ones to exercise the scalar tails after the vector loops
+static const size_t s_counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 23, 31, 32, 33, 63, 64, 65, 127, 1021, 1920 };
+
+static std::vector<uint8_t> random_pixels(size_t count, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> pixels(count * 4);
+	for (uint8_t &v : pixels)
+		v = static_cast<uint8_t>(rng());
+	return pixels;
+}
+
+static std::vector<instruction_set> supported_instruction_sets()
+{
+	limit_instruction_set(instruction_set::avx2);
+	std::vector<instruction_set> result;
+	for (int isa = 0; isa <= static_cast<int>(current_instruction_set()); ++isa)
+		result.push_back(static_cast<instruction_set>(isa));
+	return result;
+}
+
+// Scalar reference implementations, written per byte so they do not share any code with the kernels under test
+
+static void reference_swap_red_blue(uint8_t *dst, const uint8_t *src, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint8_t r = src[i * 4 + 0], g = src[i * 4 + 1], b = src[i * 4 + 2], a = src[i * 4 + 3];
+		dst[i * 4 + 0] = b;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = r;
+		dst[i * 4 + 3] = a;
+	}
+}
+static void reference_convert_rgb10a2_to_rgba8(uint8_t *dst, const uint8_t *src, size_t count, bool swap_rb)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32_t v = src[i * 4 + 0] | (src[i * 4 + 1] << 8) | (src[i * 4 + 2] << 16) | (uint32_t(src[i * 4 + 3]) << 24);
+		const uint8_t r = static_cast<uint8_t>((v >> 2) & 0xFF);
+		const uint8_t g = static_cast<uint8_t>((v >> 12) & 0xFF);
+		const uint8_t b = static_cast<uint8_t>((v >> 22) & 0xFF);
+		const uint8_t a = static_cast<uint8_t>(((v >> 30) & 0x3) * 0x55);
+		dst[i * 4 + 0] = swap_rb ? b : r;
+		dst[i * 4 + 1] = g;
+		dst[i * 4 + 2] = swap_rb ? r : b;
+		dst[i * 4 + 3] = a;
+	}
+}
+
+TEST_CASE(swap_red_blue)
+{
+	for (const instruction_set isa : supported_instruction_sets())
+	{
+		limit_instruction_set(isa);
+
+		for (const size_t count : s_counts)
+		{
+			const std::vector<uint8_t> src = random_pixels(count, static_cast<unsigned int>(count));
+			std::vector<uint8_t> expected(count * 4);
+			reference_swap_red_blue(expected.data(), src.data(), count);
+
+			// Offset the destination by one byte, so that unaligned stores are exercised too, and add a guard byte behind it to detect overruns
+			std::vector<uint8_t> dst(count * 4 + 2, 0xCD);
+			swap_red_blue(dst.data() + 1, src.data(), count);
+			CHECK(std::memcmp(dst.data() + 1, expected.data(), count * 4) == 0);
+			CHECK(dst[0] == 0xCD && dst[count * 4 + 1] == 0xCD);
+
+			// In place
+			std::vector<uint8_t> data = src;
+			swap_red_blue(data.data(), data.data(), count);
+			CHECK(data == expected);
+		}
+	}
+}
+
+TEST_CASE(clear_alpha)
+{
+	for (const instruction_set isa : supported_instruction_sets())
+	{
+		limit_instruction_set(isa);
+
+		for (const size_t count : s_counts)
+		{
+			std::vector<uint8_t> expected = random_pixels(count, static_cast<unsigned int>(count) + 1);
+			std::vector<uint8_t> data(count * 4 + 2, 0xCD);
+			std::memcpy(data.data() + 1, expected.data(), count * 4);
+			for (size_t i = 0; i < count; ++i)
+				expected[i * 4 + 3] = 0xFF;
+
+			clear_alpha(data.data() + 1, count);
+			CHECK(std::memcmp(data.data() + 1, expected.data(), count * 4) == 0);
+			CHECK(data[0] == 0xCD && data[count * 4 + 1] == 0xCD);
+		}
+	}
+}
+
+TEST_CASE(convert_rgb10a2_to_rgba8)
+{
+	for (const instruction_set isa : supported_instruction_sets())
+	{
+		limit_instruction_set(isa);
+
+		for (const bool swap_rb : { false, true })
+		{
+			for (const size_t count : s_counts)
+			{
+				const std::vector<uint8_t> src = random_pixels(count, static_cast<unsigned int>(count) + 2);
+				std::vector<uint8_t> expected(count * 4);
+				reference_convert_rgb10a2_to_rgba8(expected.data(), src.data(), count, swap_rb);
+
+				std::vector<uint8_t> dst(count * 4 + 2, 0xCD);
+				convert_rgb10a2_to_rgba8(dst.data() + 1, src.data(), count, swap_rb);
+				CHECK(std::memcmp(dst.data() + 1, expected.data(), count * 4) == 0);
+				CHECK(dst[0] == 0xCD && dst[count * 4 + 1] == 0xCD);
+
+				std::vector<uint8_t> data = src;
+				convert_rgb10a2_to_rgba8(data.data(), data.data(), count, swap_rb);
+				CHECK(data == expected);
+			}
+		}
+	}
+}
+
+TEST_CASE(convert_rgba8_to_r8_and_rg8)
+{
+	for (const instruction_set isa : supported_instruction_sets())
+	{
+		limit_instruction_set(isa);
+
+		for (const size_t count : s_counts)
+		{
+			const std::vector<uint8_t> src = random_pixels(count, static_cast<unsigned int>(count) + 3);
+
+			std::vector<uint8_t> r8(count + 2, 0xCD);
+			convert_rgba8_to_r8(r8.data() + 1, src.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				CHECK(r8[i + 1] == src[i * 4 + 0]);
+			CHECK(r8[0] == 0xCD && r8[count + 1] == 0xCD);
+
+			std::vector<uint8_t> rg8(count * 2 + 2, 0xCD);
+			convert_rgba8_to_rg8(rg8.data() + 1, src.data(), count);
+			for (size_t i = 0; i < count; ++i)
+				CHECK(rg8[i * 2 + 1] == src[i * 4 + 0] && rg8[i * 2 + 2] == src[i * 4 + 1]);
+			CHECK(rg8[0] == 0xCD && rg8[count * 2 + 1] == 0xCD);
+		}
+	}
+}
+
+TEST_CASE(flip_vertically)
+{
+	for (const size_t height : { 0, 1, 2, 3, 8, 9 })
+	{
+		const size_t pitch = 7 * 4;
+		const std::vector<uint8_t> src = random_pixels(pitch / 4 * height, static_cast<unsigned int>(height));
+		std::vector<uint8_t> data = src;
+		flip_vertically(data.data(), pitch, height);
+		for (size_t y = 0; y < height; ++y)
+			CHECK(std::memcmp(data.data() + y * pitch, src.data() + (height - 1 - y) * pitch, pitch) == 0);
+	}
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Minimal stand-in for the Windows API functions used by the sources under test, so that the tests can be built and run on other platforms too
+// This is only on the include path when not building for Windows
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+#include <ctime>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define WINAPI
+#define TRUE 1
+#define FALSE 0
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0x00000000L
+#define WAIT_TIMEOUT 0x00000102L
+
+#ifndef ARRAYSIZE
+#define ARRAYSIZE(a) (sizeof(a) / sizeof(*(a)))
+#endif
+
+typedef int BOOL;
+typedef unsigned long DWORD;
+typedef void *LPVOID;
+typedef void *HANDLE;
+typedef DWORD(WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+struct SYSTEMTIME
+{
+	uint16_t wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds;
+};
+
+namespace reshade::test::platform
+{
+	struct handle
+	{
+		virtual ~handle() = default;
+	};
+
+	struct event : handle
+	{
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool manual_reset = false;
+		bool signaled = false;
+	};
+
+	// Number of calls to 'WaitForSingleObject', so that tests can check how often a thread woke up and went to sleep again
+	inline std::atomic<unsigned int> num_waits = 0;
+}
+
+inline void GetLocalTime(SYSTEMTIME *result)
+{
+	timeval now;
+	gettimeofday(&now, nullptr);
+	tm local;
+	localtime_r(&now.tv_sec, &local);
+	*result = {
+		static_cast<uint16_t>(local.tm_year + 1900), static_cast<uint16_t>(local.tm_mon + 1), static_cast<uint16_t>(local.tm_wday), static_cast<uint16_t>(local.tm_mday),
+		static_cast<uint16_t>(local.tm_hour), static_cast<uint16_t>(local.tm_min), static_cast<uint16_t>(local.tm_sec), static_cast<uint16_t>(now.tv_usec / 1000) };
+}
+
+inline DWORD GetCurrentThreadId()
+{
+	return static_cast<DWORD>(syscall(SYS_gettid));
+}
+
+inline void OutputDebugStringA(const char *)
+{
+}
+
+inline HANDLE CreateThread(void *, size_t, LPTHREAD_START_ROUTINE start_address, LPVOID parameter, DWORD, DWORD *)
+{
+	std::thread(start_address, parameter).detach();
+	return new reshade::test::platform::handle();
+}
+
+inline HANDLE CreateEvent(void *, BOOL manual_reset, BOOL initial_state, const char *)
+{
+	const auto e = new reshade::test::platform::event();
+	e->manual_reset = manual_reset != FALSE;
+	e->signaled = initial_state != FALSE;
+	return e;
+}
+inline BOOL SetEvent(HANDLE handle)
+{
+	const auto e = static_cast<reshade::test::platform::event *>(static_cast<reshade::test::platform::handle *>(handle));
+	{ const std::lock_guard<std::mutex> lock(e->mutex);
+		e->signaled = true;
+	}
+	e->condition.notify_all();
+	return TRUE;
+}
+inline BOOL ResetEvent(HANDLE handle)
+{
+	const auto e = static_cast<reshade::test::platform::event *>(static_cast<reshade::test::platform::handle *>(handle));
+	const std::lock_guard<std::mutex> lock(e->mutex);
+	e->signaled = false;
+	return TRUE;
+}
+
+inline DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+	// Only events can be waited on
+	const auto e = static_cast<reshade::test::platform::event *>(static_cast<reshade::test::platform::handle *>(handle));
+	std::unique_lock<std::mutex> lock(e->mutex);
+	reshade::test::platform::num_waits++;
+	if (milliseconds == INFINITE)
+		e->condition.wait(lock, [e]() { return e->signaled; });
+	else if (!e->condition.wait_for(lock, std::chrono::milliseconds(milliseconds), [e]() { return e->signaled; }))
+		return WAIT_TIMEOUT;
+	if (!e->manual_reset)
+		e->signaled = false;
+	return WAIT_OBJECT_0;
+}
+
+inline BOOL CloseHandle(HANDLE handle)
+{
+	delete static_cast<reshade::test::platform::handle *>(handle);
+	return TRUE;
+}
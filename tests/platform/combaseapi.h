@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+// Minimal stand-in for the COM types used by the sources under test, see 'Windows.h' in this directory
+
+#pragma once
+
+#include "Windows.h"
+#include <cwchar>
+
+typedef long HRESULT;
+typedef wchar_t OLECHAR;
+
+struct GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+};
+typedef GUID IID;
+#define REFIID const IID &
+
+#define E_NOTIMPL static_cast<HRESULT>(0x80004001L)
+#define E_OUTOFMEMORY static_cast<HRESULT>(0x8007000EL)
+#define E_INVALIDARG static_cast<HRESULT>(0x80070057L)
+#define E_NOINTERFACE static_cast<HRESULT>(0x80004002L)
+#define E_FAIL static_cast<HRESULT>(0x80004005L)
+#define DXGI_ERROR_INVALID_CALL static_cast<HRESULT>(0x887A0001L)
+#define DXGI_ERROR_UNSUPPORTED static_cast<HRESULT>(0x887A0004L)
+#define DXGI_ERROR_DEVICE_REMOVED static_cast<HRESULT>(0x887A0005L)
+#define DXGI_ERROR_DEVICE_HUNG static_cast<HRESULT>(0x887A0006L)
+#define DXGI_ERROR_DEVICE_RESET static_cast<HRESULT>(0x887A0007L)
+
+inline int StringFromGUID2(REFIID guid, OLECHAR *result, int size)
+{
+	return std::swprintf(result, size, L"{%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+		guid.Data1, guid.Data2, guid.Data3, guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]) + 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "png_writer.hpp"
+#include <thread>
+#include <vector>
+#include <cmath>
+#if RESHADE_TEST_HAVE_STB
+#include <stb_image_write.h>
+#endif
+
+static void count_bytes(void *context, void *, int size)
+{
+	*static_cast<size_t *>(context) += size;
+}
+
+// Something that resembles a rendered frame: smooth shading, some hard edges and a bit of noise
+static std::vector<uint8_t> make_frame(unsigned int width, unsigned int height)
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	uint32_t noise = 12345;
+	for (size_t y = 0; y < height; ++y)
+	{
+		for (size_t x = 0; x < width; ++x)
+		{
+			noise = noise * 1664525 + 1013904223;
+			const float shade = 0.5f + 0.5f * std::sin(x * 0.01f) * std::cos(y * 0.013f);
+			const bool edge = ((x / 97) + (y / 61)) % 5 == 0;
+			uint8_t *const p = pixels.data() + (y * width + x) * 4;
+			p[0] = static_cast<uint8_t>((edge ? 40 : 200) * shade + (noise >> 29));
+			p[1] = static_cast<uint8_t>((edge ? 180 : 120) * shade + (noise >> 30));
+			p[2] = static_cast<uint8_t>(90 * shade + 30);
+			p[3] = 0xFF;
+		}
+	}
+	return pixels;
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+
+	const unsigned int width = quick ? 256 : 3840;
+	const unsigned int height = quick ? 144 : 2160;
+	const unsigned int repetitions = quick ? 1 : 5;
+	const std::vector<uint8_t> pixels = make_frame(width, height);
+	const double megabytes = pixels.size() / 1e6;
+
+	std::printf("%ux%u RGBA8, best of %u runs\n", width, height, repetitions);
+
+	const auto report = [&](const char *name, double seconds, size_t size) {
+		std::printf("%-34s %8.1f ms %8.1f MB/s %10zu bytes\n", name, seconds * 1e3, megabytes / seconds, size);
+	};
+
+	std::vector<unsigned int> thread_counts = { 1, 2, 4 };
+	if (std::thread::hardware_concurrency() > 4)
+		thread_counts.push_back(std::thread::hardware_concurrency());
+
+	for (const unsigned int level : { 1, 6 })
+	{
+		for (const unsigned int threads : thread_counts)
+		{
+			size_t size = 0;
+			const double seconds = reshade::bench::measure(repetitions, [&]() {
+				size = 0;
+				reshade::png::write_to_func(count_bytes, &size, width, height, 4, pixels.data(), level, threads);
+			});
+
+			char name[64];
+			std::snprintf(name, sizeof(name), "png::write_to_func level %u, %u threads", level, threads);
+			report(name, seconds, size);
+		}
+	}
+
+#if RESHADE_TEST_HAVE_STB
+	// This is what screenshots were saved with before
+	size_t stb_size = 0;
+	const double stb_seconds = reshade::bench::measure(repetitions, [&]() {
+		stb_size = 0;
+		stbi_write_png_to_func(count_bytes, &stb_size, width, height, 4, pixels.data(), 0);
+	});
+	report("stbi_write_png_to_func", stb_seconds, stb_size);
+#else
+	std::printf("stb_image_write.h was not found, so the comparison with 'stbi_write_png_to_func' is skipped\n");
+#endif
+}
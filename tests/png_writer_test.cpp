@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "png_writer.hpp"
+#include <zlib.h>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+
+static void append_to_vector(void *context, void *data, int size)
+{
+	std::vector<uint8_t> &out = *static_cast<std::vector<uint8_t> *>(context);
+	out.insert(out.end(), static_cast<uint8_t *>(data), static_cast<uint8_t *>(data) + size);
+}
+
+static uint32_t read_u32_be(const uint8_t *p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static uint8_t paeth_predictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+	return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Decode a PNG file written by 'write_to_func' (verifying chunk CRCs and the zlib stream with zlib itself) and return the unfiltered pixels
+static bool decode_png(const std::vector<uint8_t> &file, unsigned int width, unsigned int height, unsigned int channels, std::vector<uint8_t> &pixels)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0)
+		return false;
+
+	std::vector<uint8_t> zlib_stream;
+	bool has_header = false, has_end = false;
+	for (size_t offset = 8; offset + 12 <= file.size() && !has_end;)
+	{
+		const uint32_t length = read_u32_be(file.data() + offset);
+		if (offset + 12 + length > file.size())
+			return false;
+		const uint8_t *const type = file.data() + offset + 4;
+		const uint8_t *const data = type + 4;
+		if (read_u32_be(data + length) != static_cast<uint32_t>(crc32(0, type, length + 4)))
+			return false;
+
+		if (std::memcmp(type, "IHDR", 4) == 0)
+		{
+			const uint8_t color_types[4] = { 0, 4, 2, 6 };
+			has_header = length == 13 && read_u32_be(data) == width && read_u32_be(data + 4) == height && data[8] == 8 && data[9] == color_types[channels - 1];
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0)
+		{
+			zlib_stream.insert(zlib_stream.end(), data, data + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0)
+		{
+			has_end = true;
+		}
+
+		offset += 12 + length;
+	}
+	if (!has_header || !has_end)
+		return false;
+
+	const size_t row_size = static_cast<size_t>(width) * channels;
+	std::vector<uint8_t> filtered((row_size + 1) * height);
+	uLongf filtered_size = static_cast<uLongf>(filtered.size());
+	// This fails with Z_DATA_ERROR if the Adler-32 checksum at the end of the stream does not match
+	if (uncompress(filtered.data(), &filtered_size, zlib_stream.data(), static_cast<uLong>(zlib_stream.size())) != Z_OK || filtered_size != filtered.size())
+		return false;
+
+	pixels.assign(row_size * height, 0);
+	for (size_t y = 0; y < height; ++y)
+	{
+		const uint8_t type = filtered[y * (row_size + 1)];
+		const uint8_t *const in = filtered.data() + y * (row_size + 1) + 1;
+		uint8_t *const row = pixels.data() + y * row_size;
+		const uint8_t *const prev = y > 0 ? row - row_size : nullptr;
+
+		for (size_t i = 0; i < row_size; ++i)
+		{
+			const int a = i >= channels ? row[i - channels] : 0;
+			const int b = prev != nullptr ? prev[i] : 0;
+			const int c = i >= channels && prev != nullptr ? prev[i - channels] : 0;
+			switch (type)
+			{
+			case 0: row[i] = in[i]; break;
+			case 1: row[i] = static_cast<uint8_t>(in[i] + a); break;
+			case 2: row[i] = static_cast<uint8_t>(in[i] + b); break;
+			case 3: row[i] = static_cast<uint8_t>(in[i] + ((a + b) >> 1)); break;
+			case 4: row[i] = static_cast<uint8_t>(in[i] + paeth_predictor(a, b, c)); break;
+			default: return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// A mix of smooth gradients (so that the filters and matches matter) and noise
+static std::vector<uint8_t> make_image(unsigned int width, unsigned int height, unsigned int channels, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+	for (size_t y = 0; y < height; ++y)
+		for (size_t x = 0; x < width; ++x)
+			for (size_t c = 0; c < channels; ++c)
+				pixels[(y * width + x) * channels + c] = static_cast<uint8_t>((y & 64) ? rng() : x * (c + 1) + y);
+	return pixels;
+}
+
+static bool round_trip(unsigned int width, unsigned int height, unsigned int channels, unsigned int level, unsigned int max_threads)
+{
+	const std::vector<uint8_t> pixels = make_image(width, height, channels, width ^ height);
+
+	std::vector<uint8_t> file;
+	if (!reshade::png::write_to_func(append_to_vector, &file, width, height, channels, pixels.data(), level, max_threads))
+		return false;
+
+	std::vector<uint8_t> decoded;
+	return decode_png(file, width, height, channels, decoded) && decoded == pixels;
+}
+
+TEST_CASE(round_trip_small_images)
+{
+	for (unsigned int channels = 1; channels <= 4; ++channels)
+	{
+		for (const unsigned int level : { 0, 1, 6, 9 })
+		{
+			CHECK(round_trip(1, 1, channels, level, 0));
+			CHECK(round_trip(3, 17, channels, level, 4));
+			CHECK(round_trip(37, 33, channels, level, 2));
+			CHECK(round_trip(129, 100, channels, level, 7));
+		}
+	}
+}
+
+TEST_CASE(round_trip_stored_blocks_larger_than_64k)
+{
+	// Stored blocks are limited to 65535 bytes, so a strip needs to be split across multiple ones at level 0
+	CHECK(round_trip(300, 300, 4, 0, 1));
+	CHECK(round_trip(300, 300, 4, 0, 3));
+}
+
+TEST_CASE(round_trip_thread_counts_that_leave_empty_strips)
+{
+	// These used to compute more strips than there are rows to fill them (e.g. 48 strips of 23 rows each for 1080 rows), which read past the end of the image
+	CHECK(round_trip(1920, 1080, 4, 1, 48));
+	CHECK(round_trip(2560, 1440, 4, 1, 64));
+	CHECK(round_trip(64, 1080, 3, 6, 48));
+	CHECK(round_trip(64, 1440, 3, 6, 64));
+	for (unsigned int max_threads = 1; max_threads <= 70; ++max_threads)
+		CHECK(round_trip(16, 1000, 1, 1, max_threads));
+}
+
+TEST_CASE(invalid_arguments)
+{
+	std::vector<uint8_t> file;
+	const uint8_t pixel[4] = {};
+	CHECK(!reshade::png::write_to_func(append_to_vector, &file, 0, 1, 4, pixel));
+	CHECK(!reshade::png::write_to_func(append_to_vector, &file, 1, 0, 4, pixel));
+	CHECK(!reshade::png::write_to_func(append_to_vector, &file, 1, 1, 5, pixel));
+	CHECK(file.empty());
+}
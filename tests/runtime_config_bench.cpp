@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "runtime_config.hpp"
+#include <fstream>
+#include <unordered_map>
+
+std::filesystem::path g_reshade_config_path;
+
+namespace legacy
+{
+	// The INI parser before files were loaded into a single shared buffer, which allocated a string per line, key and item
+	// Reduced to loading and reading values, and without the locale, which is not available under that name on all platforms
+	class ini_file
+	{
+	public:
+		explicit ini_file(const std::filesystem::path &path)
+		{
+			std::ifstream file(path);
+
+			// Remove BOM (0xefbbbf means 0xfeff)
+			if (file.get() != 0xef || file.get() != 0xbb || file.get() != 0xbf)
+				file.seekg(0, std::ios::beg);
+
+			std::string line, section;
+			while (std::getline(file, line))
+			{
+				trim(line);
+
+				if (line.empty() || line[0] == ';' || line[0] == '/' || line[0] == '#')
+					continue;
+
+				// Read section name
+				if (line[0] == '[')
+				{
+					section = trim(line.substr(0, line.find(']')), " \t[]");
+					continue;
+				}
+
+				// Read section content
+				const auto assign_index = line.find('=');
+
+				if (assign_index != std::string::npos)
+				{
+					const auto key = trim(line.substr(0, assign_index));
+					const auto value = trim(line.substr(assign_index + 1));
+					std::vector<std::string> value_splitted;
+
+					for (size_t i = 0, len = value.size(), found; i < len; i = found + 1)
+					{
+						found = value.find_first_of(',', i);
+
+						if (found == std::string::npos)
+							found = len;
+
+						value_splitted.push_back(value.substr(i, found - i));
+					}
+
+					_sections[section][key] = value_splitted;
+				}
+				else
+				{
+					_sections[section][line] = {};
+				}
+			}
+		}
+
+		bool get(const std::string &section, const std::string &key, std::vector<float> &values) const
+		{
+			const auto it1 = _sections.find(section);
+			if (it1 == _sections.end())
+				return false;
+			const auto it2 = it1->second.find(key);
+			if (it2 == it1->second.end())
+				return false;
+			values.resize(it2->second.size());
+			for (size_t i = 0; i < it2->second.size(); ++i)
+				values[i] = static_cast<float>(std::strtod(it2->second[i].c_str(), nullptr));
+			return true;
+		}
+
+	private:
+		std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>> _sections;
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+
+	// Resembles a large preset: Many effect sections with a couple of uniform values each, most of them vectors
+	const size_t num_sections = quick ? 10 : 500;
+	const size_t keys_per_section = 20;
+	const unsigned int repetitions = quick ? 1 : 20;
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_runtime_config_bench.ini";
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << "PreprocessorDefinitions=\nTechniques=";
+		for (size_t s = 0; s < num_sections; ++s)
+			file << (s != 0 ? "," : "") << "Technique" << s << "@Effect" << s << ".fx";
+		file << "\n\n";
+
+		for (size_t s = 0; s < num_sections; ++s)
+		{
+			file << "[Effect" << s << ".fx]\n";
+			for (size_t k = 0; k < keys_per_section; ++k)
+			{
+				file << "Uniform" << k << '=';
+				for (size_t i = 0; i < 1 + (k % 4); ++i)
+					file << (i != 0 ? "," : "") << (s * 0.25 + k * 0.5 + i);
+				file << '\n';
+			}
+			file << '\n';
+		}
+	}
+
+	const std::vector<std::string> section_names = [&]() {
+		std::vector<std::string> names;
+		for (size_t s = 0; s < num_sections; ++s)
+			names.push_back("Effect" + std::to_string(s) + ".fx");
+		return names;
+	}();
+	const std::vector<std::string> key_names = [&]() {
+		std::vector<std::string> names;
+		for (size_t k = 0; k < keys_per_section; ++k)
+			names.push_back("Uniform" + std::to_string(k));
+		return names;
+	}();
+
+	std::printf("%zu keys, best of %u runs\n", num_sections * keys_per_section + 2, repetitions);
+
+	const auto run = [&](const char *name, auto &&load) {
+		const double parse_seconds = reshade::bench::measure(repetitions, [&]() {
+			const auto file = load();
+			reshade::bench::do_not_optimize(file);
+		});
+
+		std::vector<float> values;
+		size_t num_values = 0;
+		const double read_seconds = reshade::bench::measure(repetitions, [&]() {
+			const auto file = load();
+			num_values = 0;
+			for (const std::string &section : section_names)
+				for (const std::string &key : key_names)
+					if (file.get(section, key, values))
+						num_values += values.size();
+		});
+
+		std::printf("%-10s parse %8.3f ms, parse and read all values %8.3f ms (%zu values)\n", name, parse_seconds * 1e3, read_seconds * 1e3, num_values);
+	};
+
+	run("legacy", [&]() { return legacy::ini_file(path); });
+	run("ini_file", [&]() { return reshade::ini_file(path); });
+
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+}
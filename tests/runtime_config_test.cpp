@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "runtime_config.hpp"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+std::filesystem::path g_reshade_config_path;
+
+static std::filesystem::path temp_file(const char *name, const std::string &contents)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+	std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+	return path;
+}
+static std::string read_file(const std::filesystem::path &path)
+{
+	std::stringstream contents;
+	contents << std::ifstream(path, std::ios::binary).rdbuf();
+	return contents.str();
+}
+
+TEST_CASE(parse)
+{
+	const std::filesystem::path path = temp_file("reshade_test_parse.ini",
+		"\xef\xbb\xbf" "Global = 1\r\n"
+		"; Comment\n"
+		"# Comment\n"
+		"[ Section ]\n"
+		"  Items = 1.5, 2,3 \n"
+		"Text=hello world\n"
+		"Flag=true\n"
+		"KeyWithoutValue\n"
+		"[Empty]\n"
+		"[Section2]\n"
+		"items=4");
+
+	{
+		const reshade::ini_file file(path);
+
+		int global = 0;
+		CHECK(file.get("", "Global", global) && global == 1);
+
+		float items[3] = {};
+		CHECK(file.get("Section", "Items", items) && items[0] == 1.5f && items[1] == 2.0f && items[2] == 3.0f);
+		std::vector<std::string> item_strings;
+		CHECK(file.get("Section", "Items", item_strings) && item_strings.size() == 3 && item_strings[0] == "1.5" && item_strings[1] == " 2");
+
+		std::string text;
+		CHECK(file.get("Section", "Text", text) && text == "hello world");
+		bool flag = false;
+		CHECK(file.get("Section", "Flag", flag) && flag);
+		CHECK(file.has("Section", "KeyWithoutValue"));
+
+		// Lookups are case-sensitive
+		CHECK(!file.has("Section", "items"));
+		int items2 = 0;
+		CHECK(file.get("Section2", "items", items2) && items2 == 4);
+
+		CHECK(!file.has("Empty", ""));
+		CHECK(!file.has("Missing", "Items"));
+		std::vector<float> missing;
+		CHECK(!file.get("Section", "Missing", missing) && missing.empty());
+
+		// Copies reference the same file buffer, which has to stay alive after the original is gone
+		const auto copy = std::make_unique<reshade::ini_file>(file);
+		std::string copied_text;
+		CHECK(copy->get("Section", "Text", copied_text) && copied_text == "hello world");
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE(save_sorted)
+{
+	const std::filesystem::path path = temp_file("reshade_test_save.ini", "b=1\n[Beta]\nx=1\n");
+
+	{
+		reshade::ini_file file(path);
+		file.set("alpha", "Key", std::string("value"));
+		file.set("Beta", "a", 2);
+		const float values[2] = { 1.0f, 2.5f };
+		file.set("Beta", "C", values);
+		file.set("", "A", std::vector<std::string> { "x", "y" });
+		file.set("", "b", false);
+		// Destructor saves the file
+	}
+
+	// Sections and keys are sorted case-insensitively, with the global section first
+	CHECK(read_file(path) ==
+		"A=x,y\n"
+		"b=0\n"
+		"\n"
+		"[alpha]\n"
+		"Key=value\n"
+		"\n"
+		"[Beta]\n"
+		"a=2\n"
+		"C=1.000000,2.500000\n"
+		"x=1\n"
+		"\n");
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE(missing_file)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reshade_test_missing.ini";
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+
+	{
+		const reshade::ini_file file(path);
+		CHECK(!file.has("", "Key"));
+	}
+
+	// Nothing was modified, so no file should have been created
+	CHECK(!std::filesystem::exists(path));
+}
+
+TEST_CASE(flush_retries_failed_writes)
+{
+	const std::filesystem::path path = temp_file("reshade_test_flush.ini", "Key=0\n");
+	std::filesystem::path temp_path = path;
+	temp_path += ".tmp";
+
+	reshade::ini_file::load_cache(path).set("", "Key", 1);
+
+	// Files are only flushed a second after their last modification
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+	// Block writing the file by putting a directory where the temporary file would be created
+	std::filesystem::create_directory(temp_path);
+	CHECK(reshade::ini_file::flush_cache());
+	reshade::ini_file::stop_background_threads();
+	CHECK(read_file(path) == "Key=0\n");
+	std::filesystem::remove(temp_path);
+
+	// The failure is reported on the next flush, which marks the file modified again
+	CHECK(!reshade::ini_file::flush_cache());
+	reshade::ini_file::stop_background_threads();
+	CHECK(read_file(path) == "Key=0\n");
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+	CHECK(reshade::ini_file::flush_cache());
+	reshade::ini_file::stop_background_threads();
+	CHECK(read_file(path) == "Key=1\n\n");
+
+	std::filesystem::remove(path);
+}
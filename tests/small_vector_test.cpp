@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "small_vector.hpp"
+#include "allocation_counter.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+static long s_num_live_objects = 0;
+
+/// <summary>
+/// An element that keeps track of how many instances are alive and owns heap memory, so that leaks and use of destroyed elements show up.
+/// </summary>
+struct object
+{
+	object(int value = 0) : value(std::make_unique<int>(value)) { s_num_live_objects++; }
+	object(const object &other) : value(std::make_unique<int>(*other.value)) { s_num_live_objects++; }
+	object(object &&other) noexcept : value(std::move(other.value)) { s_num_live_objects++; }
+	~object() { s_num_live_objects--; }
+
+	object &operator=(const object &other) { value = std::make_unique<int>(*other.value); return *this; }
+	object &operator=(object &&other) noexcept { value = std::move(other.value); return *this; }
+
+	bool operator==(int other) const { return value != nullptr && *value == other; }
+	bool operator==(const object &other) const { return other.value != nullptr && *this == *other.value; }
+
+	std::unique_ptr<int> value;
+};
+
+template <typename T, size_t N>
+static bool equals(const small_vector<T, N> &lhs, std::initializer_list<int> rhs)
+{
+	return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+TEST_CASE(inline_until_full)
+{
+	small_vector<uint64_t, 4> v;
+	CHECK(v.empty() && v.is_inline() && v.capacity() == 4);
+
+	const size_t num_allocations_before = reshade::test::num_allocations;
+	for (uint64_t i = 0; i < 4; ++i)
+		v.push_back(i);
+	CHECK(v.is_inline());
+	CHECK(reshade::test::num_allocations == num_allocations_before);
+
+	// The fifth element does not fit anymore, which moves everything to the heap
+	v.push_back(4);
+	CHECK(!v.is_inline() && v.capacity() == 8);
+	CHECK(reshade::test::num_allocations == num_allocations_before + 1);
+	CHECK(equals(v, { 0, 1, 2, 3, 4 }));
+
+	// Shrinking moves the elements back once they fit inline again
+	v.pop_back();
+	v.shrink_to_fit();
+	CHECK(v.is_inline() && v.capacity() == 4);
+	CHECK(equals(v, { 0, 1, 2, 3 }));
+
+	v.clear();
+	CHECK(v.empty() && v.is_inline());
+}
+
+TEST_CASE(element_lifetime)
+{
+	{
+		small_vector<object, 2> v;
+		v.emplace_back(1);
+		v.emplace_back(2);
+		v.emplace_back(3);
+		v.resize(5, object(4));
+		CHECK(s_num_live_objects == 5);
+		CHECK(equals(v, { 1, 2, 3, 4, 4 }));
+
+		v.erase(v.begin() + 1, v.begin() + 3);
+		CHECK(s_num_live_objects == 3);
+		CHECK(equals(v, { 1, 4, 4 }));
+
+		v.resize(1);
+		CHECK(s_num_live_objects == 1);
+	}
+
+	CHECK(s_num_live_objects == 0);
+}
+
+TEST_CASE(insert_own_elements)
+{
+	// Adding an element of the vector to itself has to copy it before growing moves it away
+	small_vector<object, 2> v = { object(1), object(2) };
+	v.push_back(v[0]);
+	CHECK(!v.is_inline());
+	CHECK(equals(v, { 1, 2, 1 }));
+
+	v.insert(v.begin(), v.back());
+	CHECK(equals(v, { 1, 1, 2, 1 }));
+	v.emplace(v.begin() + 2, v[2]);
+	CHECK(equals(v, { 1, 1, 2, 2, 1 }));
+
+	v.resize(v.capacity() + 1, v[3]);
+	CHECK(v.size() == 9 && v.back() == 2);
+
+	small_vector<object, 4> w = { object(7) };
+	w.push_back(w.front());
+	w.insert(w.end(), w.front());
+	CHECK(w.is_inline());
+	CHECK(equals(w, { 7, 7, 7 }));
+}
+
+TEST_CASE(copy_move_and_swap)
+{
+	small_vector<object, 2> inline_vector = { object(1) };
+	small_vector<object, 2> heap_vector = { object(2), object(3), object(4) };
+	CHECK(inline_vector.is_inline() && !heap_vector.is_inline());
+
+	small_vector<object, 2> copy = heap_vector;
+	CHECK(equals(copy, { 2, 3, 4 }) && equals(heap_vector, { 2, 3, 4 }));
+	copy = inline_vector;
+	CHECK(equals(copy, { 1 }));
+
+	// Moving takes over heap memory as is, but has to move elements stored inline one by one
+	const object *const heap_data = heap_vector.data();
+	small_vector<object, 2> moved = std::move(heap_vector);
+	CHECK(moved.data() == heap_data && equals(moved, { 2, 3, 4 }));
+	CHECK(heap_vector.empty() && heap_vector.is_inline());
+
+	moved = std::move(inline_vector);
+	CHECK(moved.is_inline() && equals(moved, { 1 }));
+	CHECK(inline_vector.empty());
+
+	small_vector<object, 2> a = { object(5) };
+	small_vector<object, 2> b = { object(6), object(7), object(8) };
+	a.swap(b);
+	CHECK(equals(a, { 6, 7, 8 }) && equals(b, { 5 }));
+	CHECK(!a.is_inline() && b.is_inline());
+
+	const small_vector<object, 2> copy_of_a = a;
+	CHECK(a == copy_of_a && a != b);
+
+	bool thrown = false;
+	try { a.at(3); } catch (const std::out_of_range &) { thrown = true; }
+	CHECK(thrown);
+}
+
+TEST_CASE(same_as_std_vector)
+{
+	std::mt19937 rng(0);
+
+	for (int round = 0; round < 100; ++round)
+	{
+		small_vector<std::string, 4> v;
+		std::vector<std::string> reference;
+
+		for (int i = 0; i < 200; ++i)
+		{
+			// Strings that are long enough to not fit into the small string buffer, so that they are on the heap too
+			const std::string value = std::to_string(rng()) + " is a string that does not fit into the small string buffer";
+
+			switch (rng() % 8)
+			{
+			case 0:
+			case 1:
+				v.push_back(value);
+				reference.push_back(value);
+				break;
+			case 2:
+				if (!reference.empty())
+				{
+					const size_t index = rng() % reference.size();
+					v.push_back(v[index]);
+					reference.push_back(reference[index]);
+				}
+				break;
+			case 3:
+			{
+				const size_t index = rng() % (reference.size() + 1);
+				v.insert(v.begin() + index, value);
+				reference.insert(reference.begin() + index, value);
+				break;
+			}
+			case 4:
+				if (!reference.empty())
+				{
+					const size_t index = rng() % reference.size();
+					v.erase(v.begin() + index);
+					reference.erase(reference.begin() + index);
+				}
+				break;
+			case 5:
+			{
+				const size_t new_size = rng() % 12;
+				v.resize(new_size, value);
+				reference.resize(new_size, value);
+				break;
+			}
+			case 6:
+				v.shrink_to_fit();
+				break;
+			case 7:
+				v = small_vector<std::string, 4>(std::move(v));
+				break;
+			}
+
+			REQUIRE(std::equal(v.begin(), v.end(), reference.begin(), reference.end()));
+			REQUIRE(v.size() <= v.capacity() && v.capacity() >= 4);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+namespace reshade::test
+{
+	struct test_case
+	{
+		const char *name;
+		void(*func)();
+	};
+
+	inline std::vector<test_case> &registry()
+	{
+		static std::vector<test_case> s_tests;
+		return s_tests;
+	}
+	inline unsigned int &num_failures()
+	{
+		static unsigned int s_num_failures = 0;
+		return s_num_failures;
+	}
+
+	struct registrar
+	{
+		registrar(const char *name, void(*func)()) { registry().push_back({ name, func }); }
+	};
+}
+
+/// <summary>
+/// Define a test case that is run by the shared test main.
+/// </summary>
+#define TEST_CASE(name) \
+	static void test_##name(); \
+	static const reshade::test::registrar s_registrar_##name(#name, test_##name); \
+	static void test_##name()
+
+/// <summary>
+/// Record a failure (but continue running the current test case) if the expression evaluates to false.
+/// </summary>
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr); \
+			++reshade::test::num_failures(); \
+		} \
+	} while (0)
+
+/// <summary>
+/// Like <see cref="CHECK"/>, but return from the current test case on failure.
+/// </summary>
+#define REQUIRE(expr) \
+	do { \
+		if (!(expr)) { \
+			std::fprintf(stderr, "%s(%d): requirement failed: %s\n", __FILE__, __LINE__, #expr); \
+			++reshade::test::num_failures(); \
+			return; \
+		} \
+	} while (0)
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include <cstring>
+
+int main(int argc, char *argv[])
+{
+	unsigned int num_failed_tests = 0;
+
+	for (const reshade::test::test_case &test : reshade::test::registry())
+	{
+		// Optionally only run test cases whose name contains the first argument
+		if (argc > 1 && std::strstr(test.name, argv[1]) == nullptr)
+			continue;
+
+		const unsigned int failures_before = reshade::test::num_failures();
+		test.func();
+		const bool passed = reshade::test::num_failures() == failures_before;
+		num_failed_tests += passed ? 0 : 1;
+
+		std::printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.name);
+	}
+
+	return num_failed_tests == 0 ? 0 : 1;
+}
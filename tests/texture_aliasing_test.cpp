@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "runtime_objects.hpp"
+#include "texture_aliasing.hpp"
+
+using namespace reshade;
+
+static reshadefx::texture_info make_render_target(const char *name, uint32_t width = 256, uint32_t height = 256)
+{
+	reshadefx::texture_info info;
+	info.unique_name = name;
+	info.width = width;
+	info.height = height;
+	info.render_target = true;
+	return info;
+}
+
+static reshadefx::pass_info make_pass(std::vector<const char *> render_targets, std::vector<std::string> sampled = {}, bool clear = true)
+{
+	reshadefx::pass_info pass;
+	for (size_t i = 0; i < render_targets.size(); ++i)
+		pass.render_target_names[i] = render_targets[i];
+	pass.sampled_texture_names = std::move(sampled);
+	pass.clear_render_targets = clear;
+	return pass;
+}
+
+static std::vector<reshadefx::technique_info> make_techniques(std::vector<std::vector<reshadefx::pass_info>> passes)
+{
+	std::vector<reshadefx::technique_info> techniques(passes.size());
+	for (size_t i = 0; i < passes.size(); ++i)
+		techniques[i].passes = std::move(passes[i]);
+	return techniques;
+}
+
+TEST_CASE(transient_within_technique)
+{
+	const auto techniques = make_techniques({ {
+		make_pass({ "Other" }),
+		make_pass({ "Temp" }),
+		make_pass({ "Other" }, { "Temp" }),
+		make_pass({ "Other" }) } });
+
+	texture_lifetime lifetime;
+	REQUIRE(find_transient_lifetime(techniques, make_render_target("Temp"), lifetime));
+	CHECK(lifetime.technique == 0);
+	CHECK(lifetime.first_pass == 1);
+	CHECK(lifetime.last_pass == 2);
+	CHECK(lifetime.memory_size == 256 * 256 * 4);
+
+	// A texture no pass accesses is not transient, since it is not written at all
+	CHECK(!find_transient_lifetime(techniques, make_render_target("Unused"), lifetime));
+}
+
+TEST_CASE(read_before_write_across_frames)
+{
+	texture_lifetime lifetime;
+
+	// Sampling the texture before it is written reads what was written during the previous frame
+	CHECK(!find_transient_lifetime(make_techniques({ {
+		make_pass({ "Other" }, { "History" }),
+		make_pass({ "History" }) } }), make_render_target("History"), lifetime));
+
+	// Same when the read happens in an earlier technique
+	CHECK(!find_transient_lifetime(make_techniques({
+		{ make_pass({ "Other" }, { "History" }) },
+		{ make_pass({ "History" }) } }), make_render_target("History"), lifetime));
+
+	// Written in one technique and read in the next has to survive between them (which may also be toggled independently)
+	CHECK(!find_transient_lifetime(make_techniques({
+		{ make_pass({ "Temp" }) },
+		{ make_pass({ "Other" }, { "Temp" }) } }), make_render_target("Temp"), lifetime));
+
+	// Without a clear, pixels the first pass does not cover keep the contents of the previous frame
+	CHECK(!find_transient_lifetime(make_techniques({ {
+		make_pass({ "Temp" }, {}, false),
+		make_pass({ "Other" }, { "Temp" }) } }), make_render_target("Temp"), lifetime));
+
+	// Blending or masking channels in the first pass combines with the previous contents too
+	reshadefx::pass_info blend_pass = make_pass({ "Temp" });
+	blend_pass.blend_enable = true;
+	CHECK(!find_transient_lifetime(make_techniques({ { blend_pass } }), make_render_target("Temp"), lifetime));
+	reshadefx::pass_info masked_pass = make_pass({ "Temp" });
+	masked_pass.color_write_mask = 0x7;
+	CHECK(!find_transient_lifetime(make_techniques({ { masked_pass } }), make_render_target("Temp"), lifetime));
+	reshadefx::pass_info stencil_pass = make_pass({ "Temp" });
+	stencil_pass.stencil_enable = true;
+	CHECK(!find_transient_lifetime(make_techniques({ { stencil_pass } }), make_render_target("Temp"), lifetime));
+}
+
+TEST_CASE(sample_and_write_in_same_pass)
+{
+	texture_lifetime lifetime;
+
+	// The first pass samples what it writes, so it depends on the contents of the previous frame
+	CHECK(!find_transient_lifetime(make_techniques({ {
+		make_pass({ "Temp" }, { "Temp" }) } }), make_render_target("Temp"), lifetime));
+
+	// In a later pass that is fine, since the contents were produced earlier in the same technique
+	REQUIRE(find_transient_lifetime(make_techniques({ {
+		make_pass({ "Temp" }),
+		make_pass({ "Temp" }, { "Temp" }),
+		make_pass({ "Other" }) } }), make_render_target("Temp"), lifetime));
+	CHECK(lifetime.first_pass == 0);
+	CHECK(lifetime.last_pass == 1);
+}
+
+TEST_CASE(storage_writes)
+{
+	texture_lifetime lifetime;
+
+	// Compute shaders may write any subset of texels, so textures with storage access are never transient
+	reshadefx::texture_info storage_texture = make_render_target("Temp");
+	storage_texture.storage_access = true;
+	CHECK(!find_transient_lifetime(make_techniques({ {
+		make_pass({ "Temp" }),
+		make_pass({ "Other" }, { "Temp" }) } }), storage_texture, lifetime));
+
+	// A storage access as the first access is a read-modify-write too
+	reshadefx::pass_info compute_pass;
+	compute_pass.cs_entry_point = "main";
+	compute_pass.storage_texture_names = { "Temp" };
+	CHECK(!find_transient_lifetime(make_techniques({ {
+		compute_pass,
+		make_pass({ "Temp" }) } }), make_render_target("Temp"), lifetime));
+
+	// Storage accesses after the texture was cleared extend the lifetime
+	REQUIRE(find_transient_lifetime(make_techniques({ {
+		make_pass({ "Temp" }),
+		make_pass({ "Other" }),
+		compute_pass } }), make_render_target("Temp"), lifetime));
+	CHECK(lifetime.last_pass == 2);
+
+	// Textures that are not render targets or reference external data are not candidates either
+	reshadefx::texture_info not_render_target = make_render_target("Temp");
+	not_render_target.render_target = false;
+	CHECK(!find_transient_lifetime(make_techniques({ { make_pass({ "Temp" }) } }), not_render_target, lifetime));
+	reshadefx::texture_info with_semantic = make_render_target("Temp");
+	with_semantic.semantic = "COLOR";
+	CHECK(!find_transient_lifetime(make_techniques({ { make_pass({ "Temp" }) } }), with_semantic, lifetime));
+}
+
+TEST_CASE(shared_textures)
+{
+	texture tex = make_render_target("Temp");
+	CHECK(is_alias_candidate(tex));
+
+	// Another effect declaring a texture with the same name accesses the same memory, but its passes are not checked, so it may read before this one writes
+	texture shared = tex;
+	shared.shared = true;
+	CHECK(!is_alias_candidate(shared));
+
+	texture back_buffer = tex;
+	back_buffer.impl_reference = texture_reference::back_buffer;
+	CHECK(!is_alias_candidate(back_buffer));
+
+	reshadefx::annotation annotation;
+	annotation.type.base = reshadefx::type::t_int;
+	annotation.name = "pooled";
+	annotation.value.as_int[0] = 1;
+	texture pooled = tex;
+	pooled.annotations.push_back(annotation);
+	CHECK(!is_alias_candidate(pooled));
+
+	annotation.type.base = reshadefx::type::t_string;
+	annotation.name = "source";
+	annotation.value.string_data = "image.png";
+	texture from_file = tex;
+	from_file.annotations.push_back(annotation);
+	CHECK(!is_alias_candidate(from_file));
+}
+
+TEST_CASE(assign_aliases)
+{
+	const auto make_lifetime = [](size_t technique, size_t first_pass, size_t last_pass, uint64_t description = 1) {
+		texture_lifetime lifetime;
+		lifetime.technique = technique;
+		lifetime.first_pass = first_pass;
+		lifetime.last_pass = last_pass;
+		lifetime.description = description;
+		return lifetime;
+	};
+
+	const std::vector<size_t> aliases = assign_texture_aliases({
+		make_lifetime(0, 0, 1),
+		make_lifetime(0, 1, 2), // Overlaps with the first one in pass 1
+		make_lifetime(0, 2, 3), // Can reuse the first one
+		make_lifetime(0, 3, 3, 2), // Different description
+		make_lifetime(1, 0, 5), // Different technique, so can reuse the first one again
+	});
+
+	REQUIRE(aliases.size() == 5);
+	CHECK(aliases[0] == 0);
+	CHECK(aliases[1] == 1);
+	CHECK(aliases[2] == 0);
+	CHECK(aliases[3] == 3);
+	CHECK(aliases[4] == 0);
+}
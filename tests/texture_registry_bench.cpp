@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "bench.hpp"
+#include "runtime_objects.hpp"
+#include "texture_registry.hpp"
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+using namespace reshade;
+
+// Only the part of 'runtime::load_effect' that registers the textures of an effect in the global texture list, since the rest needs a graphics device
+struct texture_list
+{
+	std::mutex mutex;
+	std::vector<texture> textures;
+	texture_registry registry;
+	size_t num_shared = 0;
+};
+
+// Texture registration before the lookup tables, which searched the entire list for every texture (and locked separately for each search)
+static void register_textures_legacy(texture_list &list, const std::vector<texture> &effect_textures, size_t index)
+{
+	std::vector<texture> new_textures;
+	new_textures.reserve(effect_textures.size());
+
+	for (texture texture : effect_textures)
+	{
+		texture.effect_index = index;
+
+		{	const std::lock_guard<std::mutex> lock(list.mutex);
+
+			if (const auto existing_texture = std::find_if(list.textures.begin(), list.textures.end(),
+				[&texture](const auto &item) { return item.unique_name == texture.unique_name; });
+				existing_texture != list.textures.end())
+			{
+				existing_texture->shared = true;
+				list.num_shared++;
+				continue;
+			}
+		}
+
+		if (texture.annotation_as_int("pooled"))
+		{
+			const std::lock_guard<std::mutex> lock(list.mutex);
+
+			if (const auto existing_texture = std::find_if(list.textures.begin(), list.textures.end(),
+				[&texture](const auto &item) { return item.annotation_as_int("pooled") && item.matches_description(texture); });
+				existing_texture != list.textures.end())
+			{
+				existing_texture->shared = true;
+				list.num_shared++;
+				continue;
+			}
+		}
+
+		new_textures.push_back(std::move(texture));
+	}
+
+	const std::lock_guard<std::mutex> lock(list.mutex);
+	std::move(new_textures.begin(), new_textures.end(), std::back_inserter(list.textures));
+}
+
+// Texture registration as done by 'runtime::load_effect' now
+static void register_textures(texture_list &list, const std::vector<texture> &effect_textures, size_t index)
+{
+	const std::lock_guard<std::mutex> lock(list.mutex);
+
+	for (texture texture : effect_textures)
+	{
+		texture.effect_index = index;
+
+		if (size_t existing_index; list.registry.find_by_name(texture.unique_name, existing_index))
+		{
+			list.textures[existing_index].shared = true;
+			list.num_shared++;
+			continue;
+		}
+
+		if (texture.annotation_as_int("pooled"))
+		{
+			if (size_t existing_index; list.registry.find_pooled(list.textures, texture, index, existing_index))
+			{
+				list.textures[existing_index].shared = true;
+				list.num_shared++;
+				continue;
+			}
+		}
+
+		list.registry.add(texture, list.textures.size());
+		list.textures.push_back(std::move(texture));
+	}
+}
+
+static std::vector<std::vector<texture>> make_effects(size_t num_effects, size_t textures_per_effect)
+{
+	reshadefx::annotation pooled;
+	pooled.type.base = reshadefx::type::t_int;
+	pooled.name = "pooled";
+	pooled.value.as_int[0] = 1;
+
+	std::vector<std::vector<texture>> effects(num_effects);
+	for (size_t e = 0; e < num_effects; ++e)
+	{
+		for (size_t t = 0; t < textures_per_effect; ++t)
+		{
+			texture tex;
+			tex.width = 1920 >> (t % 4);
+			tex.height = 1080 >> (t % 4);
+
+			// A quarter of textures is shared by name with other effects (like the back buffer), a quarter is pooled, and the rest is unique to the effect
+			switch (t % 4)
+			{
+			case 0:
+				tex.unique_name = "Shared" + std::to_string(t);
+				break;
+			case 1:
+				tex.unique_name = "Effect" + std::to_string(e) + "Pooled" + std::to_string(t);
+				tex.annotations.push_back(pooled);
+				break;
+			default:
+				tex.unique_name = "Effect" + std::to_string(e) + "Texture" + std::to_string(t);
+				break;
+			}
+
+			effects[e].push_back(std::move(tex));
+		}
+	}
+	return effects;
+}
+
+int main(int argc, char *argv[])
+{
+	const bool quick = reshade::bench::is_quick_run(argc, argv);
+
+	const size_t num_effects = quick ? 20 : 400;
+	const size_t textures_per_effect = 32;
+	const unsigned int repetitions = quick ? 1 : 5;
+	const std::vector<std::vector<texture>> effects = make_effects(num_effects, textures_per_effect);
+
+	std::printf("%zu effects with %zu textures each, best of %u runs\n", num_effects, textures_per_effect, repetitions);
+
+	const auto run = [&](const char *name, unsigned int num_threads, auto register_func) {
+		size_t num_textures = 0, num_shared = 0;
+
+		const double seconds = reshade::bench::measure(repetitions, [&]() {
+			texture_list list;
+			std::atomic<size_t> next_effect = 0;
+
+			// Effects are loaded in parallel by a couple of threads, each picking the next effect that was not loaded yet
+			const auto load_effects = [&]() {
+				for (size_t index; (index = next_effect.fetch_add(1)) < effects.size();)
+					register_func(list, effects[index], index);
+			};
+
+			std::vector<std::thread> threads;
+			for (unsigned int i = 1; i < num_threads; ++i)
+				threads.emplace_back(load_effects);
+			load_effects();
+			for (std::thread &thread : threads)
+				thread.join();
+
+			num_textures = list.textures.size();
+			num_shared = list.num_shared;
+		});
+
+		std::printf("%-8s %2u threads %9.3f ms %10.0f effects/s (%zu textures, %zu shared)\n", name, num_threads, seconds * 1e3, effects.size() / seconds, num_textures, num_shared);
+	};
+
+	for (const unsigned int num_threads : { 1, 4, 8 })
+	{
+		run("legacy", num_threads, register_textures_legacy);
+		run("registry", num_threads, register_textures);
+	}
+}
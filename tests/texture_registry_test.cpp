@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "runtime_objects.hpp"
+#include "texture_registry.hpp"
+
+using namespace reshade;
+
+static texture make_texture(const char *name, size_t effect_index, uint32_t width, bool pooled)
+{
+	texture tex;
+	tex.unique_name = name;
+	tex.effect_index = effect_index;
+	tex.width = width;
+	tex.height = 16;
+	if (pooled)
+	{
+		reshadefx::annotation annotation;
+		annotation.type.base = reshadefx::type::t_int;
+		annotation.name = "pooled";
+		annotation.value.as_int[0] = 1;
+		tex.annotations.push_back(annotation);
+	}
+	return tex;
+}
+
+TEST_CASE(find_by_name)
+{
+	std::vector<texture> textures = { make_texture("A", 0, 16, false), make_texture("B", 0, 16, true) };
+	texture_registry registry;
+	registry.rebuild(textures);
+
+	size_t index = 42;
+	CHECK(registry.find_by_name("A", index) && index == 0);
+	CHECK(registry.find_by_name("B", index) && index == 1);
+	CHECK(!registry.find_by_name("C", index) && index == 1);
+
+	registry.clear();
+	CHECK(!registry.find_by_name("A", index));
+}
+
+TEST_CASE(find_pooled)
+{
+	std::vector<texture> textures;
+	texture_registry registry;
+	const auto add = [&](texture &&tex) {
+		registry.add(tex, textures.size());
+		textures.push_back(std::move(tex));
+	};
+
+	add(make_texture("NotPooled", 0, 32, false));
+	add(make_texture("Pooled0", 0, 32, true));
+
+	size_t index = 0;
+	// Textures of the same effect are in use at the same time, so cannot share memory
+	CHECK(!registry.find_pooled(textures, make_texture("Other", 0, 32, true), 0, index));
+	// Only pooled textures are candidates, and only those with a matching description
+	CHECK(registry.find_pooled(textures, make_texture("Other", 1, 32, true), 1, index) && index == 1);
+	CHECK(!registry.find_pooled(textures, make_texture("Other", 1, 64, true), 1, index));
+
+	texture different_format = make_texture("Other", 1, 32, true);
+	different_format.format = reshadefx::texture_format::rgba16f;
+	CHECK(!registry.find_pooled(textures, different_format, 1, index));
+
+	add(make_texture("Pooled1", 1, 32, true));
+	CHECK(registry.find_pooled(textures, make_texture("Other", 0, 32, true), 0, index) && index == 2);
+	CHECK(registry.find_pooled(textures, make_texture("Other", 2, 32, true), 2, index) && (index == 1 || index == 2));
+}
+
+TEST_CASE(rebuild_after_erase)
+{
+	std::vector<texture> textures = { make_texture("A", 0, 16, true), make_texture("B", 1, 16, true), make_texture("C", 2, 16, false) };
+	texture_registry registry;
+	registry.rebuild(textures);
+
+	// Unloading an effect erases its textures, which shifts the indices of all that follow
+	textures.erase(textures.begin());
+	registry.rebuild(textures);
+
+	size_t index = 0;
+	CHECK(!registry.find_by_name("A", index));
+	CHECK(registry.find_by_name("B", index) && index == 0);
+	CHECK(registry.find_by_name("C", index) && index == 1);
+	CHECK(registry.find_pooled(textures, make_texture("D", 0, 16, true), 0, index) && index == 0);
+	CHECK(!registry.find_pooled(textures, make_texture("D", 1, 16, true), 1, index));
+}
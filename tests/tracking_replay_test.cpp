@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "test.hpp"
+#include "small_vector.hpp"
+#include "lockfree_table.hpp"
+#include "buffer_detection_core.hpp"
+#include "allocation_counter.hpp"
+#include <map>
+#include <vector>
+
+// Replays the work the Vulkan hooks do for an application that recreates its framebuffers and records all its command buffers every frame, with fake handles instead of a device
+// This compares the heap allocations made per frame by the data structures the hooks use against the ones they used before (std::vector for per-handle data and std::map for the depth-stencil counters)
+
+struct render_pass_data
+{
+	uint32_t depthstencil_attachment_index = std::numeric_limits<uint32_t>::max();
+};
+
+/// <summary>
+/// Depth-stencil tracking like "reshade::vulkan::buffer_detection", but on fake handles.
+/// </summary>
+class current_buffer_detection : public reshade::buffer_detection_core<uint64_t>
+{
+public:
+	void reset() { reset_core(); }
+	void merge(const current_buffer_detection &source) { merge_core(source); }
+
+	void on_draw(uint32_t vertices)
+	{
+		count_draw(vertices);
+		count_draw_current(vertices);
+	}
+	void on_set_depthstencil(uint64_t depthstencil)
+	{
+		set_current_depthstencil(depthstencil);
+		if (depthstencil != 0)
+			_counters_per_used_depthstencil[depthstencil];
+	}
+
+	uint64_t find_best_depth_texture()
+	{
+		const auto best = select_best(0, 0, reshade::depthstencil_selection::weighted_vertices,
+			[](uint64_t, const depthstencil_info &, reshade::depthstencil_desc &desc) { desc = { 1920, 1080, 1 }; return true; });
+		return best != nullptr ? best->first : 0;
+	}
+};
+
+/// <summary>
+/// Depth-stencil tracking as it was done before, with a node-based map per command buffer.
+/// </summary>
+class legacy_buffer_detection
+{
+public:
+	void reset() { _stats = {}; _counters_per_used_depth_image.clear(); }
+	void merge(const legacy_buffer_detection &source)
+	{
+		_stats.vertices += source._stats.vertices;
+		_stats.drawcalls += source._stats.drawcalls;
+		for (const auto &[depthstencil, snapshot] : source._counters_per_used_depth_image)
+		{
+			auto &target_snapshot = _counters_per_used_depth_image[depthstencil];
+			target_snapshot.vertices += snapshot.vertices;
+			target_snapshot.drawcalls += snapshot.drawcalls;
+		}
+	}
+
+	void on_draw(uint32_t vertices)
+	{
+		_stats.vertices += vertices;
+		_stats.drawcalls += 1;
+		if (_current_depthstencil == 0)
+			return;
+		auto &counters = _counters_per_used_depth_image[_current_depthstencil];
+		counters.vertices += vertices;
+		counters.drawcalls += 1;
+	}
+	void on_set_depthstencil(uint64_t depthstencil)
+	{
+		_current_depthstencil = depthstencil;
+		if (depthstencil != 0)
+			_counters_per_used_depth_image[depthstencil];
+	}
+
+	uint64_t find_best_depth_texture()
+	{
+		uint64_t best = 0;
+		uint32_t best_vertices = 0;
+		for (const auto &[depthstencil, snapshot] : _counters_per_used_depth_image)
+			if (snapshot.vertices > best_vertices)
+				best = depthstencil, best_vertices = snapshot.vertices;
+		return best;
+	}
+
+private:
+	reshade::draw_stats _stats;
+	uint64_t _current_depthstencil = 0;
+	std::map<uint64_t, reshade::draw_stats> _counters_per_used_depth_image;
+};
+
+template <typename TAttachments, typename TSubpasses, typename TBufferDetection>
+class replay
+{
+public:
+	static constexpr uint64_t num_framebuffers = 16;
+	static constexpr uint64_t num_command_buffers = 32;
+	static constexpr uint64_t num_depthstencils = 3;
+
+	replay()
+	{
+		// One render pass that only has color attachments and one with a depth-stencil (vkCreateRenderPass)
+		TSubpasses &color_pass = _renderpass_data.emplace(color_renderpass);
+		color_pass.resize(2);
+		TSubpasses &depth_pass = _renderpass_data.emplace(depth_renderpass);
+		depth_pass.resize(2);
+		depth_pass[0].depthstencil_attachment_index = 1;
+		depth_pass[1].depthstencil_attachment_index = 2;
+
+		for (uint64_t i = 0; i < num_command_buffers; ++i)
+			_command_buffer_data.emplace(command_buffer_handle(i));
+	}
+
+	/// <summary>
+	/// Replays a frame and returns the depth-stencil the detection chose.
+	/// </summary>
+	uint64_t run_frame()
+	{
+		// Recreate the framebuffers, like applications do e.g. when they use a new set of transient images every frame (vkDestroyFramebuffer and vkCreateFramebuffer)
+		for (uint64_t i = 0; i < num_framebuffers; ++i)
+		{
+			if (_frame != 0)
+				_framebuffer_data.erase(framebuffer_handle(_frame - 1, i));
+
+			const TSubpasses &subpasses = _renderpass_data.at(i % 2 ? depth_renderpass : color_renderpass);
+			TAttachments attachment_images(3);
+			for (const render_pass_data &subpass : subpasses)
+				if (subpass.depthstencil_attachment_index < attachment_images.size())
+					attachment_images[subpass.depthstencil_attachment_index] = depthstencil_handle((i + subpass.depthstencil_attachment_index) % num_depthstencils);
+			_framebuffer_data.emplace(framebuffer_handle(_frame, i), std::move(attachment_images));
+		}
+
+		// Record every command buffer (vkBeginCommandBuffer, vkCmdBeginRenderPass, vkCmdNextSubpass, vkCmdDraw and vkCmdEndRenderPass)
+		for (uint64_t i = 0; i < num_command_buffers; ++i)
+		{
+			TBufferDetection &buffer_detection = _command_buffer_data.at(command_buffer_handle(i));
+			buffer_detection.reset();
+
+			for (uint64_t pass = 0; pass < 2; ++pass)
+			{
+				const uint64_t framebuffer_index = (i * 2 + pass) % num_framebuffers;
+				const TSubpasses &subpasses = _renderpass_data.at(framebuffer_index % 2 ? depth_renderpass : color_renderpass);
+				const TAttachments &attachment_images = _framebuffer_data.at(framebuffer_handle(_frame, framebuffer_index));
+
+				for (const render_pass_data &subpass : subpasses)
+				{
+					buffer_detection.on_set_depthstencil(subpass.depthstencil_attachment_index < attachment_images.size() ? attachment_images[subpass.depthstencil_attachment_index] : 0);
+
+					for (uint32_t draw = 0; draw < 10; ++draw)
+						buffer_detection.on_draw(300 * (draw + 1));
+				}
+
+				buffer_detection.on_set_depthstencil(0);
+			}
+		}
+
+		// Submit them all (vkQueueSubmit) and find the depth-stencil at the end of the frame (vkQueuePresentKHR)
+		for (uint64_t i = 0; i < num_command_buffers; ++i)
+			_device_buffer_detection.merge(_command_buffer_data.at(command_buffer_handle(i)));
+
+		const uint64_t best = _device_buffer_detection.find_best_depth_texture();
+		_device_buffer_detection.reset();
+
+		_frame++;
+		return best;
+	}
+
+private:
+	static constexpr uint64_t color_renderpass = 0x1000;
+	static constexpr uint64_t depth_renderpass = 0x2000;
+
+	static uint64_t depthstencil_handle(uint64_t index) { return 0x10000 + index * 0x100; }
+	static uint64_t framebuffer_handle(uint64_t frame, uint64_t index) { return 0x100000 + (frame * num_framebuffers + index) * 0x40; }
+	static uint64_t command_buffer_handle(uint64_t index) { return 0x80000000 + index * 0x40; }
+
+	uint64_t _frame = 0;
+	lockfree_table<uint64_t, TAttachments, 4096> _framebuffer_data;
+	lockfree_table<uint64_t, TSubpasses, 4096> _renderpass_data;
+	lockfree_table<uint64_t, TBufferDetection, 4096> _command_buffer_data;
+	TBufferDetection _device_buffer_detection;
+};
+
+/// <summary>
+/// Replays a number of frames to warm up and then returns the average number of heap allocations of the frames after.
+/// </summary>
+template <typename TReplay>
+static double count_allocations_per_frame(uint64_t &best)
+{
+	TReplay *const replay = new TReplay();
+
+	for (int frame = 0; frame < 10; ++frame)
+		replay->run_frame();
+
+	const size_t num_allocations_before = reshade::test::num_allocations;
+	for (int frame = 0; frame < 100; ++frame)
+		best = replay->run_frame();
+	const size_t num_allocations = reshade::test::num_allocations - num_allocations_before;
+
+	delete replay;
+
+	return num_allocations / 100.0;
+}
+
+TEST_CASE(no_allocations_per_frame)
+{
+	uint64_t legacy_best = 0;
+	const double legacy_allocations = count_allocations_per_frame<replay<std::vector<uint64_t>, std::vector<render_pass_data>, legacy_buffer_detection>>(legacy_best);
+	uint64_t current_best = 0;
+	const double current_allocations = count_allocations_per_frame<replay<small_vector<uint64_t, 8>, small_vector<render_pass_data, 4>, current_buffer_detection>>(current_best);
+
+	std::printf("heap allocations per frame: %.1f before, %.1f now\n", legacy_allocations, current_allocations);
+
+	CHECK(legacy_allocations > 0);
+	CHECK(current_allocations == 0);
+
+	// Both pick the same depth-stencil, so the replay exercises the tracking that matters
+	CHECK(legacy_best != 0 && current_best == legacy_best);
+}